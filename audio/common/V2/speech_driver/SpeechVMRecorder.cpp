@@ -47,7 +47,8 @@ static const char VM_RECORD_WAKELOCK_NAME[] = "VM_RECORD_WAKELOCK";
 
 static const uint32_t kCondWaitTimeoutMsec = 100; // 100 ms (modem local buf: 10k, and EPL has 2304 byte for each frame (20 ms))
 
-static const uint32_t kReadBufferSize = 0x4000;   // 16 k
+static const uint32_t kReadBufferSize = 0x20000;  // 128 k, about 1 sec of EPL for a slow sd card
+static const uint32_t kWriteBatchSize = 0x2000;   // 8 k, wake up the dump thread per batch instead of per frame
 
 
 /*==============================================================================
@@ -127,9 +128,10 @@ SpeechVMRecorder::SpeechVMRecorder()
 {
     mStarting = false;
     mEnable = false;
+    mRecordThreadCreated = false;
 
     mDumpFile = NULL;
-    memset((void *)&mRingBuf, 0, sizeof(RingBuf));
+    mDropBytes = 0;
 
     AUDIO_CUSTOM_PARAM_STRUCT eSphParamNB;
     GetNBSpeechParamFromNVRam(&eSphParamNB);
@@ -149,20 +151,39 @@ SpeechVMRecorder::~SpeechVMRecorder()
 
 status_t SpeechVMRecorder::Open()
 {
+    // a dump thread which failed to start has not been joined by Close()
+    JoinRecordThread();
+
     mMutex.lock();
 
     ALOGD("+%s()", __FUNCTION__);
 
     ASSERT(mEnable == false);
 
+    // kept after Close(), the CCCI read thread may still be in CopyBufferToVM()
+    if (mRingBuf.getBufferSize() == 0)
+    {
+        status_t retval = mRingBuf.init(kReadBufferSize);
+        ASSERT(retval == NO_ERROR);
+    }
+
     int ret = acquire_wake_lock(PARTIAL_WAKE_LOCK, VM_RECORD_WAKELOCK_NAME);
     ALOGD("%s(), acquire_wake_lock: %s, return %d.", __FUNCTION__, VM_RECORD_WAKELOCK_NAME, ret);
 
+    // set before the thread starts, it exits as soon as it sees mEnable == false
+    mEnable = true;
+
     // create another thread to avoid fwrite() block CCCI read thread
-    pthread_create(&mRecordThread, NULL, DumpVMRecordDataThread, (void *)this);
+    ret = pthread_create(&mRecordThread, NULL, DumpVMRecordDataThread, (void *)this);
+    if (ret != 0)
+    {
+        ALOGE("%s(), pthread_create fail, ret = %d", __FUNCTION__, ret);
+        release_wake_lock(VM_RECORD_WAKELOCK_NAME);
+        mEnable = false;
+    }
+    mRecordThreadCreated = (ret == 0);
 
     mMutex.unlock();
-    mEnable = true;
 
     ALOGD("-%s(), mEnable=%d ", __FUNCTION__, mEnable );
     return NO_ERROR;
@@ -213,48 +234,59 @@ status_t SpeechVMRecorder::OpenFile()
 
 uint16_t SpeechVMRecorder::CopyBufferToVM(RingBuf ul_ring_buf)
 {
-    mMutex.lock();
-
+    // CCCI read thread: never take mMutex here, the dump thread may be blocked in fwrite()
     if (mStarting == false)
     {
         ALOGD("%s(), mStarting == false, return.", __FUNCTION__);
         mExitCond.signal(); // wake up thread to exit
-        mMutex.unlock();
         return 0;
     }
 
-    // get free space of internal input buffer
-    uint16_t free_space = RingBuf_getFreeSpace(&mRingBuf);
-    SLOGV("%s(), mRingBuf remain data count: %u, free_space: %u", __FUNCTION__, RingBuf_getDataCount(&mRingBuf), free_space);
-
     // get data count in share buffer
-    uint16_t ul_data_count = RingBuf_getDataCount(&ul_ring_buf);
-    SLOGV("%s(), ul_ring_buf data count: %u", __FUNCTION__, ul_data_count);
+    const uint32_t ul_data_count = RingBuf_getDataCount(&ul_ring_buf);
+    SLOGV("%s(), ul_ring_buf data count: %u, mRingBuf data count: %u", __FUNCTION__, ul_data_count, mRingBuf.getDataCount());
 
-    // check free space for internal input buffer
-    uint16_t copy_data_count = 0;
-    if (ul_data_count <= free_space)
+    // copy data from modem share buffer to internal input buffer
+    const uint32_t copy_data_count = mRingBuf.writeFromRingBuf(&ul_ring_buf, ul_data_count);
+    if (copy_data_count != ul_data_count)
     {
-        copy_data_count = ul_data_count;
+        android_atomic_add((int32_t)(ul_data_count - copy_data_count), &mDropBytes);
+        ALOGE("%s(), ul_data_count(%u) > free_space(%u)", __FUNCTION__, ul_data_count, copy_data_count);
     }
-    else
+
+    // signal per batch, the dump thread also wakes up every kCondWaitTimeoutMsec
+    if (mRingBuf.getDataCount() >= kWriteBatchSize)
     {
-        ALOGE("%s(), ul_data_count(%u) > free_space(%u)", __FUNCTION__, ul_data_count, free_space);
-        copy_data_count = free_space;
+        mExitCond.signal(); // wake up thread to fwrite data.
     }
 
-    // copy data from modem share buffer to internal input buffer
-    if (copy_data_count > 0)
+    return copy_data_count;
+}
+
+static uint32_t WriteVMRecordData(AudioSPSCRingBuf *ring_buf, FILE *file)
+{
+    AudioRingBufView view;
+    const uint32_t data_count = ring_buf->getReadView(&view);
+    if (data_count == 0)
     {
-        SLOGV("%s(), copy_data_count: %u", __FUNCTION__, copy_data_count);
-        RingBuf_copyFromRingBuf(&mRingBuf, &ul_ring_buf, copy_data_count);
+        return 0;
     }
 
-    // signal
-    mExitCond.signal(); // wake up thread to fwrite data.
-    mMutex.unlock();
+    uint32_t write_bytes = fwrite(view.pSeg[0], sizeof(char), view.segLen[0], file);
+    if (write_bytes == view.segLen[0] && view.segLen[1] > 0)
+    {
+        write_bytes += fwrite(view.pSeg[1], sizeof(char), view.segLen[1], file);
+    }
 
-    return copy_data_count;
+    // drop what could not be written, or the ring stays full and the modem data is lost anyway
+    ring_buf->commitRead(data_count);
+
+    SLOGV("data_count: %u, write_bytes: %u", data_count, write_bytes);
+    if (write_bytes != data_count)
+    {
+        ALOGE("%s(), write_bytes(%u) != data_count(%u), SD Card might be full!!", __FUNCTION__, write_bytes, data_count);
+    }
+    return write_bytes;
 }
 
 void *SpeechVMRecorder::DumpVMRecordDataThread(void *arg)
@@ -266,7 +298,7 @@ void *SpeechVMRecorder::DumpVMRecordDataThread(void *arg)
     ALOGD("%s(), pid: %d, tid: %d", __FUNCTION__, getpid(), gettid());
 
     SpeechVMRecorder *pSpeechVMRecorder = (SpeechVMRecorder *)arg;
-    RingBuf &ring_buf = pSpeechVMRecorder->mRingBuf;
+    AudioSPSCRingBuf *ring_buf = &pSpeechVMRecorder->mRingBuf;
 
     // open file
     if (pSpeechVMRecorder->OpenFile() != NO_ERROR)
@@ -282,35 +314,36 @@ void *SpeechVMRecorder::DumpVMRecordDataThread(void *arg)
     if (retval != NO_ERROR)
     {
         ALOGE("%s(), VoiceMemoRecordOn() fail!! Return.", __FUNCTION__);
-        pSpeechDriver->VoiceMemoRecordOff();
+        pSpeechDriver->VoiceMemoRecordOff();        
         pSpeechVMRecorder->mEnable = false;
         pthread_exit(NULL);
         return 0;
     }
 
-    // Internal Input Buffer Initialization
-    pSpeechVMRecorder->mRingBuf.pBufBase = new char[kReadBufferSize];
-    pSpeechVMRecorder->mRingBuf.bufLen   = kReadBufferSize;
-    pSpeechVMRecorder->mRingBuf.pRead    = pSpeechVMRecorder->mRingBuf.pBufBase;
-    pSpeechVMRecorder->mRingBuf.pWrite   = pSpeechVMRecorder->mRingBuf.pBufBase;
-
-    ASSERT(pSpeechVMRecorder->mRingBuf.pBufBase != NULL);
-    memset(pSpeechVMRecorder->mRingBuf.pBufBase, 0, pSpeechVMRecorder->mRingBuf.bufLen);
+    // Internal Input Buffer Initialization, drop data left by the last record
+    AudioRingBufView view;
+    ring_buf->commitRead(ring_buf->getReadView(&view));
+    android_atomic_release_store(0, &pSpeechVMRecorder->mDropBytes);
 
     pSpeechVMRecorder->mStarting = true;
 
     while (1)
     {
-        // lock & wait data
-        pSpeechVMRecorder->mMutex.lock();
-        if (pSpeechVMRecorder->mExitCond.waitRelative(pSpeechVMRecorder->mMutex, milliseconds(kCondWaitTimeoutMsec)) != NO_ERROR)
+        // wait a batch of data, the lock only guards the wait, CopyBufferToVM() never takes it
+        if (ring_buf->getDataCount() < kWriteBatchSize && pSpeechVMRecorder->mEnable == true)
         {
-            ALOGW("%s(), waitRelative fail", __FUNCTION__);
+            pSpeechVMRecorder->mMutex.lock();
+            pSpeechVMRecorder->mExitCond.waitRelative(pSpeechVMRecorder->mMutex, milliseconds(kCondWaitTimeoutMsec));
+            pSpeechVMRecorder->mMutex.unlock();
         }
 
+        // write data to sd card
+        WriteVMRecordData(ring_buf, pSpeechVMRecorder->mDumpFile);
+
         // make sure VM is still recording after conditional wait
         if (pSpeechVMRecorder->mEnable == false)
         {
+            pSpeechVMRecorder->mMutex.lock();
 
             // close file
             if (pSpeechVMRecorder->mDumpFile != NULL)
@@ -320,53 +353,16 @@ void *SpeechVMRecorder::DumpVMRecordDataThread(void *arg)
                 pSpeechVMRecorder->mDumpFile = NULL;
             }
 
-            // release local ring buffer
-            if (pSpeechVMRecorder->mRingBuf.pBufBase != NULL)
+            const int32_t drop_bytes = android_atomic_acquire_load(&pSpeechVMRecorder->mDropBytes);
+            if (drop_bytes > 0)
             {
-                delete []pSpeechVMRecorder->mRingBuf.pBufBase;
-                pSpeechVMRecorder->mRingBuf.pBufBase = NULL;
-
-                pSpeechVMRecorder->mRingBuf.pRead    = NULL;
-                pSpeechVMRecorder->mRingBuf.pWrite   = NULL;
-                pSpeechVMRecorder->mRingBuf.bufLen   = 0;
+                ALOGW("%s(), %d bytes VM data dropped while sd card was busy", __FUNCTION__, drop_bytes);
             }
 
             ALOGD("%s(), pid: %d, tid: %d, mEnable == false, break.", __FUNCTION__, getpid(), gettid());
             pSpeechVMRecorder->mMutex.unlock();
             break;
         }
-
-        // write data to sd card
-        const uint16_t data_count = RingBuf_getDataCount(&ring_buf);
-        uint16_t write_bytes = 0;
-
-        if (data_count > 0)
-        {
-            const char *end = ring_buf.pBufBase + ring_buf.bufLen;
-            if (ring_buf.pRead <= ring_buf.pWrite)
-            {
-                write_bytes += fwrite((void *)ring_buf.pRead, sizeof(char), data_count, pSpeechVMRecorder->mDumpFile);
-            }
-            else
-            {
-                int r2e = end - ring_buf.pRead;
-                write_bytes += fwrite((void *)ring_buf.pRead, sizeof(char), r2e, pSpeechVMRecorder->mDumpFile);
-                write_bytes += fwrite((void *)ring_buf.pBufBase, sizeof(char), data_count - r2e, pSpeechVMRecorder->mDumpFile);
-            }
-
-            ring_buf.pRead += write_bytes;
-            if (ring_buf.pRead >= end) { ring_buf.pRead -= ring_buf.bufLen; }
-
-            SLOGV("data_count: %u, write_bytes: %u", data_count, write_bytes);
-        }
-
-        if (write_bytes != data_count)
-        {
-            ALOGE("%s(), write_bytes(%d) != data_count(%d), SD Card might be full!!", __FUNCTION__, write_bytes, data_count);
-        }
-
-        // unlock
-        pSpeechVMRecorder->mMutex.unlock();
     }
 
     pthread_exit(NULL);
@@ -384,6 +380,7 @@ status_t SpeechVMRecorder::Close()
     {
         ALOGW("-%s(), mEnable == false, return!!", __FUNCTION__);
         mMutex.unlock();
+        JoinRecordThread();
         return INVALID_OPERATION;
     }
 
@@ -440,11 +437,25 @@ status_t SpeechVMRecorder::Close()
     mEnable = false;
     mMutex.unlock();
     mExitCond.signal(); // wake up thread to exit
-    
+
+    // the next Open() reuses mRingBuf and mDumpFile, the thread must have flushed and closed the file
+    JoinRecordThread();
+
     ALOGD("-%s()", __FUNCTION__);
     return NO_ERROR;
 }
 
+void SpeechVMRecorder::JoinRecordThread()
+{
+    if (mRecordThreadCreated == false)
+    {
+        return;
+    }
+
+    pthread_join(mRecordThread, NULL);
+    mRecordThreadCreated = false;
+}
+
 void SpeechVMRecorder::SetVMRecordCapability(const AUDIO_CUSTOM_PARAM_STRUCT *pSphParamNB)
 {
     ALOGD("%s(), uAutoVM = 0x%x, debug_info[0] = %u, speech_common_para[0] = %u", __FUNCTION__,
@@ -1,6 +1,14 @@
 #include "AudioALSACaptureDataClient.h"
 
+#include <linux/rtpm_prio.h>
+#include <sys/prctl.h>
+
+#include <cutils/atomic.h>
+
 #include "AudioUtility.h"
+#include "AudioSampleKernel.h"
+#include "AudioTimeline.h"
+#include "AudioBenchTrace.h"
 
 #include "AudioType.h"
 #include "AudioLock.h"
@@ -133,6 +141,19 @@ AudioALSACaptureDataClient::AudioALSACaptureDataClient(AudioALSACaptureDataProvi
     mAudioALSAVolumeController(AudioVolumeFactory::CreateAudioVolumeController()),
     mAudioSpeechEnhanceInfoInstance(AudioSpeechEnhanceInfo::getInstance()),
     mChannelRemixOp(CHANNEL_REMIX_NOP),
+    mFanOutThreadCreated(false),
+    mFanOutExit(false),
+    mFanOutQueue(),
+    mFanOutQueueHead(0),
+    mFanOutQueueCount(0),
+    mCaptureTimeInfo(&mStreamAttributeSource->Time_Info),
+    mScratchLinearBuf(NULL),
+    mScratchLinearBufSize(0),
+    mScratchSrc1Buf(NULL),
+    mScratchSrc1BufSize(0),
+    mScratchSrc2Buf(NULL),
+    mScratchSrc2BufSize(0),
+    mScratchAllocCount(0),
     //echoref+++
     mCaptureDataProviderEchoRef(NULL),
     mStreamAttributeSourceEchoRef(NULL),
@@ -144,28 +165,16 @@ AudioALSACaptureDataClient::AudioALSACaptureDataClient(AudioALSACaptureDataProvi
     ALOGD("%s()", __FUNCTION__);
 
     // raw data
-    memset((void *)&mRawDataBuf, 0, sizeof(mRawDataBuf));
-    mRawDataBuf.pBufBase = new char[kClientBufferSize];
-    mRawDataBuf.bufLen   = kClientBufferSize;
-    mRawDataBuf.pRead    = mRawDataBuf.pBufBase;
-    mRawDataBuf.pWrite   = mRawDataBuf.pBufBase;
-    ASSERT(mRawDataBuf.pBufBase != NULL);
+    status_t retval = mRawDataBuf.init(kClientBufferSize);
+    ASSERT(retval == NO_ERROR);
 
     // src data
-    memset((void *)&mSrcDataBuf, 0, sizeof(mSrcDataBuf));
-    mSrcDataBuf.pBufBase = new char[kClientBufferSize];
-    mSrcDataBuf.bufLen   = kClientBufferSize;
-    mSrcDataBuf.pRead    = mSrcDataBuf.pBufBase;
-    mSrcDataBuf.pWrite   = mSrcDataBuf.pBufBase;
-    ASSERT(mSrcDataBuf.pBufBase != NULL);
+    retval = mSrcDataBuf.init(kClientBufferSize);
+    ASSERT(retval == NO_ERROR);
 
     // processed data
-    memset((void *)&mProcessedDataBuf, 0, sizeof(mProcessedDataBuf));
-    mProcessedDataBuf.pBufBase = new char[kClientBufferSize];
-    mProcessedDataBuf.bufLen   = kClientBufferSize;
-    mProcessedDataBuf.pRead    = mProcessedDataBuf.pBufBase;
-    mProcessedDataBuf.pWrite   = mProcessedDataBuf.pBufBase;
-    ASSERT(mProcessedDataBuf.pBufBase != NULL);
+    retval = mProcessedDataBuf.init(kClientBufferSize);
+    ASSERT(retval == NO_ERROR);
 
     //TODO: Sam, move here for temp
     //BesRecord+++
@@ -253,12 +262,24 @@ AudioALSACaptureDataClient::AudioALSACaptureDataClient(AudioALSACaptureDataProvi
     }
 
     CheckChannelRemixOp();
+
+    // after CheckNeedBesRecordSRC() for the BesRecord SRC size factors
+    InitScratchBuffer();
+
+    // periods queued since attach wait here until the client is fully set up
+    if (mCaptureDataProvider->isParallelFanOut() == true)
+    {
+        StartFanOutWorker();
+    }
 }
 
 AudioALSACaptureDataClient::~AudioALSACaptureDataClient()
 {
     ALOGD("%s()", __FUNCTION__);
 
+    // stop before teardown, provider periods queued later are refused
+    StopFanOutWorker();
+
     //EchoRef+++
     if (mCaptureDataProviderEchoRef != NULL)
     {
@@ -287,11 +308,9 @@ AudioALSACaptureDataClient::~AudioALSACaptureDataClient()
 
     mCaptureDataProvider->detach(this);
 
-    if (mRawDataBuf.pBufBase != NULL) { delete[] mRawDataBuf.pBufBase; }
-
-    if (mSrcDataBuf.pBufBase != NULL) { delete[] mSrcDataBuf.pBufBase; }
-
-    if (mProcessedDataBuf.pBufBase != NULL) { delete[] mProcessedDataBuf.pBufBase; }
+    mRawDataBuf.deinit();
+    mSrcDataBuf.deinit();
+    mProcessedDataBuf.deinit();
 
     if (mBliSrc != NULL)
     {
@@ -323,9 +342,65 @@ AudioALSACaptureDataClient::~AudioALSACaptureDataClient()
     if (mAudioPreProcessEffect != NULL) { delete mAudioPreProcessEffect; }
     //Android Native Preprocess effect ---
 
+    DeinitScratchBuffer();
+
     ALOGD("-%s()", __FUNCTION__);
 }
 
+void AudioALSACaptureDataClient::InitScratchBuffer(void)
+{
+    // one period never holds more than a client ring buffer of raw data
+    mScratchLinearBufSize = kClientBufferSize << 1; // mono to stereo remix in place
+    mScratchSrc1BufSize = kClientBufferSize * mBesRecSRCSizeFactor;
+    mScratchSrc2BufSize = 0;
+
+    if (mStreamAttributeTarget->BesRecord_Info.besrecord_enable && mBliSrcHandler2 != NULL)
+    {
+        mScratchSrc2BufSize = mScratchSrc1BufSize * mBesRecSRCSizeFactor2;
+    }
+
+    mScratchLinearBuf = new char[mScratchLinearBufSize];
+    mScratchSrc1Buf = new char[mScratchSrc1BufSize];
+    mScratchSrc2Buf = (mScratchSrc2BufSize > 0) ? new char[mScratchSrc2BufSize] : NULL;
+    ASSERT(mScratchLinearBuf != NULL && mScratchSrc1Buf != NULL);
+
+    ALOGD("%s(), mScratchLinearBufSize = %u, mScratchSrc1BufSize = %u, mScratchSrc2BufSize = %u",
+          __FUNCTION__, mScratchLinearBufSize, mScratchSrc1BufSize, mScratchSrc2BufSize);
+}
+
+void AudioALSACaptureDataClient::DeinitScratchBuffer(void)
+{
+    ALOGD("%s(), mScratchAllocCount = %u", __FUNCTION__, mScratchAllocCount);
+
+    if (mScratchLinearBuf != NULL) { delete[] mScratchLinearBuf; mScratchLinearBuf = NULL; }
+    if (mScratchSrc1Buf != NULL) { delete[] mScratchSrc1Buf; mScratchSrc1Buf = NULL; }
+    if (mScratchSrc2Buf != NULL) { delete[] mScratchSrc2Buf; mScratchSrc2Buf = NULL; }
+    mScratchLinearBufSize = 0;
+    mScratchSrc1BufSize = 0;
+    mScratchSrc2BufSize = 0;
+}
+
+char *AudioALSACaptureDataClient::GetScratchBuffer(char *pScratch, const uint32_t scratchSize, const uint32_t bytes)
+{
+    if (pScratch != NULL && bytes <= scratchSize)
+    {
+        return pScratch;
+    }
+
+    // should never happen, mScratchAllocCount tells if it does
+    mScratchAllocCount++;
+    ALOGW("%s(), bytes(%u) > scratchSize(%u), mScratchAllocCount = %u", __FUNCTION__, bytes, scratchSize, mScratchAllocCount);
+    return new char[bytes];
+}
+
+void AudioALSACaptureDataClient::ReleaseScratchBuffer(char *pBuffer, const char *pScratch)
+{
+    if (pBuffer != pScratch)
+    {
+        delete[] pBuffer;
+    }
+}
+
 void AudioALSACaptureDataClient::setIdentity(const uint32_t identity)
 {
     ALOGD("%s(), mIsIdentitySet=%d, identity=%d", __FUNCTION__, mIsIdentitySet, identity);
@@ -336,38 +411,155 @@ void AudioALSACaptureDataClient::setIdentity(const uint32_t identity)
     }
 }
 
+void AudioALSACaptureDataClient::StartFanOutWorker(void)
+{
+    // the queue is set up in the constructor init list, the provider may already be queueing
+    int ret = pthread_create(&mFanOutThread, NULL, AudioALSACaptureDataClient::FanOutThread, (void *)this);
+    if (ret != 0)
+    {
+        ALOGE("%s() create thread fail!!", __FUNCTION__);
+        ASSERT(ret == 0);
+        return;
+    }
+    mFanOutThreadCreated = true;
+}
+
+void AudioALSACaptureDataClient::StopFanOutWorker(void)
+{
+    mFanOutLock.lock();
+    mFanOutExit = true;
+    mFanOutCV.signal();
+    mFanOutLock.unlock();
+
+    if (mFanOutThreadCreated == true)
+    {
+        pthread_join(mFanOutThread, NULL);
+        mFanOutThreadCreated = false;
+    }
+
+    // give back what the worker never got to
+    mFanOutLock.lock();
+    while (mFanOutQueueCount > 0)
+    {
+        AudioALSACaptureDataProviderBase::releaseCapturePeriod(mFanOutQueue[mFanOutQueueHead]);
+        mFanOutQueueHead = (mFanOutQueueHead + 1) % kMaxPendingCapturePeriod;
+        mFanOutQueueCount--;
+    }
+    mFanOutLock.unlock();
+}
+
+bool AudioALSACaptureDataClient::queueCapturePeriod(capture_period_t *period)
+{
+    AudioAutoTimeoutLock _l(mFanOutLock);
+
+    if (mFanOutExit == true)
+    {
+        return false;
+    }
+
+    if (mFanOutQueueCount == kMaxPendingCapturePeriod)
+    {
+        // same as mRawDataBuf overflow in serial mode, drop the oldest period
+        ALOGE("%s(), worker %u periods behind, drop oldest!!", __FUNCTION__, mFanOutQueueCount);
+        AudioALSACaptureDataProviderBase::releaseCapturePeriod(mFanOutQueue[mFanOutQueueHead]);
+        mFanOutQueueHead = (mFanOutQueueHead + 1) % kMaxPendingCapturePeriod;
+        mFanOutQueueCount--;
+    }
+
+    mFanOutQueue[(mFanOutQueueHead + mFanOutQueueCount) % kMaxPendingCapturePeriod] = period;
+    mFanOutQueueCount++;
+    mFanOutCV.signal();
+    return true;
+}
+
+void *AudioALSACaptureDataClient::FanOutThread(void *arg)
+{
+    AudioALSACaptureDataClient *pClient = static_cast<AudioALSACaptureDataClient *>(arg);
+
+    char nameset[32];
+    sprintf(nameset, "%s%d", __FUNCTION__, pClient->mIdentity);
+    prctl(PR_SET_NAME, (unsigned long)nameset, 0, 0, 0);
+
+#ifdef MTK_AUDIO_ADJUST_PRIORITY
+    // below the provider read thread, which must never wait for a client
+    struct sched_param sched_p;
+    sched_getparam(0, &sched_p);
+    sched_p.sched_priority = RTPM_PRIO_AUDIO_RECORD;
+    if (0 != sched_setscheduler(0, SCHED_RR, &sched_p))
+    {
+        ALOGE("[%s] failed, errno: %d", __FUNCTION__, errno);
+    }
+#endif
+    ALOGD("+%s(), pid: %d, tid: %d, identity: %u", __FUNCTION__, getpid(), gettid(), pClient->mIdentity);
+
+    capture_period_t *period = NULL;
+    RingBuf pcm_read_buf;
+
+    while (1)
+    {
+        pClient->mFanOutLock.lock();
+        while (pClient->mFanOutQueueCount == 0 && pClient->mFanOutExit == false)
+        {
+            pClient->mFanOutCV.wait(pClient->mFanOutLock);
+        }
+        if (pClient->mFanOutExit == true)
+        {
+            pClient->mFanOutLock.unlock();
+            break;
+        }
+        period = pClient->mFanOutQueue[pClient->mFanOutQueueHead];
+        pClient->mFanOutQueueHead = (pClient->mFanOutQueueHead + 1) % kMaxPendingCapturePeriod;
+        pClient->mFanOutQueueCount--;
+        pClient->mFanOutLock.unlock();
+
+        // read-only view of the shared period, copyCaptureDataToClient() only moves its own pRead
+        pcm_read_buf.pBufBase = period->pBufBase;
+        pcm_read_buf.bufLen   = period->bufLen;
+        pcm_read_buf.pRead    = period->pBufBase;
+        pcm_read_buf.pWrite   = period->pBufBase + period->dataSize;
+
+        pClient->mCaptureTimeInfo = &period->Time_Info;
+        pClient->copyCaptureDataToClient(pcm_read_buf);
+        AudioALSACaptureDataProviderBase::releaseCapturePeriod(period);
+    }
+
+    ALOGD("-%s(), identity: %u", __FUNCTION__, pClient->mIdentity);
+    return NULL;
+}
+
 uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_buf)
 {
     ALOGV("+%s()", __FUNCTION__);
 
     mLock.lock();
 
-    uint32_t freeSpace = RingBuf_getFreeSpace(&mRawDataBuf);
+    uint32_t freeSpace = mRawDataBuf.getFreeSpace();
     uint32_t dataSize = RingBuf_getDataCount(&pcm_read_buf);
     if (freeSpace < dataSize)
     {
         ALOGE("%s(), mRawDataBuf <= pcm_read_buf, freeSpace(%u) < dataSize(%u), buffer overflow!!", __FUNCTION__, freeSpace, dataSize);
-        RingBuf_copyFromRingBuf(&mRawDataBuf, &pcm_read_buf, freeSpace);
+        mRawDataBuf.writeFromRingBuf(&pcm_read_buf, freeSpace);
     }
     else
     {
-        RingBuf_copyFromRingBuf(&mRawDataBuf, &pcm_read_buf, dataSize);
+        mRawDataBuf.writeFromRingBuf(&pcm_read_buf, dataSize);
     }
 
     // SRC
-    const uint32_t kNumRawData = RingBuf_getDataCount(&mRawDataBuf);    //mRawDataBuf has data with mStreamAttributeSource sample rate
-    uint32_t num_free_space = RingBuf_getFreeSpace(&mSrcDataBuf);   //mSrcDataBuf has data with mStreamAttributeTarget sample rate
+    AUDIO_BENCH_BEGIN(srcStartNs);
+    const uint32_t kNumRawData = mRawDataBuf.getDataCount();    //mRawDataBuf has data with mStreamAttributeSource sample rate
+    uint32_t num_free_space = mSrcDataBuf.getFreeSpace();   //mSrcDataBuf has data with mStreamAttributeTarget sample rate
 
     //BesRecord PreProcess effect
     if (((mStreamAttributeTarget->BesRecord_Info.besrecord_enable) && !mBypassBesRecord))
     {
-        char *pRawDataLinearBuf = new char[kNumRawData];
+        char *pRawDataLinearBuf = GetScratchBuffer(mScratchLinearBuf, mScratchLinearBufSize, kNumRawData);
         uint32_t ProcesseddataSize = kNumRawData;
         
-        RingBuf_copyToLinear(pRawDataLinearBuf, &mRawDataBuf, kNumRawData);
+        mRawDataBuf.read(pRawDataLinearBuf, kNumRawData);
 
         uint32_t SRC1outputLength = kNumRawData * mBesRecSRCSizeFactor;
-        char *pSRC1DataLinearBuf = new char[SRC1outputLength];
+        char *pSRC1DataLinearBuf = GetScratchBuffer(mScratchSrc1Buf, mScratchSrc1BufSize, SRC1outputLength);
         
         char *p_read = pRawDataLinearBuf;
         uint32_t num_raw_data_left = kNumRawData;
@@ -397,7 +589,7 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
             if (mBliSrcHandler2 != 0)
             {
                 uint32_t SRC2outputLength = ProcesseddataSize * mBesRecSRCSizeFactor2;
-                char *pSRC2DataLinearBuf = new char[SRC2outputLength];
+                char *pSRC2DataLinearBuf = GetScratchBuffer(mScratchSrc2Buf, mScratchSrc2BufSize, SRC2outputLength);
             
                 p_read = pSRC1DataLinearBuf;
                 num_raw_data_left = ProcesseddataSize;
@@ -421,25 +613,25 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
                 if (num_free_space < SRC2outputLength)
                 {
                     ALOGE("%s(), BesRecord1 SRC2outputLength <= mSrcDataBuf num_free_space, num_free_space(%u) < SRC2outputLength(%u), buffer overflow!!", __FUNCTION__, num_free_space, SRC2outputLength);
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pSRC2DataLinearBuf, num_free_space);
+                    mSrcDataBuf.write(pSRC2DataLinearBuf, num_free_space);
                 }
                 else
                 {
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pSRC2DataLinearBuf, SRC2outputLength);
+                    mSrcDataBuf.write(pSRC2DataLinearBuf, SRC2outputLength);
                 }
                 
-                delete[] pSRC2DataLinearBuf;
+                ReleaseScratchBuffer(pSRC2DataLinearBuf, mScratchSrc2Buf);
             }
             else
             {
                 if (num_free_space < ProcesseddataSize)
                 {
                     ALOGE("%s(), BesRecord1 mProcessedDataBuf <= mSrcDataBuf, num_free_space(%u) < ProcesseddataSize(%u), buffer overflow!!", __FUNCTION__, num_free_space, ProcesseddataSize);
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pSRC1DataLinearBuf, num_free_space);
+                    mSrcDataBuf.write(pSRC1DataLinearBuf, num_free_space);
                 }
                 else
                 {
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pSRC1DataLinearBuf, ProcesseddataSize);
+                    mSrcDataBuf.write(pSRC1DataLinearBuf, ProcesseddataSize);
                 }
             }
         }
@@ -452,7 +644,7 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
             if (mBliSrcHandler2 != 0)
             {
                 uint32_t SRC2outputLength = ProcesseddataSize * mBesRecSRCSizeFactor2;
-                char *pSRC2DataLinearBuf = new char[SRC2outputLength];
+                char *pSRC2DataLinearBuf = GetScratchBuffer(mScratchSrc2Buf, mScratchSrc2BufSize, SRC2outputLength);
             
                 p_read = pRawDataLinearBuf;
                 num_raw_data_left = ProcesseddataSize;
@@ -476,32 +668,32 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
                 if (num_free_space < SRC2outputLength)
                 {
                     ALOGE("%s(), BesRecord2 SRC2outputLength <= mSrcDataBuf num_free_space, num_free_space(%u) < SRC2outputLength(%u), buffer overflow!!", __FUNCTION__, num_free_space, SRC2outputLength);
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pSRC2DataLinearBuf, num_free_space);
+                    mSrcDataBuf.write(pSRC2DataLinearBuf, num_free_space);
                 }
                 else
                 {
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pSRC2DataLinearBuf, SRC2outputLength);
+                    mSrcDataBuf.write(pSRC2DataLinearBuf, SRC2outputLength);
                 }
                 
-                delete[] pSRC2DataLinearBuf;
+                ReleaseScratchBuffer(pSRC2DataLinearBuf, mScratchSrc2Buf);
             }
             else
             {
                 if (num_free_space < ProcesseddataSize)
                 {
                     ALOGE("%s(), BesRecord2 mProcessedDataBuf <= mSrcDataBuf, num_free_space(%u) < ProcesseddataSize(%u), buffer overflow!!", __FUNCTION__, num_free_space, ProcesseddataSize);
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pRawDataLinearBuf, num_free_space);
+                    mSrcDataBuf.write(pRawDataLinearBuf, num_free_space);
                 }
                 else
                 {
-                    RingBuf_copyFromLinear(&mSrcDataBuf, pRawDataLinearBuf, ProcesseddataSize);
+                    mSrcDataBuf.write(pRawDataLinearBuf, ProcesseddataSize);
                 }
             }
         }
         
         
-        delete[] pRawDataLinearBuf;
-        delete[] pSRC1DataLinearBuf;
+        ReleaseScratchBuffer(pRawDataLinearBuf, mScratchLinearBuf);
+        ReleaseScratchBuffer(pSRC1DataLinearBuf, mScratchSrc1Buf);
     }
     else    //no need to do BesRecord PreProcess, transform data to mStreamAttributeTarget format
     {
@@ -511,61 +703,65 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
             if (num_free_space < kNumRawData)
             {
                 ALOGW("%s(), num_free_space(%u) < kNumRawData(%u)", __FUNCTION__, num_free_space, kNumRawData);
-                RingBuf_copyFromRingBuf(&mSrcDataBuf, &mRawDataBuf, num_free_space);
+                mRawDataBuf.copyToRingBuf(&mSrcDataBuf, num_free_space);
             }
             else
             {
-                RingBuf_copyFromRingBuf(&mSrcDataBuf, &mRawDataBuf, kNumRawData);
+                mRawDataBuf.copyToRingBuf(&mSrcDataBuf, kNumRawData);
             }
         }
         else // Need SRC
         {
-            char *pRawDataLinearBuf = new char[kNumRawData];
-            RingBuf_copyToLinear(pRawDataLinearBuf, &mRawDataBuf, kNumRawData);
+            // SRC reads both segments of mRawDataBuf in place
+            AudioRingBufView rawView;
+            mRawDataBuf.getReadView(&rawView);
 
-            char *pSrcDataLinearBuf = new char[num_free_space];
+            char *pSrcDataLinearBuf = GetScratchBuffer(mScratchSrc1Buf, mScratchSrc1BufSize, num_free_space);
+            uint32_t num_converted_data = 0;
 
-            char *p_read = pRawDataLinearBuf;
-            uint32_t num_raw_data_left = kNumRawData;
-            uint32_t num_converted_data = num_free_space; // max convert num_free_space
+            for (int seg = 0; seg < 2 && rawView.segLen[seg] > 0; seg++)
+            {
+                uint32_t num_raw_data_left = rawView.segLen[seg];
+                uint32_t num_seg_converted_data = num_free_space - num_converted_data; // max convert num_free_space
 
-            uint32_t consumed = num_raw_data_left;
-            mBliSrc->Process((int16_t *)p_read, &num_raw_data_left,
-                            (int16_t *)pSrcDataLinearBuf, &num_converted_data);
-            consumed -= num_raw_data_left;
+                mBliSrc->Process((int16_t *)rawView.pSeg[seg], &num_raw_data_left,
+                                 (int16_t *)(pSrcDataLinearBuf + num_converted_data), &num_seg_converted_data);
+                num_converted_data += num_seg_converted_data;
 
-            p_read += consumed;
-            ALOGV("%s(), num_raw_data_left = %u, num_converted_data = %u",
-                __FUNCTION__, num_raw_data_left, num_converted_data);
+                ALOGV("%s(), num_raw_data_left = %u, num_converted_data = %u",
+                      __FUNCTION__, num_raw_data_left, num_converted_data);
 
-            //ASSERT(num_raw_data_left == 0);
-            if (num_raw_data_left > 0)
-            {
-                ALOGW("%s(), num_raw_data_left(%u) > 0", __FUNCTION__, num_raw_data_left);
+                //ASSERT(num_raw_data_left == 0);
+                if (num_raw_data_left > 0)
+                {
+                    ALOGW("%s(), num_raw_data_left(%u) > 0", __FUNCTION__, num_raw_data_left);
+                }
             }
+            mRawDataBuf.commitRead(kNumRawData);
 
-            RingBuf_copyFromLinear(&mSrcDataBuf, pSrcDataLinearBuf, num_converted_data);
-            ALOGV("%s(), pRead:%u, pWrite:%u, dataCount:%u", __FUNCTION__,
-                  mSrcDataBuf.pRead - mSrcDataBuf.pBufBase,
-                  mSrcDataBuf.pWrite - mSrcDataBuf.pBufBase,
-                  RingBuf_getDataCount(&mSrcDataBuf));
+            mSrcDataBuf.write(pSrcDataLinearBuf, num_converted_data);
+            ALOGV("%s(), dataCount:%u", __FUNCTION__, mSrcDataBuf.getDataCount());
 
-            delete[] pRawDataLinearBuf;
-            delete[] pSrcDataLinearBuf;
+            ReleaseScratchBuffer(pSrcDataLinearBuf, mScratchSrc1Buf);
         }
     }
 
-    freeSpace = RingBuf_getFreeSpace(&mProcessedDataBuf);
-    dataSize = RingBuf_getDataCount(&mSrcDataBuf);
+    AUDIO_BENCH_END(AUDIO_BENCH_CLIENT_SRC, srcStartNs);
+
+    AUDIO_BENCH_BEGIN(effectStartNs);
+    freeSpace = mProcessedDataBuf.getFreeSpace();
+    dataSize = mSrcDataBuf.getDataCount();
     uint32_t ProcessdataSize = dataSize;
  
     //android native effect, use the same sample rate as mStreamAttributeTarget
     //Native Preprocess effect+++
     if ((mAudioPreProcessEffect->num_preprocessors > 0) && (IsVoIPEnable() == false))
     {
-        char *pSrcDataLinearBuf = new char[dataSize];
+        // mono to stereo remix doubles the data in place
+        uint32_t linearBufSize = (mChannelRemixOp == CHANNEL_MONO_TO_STEREO) ? (dataSize << 1) : dataSize;
+        char *pSrcDataLinearBuf = GetScratchBuffer(mScratchLinearBuf, mScratchLinearBufSize, linearBufSize);
         uint32_t native_processed_byte = 0;
-        RingBuf_copyToLinear(pSrcDataLinearBuf, &mSrcDataBuf, dataSize);
+        mSrcDataBuf.read(pSrcDataLinearBuf, dataSize);
 
         if (IsNeedChannelRemix()) {
             ProcessdataSize = ApplyChannelRemix((short *)pSrcDataLinearBuf, dataSize);
@@ -576,14 +772,14 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
         if (freeSpace < native_processed_byte)
         {
             ALOGE("%s(), NativeProcess mProcessedDataBuf <= mSrcDataBuf, freeSpace(%u) < native_processed size(%u), buffer overflow!!", __FUNCTION__, native_processed_byte, dataSize);
-            RingBuf_copyFromLinear(&mProcessedDataBuf, pSrcDataLinearBuf, freeSpace);
+            mProcessedDataBuf.write(pSrcDataLinearBuf, freeSpace);
         }
         else
         {
-            RingBuf_copyFromLinear(&mProcessedDataBuf, pSrcDataLinearBuf, native_processed_byte);
+            mProcessedDataBuf.write(pSrcDataLinearBuf, native_processed_byte);
         }
 
-        delete[] pSrcDataLinearBuf;
+        ReleaseScratchBuffer(pSrcDataLinearBuf, mScratchLinearBuf);
     }
     //Native Preprocess effect---
     else    //no need to do native effect, copy data from mSrcDataBuf to mProcessedDataBuf directly
@@ -598,18 +794,23 @@ uint32_t AudioALSACaptureDataClient::copyCaptureDataToClient(RingBuf pcm_read_bu
             {
                 ALOGE("%s(), mProcessedDataBuf <= mSrcDataBuf, freeSpace(%u) < dataSize(%u), buffer overflow!!",
                       __FUNCTION__, freeSpace, dataSize);
-                RingBuf_copyFromRingBuf(&mProcessedDataBuf, &mSrcDataBuf, freeSpace);
+                mSrcDataBuf.copyToRingBuf(&mProcessedDataBuf, freeSpace);
             }
             else
             {
-                RingBuf_copyFromRingBuf(&mProcessedDataBuf, &mSrcDataBuf, dataSize);
+                mSrcDataBuf.copyToRingBuf(&mProcessedDataBuf, dataSize);
             }
         }
     }
+    AUDIO_BENCH_END(AUDIO_BENCH_CLIENT_EFFECT, effectStartNs);
 
-    mWaitWorkCV.signal();
     mLock.unlock();
 
+    // data is already published in mProcessedDataBuf, the lock is only for the wakeup
+    mWaitLock.lock();
+    mWaitWorkCV.signal();
+    mWaitLock.unlock();
+
     ALOGV("-%s()", __FUNCTION__);
     return 0;
 }
@@ -628,65 +829,48 @@ ssize_t AudioALSACaptureDataClient::read(void *buffer, ssize_t bytes)
     do
     {
         mLock.lock();
-
         CheckNativeEffect();    //add here for alsaStreamIn lock holding
         CheckDynamicSpeechMask();
+        mLock.unlock();
 
+        // mProcessedDataBuf is single producer / single consumer, no lock needed from here
         if (dropBesRecordDataSize > 0)
         {
             /* Drop distortion data */
-            RingBufferSize = RingBuf_getDataCount(&mProcessedDataBuf);
-            if (RingBufferSize >= dropBesRecordDataSize)
-            {
-                // Drop dropBesRecordDataSize bytes from RingBuffer
-                while(dropBesRecordDataSize > 0)
-                {
-                    uint32_t dropSize = dropBesRecordDataSize > ReadDataBytes ? ReadDataBytes : dropBesRecordDataSize;
-                    RingBuf_copyToLinear((char *)pWrite, &mProcessedDataBuf, dropSize);
-                    dropBesRecordDataSize -= dropSize;
-                }
-            }
-            else
-            {
-                // Drop RingBufferSize from RingBuffer
-                while(RingBufferSize > 0 && dropBesRecordDataSize > 0)
-                {
-                    uint32_t dropSize = dropBesRecordDataSize > ReadDataBytes ? ReadDataBytes : dropBesRecordDataSize;
-                    dropSize = dropSize > RingBufferSize ? RingBufferSize : dropSize;
-                    RingBuf_copyToLinear((char *)pWrite, &mProcessedDataBuf, dropSize);
-                    RingBufferSize -= dropSize;
-                    dropBesRecordDataSize -= dropSize;
-                }
-            }
+            RingBufferSize = mProcessedDataBuf.getDataCount();
+            uint32_t dropSize = dropBesRecordDataSize > RingBufferSize ? RingBufferSize : dropBesRecordDataSize;
+            mProcessedDataBuf.commitRead(dropSize);
+            dropBesRecordDataSize -= dropSize;
         }
 
         if (dropBesRecordDataSize == 0)
         {
-            RingBufferSize = RingBuf_getDataCount(&mProcessedDataBuf);
+            RingBufferSize = mProcessedDataBuf.getDataCount();
             if (RingBufferSize >= ReadDataBytes) // ring buffer is enough, copy & exit
             {
-                RingBuf_copyToLinear((char *)pWrite, &mProcessedDataBuf, ReadDataBytes);
+                mProcessedDataBuf.read((char *)pWrite, ReadDataBytes);
                 ReadDataBytes = 0;
-                mLock.unlock();
                 break;
             }
             else // ring buffer is not enough, copy all data
             {
-                RingBuf_copyToLinear((char *)pWrite, &mProcessedDataBuf, RingBufferSize);
+                mProcessedDataBuf.read((char *)pWrite, RingBufferSize);
                 ReadDataBytes -= RingBufferSize;
                 pWrite += RingBufferSize;
             }
         }
 
-        // wait for new data
-        if (mWaitWorkCV.waitRelative(mLock, milliseconds(300)) != NO_ERROR)
+        // wait for new data, unless it came in after the check above
+        mWaitLock.lock();
+        if (mProcessedDataBuf.getDataCount() == 0 &&
+            mWaitWorkCV.waitRelative(mWaitLock, milliseconds(300)) != NO_ERROR)
         {
             ALOGW("%s(), waitRelative fail", __FUNCTION__);
-            mLock.unlock();
+            mWaitLock.unlock();
             break;
         }
 
-        mLock.unlock();
+        mWaitLock.unlock();
         TryCount--;
     }
     while (ReadDataBytes > 0 && TryCount);
@@ -786,95 +970,53 @@ ssize_t AudioALSACaptureDataClient::ApplyChannelRemix(short *buffer, size_t byte
 {
     ssize_t remixSize = 0;
     uint32_t remixOp = mChannelRemixOp;
-    int frameCount;
+    uint32_t frameCount;
 
     if (remixOp == CHANNEL_STEREO_CROSSMIX_L2R)
     {
         frameCount = bytes >> 2;
-
-        for (int i = 0; i < frameCount; i++) {
-            *(buffer + 1) = *buffer;
-            buffer += 2;
-        }
-
+        AudioKernel_crossmix16(buffer, frameCount, 0);
         remixSize = bytes;
     }
     else if (remixOp == CHANNEL_STEREO_CROSSMIX_R2L)
     {
         frameCount = bytes >> 2;
-
-        for (int i = 0; i < frameCount; i++) {
-            *buffer = *(buffer + 1);
-            buffer += 2;
-        }
-
+        AudioKernel_crossmix16(buffer, frameCount, 1);
         remixSize = bytes;
     }
     else if (remixOp == CHANNEL_STEREO_DOWNMIX)
     {
-        short mix;
-        short *monoBuffer = buffer;
         frameCount = bytes >> 2;
-
-        for (int i = 0; i < frameCount; i++) {
-            mix = (*buffer + *(buffer + 1)) >> 1;
-            *monoBuffer = mix;
-            monoBuffer++;
-            buffer += 2;
-        }
-
+        AudioKernel_downmix16(buffer, buffer, frameCount);
         remixSize = bytes >> 1;
     }
     else if (remixOp == CHANNEL_STEREO_DOWNMIX_L_ONLY)
     {
-        short *monoBuffer = buffer;
         frameCount = bytes >> 2;
-
-        for (int i = 0; i < frameCount; i++) {
-            *monoBuffer = *buffer;
-            monoBuffer++;
-            buffer += 2;
-        }
-
+        AudioKernel_selectChannel16(buffer, buffer, frameCount, 0);
         remixSize = bytes >> 1;
     }
     else if (remixOp == CHANNEL_STEREO_DOWNMIX_R_ONLY)
     {
-        short *monoBuffer = buffer;
         frameCount = bytes >> 2;
-
-        for (int i = 0; i < frameCount; i++) {
-            *monoBuffer = *(buffer+1);
-            monoBuffer++;
-            buffer += 2;
-        }
-
+        AudioKernel_selectChannel16(buffer, buffer, frameCount, 1);
         remixSize = bytes >> 1;
     }
     else if (remixOp == CHANNEL_MONO_TO_STEREO)
     {
         frameCount = bytes >> 1;
-        short *monoBuffer = buffer + frameCount - 1;
-        short *stereoBuffer = buffer + (frameCount * 2) - 1;
-        short data;
-
-        for (int i = 0; i < frameCount; i++) {
-             data = *monoBuffer--;
-            *stereoBuffer-- = data;
-            *stereoBuffer-- = data;
-        }
-
+        AudioKernel_upmix16(buffer, buffer, frameCount); // in place, buffer holds bytes << 1
         remixSize = bytes << 1;
     }
 
     return remixSize;
 }
 
-ssize_t AudioALSACaptureDataClient::ApplyChannelRemixWithRingBuf(RingBuf *srcBuffer, RingBuf *dstBuffer)
+ssize_t AudioALSACaptureDataClient::ApplyChannelRemixWithRingBuf(AudioSPSCRingBuf *srcBuffer, AudioSPSCRingBuf *dstBuffer)
 {
     ssize_t remixSize = 0;
-    size_t dataSize = RingBuf_getDataCount(srcBuffer);
-    size_t availSize = RingBuf_getFreeSpace(dstBuffer);
+    size_t dataSize = srcBuffer->getDataCount();
+    size_t availSize = dstBuffer->getFreeSpace();
     size_t dataSizeAfterProcess;
     char *tempBuffer = NULL;
     size_t tempBufferSize;
@@ -913,18 +1055,17 @@ ssize_t AudioALSACaptureDataClient::ApplyChannelRemixWithRingBuf(RingBuf *srcBuf
         return 0;
 
     tempBufferSize = (dataSizeAfterProcess > dataSize) ? dataSizeAfterProcess : dataSize;
-    tempBuffer = new char[tempBufferSize];
+    tempBuffer = GetScratchBuffer(mScratchLinearBuf, mScratchLinearBufSize, tempBufferSize);
     if (!tempBuffer)
         return 0;
 
-    RingBuf_copyToLinear(tempBuffer, srcBuffer, dataSize);
+    srcBuffer->read(tempBuffer, dataSize);
 
     remixSize = ApplyChannelRemix((short *)tempBuffer, dataSize);
 
-    RingBuf_copyFromLinear(dstBuffer, tempBuffer, remixSize);
+    dstBuffer->write(tempBuffer, remixSize);
 
-    if (tempBuffer)
-        delete[] tempBuffer;
+    ReleaseScratchBuffer(tempBuffer, mScratchLinearBuf);
 
     return remixSize;
 }
@@ -2173,29 +2314,20 @@ void AudioALSACaptureDataClient::SetDMNREnable(DMNR_TYPE type, bool enable)
 timespec AudioALSACaptureDataClient::GetCaptureTimeStamp(void)
 {
     struct timespec capturetime;
-
-    long ret_ns;
     capturetime.tv_sec  = 0;
     capturetime.tv_nsec = 0;
 
-    if ((mStreamAttributeSource->Time_Info.timestamp_get.tv_sec == 0) && (mStreamAttributeSource->Time_Info.timestamp_get.tv_nsec == 0))
+    if ((mCaptureTimeInfo->timestamp_get.tv_sec == 0) && (mCaptureTimeInfo->timestamp_get.tv_nsec == 0))
     {
         ALOGE("%s fail", __FUNCTION__);
     }
     else
     {
-        capturetime = mStreamAttributeSource->Time_Info.timestamp_get;
-        ret_ns = mStreamAttributeSource->Time_Info.kernelbuffer_ns;
-        if ((capturetime.tv_nsec - ret_ns) >= 0)
-        {
-            capturetime.tv_nsec -= ret_ns;
-        }
-        else
-        {
-            capturetime.tv_sec -= 1;
-            capturetime.tv_nsec = 1000000000 + capturetime.tv_nsec - ret_ns;
-        }
-        ALOGV("%s, sec= %ld, nsec=%ld, ret_ns = %ld\n", __FUNCTION__, capturetime.tv_sec, capturetime.tv_nsec, ret_ns);
+        // start time of this read = hw timestamp - data still in kernel, counted at the measured mic clock rate
+        AudioTimeline *pTimeline = AudioTimeline::getInstance();
+        const int64_t ret_ns = pTimeline->correctDurationNs(AUDIO_TIMELINE_CLOCK_CAPTURE, mCaptureTimeInfo->kernelbuffer_ns);
+        capturetime = AudioTimeline::nsToTimespec(AudioTimeline::timespecToNs(mCaptureTimeInfo->timestamp_get) - ret_ns);
+        ALOGV("%s, sec= %ld, nsec=%ld, ret_ns = %lld\n", __FUNCTION__, capturetime.tv_sec, capturetime.tv_nsec, (long long)ret_ns);
     }
 
     return capturetime;
@@ -2204,8 +2336,6 @@ timespec AudioALSACaptureDataClient::GetCaptureTimeStamp(void)
 timespec AudioALSACaptureDataClient::GetEchoRefTimeStamp(void)
 {
     struct timespec echoreftime;
-
-    long ret_ns;
     echoreftime.tv_sec  = 0;
     echoreftime.tv_nsec = 0;
 
@@ -2215,18 +2345,11 @@ timespec AudioALSACaptureDataClient::GetEchoRefTimeStamp(void)
     }
     else
     {
-        echoreftime = mStreamAttributeSourceEchoRef->Time_Info.timestamp_get;
-        ret_ns = mStreamAttributeSourceEchoRef->Time_Info.kernelbuffer_ns;
-        if ((echoreftime.tv_nsec - ret_ns) >= 0)
-        {
-            echoreftime.tv_nsec -= ret_ns;
-        }
-        else
-        {
-            echoreftime.tv_sec -= 1;
-            echoreftime.tv_nsec = 1000000000 + echoreftime.tv_nsec - ret_ns;
-        }
-        ALOGV("%s, sec= %ld, nsec=%ld, ret_ns = %ld\n", __FUNCTION__, echoreftime.tv_sec, echoreftime.tv_nsec, ret_ns);
+        // same as GetCaptureTimeStamp(), with the echo ref clock rate
+        AudioTimeline *pTimeline = AudioTimeline::getInstance();
+        const int64_t ret_ns = pTimeline->correctDurationNs(AUDIO_TIMELINE_CLOCK_ECHOREF, mStreamAttributeSourceEchoRef->Time_Info.kernelbuffer_ns);
+        echoreftime = AudioTimeline::nsToTimespec(AudioTimeline::timespecToNs(mStreamAttributeSourceEchoRef->Time_Info.timestamp_get) - ret_ns);
+        ALOGV("%s, sec= %ld, nsec=%ld, ret_ns = %lld\n", __FUNCTION__, echoreftime.tv_sec, echoreftime.tv_nsec, (long long)ret_ns);
     }
 
     return echoreftime;
@@ -2263,7 +2386,7 @@ void AudioALSACaptureDataClient::CheckNativeEffect(void)
 uint32_t AudioALSACaptureDataClient::NativePreprocess(void *buffer , uint32_t bytes)
 {
     uint32_t retsize = bytes;
-    retsize = mAudioPreProcessEffect->NativePreprocess(buffer, bytes, &mStreamAttributeSource->Time_Info);
+    retsize = mAudioPreProcessEffect->NativePreprocess(buffer, bytes, mCaptureTimeInfo);
     return retsize;
 }
 
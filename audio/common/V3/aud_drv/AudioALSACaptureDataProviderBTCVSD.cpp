@@ -272,101 +272,27 @@ uint32_t AudioALSACaptureDataProviderBTCVSD::readDataFromBTCVSD(void *linear_buf
     }
 #endif
 
-    uint8_t *inbuf = mAudioBTCVSDControl->BT_SCO_RX_GetCVSDInBuf();
-    uint32_t insize = SCO_RX_PLC_SIZE;
-
-    uint8_t *outbuf = NULL;
-    uint32_t outsize = 0;
-    if (mAudioBTCVSDControl->BT_SCO_isWideBand() == true)
-    {
-        outbuf = mAudioBTCVSDControl->BT_SCO_RX_GetMSBCOutBuf();
-        outsize = MSBC_PCM_FRAME_BYTE;
-    }
-    else
-    {
-        outbuf = mAudioBTCVSDControl->BT_SCO_RX_GetCVSDOutBuf();
-        outsize = SCO_RX_PCM8K_BUF_SIZE;
-    }
-
-    uint8_t *workbuf = mAudioBTCVSDControl->BT_SCO_RX_GetCVSDWorkBuf();
-    uint32_t workbufsize = SCO_RX_PCM64K_BUF_SIZE;
-
-
-    uint8_t packetvalid = 0;
-    uint32_t total_read_size = 0;
-    uint32_t bytes = BTSCO_CVSD_RX_INBUF_SIZE;
-    do
+    if (mBTMode_Open != mAudioBTCVSDControl->BT_SCO_isWideBand())
     {
-        memcpy(inbuf, cvsd_raw_data, SCO_RX_PLC_SIZE);
-        cvsd_raw_data += SCO_RX_PLC_SIZE;
-
-        packetvalid = *cvsd_raw_data; // parser packet valid info for each 30-byte packet
-        //packetvalid = 1; // force packvalid to 1 for test
-        cvsd_raw_data += BTSCO_CVSD_PACKET_VALID_SIZE;
-
-        insize = SCO_RX_PLC_SIZE;
-        
-        if(mBTMode_Open != mAudioBTCVSDControl->BT_SCO_isWideBand())
-        {            
-            ALOGD("BTSCO change mode after RX_Begin!!!");
-            mAudioBTCVSDControl->BT_SCO_RX_End(mFd2);
-            mAudioBTCVSDControl->BT_SCO_RX_Begin(mFd2); 
-            mBTMode_Open = mAudioBTCVSDControl->BT_SCO_isWideBand();                    
-
-            if (mAudioBTCVSDControl->BT_SCO_isWideBand() == true)
-            {
-                mReadBufferSize = MSBC_PCM_FRAME_BYTE * 6 * 2; // 16k mono->48k stereo
-            }
-            else
-            {
-                mReadBufferSize = SCO_RX_PCM8K_BUF_SIZE * 12 * 2; // 8k mono->48k stereo
-            }
-
-            return 0;
-        }
-
-        outsize = (mAudioBTCVSDControl->BT_SCO_isWideBand() == true) ? MSBC_PCM_FRAME_BYTE : SCO_RX_PCM8K_BUF_SIZE;
-        ALOGV("btsco_process_RX_CVSD/MSBC(+), insize = %d, outsize = %d, packetvalid = %u", insize, outsize, packetvalid);
+        ALOGD("BTSCO change mode after RX_Begin!!!");
+        mAudioBTCVSDControl->BT_SCO_RX_End(mFd2);
+        mAudioBTCVSDControl->BT_SCO_RX_Begin(mFd2);
+        mBTMode_Open = mAudioBTCVSDControl->BT_SCO_isWideBand();
 
         if (mAudioBTCVSDControl->BT_SCO_isWideBand() == true)
         {
-            mAudioBTCVSDControl->btsco_process_RX_MSBC(inbuf, &insize, outbuf, &outsize, workbuf, workbufsize, packetvalid);
+            mReadBufferSize = MSBC_PCM_FRAME_BYTE * 6 * 2; // 16k mono->48k stereo
         }
         else
         {
-            mAudioBTCVSDControl->btsco_process_RX_CVSD(inbuf, &insize, outbuf, &outsize, workbuf, workbufsize, packetvalid);
+            mReadBufferSize = SCO_RX_PCM8K_BUF_SIZE * 12 * 2; // 8k mono->48k stereo
         }
-        inbuf += SCO_RX_PLC_SIZE;
-        bytes -= insize;
-        ALOGV("btsco_process_RX_CVSD/MSBC(-), insize = %d, outsize = %d, bytes = %d", insize, outsize, bytes);
 
-
-        if (outsize > 0)
-        {
-            if (total_read_size + outsize <= mReadBufferSize)
-            {
-                memcpy(linear_buffer, outbuf, outsize);
-            }
-            else
-            {
-                ALOGE("%s(), total_read_size %u + outsize %u > mReadBufferSize %u, bytes %u", __FUNCTION__, total_read_size, outsize, mReadBufferSize, bytes);
-                ASSERT(total_read_size + outsize <= mReadBufferSize);
-                if (total_read_size < mReadBufferSize)
-                {
-                    outsize = mReadBufferSize - total_read_size;
-                    memcpy(linear_buffer, outbuf, outsize);
-                }
-                else
-                {
-                    break;
-                }
-            }
-            linear_buffer += outsize;
-            total_read_size += outsize;
-        }
+        return 0;
     }
-    while (bytes > 0 && total_read_size < mReadBufferSize);
 
+    // decode all packets of this read straight from the raw buffer into linear_buffer
+    uint32_t total_read_size = mAudioBTCVSDControl->BT_SCO_RX_ProcessPackets(cvsd_raw_data, BTSCO_CVSD_RX_TEMPINPUTBUF_SIZE, (uint8_t *)linear_buffer, mReadBufferSize);
 
     ALOGV("+%s(), total_read_size = %u", __FUNCTION__, total_read_size);
     return total_read_size;
@@ -1,11 +1,13 @@
 #include "AudioALSACaptureDataProviderBase.h"
 
 #include <utils/threads.h>
+#include <cutils/atomic.h>
 
 #include "AudioType.h"
 #include "AudioLock.h"
 
 #include "AudioALSACaptureDataClient.h"
+#include "AudioTimeline.h"
 
 
 
@@ -14,11 +16,35 @@
 namespace android
 {
 static const uint32_t kAudioSoundCardIndex = 0;
+
+// per client: its queue depth + 1 in process, plus 1 in publish shared by all
+static inline size_t getCapturePeriodPoolSize(const size_t num_clients)
+{
+    return num_clients * (AudioALSACaptureDataClient::kMaxPendingCapturePeriod + 1) + 1;
+}
+
+// hw clock of the shared timeline a provider feeds, AUDIO_TIMELINE_CLOCK_NUM for none
+static audio_timeline_clock_t getTimelineClock(const capture_provider_t provider_type)
+{
+    switch (provider_type)
+    {
+        case CAPTURE_PROVIDER_NORMAL:
+        case CAPTURE_PROVIDER_BT_SCO:
+            return AUDIO_TIMELINE_CLOCK_CAPTURE;
+        case CAPTURE_PROVIDER_ECHOREF:
+        case CAPTURE_PROVIDER_ECHOREF_BTSCO:
+        case CAPTURE_PROVIDER_ECHOREF_EXT:
+            return AUDIO_TIMELINE_CLOCK_ECHOREF;
+        default:
+            return AUDIO_TIMELINE_CLOCK_NUM;
+    }
+}
 int AudioALSACaptureDataProviderBase::mDumpFileNum = 0;
 
 AudioALSACaptureDataProviderBase::AudioALSACaptureDataProviderBase() :
     mEnable(false),
     mOpenIndex(0),
+    mParallelFanOut(false),
     mCaptureDataClientIndex(0),
     mPcm(NULL),
     mCaptureDataProviderType(CAPTURE_PROVIDER_BASE)
@@ -40,6 +66,7 @@ AudioALSACaptureDataProviderBase::AudioALSACaptureDataProviderBase() :
 AudioALSACaptureDataProviderBase::~AudioALSACaptureDataProviderBase()
 {
     ALOGD("%s(), %p", __FUNCTION__, this);
+    clearCapturePeriodPool();
 }
 
 status_t AudioALSACaptureDataProviderBase::openPcmDriver(const unsigned int device)
@@ -114,6 +141,10 @@ void AudioALSACaptureDataProviderBase::detach(AudioALSACaptureDataClient *pCaptu
     if (mCaptureDataClientVector.size() == 0)
     {
         close();
+        clearCapturePeriodPool();
+
+        // the next open counts frames from 0 again, the timeline must re-anchor
+        AudioTimeline::getInstance()->resetClock(getTimelineClock(mCaptureDataProviderType));
         ALOGD("%s(), close finish", __FUNCTION__);
     }
     ALOGD("-%s()", __FUNCTION__);
@@ -133,6 +164,13 @@ void AudioALSACaptureDataProviderBase::provideCaptureDataToAllClients(const uint
     AudioALSACaptureDataClient *pCaptureDataClient = NULL;
 
     WritePcmDumpData();
+    if (mParallelFanOut == true)
+    {
+        publishCaptureDataToAllClients();
+        ALOGV("-%s()", __FUNCTION__);
+        return;
+    }
+
     for (size_t i = 0; i < mCaptureDataClientVector.size(); i++)
     {
         pCaptureDataClient = mCaptureDataClientVector[i];
@@ -142,6 +180,106 @@ void AudioALSACaptureDataProviderBase::provideCaptureDataToAllClients(const uint
     ALOGV("-%s()", __FUNCTION__);
 }
 
+void AudioALSACaptureDataProviderBase::publishCaptureDataToAllClients(void)
+{
+    if (mCaptureDataClientVector.size() == 0)
+    {
+        return;
+    }
+
+    // mPcmReadBuf points to the read thread stack, so copy it once for all workers
+    RingBuf pcm_read_buf = mPcmReadBuf;
+    const uint32_t dataSize = RingBuf_getDataCount(&pcm_read_buf);
+
+    capture_period_t *period = getFreeCapturePeriod(dataSize);
+    if (period == NULL)
+    {
+        // every client still holds older periods, skip this one rather than allocate on the capture thread
+        ALOGW("%s(), no free period, drop %u bytes", __FUNCTION__, dataSize);
+        return;
+    }
+    RingBuf_copyToLinear(period->pBufBase, &pcm_read_buf, dataSize);
+    period->dataSize = dataSize;
+    period->Time_Info = mStreamAttributeSource.Time_Info;
+
+    // hold one reference while queueing so that a fast worker cannot recycle it
+    android_atomic_release_store(1, &period->refCount);
+    for (size_t i = 0; i < mCaptureDataClientVector.size(); i++)
+    {
+        android_atomic_inc(&period->refCount);
+        if (mCaptureDataClientVector[i]->queueCapturePeriod(period) == false)
+        {
+            android_atomic_dec(&period->refCount);
+        }
+    }
+    releaseCapturePeriod(period);
+}
+
+capture_period_t *AudioALSACaptureDataProviderBase::getFreeCapturePeriod(const uint32_t dataSize)
+{
+    capture_period_t *period = NULL;
+
+    for (size_t i = 0; i < mCapturePeriodPool.size(); i++)
+    {
+        if (android_atomic_acquire_load(&mCapturePeriodPool[i]->refCount) == 0)
+        {
+            period = mCapturePeriodPool[i];
+            break;
+        }
+    }
+
+    if (period == NULL)
+    {
+        if (mCapturePeriodPool.size() >= getCapturePeriodPoolSize(mCaptureDataClientVector.size()))
+        {
+            return NULL;
+        }
+        // the pool fills up during the first periods of a stream and grows with each attached client,
+        // so a client that is behind only drops its own oldest periods
+        period = new capture_period_t;
+        memset((void *)period, 0, sizeof(capture_period_t));
+        mCapturePeriodPool.add(period);
+    }
+
+    if (period->bufLen < dataSize + 1) // +1: avoid pRead == pWrite when clients wrap it as RingBuf
+    {
+        if (period->pBufBase != NULL)
+        {
+            delete[] period->pBufBase;
+        }
+        period->pBufBase = new char[dataSize + 1];
+        period->bufLen = dataSize + 1;
+    }
+
+    return period;
+}
+
+void AudioALSACaptureDataProviderBase::releaseCapturePeriod(capture_period_t *period)
+{
+    // the last owner makes the period free for getFreeCapturePeriod() again
+    android_atomic_dec(&period->refCount);
+}
+
+void AudioALSACaptureDataProviderBase::clearCapturePeriodPool(void)
+{
+    for (size_t i = 0; i < mCapturePeriodPool.size(); i++)
+    {
+        capture_period_t *period = mCapturePeriodPool[i];
+        if (android_atomic_acquire_load(&period->refCount) != 0)
+        {
+            // client workers are stopped before detach, so this should never happen
+            ALOGE("%s(), period %p refCount %d, leak it", __FUNCTION__, period, period->refCount);
+            continue;
+        }
+        if (period->pBufBase != NULL)
+        {
+            delete[] period->pBufBase;
+        }
+        delete period;
+    }
+    mCapturePeriodPool.clear();
+}
+
 bool AudioALSACaptureDataProviderBase::HasLowLatencyCapture(void)
 {
     ALOGD("+%s()", __FUNCTION__);
@@ -243,6 +381,10 @@ status_t AudioALSACaptureDataProviderBase::GetCaptureTimeStamp(time_info_struct_
     {
         Time_Info->buffer_per_time = pcm_bytes_to_frames(mPcm, read_size);
         Time_Info->kernelbuffer_ns = 1000000000 / mStreamAttributeSource.sample_rate * (Time_Info->buffer_per_time + Time_Info->frameInfo_get);
+
+        // feed the mic / echo ref hw clocks to the shared timeline for drift estimation
+        AudioTimeline::getInstance()->updateClock(getTimelineClock(mCaptureDataProviderType), Time_Info->timestamp_get,
+                                                  Time_Info->buffer_per_time, Time_Info->frameInfo_get, mStreamAttributeSource.sample_rate);
         ALOGV("%s pcm_get_htimestamp sec= %ld, nsec=%ld, frameInfo_get = %u, buffer_per_time=%u, ret_ns = %lu\n",
               __FUNCTION__, Time_Info->timestamp_get.tv_sec, Time_Info->timestamp_get.tv_nsec, Time_Info->frameInfo_get,
               Time_Info->buffer_per_time, Time_Info->kernelbuffer_ns);
@@ -4,9 +4,12 @@
 
 #include <linux/rtpm_prio.h>
 #include <sys/prctl.h>
+#include <cutils/properties.h>
 
 #include "AudioALSADriverUtility.h"
 #include "AudioType.h"
+#include "AudioSampleKernel.h"
+#include "AudioBenchTrace.h"
 
 #if !defined(MTK_BASIC_PACKAGE)
 #include <audio_utils/pulse.h>
@@ -28,6 +31,9 @@ namespace android
 static uint32_t kReadBufferSize = 0;
 static const uint32_t kDCRReadBufferSize = 0x2EE00; //48K\stereo\1s data , calculate 1time/sec
 
+// let VoIP, voice recognition and camcorder clients process in parallel
+static const char PROPERTY_KEY_PARALLEL_FANOUT[PROPERTY_KEY_MAX] = "streamin.parallel.fanout";
+
 //static FILE *pDCCalFile = NULL;
 
 
@@ -51,7 +57,11 @@ AudioALSACaptureDataProviderNormal *AudioALSACaptureDataProviderNormal::getInsta
 
 AudioALSACaptureDataProviderNormal::AudioALSACaptureDataProviderNormal()
 {
-    ALOGD("%s()", __FUNCTION__);
+    char property_value[PROPERTY_VALUE_MAX];
+    property_get(PROPERTY_KEY_PARALLEL_FANOUT, property_value, "0");
+    mParallelFanOut = (atoi(property_value) != 0);
+
+    ALOGD("%s(), mParallelFanOut = %d", __FUNCTION__, mParallelFanOut);
 }
 
 AudioALSACaptureDataProviderNormal::~AudioALSACaptureDataProviderNormal()
@@ -334,7 +344,9 @@ void *AudioALSACaptureDataProviderNormal::readThread(void *arg)
         }
         else
         {
+            AUDIO_BENCH_BEGIN(pcmReadStartNs);
             int retval = pcm_read(pDataProvider->mPcm, linear_buffer, kReadBufferSize);
+            AUDIO_BENCH_END(AUDIO_BENCH_CAPTURE_PCM_READ, pcmReadStartNs);
             if (retval != 0)
             {
                 ALOGE("%s(), pcm_read() error, retval = %d", __FUNCTION__, retval);
@@ -348,14 +360,10 @@ void *AudioALSACaptureDataProviderNormal::readThread(void *arg)
         pDataProvider->GetCaptureTimeStamp(&pDataProvider->mStreamAttributeSource.Time_Info, kReadBufferSize);
 
 #ifdef RECORD_INPUT_24BITS // 24bit record
-        uint32_t *ptr32bit_r = (uint32_t *)linear_buffer;
-        int16_t *ptr16bit_w = (int16_t *)linear_buffer;
-        int i;
-        ALOGV("24bit record, kReadBufferSize=%d, init ptr32bit_r=0x%x, ptr16bit_w =0x%x", kReadBufferSize, ptr32bit_r, ptr16bit_w);
-        for (i = 0; i < kReadBufferSize / 4; i++)
-        {
-            *(ptr16bit_w + i) = (int16_t)(*(ptr32bit_r + i) >> 8);
-        }
+        ALOGV("24bit record, kReadBufferSize=%d", kReadBufferSize);
+        AUDIO_BENCH_BEGIN(narrowStartNs);
+        AudioKernel_q9p23ToQ15((int16_t *)linear_buffer, (const int32_t *)linear_buffer, kReadBufferSize / 4);
+        AUDIO_BENCH_END(AUDIO_BENCH_CAPTURE_24_TO_16, narrowStartNs);
         kReadBufferSize_new = kReadBufferSize >> 1;
 #else
         kReadBufferSize_new = kReadBufferSize;
@@ -378,7 +386,9 @@ void *AudioALSACaptureDataProviderNormal::readThread(void *arg)
         pDataProvider->mPcmReadBuf.pWrite   = linear_buffer + kReadBufferSize_new;
         pDataProvider->mEnableLock.unlock();
 
+        AUDIO_BENCH_BEGIN(publishStartNs);
         pDataProvider->provideCaptureDataToAllClients(open_index);
+        AUDIO_BENCH_END(AUDIO_BENCH_CAPTURE_PUBLISH, publishStartNs);
 
         clock_gettime(CLOCK_REALTIME, &pDataProvider->mNewtime);
         pDataProvider->timerec[2] = calc_time_diff(pDataProvider->mNewtime, pDataProvider->mOldtime);
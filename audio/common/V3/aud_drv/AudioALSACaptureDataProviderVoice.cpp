@@ -21,6 +21,10 @@ namespace android
 
 static const uint32_t kReadBufferSize = 0x2000; // 8k
 
+static const uint32_t kStagingBufferSize = 0x8000; // 32k, > 500 ms of 16k stereo record data
+
+static const uint32_t kDeliverWaitTimeoutMsec = 20;
+
 
 /*==============================================================================
  *                     Implementation
@@ -40,10 +44,16 @@ AudioALSACaptureDataProviderVoice *AudioALSACaptureDataProviderVoice::getInstanc
     return mAudioALSACaptureDataProviderVoice;
 }
 
-AudioALSACaptureDataProviderVoice::AudioALSACaptureDataProviderVoice()
+AudioALSACaptureDataProviderVoice::AudioALSACaptureDataProviderVoice() :
+    mStagingDropBytes(0),
+    hDeliverThread(0)
 {
     ALOGD("%s()", __FUNCTION__);
     mCaptureDataProviderType = CAPTURE_PROVIDER_FM_RADIO;
+
+    // allocated once, the modem read thread may still touch it after close()
+    status_t retval = mStagingBuf.init(kStagingBufferSize);
+    ASSERT(retval == NO_ERROR);
 }
 
 AudioALSACaptureDataProviderVoice::~AudioALSACaptureDataProviderVoice()
@@ -68,9 +78,21 @@ status_t AudioALSACaptureDataProviderVoice::open()
     mStreamAttributeSource.audio_channel_mask = (mStreamAttributeSource.num_channels == 1) ? AUDIO_CHANNEL_IN_MONO : AUDIO_CHANNEL_IN_STEREO;
     mStreamAttributeSource.sample_rate = pSpeechDriver->GetRecordSampleRate();
 
+    OpenPCMDump(LOG_TAG);
+
+    // drop what was left by the last record, an old deliverThread only reads under mEnableLock
+    AudioRingBufView view;
+    mStagingBuf.commitRead(mStagingBuf.getReadView(&view));
+    android_atomic_release_store(0, &mStagingDropBytes);
     mEnable = true;
 
-    OpenPCMDump(LOG_TAG);
+    int ret = pthread_create(&hDeliverThread, NULL, AudioALSACaptureDataProviderVoice::deliverThread, (void *)this);
+    if (ret != 0)
+    {
+        ALOGE("%s() create thread fail!!", __FUNCTION__);
+        mEnable = false;
+        return UNKNOWN_ERROR;
+    }
 
     return SpeechDriverFactory::GetInstance()->GetSpeechDriver()->RecordOn();
 }
@@ -81,37 +103,93 @@ status_t AudioALSACaptureDataProviderVoice::close()
     ASSERT(mClientLock.tryLock() != 0); // lock by base class detach
 
     mEnable = false;
+    mStagingCond.signal(); // wake up deliverThread to exit
     AudioAutoTimeoutLock _l(mEnableLock);
 
+    const int32_t dropBytes = android_atomic_acquire_load(&mStagingDropBytes);
+    if (dropBytes > 0)
+    {
+        ALOGW("%s(), %d bytes modem record data dropped since open", __FUNCTION__, dropBytes);
+    }
+
     ClosePCMDump();
     return SpeechDriverFactory::GetInstance()->GetSpeechDriver()->RecordOff();
 }
 
 status_t AudioALSACaptureDataProviderVoice::provideModemRecordDataToProvider(RingBuf modem_record_buf)
 {
-    status_t retval = mEnableLock.lock_timeout(300);
-    ASSERT(retval == NO_ERROR);
-
+    // modem read thread: no lock here, the share buffer read ack is sent right after we return
     if (mEnable == false)
     {
         ALOGW("%s(), mEnable == false, return", __FUNCTION__);
-        mEnableLock.unlock();
         return NO_INIT;
     }
 
-    mPcmReadBuf = modem_record_buf;
-    ALOGD("%s(), pBufBase(%p), bufLen(%d), pRead(%p), pWrite(%p)",
-          __FUNCTION__,
-          mPcmReadBuf.pBufBase,
-          mPcmReadBuf.bufLen,
-          mPcmReadBuf.pRead,
-          mPcmReadBuf.pWrite);
+    const uint32_t dataCount = RingBuf_getDataCount(&modem_record_buf);
+    const uint32_t copyCount = mStagingBuf.writeFromRingBuf(&modem_record_buf, dataCount);
+    if (copyCount != dataCount)
+    {
+        // deliverThread is stuck, drop the newest data instead of holding the modem
+        android_atomic_add((int32_t)(dataCount - copyCount), &mStagingDropBytes);
+        ALOGW("%s(), staging buffer full, drop %u bytes", __FUNCTION__, dataCount - copyCount);
+    }
+    ALOGV("%s(), dataCount %u, staged %u", __FUNCTION__, dataCount, mStagingBuf.getDataCount());
 
-    mEnableLock.unlock();
+    mStagingCond.signal();
+    return NO_ERROR;
+}
 
-    provideCaptureDataToAllClients(mOpenIndex);
 
-    return NO_ERROR;
+void *AudioALSACaptureDataProviderVoice::deliverThread(void *arg)
+{
+    pthread_detach(pthread_self());
+
+    AudioALSACaptureDataProviderVoice *pDataProvider = static_cast<AudioALSACaptureDataProviderVoice *>(arg);
+
+    uint32_t open_index = pDataProvider->mOpenIndex;
+
+    prctl(PR_SET_NAME, (unsigned long)__FUNCTION__, 0, 0, 0);
+    ALOGD("+%s(), pid: %d, tid: %d, open_index=%d", __FUNCTION__, getpid(), gettid(), open_index);
+
+    char linear_buffer[kReadBufferSize];
+    while (pDataProvider->mEnable == true)
+    {
+        // wait data, a missed signal only costs kDeliverWaitTimeoutMsec
+        if (pDataProvider->mStagingBuf.getDataCount() == 0)
+        {
+            pDataProvider->mStagingLock.lock();
+            pDataProvider->mStagingCond.waitRelative(pDataProvider->mStagingLock, milliseconds(kDeliverWaitTimeoutMsec));
+            pDataProvider->mStagingLock.unlock();
+        }
+
+        status_t retval = pDataProvider->mEnableLock.lock_timeout(500);
+        ASSERT(retval == NO_ERROR);
+        if (pDataProvider->mEnable == false || open_index != pDataProvider->mOpenIndex)
+        {
+            pDataProvider->mEnableLock.unlock();
+            break;
+        }
+
+        const uint32_t readSize = pDataProvider->mStagingBuf.read(linear_buffer, kReadBufferSize);
+        if (readSize == 0)
+        {
+            pDataProvider->mEnableLock.unlock();
+            continue;
+        }
+
+        // use ringbuf format to save buffer info
+        pDataProvider->mPcmReadBuf.pBufBase = linear_buffer;
+        pDataProvider->mPcmReadBuf.bufLen   = readSize + 1; // +1: avoid pRead == pWrite
+        pDataProvider->mPcmReadBuf.pRead    = linear_buffer;
+        pDataProvider->mPcmReadBuf.pWrite   = linear_buffer + readSize;
+        pDataProvider->mEnableLock.unlock();
+
+        pDataProvider->provideCaptureDataToAllClients(open_index);
+    }
+
+    ALOGD("-%s(), pid: %d, tid: %d", __FUNCTION__, getpid(), gettid());
+    pthread_exit(NULL);
+    return NULL;
 }
 
 
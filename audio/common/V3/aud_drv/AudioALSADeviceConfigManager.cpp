@@ -32,7 +32,8 @@ AudioALSADeviceConfigManager *AudioALSADeviceConfigManager::getInstance()
 AudioALSADeviceConfigManager::AudioALSADeviceConfigManager():
     mMixer(NULL),
     mConfigsupport(false),
-    mInit(false)
+    mInit(false),
+    mCtlDiffEnable(true)
 
 {
     ALOGD("%s()", __FUNCTION__);
@@ -53,6 +54,12 @@ AudioALSADeviceConfigManager::AudioALSADeviceConfigManager():
         ASSERT(mMixer != NULL);
     }
 
+    char property_value[PROPERTY_VALUE_MAX];
+    property_get("persist.af.device_ctl_diff", property_value, "1");
+    mCtlDiffEnable = (atoi(property_value) != 0);
+
+    CompileDeviceSequence();
+
     mInit = true;
 
     dump();
@@ -247,9 +254,106 @@ status_t AudioALSADeviceConfigManager::LoadAudioConfig(const char *path)
     return NO_ERROR;
 }
 
+void AudioALSADeviceConfigManager::CompileCtlVector(const Vector<String8> &CtlVector, Vector<DeviceCtlCompiledItem> *CompiledVector)
+{
+    CompiledVector->clear();
+    CompiledVector->setCapacity(CtlVector.size() / 2);
+    for (size_t count = 0; count + 1 < CtlVector.size(); count += 2)
+    {
+        DeviceCtlCompiledItem item;
+        item.mCtl = NULL;
+        item.mEnumIndex = -1;
+
+        struct mixer_ctl *ctl = mixer_get_ctl_by_name(mMixer, CtlVector.itemAt(count).string());
+        if (ctl != NULL && mixer_ctl_get_type(ctl) == MIXER_CTL_TYPE_ENUM)
+        {
+            const char *cltvalue = CtlVector.itemAt(count + 1).string();
+            unsigned int num_enums = mixer_ctl_get_num_enums(ctl);
+            for (unsigned int index = 0; index < num_enums; index++)
+            {
+                const char *enum_string = mixer_ctl_get_enum_string(ctl, index);
+                if (enum_string != NULL && strcmp(enum_string, cltvalue) == 0)
+                {
+                    item.mCtl = ctl;
+                    item.mEnumIndex = index;
+                    break;
+                }
+            }
+        }
+
+        if (item.mCtl == NULL)
+        {
+            ALOGW("%s() can not resolve cltname = %s cltvalue = %s", __FUNCTION__,
+                  CtlVector.itemAt(count).string(), CtlVector.itemAt(count + 1).string());
+        }
+        CompiledVector->add(item);
+    }
+}
+
+void AudioALSADeviceConfigManager::CompileDeviceSequence()
+{
+    ALOGD("+%s()", __FUNCTION__);
+    if (mMixer == NULL)
+    {
+        return;
+    }
+
+    for (size_t count = 0; count < mDeviceVector.size(); count++)
+    {
+        DeviceCtlDescriptor *descriptor = mDeviceVector.itemAt(count);
+        CompileCtlVector(descriptor->mDeviceCltonVector, &descriptor->mDeviceCltonCompiled);
+        CompileCtlVector(descriptor->mDeviceCltoffVector, &descriptor->mDeviceCltoffCompiled);
+        CompileCtlVector(descriptor->mDeviceCltsettingVector, &descriptor->mDeviceCltsettingCompiled);
+    }
+    ALOGD("-%s()", __FUNCTION__);
+}
+
+status_t AudioALSADeviceConfigManager::ApplyCompiledSequence(DeviceCtlDescriptor *descriptor, const Vector<String8> &CtlVector,
+                                                             const Vector<DeviceCtlCompiledItem> &CompiledVector)
+{
+    for (size_t count = 0; count + 1 < CtlVector.size(); count += 2)
+    {
+        const String8 &cltname = CtlVector.itemAt(count);
+        const String8 &cltvalue = CtlVector.itemAt(count + 1);
+        struct mixer_ctl *ctl = NULL;
+        int enumIndex = -1;
+
+        if ((count / 2) < CompiledVector.size())
+        {
+            const DeviceCtlCompiledItem &item = CompiledVector.itemAt(count / 2);
+            ctl = item.mCtl;
+            enumIndex = item.mEnumIndex;
+
+            // the codec put callback may run power sequence even for the same value, skip it.
+            // read back the ctl itself, other modules (FTM, resource manager, codec devices) set the same ctls directly
+            if (ctl != NULL && enumIndex >= 0 && mCtlDiffEnable == true)
+            {
+                if (mixer_ctl_get_value(ctl, 0) == enumIndex)
+                {
+                    ALOGV("cltname = %s cltvalue = %s already set", cltname.string(), cltvalue.string());
+                    continue;
+                }
+            }
+        }
+
+        if (ctl == NULL)
+        {
+            ctl = mixer_get_ctl_by_name(mMixer, cltname.string());
+        }
+
+        ALOGD("cltname = %s cltvalue = %s", cltname.string(), cltvalue.string());
+        if (mixer_ctl_set_enum_by_string(ctl, cltvalue.string()))
+        {
+            ALOGE("Error: %s devicename = %s cltname = %s cltvalue = %s", __FUNCTION__,
+                  descriptor->mDevicename.string(), cltname.string(), cltvalue.string());
+            ASSERT(false);
+        }
+    }
+    return NO_ERROR;
+}
+
 status_t AudioALSADeviceConfigManager::ApplyDeviceTurnonSequenceByName(const char *DeviceName)
 {
-    int count = 0;
     DeviceCtlDescriptor *descriptor = GetDeviceDescriptorbyname(DeviceName);
     if (descriptor == NULL)
     {
@@ -259,17 +363,7 @@ status_t AudioALSADeviceConfigManager::ApplyDeviceTurnonSequenceByName(const cha
     ALOGD("%s() DeviceName = %s descriptor->DeviceStatusCounte = %d", __FUNCTION__, DeviceName, descriptor->DeviceStatusCounter);
     if (descriptor->DeviceStatusCounter == 0)
     {
-        for (count = 0; count < descriptor->mDeviceCltonVector.size(); count += 2)
-        {
-            String8 cltname = descriptor->mDeviceCltonVector.itemAt(count);
-            String8 cltvalue = descriptor->mDeviceCltonVector.itemAt(count + 1);
-            ALOGD("cltname = %s cltvalue = %s", cltname.string(), cltvalue.string());
-            if (mixer_ctl_set_enum_by_string(mixer_get_ctl_by_name(mMixer, cltname.string()), cltvalue.string()))
-            {
-                ALOGE("Error: ApplyDeviceTurnonSequence  cltname.string () = %s cltvalue.string () = %s", cltname.string(), cltvalue.string());
-                ASSERT(false);
-            }
-        }
+        ApplyCompiledSequence(descriptor, descriptor->mDeviceCltonVector, descriptor->mDeviceCltonCompiled);
     }
     descriptor->DeviceStatusCounter++;
     return NO_ERROR;
@@ -277,7 +371,6 @@ status_t AudioALSADeviceConfigManager::ApplyDeviceTurnonSequenceByName(const cha
 
 status_t AudioALSADeviceConfigManager::ApplyDeviceTurnoffSequenceByName(const char *DeviceName)
 {
-    int count = 0;
     DeviceCtlDescriptor *descriptor = GetDeviceDescriptorbyname(DeviceName);
     if (descriptor == NULL)
     {
@@ -289,17 +382,7 @@ status_t AudioALSADeviceConfigManager::ApplyDeviceTurnoffSequenceByName(const ch
     descriptor->DeviceStatusCounter--;
     if (descriptor->DeviceStatusCounter == 0)
     {
-        for (count = 0; count < descriptor->mDeviceCltoffVector.size(); count += 2)
-        {
-            String8 cltname = descriptor->mDeviceCltoffVector.itemAt(count);
-            String8 cltvalue = descriptor->mDeviceCltoffVector.itemAt(count + 1);
-            ALOGD("cltname = %s cltvalue = %s", cltname.string(), cltvalue.string());
-            if (mixer_ctl_set_enum_by_string(mixer_get_ctl_by_name(mMixer, cltname.string()), cltvalue.string()))
-            {
-                ALOGE("Error: ApplyDeviceTurnoffSequenceByName devicename = %s", descriptor->mDevicename.string());
-                ASSERT(false);
-            }
-        }
+        ApplyCompiledSequence(descriptor, descriptor->mDeviceCltoffVector, descriptor->mDeviceCltoffCompiled);
     }
     return NO_ERROR;
 }
@@ -307,7 +390,6 @@ status_t AudioALSADeviceConfigManager::ApplyDeviceTurnoffSequenceByName(const ch
 
 status_t AudioALSADeviceConfigManager::ApplyDeviceSettingByName(const char *DeviceName)
 {
-    int count = 0;
     DeviceCtlDescriptor *descriptor = GetDeviceDescriptorbyname(DeviceName);
     if (descriptor == NULL)
     {
@@ -316,18 +398,7 @@ status_t AudioALSADeviceConfigManager::ApplyDeviceSettingByName(const char *Devi
     }
     ALOGD("%s() DeviceName = %s descriptor->DeviceStatusCounte = %d", __FUNCTION__, DeviceName, descriptor->DeviceStatusCounter);
 
-    for (count = 0; count < descriptor->mDeviceCltsettingVector.size(); count += 2)
-    {
-        String8 cltname = descriptor->mDeviceCltsettingVector.itemAt(count);
-        String8 cltvalue = descriptor->mDeviceCltsettingVector.itemAt(count + 1);
-        ALOGD("cltname = %s cltvalue = %s", cltname.string(), cltvalue.string());
-        if (mixer_ctl_set_enum_by_string(mixer_get_ctl_by_name(mMixer, cltname.string()), cltvalue.string()))
-        {
-            ALOGE("Error: ApplyDeviceTurnoffSequenceByName devicename = %s", descriptor->mDevicename.string());
-            ASSERT(false);
-        }
-    }
-    return NO_ERROR;
+    return ApplyCompiledSequence(descriptor, descriptor->mDeviceCltsettingVector, descriptor->mDeviceCltsettingCompiled);
 }
 
 void AudioALSADeviceConfigManager::dump()
@@ -309,6 +309,12 @@ AudioMTKGainController::AudioMTKGainController()
     ALOGD("mMixer = %p", mMixer);
     ASSERT(mMixer != NULL);
 
+    char property_value[PROPERTY_VALUE_MAX];
+    property_get("persist.af.gain_ctl_diff", property_value, "1");
+    mGainCtlDiffEnable = (atoi(property_value) != 0);
+    mMasterVolumeDegradeDb = 0;
+    compileGainCtlCache();
+
     /* XML changed callback process */
     appHandleRegXmlChangedCb(appHandleGetInstance(), xmlChangedCallback);
 }
@@ -331,6 +337,8 @@ void AudioMTKGainController::updateXmlParam(const char *_audioTypeName)
 {
     ALOGD("%s(), audioType = %s", __FUNCTION__, _audioTypeName);
 
+    GainTableParamParser::getInstance()->invalidateSnapshot();
+
     bool needResetDlGain = false;
     bool isMicGainChanged = false;
 
@@ -365,6 +373,7 @@ void AudioMTKGainController::updateXmlParam(const char *_audioTypeName)
         GainTableParamParser::getInstance()->loadGainTableSpec();
         GainTableParamParser::getInstance()->getGainTableParam(&mGainTable);
         GainTableParamParser::getInstance()->getGainTableSpec(&mSpec);
+        compileGainCtlCache();
         isMicGainChanged = true;
         needResetDlGain = true;
     }
@@ -775,7 +784,7 @@ GAIN_DEVICE AudioMTKGainController::getGainDevice(audio_devices_t devices)
         gainDevice = GAIN_DEVICE_EARPIECE ;
     }
 
-    ALOGD("%s(), input devices = 0x%x, return gainDevice = %d", __FUNCTION__, devices, gainDevice);
+    ALOGV("%s(), input devices = 0x%x, return gainDevice = %d", __FUNCTION__, devices, gainDevice);
     return gainDevice;
 }
 
@@ -901,63 +910,78 @@ int AudioMTKGainController::GetHeadphoneLGain(void)
 
 void AudioMTKGainController::SetReceiverGain(int index)
 {
-    ALOGD("SetReceiverGain = %d", index);
-    struct mixer_ctl *ctl;
-    enum mixer_ctl_type type;
-    ctl = mixer_get_ctl_by_name(mMixer, "Handset_PGA_GAIN");
-    type = mixer_ctl_get_type(ctl);
-
     if (index < 0)
         index = 0;
 
     if ((uint32_t)index >= mSpec.bufferGainString.size())
         index = mSpec.bufferGainString.size() - 1;
 
-    if (mixer_ctl_set_enum_by_string(ctl, mSpec.bufferGainString[index].c_str()))
-    {
-        ALOGE("Error: Handset_PGA_GAIN invalid value");
-    }
+    setGainCtl(GAIN_CTL_HANDSET, "Handset_PGA_GAIN", mSpec.bufferGainString, index);
 }
 
 void AudioMTKGainController::SetHeadPhoneLGain(int index)
 {
-    ALOGD("SetHeadPhoneLGain = %d", index);
-    struct mixer_ctl *ctl;
-    enum mixer_ctl_type type;
-    ctl = mixer_get_ctl_by_name(mMixer, "Headset_PGAL_GAIN");
-    type = mixer_ctl_get_type(ctl);
-
     if (index < 0)
         index = 0;
 
     if ((uint32_t)index >= mSpec.bufferGainString.size())
         index = mSpec.bufferGainString.size() - 1;
 
-    if (mixer_ctl_set_enum_by_string(ctl, mSpec.bufferGainString[index].c_str()))
-    {
-        ALOGE("Error: Headset_PGAL_GAIN invalid value");
-    }
+    setGainCtl(GAIN_CTL_HEADSET_L, "Headset_PGAL_GAIN", mSpec.bufferGainString, index);
 }
 
 void AudioMTKGainController::SetHeadPhoneRGain(int index)
 {
-    ALOGD("SetHeadPhoneRGain = %d", index);
-    struct mixer_ctl *ctl;
-    enum mixer_ctl_type type;
-    ctl = mixer_get_ctl_by_name(mMixer, "Headset_PGAR_GAIN");
-    type = mixer_ctl_get_type(ctl);
-
     if (index < 0)
         index = 0;
 
     if ((uint32_t)index >= mSpec.bufferGainString.size())
         index = mSpec.bufferGainString.size() - 1;
-    if (mixer_ctl_set_enum_by_string(ctl, mSpec.bufferGainString[index].c_str()))
+
+    setGainCtl(GAIN_CTL_HEADSET_R, "Headset_PGAR_GAIN", mSpec.bufferGainString, index);
+}
+
+void AudioMTKGainController::compileGainCtlCache()
+{
+    mGainCtlCache[GAIN_CTL_HANDSET].ctl = mixer_get_ctl_by_name(mMixer, "Handset_PGA_GAIN");
+    mGainCtlCache[GAIN_CTL_HEADSET_L].ctl = mixer_get_ctl_by_name(mMixer, "Headset_PGAL_GAIN");
+    mGainCtlCache[GAIN_CTL_HEADSET_R].ctl = mixer_get_ctl_by_name(mMixer, "Headset_PGAR_GAIN");
+    mGainCtlCache[GAIN_CTL_SPEAKER_L].ctl = mixer_get_ctl_by_name(mMixer, mSpec.spkLMixerName.c_str());
+    mGainCtlCache[GAIN_CTL_SPEAKER_R].ctl = mixer_get_ctl_by_name(mMixer, mSpec.spkRMixerName.c_str());
+
+    // gain strings may have changed with the spec, write everything again
+    for (int i = 0; i < NUM_GAIN_CTL; i++)
     {
-        ALOGE("Error: Headset_PGAR_GAIN invalid value");
+        mGainCtlCache[i].lastIndex = -1;
     }
 }
 
+void AudioMTKGainController::setGainCtl(gain_ctl_t gainCtl, const char *ctlName,
+                                        const std::vector<std::string> &enumString, int index)
+{
+    gain_ctl_cache_t *pCache = &mGainCtlCache[gainCtl];
+
+    if (mGainCtlDiffEnable && pCache->lastIndex == index)
+    {
+        ALOGV("%s(), %s = %d already set", __FUNCTION__, ctlName, index);
+        return;
+    }
+
+    if (pCache->ctl == NULL)
+    {
+        pCache->ctl = mixer_get_ctl_by_name(mMixer, ctlName);
+    }
+
+    ALOGD("%s(), %s = %d", __FUNCTION__, ctlName, index);
+    if (mixer_ctl_set_enum_by_string(pCache->ctl, enumString[index].c_str()))
+    {
+        ALOGE("Error: %s invalid value", ctlName);
+        pCache->lastIndex = -1;
+        return;
+    }
+    pCache->lastIndex = index;
+}
+
 void   AudioMTKGainController::setAudioBufferGain(int gain)
 {
 #ifdef MTK_AUDIO_SW_DRE
@@ -1039,20 +1063,11 @@ void AudioMTKGainController::SetSpeakerGain(int index)
     if ((uint32_t)index >= enumString->size())
         index = enumString->size() - 1;
 
-    struct mixer_ctl *ctl;
     // left chanel
-    ctl = mixer_get_ctl_by_name(mMixer, mSpec.spkLMixerName.c_str());
-    if (mixer_ctl_set_enum_by_string(ctl, enumString->at(index).c_str()))
-    {
-        ALOGE("Error: %s invalid value", mSpec.spkLMixerName.c_str());
-    }
+    setGainCtl(GAIN_CTL_SPEAKER_L, mSpec.spkLMixerName.c_str(), *enumString, index);
 #ifdef ENABLE_STEREO_SPEAKER
     // right channel
-    ctl = mixer_get_ctl_by_name(mMixer, mSpec.spkRMixerName.c_str());
-    if (mixer_ctl_set_enum_by_string(ctl, enumString->at(index).c_str()))
-    {
-        ALOGE("Error: %s invalid value", mSpec.spkRMixerName.c_str());
-    }
+    setGainCtl(GAIN_CTL_SPEAKER_R, mSpec.spkRMixerName.c_str(), *enumString, index);
 #endif
 }
 
@@ -1070,8 +1085,8 @@ void   AudioMTKGainController::setSpeakerGain(int gain)
     {
         if (!isInVoiceCall(mHwStream.mode)) // mMasterVolume don't affect voice call
         {
-            int degradedB = (keyvolumeStep - logToLinear(mMasterVolume)) * keydBPerStep;
-            ALOGD("%s(), degraded gain of mMasterVolume = %d dB", __FUNCTION__, degradedB);
+            int degradedB = mMasterVolumeDegradeDb;
+            ALOGV("%s(), degraded gain of mMasterVolume = %d dB", __FUNCTION__, degradedB);
             gain -= degradedB;
             if (gain <= 0) //avoid mute
                 gain = 1;
@@ -1421,8 +1436,8 @@ int AudioMTKGainController::tuneGainForMasterVolume(int gain, audio_mode_t mode,
     if (!isInVoiceCall(mode) && // mMasterVolume don't affect voice call
         gain <= mSpec.bufferGainPreferMaxIdx) // don't change gain if already mute(-40dB)
     {
-        int degradedB = (keyvolumeStep - logToLinear(mMasterVolume)) * keydBPerStep;
-        ALOGD("%s(), degraded gain of mMasterVolume = %d dB", __FUNCTION__, degradedB);
+        int degradedB = mMasterVolumeDegradeDb;
+        ALOGV("%s(), degraded gain of mMasterVolume = %d dB", __FUNCTION__, degradedB);
         if (gain + degradedB <= mSpec.bufferGainPreferMaxIdx)
             gain += degradedB;
         else
@@ -1480,6 +1495,7 @@ status_t AudioMTKGainController::setMasterVolume(float v, audio_mode_t mode, uin
 {
     ALOGD("%s(), mMasterVolume = %f, mode = %d, devices = 0x%x", __FUNCTION__, v, mode, devices);
     mMasterVolume = v;
+    mMasterVolumeDegradeDb = (keyvolumeStep - logToLinear(mMasterVolume)) * keydBPerStep;
     mHwStream.mode = mode;
     if(!isInVoiceCall(mode))
     {
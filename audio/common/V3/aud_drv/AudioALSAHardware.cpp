@@ -44,6 +44,10 @@
 #include "AudioParamParser.h"
 #endif
 
+#ifdef AUDIO_POLICY_TEST
+#include "AudioPolicyParameters.h"
+#endif
+
 #define LOG_TAG "AudioALSAHardware"
 
 namespace android
@@ -218,6 +222,20 @@ static String8 keyMTK_VOW_SUPPORT = String8("MTK_VOW_SUPPORT");
 
 static String8 keyNUM_HEADSET_POLE = String8("num_hs_pole");
 
+#ifdef AUDIO_POLICY_TEST
+static String8 keyTestCmdPolicy = String8("test_cmd_policy");
+static const char *keyTestCmdPolicyArgs[] =
+{
+    "test_cmd_policy_output",
+    "test_cmd_policy_direct",
+    "test_cmd_policy_input",
+    "test_cmd_policy_format",
+    "test_cmd_policy_channels",
+    "test_cmd_policy_sampleRate",
+    "test_cmd_policy_reopen",
+};
+#endif
+
 #if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)||defined(MTK_AUDIO_GAIN_TABLE)
 static String8 keyVolumeStreamType    = String8("volumeStreamType");;
 static String8 keyVolumeDevice        = String8("volumeDevice");
@@ -260,9 +278,11 @@ AudioALSAHardware::AudioALSAHardware() :
     mSpeechANCControllerInstance(SpeechANCController::getInstance()),
     mSpeechPhoneCallController(AudioALSASpeechPhoneCallController::getInstance()),
     mAudioAlsaDeviceInstance(AudioALSADeviceParser::getInstance()),
-    mFmTxEnable(false)
+    mFmTxEnable(false),
+    mParamDispatcher("AudioALSAHardware")
 {
     ALOGD("%s()", __FUNCTION__);
+    initParamDispatcher();
 #if defined(MTK_SPEAKER_MONITOR_SUPPORT)
     AudioALSASpeakerMonitor::getInstance()->EnableSpeakerMonitorThread(true);
 #endif
@@ -364,21 +384,20 @@ status_t AudioALSAHardware::getMicMute(bool *state)
 
 status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
 {
-    ALOGD("+%s(): %s", __FUNCTION__, keyValuePairs.string());
+    ALOGV("+%s(): %s", __FUNCTION__, keyValuePairs.string());
     AudioParameter param = AudioParameter(keyValuePairs);
 
+    /// keys with a handler, the ladder below only runs for the rest
+    status_t status = mParamDispatcher.dispatch(this, param);
+    if (param.size() == 0)
+    {
+        return status;
+    }
+
     /// parse key value pairs
-    status_t status = NO_ERROR;
     int value = 0;
-    float value_float = 0.0;
     String8 value_str;
 
-    if (param.getFloat(String8("setMasterVolume"), value_float) == NO_ERROR)
-    {
-        param.remove(String8("setMasterVolume"));
-        mStreamManager->setMasterVolume(value_float);
-    }
-
     //Tina temp for 6595 eccci fake
     if (param.getInt(String8("ECCCI_Test"), value) == NO_ERROR)
     {
@@ -621,98 +640,6 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
         }
     }
 
-    // VT call (true) / Voice call (false)
-    if (param.getInt(keySetVTSpeechCall, value) == NO_ERROR)
-    {
-        param.remove(keySetVTSpeechCall);
-        mStreamManager->setVtNeedOn((bool)value);
-    }
-
-    // Set BGS DL Mute (true) / Unmute(false)
-    if (param.getInt(keySet_BGS_DL_Mute, value) == NO_ERROR)
-    {
-        param.remove(keySet_BGS_DL_Mute);
-        ALOGD("%s(), %s", __FUNCTION__, keyValuePairs.string());
-        mStreamManager->setBGSDlMute((bool)value);
-    }
-
-    // Set BGS UL Mute (true) / Unmute(false)
-    if (param.getInt(keySet_BGS_UL_Mute, value) == NO_ERROR)
-    {
-        param.remove(keySet_BGS_UL_Mute);
-        ALOGD("%s(), %s", __FUNCTION__, keyValuePairs.string());
-        mStreamManager->setBGSUlMute((bool)value);
-    }
-
-    // Set SpeechCall DL Mute (true) / Unmute(false)
-    if (param.getInt(keySet_SpeechCall_DL_Mute, value) == NO_ERROR)
-    {
-        param.remove(keySet_SpeechCall_DL_Mute);
-        ALOGD("%s(), %s", __FUNCTION__, keyValuePairs.string());
-        mSpeechPhoneCallController->setDlMute((bool)value);
-    }
-
-    // Set SpeechCall UL Mute (true) / Unmute(false)
-    if (param.getInt(keySet_SpeechCall_UL_Mute, value) == NO_ERROR)
-    {
-        param.remove(keySet_SpeechCall_UL_Mute);
-        ALOGD("%s(), %s", __FUNCTION__, keyValuePairs.string());
-        mSpeechPhoneCallController->setUlMute((bool)value);
-    }
-
-    // FM enable
-    if (param.getInt(keySetFmEnable, value) == NO_ERROR)
-    {
-        param.remove(keySetFmEnable);
-        if (mUseAudioPatchForFm == false)
-        {
-            mStreamManager->setFmEnable((bool)value);
-        }
-    }
-
-    // Set FM volume
-    if (param.getFloat(keySetFmVolume, value_float) == NO_ERROR)
-    {
-        param.remove(keySetFmVolume);
-        if (mUseAudioPatchForFm == false)
-        {
-            mStreamManager->setFmVolume(value_float);
-        }
-    }
-
-    // Set FM Tx enable
-    if (param.getInt(keySetFmTxEnable, value) == NO_ERROR)
-    {
-        param.remove(keySetFmTxEnable);
-        mFmTxEnable = (bool)value;
-    }
-
-    // Force dusable FM Tx due to FM Rx is ready to play
-    if (param.getInt(keyFMRXForceDisableFMTX, value) == NO_ERROR)
-    {
-        param.remove(keyFMRXForceDisableFMTX);
-        if (value == true)
-        {
-            mFmTxEnable = false;
-        }
-    }
-
-
-    if (param.getInt(keyMusicPlusSet, value) == NO_ERROR)
-    {
-        param.remove(keyMusicPlusSet);
-        mStreamManager->SetMusicPlusStatus(value ? true : false);
-    }
-
-    // set the LR channel switch
-    if (param.getInt(keyLR_ChannelSwitch, value) == NO_ERROR)
-    {
-        ALOGD("keyLR_ChannelSwitch=%d", value);
-        bool bIsLRSwitch = value;
-        AudioALSAHardwareResourceManager::getInstance()->setMicInverse(bIsLRSwitch);
-        param.remove(keyLR_ChannelSwitch);
-    }
-
     // BesRecord Mode setting
     if (param.getInt(keyHDREC_SET_VOICE_MODE, value) == NO_ERROR)
     {
@@ -751,40 +678,6 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
         }
     }
 
-#ifdef BTNREC_DECIDED_BY_DEVICE
-    // BT NREC on/off
-    if (param.get(keyBtHeadsetNrec, value_str) == NO_ERROR)
-    {
-        param.remove(keyBtHeadsetNrec);
-        if (value_str == "on")
-        {
-            mStreamManager->SetBtHeadsetNrec(true);
-        }
-        else if (value_str == "off")
-        {
-            mStreamManager->SetBtHeadsetNrec(false);
-        }
-    }
-#endif
-    if (param.get(keySetBTMode, value_str) == NO_ERROR)
-    {
-        param.remove(keySetBTMode);
-
-        ALOGD("%s(), setBTMode = %d", __FUNCTION__, value);
-        if (value_str == "on")
-        {
-            WCNChipController::GetInstance()->SetBTCurrentSamplingRateNumber(16000);
-            AudioBTCVSDControl::getInstance()->BT_SCO_SetMode(true);
-            mSpeechPhoneCallController->setBTMode(true);
-        }
-        else if (value_str == "off")
-        {
-            WCNChipController::GetInstance()->SetBTCurrentSamplingRateNumber(8000);
-            AudioBTCVSDControl::getInstance()->BT_SCO_SetMode(false);
-            mSpeechPhoneCallController->setBTMode(false);
-        }
-    }
-
     //<---for audio tool(speech/ACF/HCF/DMNR/HD/Audiotaste calibration)
     // calibrate speech parameters
     if (param.getInt(keySpeechParams_Update, value) == NO_ERROR)
@@ -1010,24 +903,6 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
     }
 #endif
 
-#if defined(MTK_HAC_SUPPORT)
-    // HAC
-    if (param.get(keySET_HAC_ENABLE, value_str) == NO_ERROR)
-    {
-        param.remove(keySET_HAC_ENABLE);
-
-        if (value_str == "ON")
-        {
-            mStreamManager->SetHACEnable(true);
-        }
-        else if (value_str == "OFF")
-        {
-            mStreamManager->SetHACEnable(false);
-        }
-    }
-
-#endif
-
 #if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)
     // VM Log
     if (param.getInt(keySET_VMLOG_CONFIG, value) == NO_ERROR)
@@ -1127,48 +1002,6 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
     }
 #endif
 
-#ifdef  MTK_TTY_SUPPORT
-    // Set TTY mode
-    if (param.get(keySetTtyMode, value_str) == NO_ERROR)
-    {
-        param.remove(keySetTtyMode);
-        tty_mode_t tty_mode;
-
-        if (value_str == "tty_full")
-        {
-            tty_mode = AUD_TTY_FULL;
-        }
-        else if (value_str == "tty_vco")
-        {
-            tty_mode = AUD_TTY_VCO;
-        }
-        else if (value_str == "tty_hco")
-        {
-            tty_mode = AUD_TTY_HCO;
-        }
-        else if (value_str == "tty_off")
-        {
-            tty_mode = AUD_TTY_OFF;
-        }
-        else
-        {
-            ALOGD("setParameters tty_mode error !!");
-            tty_mode = AUD_TTY_ERR;
-        }
-        mSpeechPhoneCallController->setTtyMode(tty_mode);
-    }
-#endif
-
-    // Low latency mode
-    if (param.get(keySCREEN_STATE, value_str) == NO_ERROR)
-    {
-        param.remove(keySCREEN_STATE);
-        //Diable low latency mode for 32bits audio task
-#ifndef MTK_DYNAMIC_CHANGE_HAL_BUFFER_SIZE
-        setLowLatencyMode(value_str == "on");
-#endif
-    }
-
     // Loopback use speaker or not
     static bool bForceUseLoudSpeakerInsteadOfReceiver = false;
     if (param.getInt(keySET_LOOPBACK_USE_LOUD_SPEAKER, value) == NO_ERROR)
@@ -1238,30 +1071,6 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
         }
     }
 
-#if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)||defined(MTK_AUDIO_GAIN_TABLE)
-
-    if (param.getInt(keyVolumeStreamType, value) == NO_ERROR)
-    {
-        int device = 0;
-        int index = 0;
-        if (param.getInt(keyVolumeDevice, device) == NO_ERROR)
-        {
-            if (param.getInt(keyVolumeIndex, index) == NO_ERROR)
-            {
-#ifdef MTK_AUDIO_GAIN_TABLE
-                mStreamManager->setAnalogVolume(value, device, index, 0);
-#endif
-#if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)
-                mStreamManager->setMDVolumeIndex(value, device, index);
-#endif
-
-            }
-        }
-        param.remove(keyVolumeStreamType);
-        param.remove(keyVolumeDevice);
-        param.remove(keyVolumeIndex);
-    }
-#endif
 
 #ifdef MTK_AUDIO_GAIN_TABLE
     // Set ACS volume
@@ -1333,20 +1142,6 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
         mStreamManager->SetCaptureGain();
         param.remove(keyMicGain_Update);
     }
-
-    //BT VGS feature +
-    if (param.get(keyBtSupportVolume, value_str) == NO_ERROR)
-    {
-        param.remove(keyBtSupportVolume);
-        if (value_str == "on")
-        {
-            mAudioALSAVolumeController->setBtVolumeCapability(true);
-        }
-        else if (value_str == "off")
-        {
-            mAudioALSAVolumeController->setBtVolumeCapability(false);
-        }
-    }
 #endif
 
 #ifdef MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT
@@ -1537,9 +1332,162 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
 
 #endif
 
-    if (param.getInt(keySetFlightMode, value) == NO_ERROR)
+    if (param.size())
+    {
+        ALOGW("%s(), still have param.size() = %d, remain param = \"%s\"",
+              __FUNCTION__, param.size(), param.toString().string());
+        status = BAD_VALUE;
+    }
+
+    ALOGV("-%s(): %s ", __FUNCTION__, keyValuePairs.string());
+    return status;
+}
+
+void AudioALSAHardware::initParamDispatcher()
+{
+    mParamDispatcher.add("setMasterVolume", &AudioALSAHardware::setParamMasterVolume);
+
+    // Phone Call Related
+    mParamDispatcher.add(keySetVTSpeechCall.string(), &AudioALSAHardware::setParamVTSpeechCall);
+    mParamDispatcher.add(keySet_BGS_DL_Mute.string(), &AudioALSAHardware::setParamMute);
+    mParamDispatcher.add(keySet_BGS_UL_Mute.string(), &AudioALSAHardware::setParamMute);
+    mParamDispatcher.add(keySet_SpeechCall_DL_Mute.string(), &AudioALSAHardware::setParamMute);
+    mParamDispatcher.add(keySet_SpeechCall_UL_Mute.string(), &AudioALSAHardware::setParamMute);
+    mParamDispatcher.add(keySetFlightMode.string(), &AudioALSAHardware::setParamFlightMode);
+#ifdef  MTK_TTY_SUPPORT
+    mParamDispatcher.add(keySetTtyMode.string(), &AudioALSAHardware::setParamTtyMode);
+#endif
+#if defined(MTK_HAC_SUPPORT)
+    mParamDispatcher.add(keySET_HAC_ENABLE.string(), &AudioALSAHardware::setParamHACEnable);
+#endif
+
+    // FM Rx / Tx Related
+    mParamDispatcher.add(keySetFmEnable.string(), &AudioALSAHardware::setParamFm);
+    mParamDispatcher.add(keySetFmVolume.string(), &AudioALSAHardware::setParamFm);
+    mParamDispatcher.add(keySetFmTxEnable.string(), &AudioALSAHardware::setParamFm);
+    mParamDispatcher.add(keyFMRXForceDisableFMTX.string(), &AudioALSAHardware::setParamFm);
+
+    // BT
+#ifdef BTNREC_DECIDED_BY_DEVICE
+    mParamDispatcher.add(keyBtHeadsetNrec.string(), &AudioALSAHardware::setParamBtHeadsetNrec);
+#endif
+    mParamDispatcher.add(keySetBTMode.string(), &AudioALSAHardware::setParamBtMode);
+#ifdef MTK_AUDIO_GAIN_TABLE
+    mParamDispatcher.add(keyBtSupportVolume.string(), &AudioALSAHardware::setParamBtSupportVolume);
+#endif
+
+    // Volume
+#if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)||defined(MTK_AUDIO_GAIN_TABLE)
+    mParamDispatcher.add(keyVolumeStreamType.string(), &AudioALSAHardware::setParamVolumeIndex);
+    mParamDispatcher.add(keyVolumeDevice.string(), &AudioALSAHardware::setParamConsumed);
+    mParamDispatcher.add(keyVolumeIndex.string(), &AudioALSAHardware::setParamConsumed);
+#endif
+
+    // Misc
+    mParamDispatcher.add(keySCREEN_STATE.string(), &AudioALSAHardware::setParamScreenState);
+    mParamDispatcher.add(keyMusicPlusSet.string(), &AudioALSAHardware::setParamMusicPlus);
+    mParamDispatcher.add(keyLR_ChannelSwitch.string(), &AudioALSAHardware::setParamLRChannelSwitch);
+    mParamDispatcher.add(keyNUM_HEADSET_POLE.string(), &AudioALSAHardware::setParamNumHeadsetPole);
+
+#ifdef AUDIO_POLICY_TEST
+    mParamDispatcher.add(keyTestCmdPolicy.string(), &AudioALSAHardware::setParamPolicyTestCommand);
+    for (size_t i = 0; i < sizeof(keyTestCmdPolicyArgs) / sizeof(keyTestCmdPolicyArgs[0]); i++)
+    {
+        mParamDispatcher.add(keyTestCmdPolicyArgs[i], &AudioALSAHardware::setParamConsumed);
+    }
+#endif
+}
+
+status_t AudioALSAHardware::setParamConsumed(AudioParameter &param, const String8 &key)
+{
+    // read by the handler of another key in the same call
+    return NO_ERROR;
+}
+
+#ifdef AUDIO_POLICY_TEST
+status_t AudioALSAHardware::setParamPolicyTestCommand(AudioParameter &param, const String8 &key)
+{
+    // keep the command and its arguments for getParameters(), the policy test thread reads them back
+    mPolicyTestParam = AudioParameter();
+    String8 argKey, argValue;
+    for (size_t i = 0; i < param.size(); i++)
+    {
+        if (param.getAt(i, argKey, argValue) == NO_ERROR &&
+            strncmp(argKey.string(), key.string(), key.length()) == 0)
+        {
+            mPolicyTestParam.add(argKey, argValue);
+        }
+    }
+
+    // the policy itself clears the command with an empty value, only wake it for a new one
+    int value = 0;
+    if (param.getInt(key, value) == NO_ERROR && value != 0)
+    {
+        const sp<IAudioPolicyService> &aps = AudioSystem::get_audio_policy_service();
+        if (aps != 0)
+        {
+            aps->SetPolicyManagerParameters(POLICY_TEST_COMMAND, 0, 0, 0);
+        }
+    }
+    return NO_ERROR;
+}
+#endif
+
+status_t AudioALSAHardware::setParamMasterVolume(AudioParameter &param, const String8 &key)
+{
+    float value_float = 0.0;
+    if (param.getFloat(key, value_float) == NO_ERROR)
+    {
+        mStreamManager->setMasterVolume(value_float);
+    }
+    return NO_ERROR;
+}
+
+status_t AudioALSAHardware::setParamVTSpeechCall(AudioParameter &param, const String8 &key)
+{
+    // VT call (true) / Voice call (false)
+    int value = 0;
+    if (param.getInt(key, value) == NO_ERROR)
+    {
+        mStreamManager->setVtNeedOn((bool)value);
+    }
+    return NO_ERROR;
+}
+
+status_t AudioALSAHardware::setParamMute(AudioParameter &param, const String8 &key)
+{
+    // Mute (true) / Unmute(false)
+    int value = 0;
+    if (param.getInt(key, value) != NO_ERROR)
+    {
+        return NO_ERROR;
+    }
+    ALOGD("%s(), %s=%d", __FUNCTION__, key.string(), value);
+
+    if (key == keySet_BGS_DL_Mute)
+    {
+        mStreamManager->setBGSDlMute((bool)value);
+    }
+    else if (key == keySet_BGS_UL_Mute)
+    {
+        mStreamManager->setBGSUlMute((bool)value);
+    }
+    else if (key == keySet_SpeechCall_DL_Mute)
+    {
+        mSpeechPhoneCallController->setDlMute((bool)value);
+    }
+    else if (key == keySet_SpeechCall_UL_Mute)
+    {
+        mSpeechPhoneCallController->setUlMute((bool)value);
+    }
+    return NO_ERROR;
+}
+
+status_t AudioALSAHardware::setParamFlightMode(AudioParameter &param, const String8 &key)
+{
+    int value = 0;
+    if (param.getInt(key, value) == NO_ERROR)
     {
-        param.remove(keySetFlightMode);
         if (value == 1)
         {
             ALOGD("flignt mode=1");
@@ -1549,22 +1497,235 @@ status_t AudioALSAHardware::setParameters(const String8 &keyValuePairs)
             ALOGD("flight mode=0");
         }
     }
+    return NO_ERROR;
+}
 
-    if (param.getInt(keyNUM_HEADSET_POLE, value) == NO_ERROR)
+#ifdef  MTK_TTY_SUPPORT
+status_t AudioALSAHardware::setParamTtyMode(AudioParameter &param, const String8 &key)
+{
+    String8 value_str;
+    if (param.get(key, value_str) != NO_ERROR)
     {
-        param.remove(keyNUM_HEADSET_POLE);
-        AudioALSAHardwareResourceManager::getInstance()->setNumOfHeadsetPole(value);
+        return NO_ERROR;
     }
 
-    if (param.size())
+    tty_mode_t tty_mode;
+    if (value_str == "tty_full")
     {
-        ALOGW("%s(), still have param.size() = %d, remain param = \"%s\"",
-              __FUNCTION__, param.size(), param.toString().string());
-        status = BAD_VALUE;
+        tty_mode = AUD_TTY_FULL;
+    }
+    else if (value_str == "tty_vco")
+    {
+        tty_mode = AUD_TTY_VCO;
     }
+    else if (value_str == "tty_hco")
+    {
+        tty_mode = AUD_TTY_HCO;
+    }
+    else if (value_str == "tty_off")
+    {
+        tty_mode = AUD_TTY_OFF;
+    }
+    else
+    {
+        ALOGD("setParameters tty_mode error !!");
+        tty_mode = AUD_TTY_ERR;
+    }
+    mSpeechPhoneCallController->setTtyMode(tty_mode);
+    return NO_ERROR;
+}
+#endif
 
-    ALOGD("-%s(): %s ", __FUNCTION__, keyValuePairs.string());
-    return status;
+#if defined(MTK_HAC_SUPPORT)
+status_t AudioALSAHardware::setParamHACEnable(AudioParameter &param, const String8 &key)
+{
+    String8 value_str;
+    if (param.get(key, value_str) == NO_ERROR)
+    {
+        if (value_str == "ON")
+        {
+            mStreamManager->SetHACEnable(true);
+        }
+        else if (value_str == "OFF")
+        {
+            mStreamManager->SetHACEnable(false);
+        }
+    }
+    return NO_ERROR;
+}
+#endif
+
+status_t AudioALSAHardware::setParamFm(AudioParameter &param, const String8 &key)
+{
+    int value = 0;
+    float value_float = 0.0;
+
+    if (key == keySetFmEnable)
+    {
+        // FM enable
+        if (param.getInt(key, value) == NO_ERROR && mUseAudioPatchForFm == false)
+        {
+            mStreamManager->setFmEnable((bool)value);
+        }
+    }
+    else if (key == keySetFmVolume)
+    {
+        // Set FM volume
+        if (param.getFloat(key, value_float) == NO_ERROR && mUseAudioPatchForFm == false)
+        {
+            mStreamManager->setFmVolume(value_float);
+        }
+    }
+    else if (key == keySetFmTxEnable)
+    {
+        // Set FM Tx enable
+        if (param.getInt(key, value) == NO_ERROR)
+        {
+            mFmTxEnable = (bool)value;
+        }
+    }
+    else if (key == keyFMRXForceDisableFMTX)
+    {
+        // Force dusable FM Tx due to FM Rx is ready to play
+        if (param.getInt(key, value) == NO_ERROR && value == true)
+        {
+            mFmTxEnable = false;
+        }
+    }
+    return NO_ERROR;
+}
+
+#ifdef BTNREC_DECIDED_BY_DEVICE
+status_t AudioALSAHardware::setParamBtHeadsetNrec(AudioParameter &param, const String8 &key)
+{
+    // BT NREC on/off
+    String8 value_str;
+    if (param.get(key, value_str) == NO_ERROR)
+    {
+        if (value_str == "on")
+        {
+            mStreamManager->SetBtHeadsetNrec(true);
+        }
+        else if (value_str == "off")
+        {
+            mStreamManager->SetBtHeadsetNrec(false);
+        }
+    }
+    return NO_ERROR;
+}
+#endif
+
+status_t AudioALSAHardware::setParamBtMode(AudioParameter &param, const String8 &key)
+{
+    String8 value_str;
+    if (param.get(key, value_str) != NO_ERROR)
+    {
+        return NO_ERROR;
+    }
+
+    ALOGD("%s(), setBTMode = %s", __FUNCTION__, value_str.string());
+    if (value_str == "on")
+    {
+        WCNChipController::GetInstance()->SetBTCurrentSamplingRateNumber(16000);
+        AudioBTCVSDControl::getInstance()->BT_SCO_SetMode(true);
+        mSpeechPhoneCallController->setBTMode(true);
+    }
+    else if (value_str == "off")
+    {
+        WCNChipController::GetInstance()->SetBTCurrentSamplingRateNumber(8000);
+        AudioBTCVSDControl::getInstance()->BT_SCO_SetMode(false);
+        mSpeechPhoneCallController->setBTMode(false);
+    }
+    return NO_ERROR;
+}
+
+#ifdef MTK_AUDIO_GAIN_TABLE
+status_t AudioALSAHardware::setParamBtSupportVolume(AudioParameter &param, const String8 &key)
+{
+    //BT VGS feature +
+    String8 value_str;
+    if (param.get(key, value_str) == NO_ERROR)
+    {
+        if (value_str == "on")
+        {
+            mAudioALSAVolumeController->setBtVolumeCapability(true);
+        }
+        else if (value_str == "off")
+        {
+            mAudioALSAVolumeController->setBtVolumeCapability(false);
+        }
+    }
+    return NO_ERROR;
+}
+#endif
+
+#if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)||defined(MTK_AUDIO_GAIN_TABLE)
+status_t AudioALSAHardware::setParamVolumeIndex(AudioParameter &param, const String8 &key)
+{
+    // volumeDevice / volumeIndex come in the same call
+    int value = 0;
+    int device = 0;
+    int index = 0;
+    if (param.getInt(key, value) == NO_ERROR &&
+        param.getInt(keyVolumeDevice, device) == NO_ERROR &&
+        param.getInt(keyVolumeIndex, index) == NO_ERROR)
+    {
+#ifdef MTK_AUDIO_GAIN_TABLE
+        mStreamManager->setAnalogVolume(value, device, index, 0);
+#endif
+#if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)
+        mStreamManager->setMDVolumeIndex(value, device, index);
+#endif
+    }
+    return NO_ERROR;
+}
+#endif
+
+status_t AudioALSAHardware::setParamScreenState(AudioParameter &param, const String8 &key)
+{
+    // Low latency mode
+    String8 value_str;
+    if (param.get(key, value_str) == NO_ERROR)
+    {
+        //Diable low latency mode for 32bits audio task
+#ifndef MTK_DYNAMIC_CHANGE_HAL_BUFFER_SIZE
+        setLowLatencyMode(value_str == "on");
+#endif
+    }
+    return NO_ERROR;
+}
+
+status_t AudioALSAHardware::setParamMusicPlus(AudioParameter &param, const String8 &key)
+{
+    int value = 0;
+    if (param.getInt(key, value) == NO_ERROR)
+    {
+        mStreamManager->SetMusicPlusStatus(value ? true : false);
+    }
+    return NO_ERROR;
+}
+
+status_t AudioALSAHardware::setParamLRChannelSwitch(AudioParameter &param, const String8 &key)
+{
+    // set the LR channel switch
+    int value = 0;
+    if (param.getInt(key, value) == NO_ERROR)
+    {
+        ALOGD("keyLR_ChannelSwitch=%d", value);
+        bool bIsLRSwitch = value;
+        AudioALSAHardwareResourceManager::getInstance()->setMicInverse(bIsLRSwitch);
+    }
+    return NO_ERROR;
+}
+
+status_t AudioALSAHardware::setParamNumHeadsetPole(AudioParameter &param, const String8 &key)
+{
+    int value = 0;
+    if (param.getInt(key, value) == NO_ERROR)
+    {
+        AudioALSAHardwareResourceManager::getInstance()->setNumOfHeadsetPole(value);
+    }
+    return NO_ERROR;
 }
 
 String8 AudioALSAHardware::getParameters(const String8 &keys)
@@ -1576,6 +1737,20 @@ String8 AudioALSAHardware::getParameters(const String8 &keys)
     AudioParameter param = AudioParameter(keys);
     AudioParameter returnParam = AudioParameter();
 
+#ifdef AUDIO_POLICY_TEST
+    if (param.get(keyTestCmdPolicy, value) == NO_ERROR)
+    {
+        param.remove(keyTestCmdPolicy);
+        String8 argKey, argValue;
+        for (size_t i = 0; i < mPolicyTestParam.size(); i++)
+        {
+            if (mPolicyTestParam.getAt(i, argKey, argValue) == NO_ERROR)
+            {
+                returnParam.add(argKey, argValue);
+            }
+        }
+    }
+#endif
     if (param.get(keyMTK_AUDENH_SUPPORT, value) == NO_ERROR)
     {
         param.remove(keyMTK_AUDENH_SUPPORT);
@@ -2304,6 +2479,7 @@ status_t AudioALSAHardware::dumpState(int fd, const Vector<String16> &args)
 status_t AudioALSAHardware::dump(int fd, const Vector<String16> &args)
 {
     ALOGD("%s()", __FUNCTION__);
+    mParamDispatcher.dump(fd);
     return NO_ERROR;
 }
 
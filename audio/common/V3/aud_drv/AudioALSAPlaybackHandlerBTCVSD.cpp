@@ -202,49 +202,26 @@ ssize_t AudioALSAPlaybackHandlerBTCVSD::write(const void *buffer, size_t bytes)
     doBitConversion(pBuffer, bytes, &pBufferAfterBitConvertion, &bytesAfterBitConvertion);
 
 
-    // write data to bt cvsd driver
-    uint8_t *outbuffer, *inbuf, *workbuf;
-    uint32_t insize, outsize, workbufsize, total_outsize, src_fs_s;
+    if (mBTMode_Open != mAudioBTCVSDControl->BT_SCO_isWideBand())
+    {
+        ALOGD("BTSCO change mode after TX_Begin!!!");
+        mAudioBTCVSDControl->BT_SCO_TX_End(mFd2);
+        mAudioBTCVSDControl->BT_SCO_TX_Begin(mFd2, mStreamAttributeSource->sample_rate, mStreamAttributeSource->num_channels);
+        mBTMode_Open = mAudioBTCVSDControl->BT_SCO_isWideBand();
+        return bytes;
+    }
 
-    inbuf = (uint8_t *)pBufferAfterBitConvertion;
+    // write data to bt cvsd driver
+    uint8_t *inbuf = (uint8_t *)pBufferAfterBitConvertion;
+    uint32_t insize, total_outsize;
     do
     {
-        outbuffer = mAudioBTCVSDControl->BT_SCO_TX_GetCVSDOutBuf();
-        outsize = SCO_TX_ENCODE_SIZE;
+        // encode as many packets as fit in one kernel write
         insize = bytesAfterBitConvertion;
-        workbuf = mAudioBTCVSDControl->BT_SCO_TX_GetCVSDWorkBuf();
-        workbufsize = SCO_TX_PCM64K_BUF_SIZE;
-        total_outsize = 0;
-        do
-        {
-            if(mBTMode_Open != mAudioBTCVSDControl->BT_SCO_isWideBand())
-            {            
-                ALOGD("BTSCO change mode after TX_Begin!!!");
-                mAudioBTCVSDControl->BT_SCO_TX_End(mFd2);
-                mAudioBTCVSDControl->BT_SCO_TX_Begin(mFd2, mStreamAttributeSource->sample_rate, mStreamAttributeSource->num_channels); 
-                mBTMode_Open = mAudioBTCVSDControl->BT_SCO_isWideBand();
-                return bytes;
-            }
-            
-            if (mAudioBTCVSDControl->BT_SCO_isWideBand())
-            {
-                mAudioBTCVSDControl->btsco_process_TX_MSBC(inbuf, &insize, outbuffer, &outsize, workbuf, workbufsize, mStreamAttributeSource->sample_rate); // return insize is consumed size
-                ALOGV("WriteDataToBTSCOHW, do mSBC encode outsize=%d, consumed size=%d, bytesAfterBitConvertion=%d", outsize, insize, bytesAfterBitConvertion);
-            }
-            else
-            {
-                mAudioBTCVSDControl->btsco_process_TX_CVSD(inbuf, &insize, outbuffer, &outsize, workbuf, workbufsize, mStreamAttributeSource->sample_rate); // return insize is consumed size
-                ALOGV("WriteDataToBTSCOHW, do CVSD encode outsize=%d, consumed size=%d, bytesAfterBitConvertion=%d", outsize, insize, bytesAfterBitConvertion);
-            }
-            outbuffer += outsize;
-            inbuf += insize;
-            bytesAfterBitConvertion -= insize;
-            ASSERT(bytesAfterBitConvertion >= 0);
-
-            insize = bytesAfterBitConvertion;
-            total_outsize += outsize;
-        }
-        while (total_outsize < BTSCO_CVSD_TX_OUTBUF_SIZE && outsize != 0);
+        total_outsize = mAudioBTCVSDControl->BT_SCO_TX_ProcessPackets(inbuf, &insize, mAudioBTCVSDControl->BT_SCO_TX_GetCVSDOutBuf(), BTSCO_CVSD_TX_OUTBUF_SIZE, mStreamAttributeSource->sample_rate); // return insize is consumed size
+        inbuf += insize;
+        bytesAfterBitConvertion -= insize;
+        ALOGV("WriteDataToBTSCOHW, encode total_outsize=%d, consumed size=%d, bytesAfterBitConvertion=%d", total_outsize, insize, bytesAfterBitConvertion);
 
         ALOGV("WriteDataToBTSCOHW write to kernel(+) total_outsize = %d", total_outsize);
         if (total_outsize > 0)
@@ -261,6 +238,12 @@ ssize_t AudioALSAPlaybackHandlerBTCVSD::write(const void *buffer, size_t bytes)
 #endif
         }
         ALOGV("WriteDataToBTSCOHW write to kernel(-) remaining bytes = %d", bytesAfterBitConvertion);
+
+        if (insize == 0 && total_outsize == 0)
+        {
+            ALOGE("%s(), encoder made no progress, drop remaining bytes = %d", __FUNCTION__, bytesAfterBitConvertion);
+            break;
+        }
     }
     while (bytesAfterBitConvertion > 0);
 
@@ -4,8 +4,11 @@
 
 #include "AudioALSAHardwareResourceManager.h"
 #include "AudioUtility.h"
+#include "AudioSampleKernel.h"
 
 #include "AudioMTKFilter.h"
+#include "AudioALSAPlaybackTap.h"
+#include "AudioBenchTrace.h"
 
 
 extern "C" {
@@ -32,6 +35,7 @@ AudioALSAPlaybackHandlerBase::AudioALSAPlaybackHandlerBase(const stream_attribut
     mPlaybackHandlerType(PLAYBACK_HANDLER_BASE),
     mDataProcessor(AudioALSADataProcessor::getInstance()),
     mHardwareResourceManager(AudioALSAHardwareResourceManager::getInstance()),
+    mPlaybackTap(AudioALSAPlaybackTap::getInstance()),
     mStreamAttributeSource(stream_attribute_source),
     mPcm(NULL),
     mComprStream(NULL),
@@ -46,12 +50,17 @@ AudioALSAPlaybackHandlerBase::AudioALSAPlaybackHandlerBase(const stream_attribut
     mdataPendingOutputBuffer(NULL),
     mdataPendingTempBuffer(NULL),
     mdataPendingOutputBufferSize(0),
-    mdataPendingRemindBufferSize(0)
+    mdataPendingRemindBufferSize(0),
+    mPlaybackStageEnable(false),
+    mNumPlaybackStages(0),
+    mPlaybackStageBufferSize(0)
 {
     ALOGD("%s()", __FUNCTION__);
 
     memset(&mConfig, 0, sizeof(mConfig));
     memset(&mStreamAttributeTarget, 0, sizeof(mStreamAttributeTarget));
+    memset(mPlaybackStages, 0, sizeof(mPlaybackStages));
+    memset(mPlaybackStageBuffer, 0, sizeof(mPlaybackStageBuffer));
 }
 
 
@@ -190,25 +199,11 @@ status_t AudioALSAPlaybackHandlerBase::doStereoToMonoConversionIfNeed(void *buff
     {
         if (mStreamAttributeSource->audio_format == AUDIO_FORMAT_PCM_32_BIT)
         {
-            int32_t *Sample = (int32_t *)buffer;
-            while (bytes > 0)
-            {
-                int32_t averageValue = ((*Sample) >> 1) + ((*(Sample + 1)) >> 1);
-                *Sample++ = averageValue;
-                *Sample++ = averageValue;
-                bytes -= 8;
-            }
+            AudioKernel_stereoToMonoDup32((int32_t *)buffer, bytes >> 3);
         }
         else if (mStreamAttributeSource->audio_format == AUDIO_FORMAT_PCM_16_BIT)
         {
-            int16_t *Sample = (int16_t *)buffer;
-            while (bytes > 0)
-            {
-                int16_t averageValue = ((*Sample) >> 1) + ((*(Sample + 1)) >> 1);
-                *Sample++ = averageValue;
-                *Sample++ = averageValue;
-                bytes -= 4;
-            }
+            AudioKernel_stereoToMonoDup16((int16_t *)buffer, bytes >> 2);
         }
     }
 #endif
@@ -284,10 +279,13 @@ status_t AudioALSAPlaybackHandlerBase::setFilterMng(AudioMTKFilterManager *pFilt
 
 status_t AudioALSAPlaybackHandlerBase::initPostProcessing()
 {
-    // init post processing
-    mPostProcessingOutputBufferSize = mStreamAttributeSource->buffer_size;
-    mPostProcessingOutputBuffer = new char[mPostProcessingOutputBufferSize];
-    ASSERT(mPostProcessingOutputBuffer != NULL);
+    // init post processing, output buffer is planned by planPlaybackStages() if stage graph is used
+    if (mPlaybackStageEnable == false)
+    {
+        mPostProcessingOutputBufferSize = mStreamAttributeSource->buffer_size;
+        mPostProcessingOutputBuffer = new char[mPostProcessingOutputBufferSize];
+        ASSERT(mPostProcessingOutputBuffer != NULL);
+    }
 
     return NO_ERROR;
 }
@@ -380,8 +378,11 @@ status_t AudioALSAPlaybackHandlerBase::initBliSrc()
         ASSERT(mBliSrc != NULL);
         mBliSrc->Open();
 
-        mBliSrcOutputBuffer = new char[kBliSrcOutputBufferSize];
-        ASSERT(mBliSrcOutputBuffer != NULL);
+        if (mPlaybackStageEnable == false)
+        {
+            mBliSrcOutputBuffer = new char[kBliSrcOutputBufferSize];
+            ASSERT(mBliSrcOutputBuffer != NULL);
+        }
     }
 
     return NO_ERROR;
@@ -550,9 +551,11 @@ status_t AudioALSAPlaybackHandlerBase::initBitConverter()
         mBitConverter->Open();
         mBitConverter->ResetBuffer();
 
-        mBitConverterOutputBuffer = new char[kMaxPcmDriverBufferSize];
-        ASSERT(mBitConverterOutputBuffer != NULL);
-        ASSERT(mBitConverterOutputBuffer != NULL);
+        if (mPlaybackStageEnable == false)
+        {
+            mBitConverterOutputBuffer = new char[kMaxPcmDriverBufferSize];
+            ASSERT(mBitConverterOutputBuffer != NULL);
+        }
     }
 
     ALOGV("%s(), mBitConverter = %p, mBitConverterOutputBuffer = %p", __FUNCTION__, mBitConverter, mBitConverterOutputBuffer);
@@ -605,10 +608,15 @@ status_t AudioALSAPlaybackHandlerBase::initDataPending()
     ALOGV("mBliSrc = %p",mBliSrc);
     if(mBliSrc != NULL)
     {
-        mdataPendingOutputBufferSize = (1024*128) + dataAlignedSize;// here nned to cover max write buffer size
-        mdataPendingOutputBuffer = new char[mdataPendingOutputBufferSize];
+        // stage graph pends data in the headroom of the planned stage buffer, only the remind is kept here
+        if (mPlaybackStageEnable == false)
+        {
+            mdataPendingOutputBufferSize = (1024*128) + dataAlignedSize;// here nned to cover max write buffer size
+            mdataPendingOutputBuffer = new char[mdataPendingOutputBufferSize];
+            ASSERT(mdataPendingOutputBuffer != NULL);
+        }
         mdataPendingTempBuffer  = new char[dataAlignedSize];
-        ASSERT(mdataPendingOutputBufferSize != NULL);
+        ASSERT(mdataPendingTempBuffer != NULL);
     }
     return NO_ERROR;
 }
@@ -679,6 +687,267 @@ status_t AudioALSAPlaybackHandlerBase::dodataPending(void *pInBuffer, uint32_t i
      return NO_ERROR;
 }
 
+// pInBuffer must be a planned stage buffer, which keeps dataAlignedSize bytes of headroom in front,
+// so the remind of last write is put ahead of it instead of copying the whole buffer
+status_t AudioALSAPlaybackHandlerBase::dodataPendingInPlace(void *pInBuffer, uint32_t inBytes, void **ppOutBuffer, uint32_t *pOutBytes)
+{
+    char *DataPointer = (char *)pInBuffer - mdataPendingRemindBufferSize;
+    uint32_t TotalBufferSize = inBytes + mdataPendingRemindBufferSize;
+    uint32_t tempRemind = TotalBufferSize % dataAlignedSize;
+
+    ASSERT(DataPointer == mPlaybackStageBuffer[0] + dataAlignedSize - mdataPendingRemindBufferSize ||
+           DataPointer == mPlaybackStageBuffer[1] + dataAlignedSize - mdataPendingRemindBufferSize);
+
+    if (mdataPendingRemindBufferSize != 0) // deal previous remaind buffer
+    {
+        memcpy((void *)DataPointer, (void *)mdataPendingTempBuffer, mdataPendingRemindBufferSize);
+    }
+
+    // deal with remind buffer
+    memcpy((void *)mdataPendingTempBuffer, (void *)(DataPointer + TotalBufferSize - tempRemind), tempRemind);
+    mdataPendingRemindBufferSize = tempRemind;
+
+    *ppOutBuffer = DataPointer;
+    *pOutBytes = TotalBufferSize - tempRemind;
+
+    ALOGV("%s(), inBytes = %u, tempRemind = %u, pOutBytes = %u", __FUNCTION__, inBytes, tempRemind, *pOutBytes);
+    ASSERT(*ppOutBuffer != NULL && *pOutBytes != 0);
+    return NO_ERROR;
+}
+
+
+status_t AudioALSAPlaybackHandlerBase::planPlaybackStages()
+{
+    ASSERT(mPlaybackStageEnable == true);
+    ASSERT(mPlaybackStageBuffer[0] == NULL && mPlaybackStageBuffer[1] == NULL);
+
+    // stage list, in write() order
+    uint32_t num_out_of_place = 0;
+    uint32_t max_output_size = 0;
+
+    memset(mPlaybackStages, 0, sizeof(mPlaybackStages));
+    mNumPlaybackStages = 0;
+
+    mPlaybackStages[mNumPlaybackStages].stage = PLAYBACK_STAGE_STEREO_TO_MONO;
+    mPlaybackStages[mNumPlaybackStages].in_place = true;
+    mNumPlaybackStages++;
+
+    if (mAudioFilterManagerHandler != NULL)
+    {
+        mPlaybackStages[mNumPlaybackStages].stage = PLAYBACK_STAGE_POST_PROCESSING;
+        mPlaybackStages[mNumPlaybackStages].in_place = false;
+        mNumPlaybackStages++;
+        num_out_of_place++;
+        if (mStreamAttributeSource->buffer_size > max_output_size) { max_output_size = mStreamAttributeSource->buffer_size; }
+    }
+
+    if (mBliSrc != NULL)
+    {
+        mPlaybackStages[mNumPlaybackStages].stage = PLAYBACK_STAGE_BLI_SRC;
+        mPlaybackStages[mNumPlaybackStages].in_place = false;
+        mNumPlaybackStages++;
+        num_out_of_place++;
+        if (kBliSrcOutputBufferSize > max_output_size) { max_output_size = kBliSrcOutputBufferSize; }
+    }
+
+    if (mBitConverter != NULL)
+    {
+        mPlaybackStages[mNumPlaybackStages].stage = PLAYBACK_STAGE_BIT_CONVERSION;
+        mPlaybackStages[mNumPlaybackStages].in_place = false;
+        mNumPlaybackStages++;
+        num_out_of_place++;
+        if (kPcmDriverBufferSize > max_output_size) { max_output_size = kPcmDriverBufferSize; }
+    }
+
+    if (mBliSrc != NULL) // data pending follows an out-of-place stage, so it always works on a planned buffer
+    {
+        mPlaybackStages[mNumPlaybackStages].stage = PLAYBACK_STAGE_DATA_PENDING;
+        mPlaybackStages[mNumPlaybackStages].in_place = true;
+        mNumPlaybackStages++;
+    }
+
+    // out-of-place stages alternate between two buffers, each with headroom for data pending
+    mPlaybackStageBufferSize = max_output_size;
+    for (uint32_t i = 0; i < 2 && i < num_out_of_place; i++)
+    {
+        mPlaybackStageBuffer[i] = new char[dataAlignedSize + mPlaybackStageBufferSize];
+        ASSERT(mPlaybackStageBuffer[i] != NULL);
+    }
+
+    uint32_t buffer_index = 0;
+    for (uint32_t i = 0; i < mNumPlaybackStages; i++)
+    {
+        if (mPlaybackStages[i].in_place == true)
+        {
+            continue;
+        }
+
+        char *pStageBuffer = mPlaybackStageBuffer[buffer_index] + dataAlignedSize;
+        buffer_index ^= 1;
+
+        switch (mPlaybackStages[i].stage)
+        {
+            case PLAYBACK_STAGE_POST_PROCESSING:
+            {
+                mPostProcessingOutputBuffer = pStageBuffer;
+                mPostProcessingOutputBufferSize = mPlaybackStageBufferSize;
+                break;
+            }
+            case PLAYBACK_STAGE_BLI_SRC:
+            {
+                mBliSrcOutputBuffer = pStageBuffer;
+                break;
+            }
+            case PLAYBACK_STAGE_BIT_CONVERSION:
+            {
+                mBitConverterOutputBuffer = pStageBuffer;
+                break;
+            }
+            default:
+            {
+                ASSERT(0);
+                break;
+            }
+        }
+    }
+
+    ALOGD("%s(), mNumPlaybackStages = %u, num_out_of_place = %u, mPlaybackStageBufferSize = %u",
+          __FUNCTION__, mNumPlaybackStages, num_out_of_place, mPlaybackStageBufferSize);
+    return NO_ERROR;
+}
+
+
+status_t AudioALSAPlaybackHandlerBase::clearPlaybackStages()
+{
+    // stage outputs alias the planned buffers, detach them before deinit
+    mPostProcessingOutputBuffer = NULL;
+    mPostProcessingOutputBufferSize = 0;
+    mBliSrcOutputBuffer = NULL;
+    mBitConverterOutputBuffer = NULL;
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        if (mPlaybackStageBuffer[i] != NULL)
+        {
+            delete[] mPlaybackStageBuffer[i];
+            mPlaybackStageBuffer[i] = NULL;
+        }
+    }
+    mPlaybackStageBufferSize = 0;
+
+    memset(mPlaybackStages, 0, sizeof(mPlaybackStages));
+    mNumPlaybackStages = 0;
+    return NO_ERROR;
+}
+
+
+status_t AudioALSAPlaybackHandlerBase::doPlaybackStages(void *pInBuffer, uint32_t inBytes, void **ppOutBuffer, uint32_t *pOutBytes)
+{
+    void *pBuffer = pInBuffer;
+    uint32_t bytes = inBytes;
+
+    for (uint32_t i = 0; i < mNumPlaybackStages; i++)
+    {
+        playback_stage_info_t *pStage = &mPlaybackStages[i];
+        AUDIO_BENCH_BEGIN(stageStartNs);
+
+        switch (pStage->stage)
+        {
+            case PLAYBACK_STAGE_STEREO_TO_MONO:
+            {
+                if (mStreamAttributeSource->audio_format == AUDIO_FORMAT_PCM_16_BIT) // AudioMixer will perform stereo to mono when 32-bit
+                {
+                    doStereoToMonoConversionIfNeed(pBuffer, bytes);
+                }
+                pStage->output_buffer = pBuffer;
+                pStage->output_bytes = bytes;
+                break;
+            }
+            case PLAYBACK_STAGE_POST_PROCESSING:
+            {
+                doPostProcessing(pBuffer, bytes, &pStage->output_buffer, &pStage->output_bytes);
+                break;
+            }
+            case PLAYBACK_STAGE_BLI_SRC:
+            {
+                doBliSrc(pBuffer, bytes, &pStage->output_buffer, &pStage->output_bytes);
+                break;
+            }
+            case PLAYBACK_STAGE_BIT_CONVERSION:
+            {
+                doBitConversion(pBuffer, bytes, &pStage->output_buffer, &pStage->output_bytes);
+                break;
+            }
+            case PLAYBACK_STAGE_DATA_PENDING:
+            {
+                dodataPendingInPlace(pBuffer, bytes, &pStage->output_buffer, &pStage->output_bytes);
+                break;
+            }
+            default:
+            {
+                ASSERT(0);
+                break;
+            }
+        }
+        AUDIO_BENCH_END((audio_bench_stage_t)(AUDIO_BENCH_PLAYBACK_STEREO_TO_MONO + pStage->stage), stageStartNs);
+
+        pBuffer = pStage->output_buffer;
+        bytes = pStage->output_bytes;
+    }
+
+    *ppOutBuffer = pBuffer;
+    *pOutBytes = bytes;
+    return NO_ERROR;
+}
+
+
+status_t AudioALSAPlaybackHandlerBase::getPlaybackStageOutput(const playback_stage_t stage, void **ppOutBuffer, uint32_t *pOutBytes) const
+{
+    // a stage not in the plan is a bypass, so report the output of the last planned stage before it
+    const playback_stage_info_t *pStage = NULL;
+    for (uint32_t i = 0; i < mNumPlaybackStages && mPlaybackStages[i].stage <= stage; i++)
+    {
+        pStage = &mPlaybackStages[i];
+    }
+
+    if (pStage == NULL)
+    {
+        ALOGW("%s(), stage %d not planned", __FUNCTION__, stage);
+        return NAME_NOT_FOUND;
+    }
+
+    *ppOutBuffer = pStage->output_buffer;
+    *pOutBytes = pStage->output_bytes;
+    return NO_ERROR;
+}
+
+
+status_t AudioALSAPlaybackHandlerBase::attachPlaybackTap()
+{
+    // the primary mix owns the tap, fast / HDMI only feed it while no normal handler is open
+    const int priority = (mPlaybackHandlerType == PLAYBACK_HANDLER_NORMAL) ? 1 : 0;
+    return (mPlaybackTap->attachWriter(this, &mStreamAttributeTarget, priority) == true) ? NO_ERROR : INVALID_OPERATION;
+}
+
+
+status_t AudioALSAPlaybackHandlerBase::detachPlaybackTap()
+{
+    mPlaybackTap->detachWriter(this);
+    return NO_ERROR;
+}
+
+
+void AudioALSAPlaybackHandlerBase::publishPlaybackTap(const void *buffer, const uint32_t bytes)
+{
+    mPlaybackTap->publish(this, buffer, bytes);
+}
+
+
+bool AudioALSAPlaybackHandlerBase::ownPlaybackTap() const
+{
+    return mPlaybackTap->isWriter(this);
+}
+
 
 
 
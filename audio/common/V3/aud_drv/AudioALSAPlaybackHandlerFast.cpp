@@ -207,12 +207,14 @@ status_t AudioALSAPlaybackHandlerFast::open()
     mHardwareResourceManager->startOutputDevice(mStreamAttributeSource->output_devices, mStreamAttributeTarget.sample_rate);
 
 
+    // post-mix tap, publish what is written to pcm
+    attachPlaybackTap();
+
     //============Voice UI&Unlock REFERECE=============
     AudioVUnlockDL *VUnlockhdl = AudioVUnlockDL::getInstance();
     if (VUnlockhdl != NULL)
     {
         VUnlockhdl->SetInputStandBy(false);
-        VUnlockhdl-> GetSRCInputParameter(mStreamAttributeTarget.sample_rate, mStreamAttributeTarget.num_channels, mStreamAttributeTarget.audio_format);
         VUnlockhdl->GetFirstDLTime();
     }
     //===========================================
@@ -236,6 +238,8 @@ status_t AudioALSAPlaybackHandlerFast::close()
     }
     //===========================================
 
+    detachPlaybackTap();
+
 
     // close codec driver
     mHardwareResourceManager->stopOutputDevice();
@@ -381,6 +385,8 @@ ssize_t AudioALSAPlaybackHandlerFast::write(const void *buffer, size_t bytes)
 
 #ifndef DOWNLINK_LOW_LATENCY
     // TODO(Harvey, Wendy), temporary disable Voice Unlock until 24bit ready
+    publishPlaybackTap(pBufferAfterBitConvertion, bytesAfterBitConvertion);
+
     //============Voice UI&Unlock REFERECE=============
     AudioVUnlockDL *VUnlockhdl = AudioVUnlockDL::getInstance();
     if (VUnlockhdl != NULL)
@@ -389,13 +395,13 @@ ssize_t AudioALSAPlaybackHandlerFast::write(const void *buffer, size_t bytes)
         //VUnlockhdl->SetDownlinkStartTime(ret_ms);
         VUnlockhdl->GetFirstDLTime();
 
-        //VUnlockhdl->SetInputStandBy(false);
-        if (mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADSET ||
-            mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADPHONE)
+        // voice unlock reads the playback tap, headset output does not reach the mic;
+        // only the handler publishing to the tap knows where the reference goes
+        if (ownPlaybackTap())
         {
-            memset((void *)pBufferAfterBitConvertion, 0, bytesAfterBitConvertion);
+            VUnlockhdl->SetReferenceMute(mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADSET ||
+                                         mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADPHONE);
         }
-        VUnlockhdl->WriteStreamOutToRing(pBufferAfterBitConvertion, bytesAfterBitConvertion);
     }
     //===========================================
 #endif
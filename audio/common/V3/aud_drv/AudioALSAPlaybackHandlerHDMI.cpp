@@ -5,6 +5,7 @@
 #include <fcntl.h>
 
 #include "AudioALSADriverUtility.h"
+#include "AudioSampleKernel.h"
 
 #define LOG_TAG "AudioALSAPlaybackHandlerHDMI"
 //#define __2CH_TO_8CH
@@ -20,7 +21,12 @@ static FILE *pOutFileorg = NULL;
 
 
 AudioALSAPlaybackHandlerHDMI::AudioALSAPlaybackHandlerHDMI(const stream_attribute_t *stream_attribute_source) :
-    AudioALSAPlaybackHandlerBase(stream_attribute_source)
+    AudioALSAPlaybackHandlerBase(stream_attribute_source),
+    mExpandMode(HDMI_EXPAND_NONE),
+    mExpandBuffer(NULL),
+    mExpandFrames(0),
+    mExpandSampleSize(0),
+    mExpandInChannels(0)
 {
     ALOGD("%s()", __FUNCTION__);
     mPlaybackHandlerType = PLAYBACK_HANDLER_HDMI;
@@ -30,6 +36,7 @@ AudioALSAPlaybackHandlerHDMI::AudioALSAPlaybackHandlerHDMI(const stream_attribut
 AudioALSAPlaybackHandlerHDMI::~AudioALSAPlaybackHandlerHDMI()
 {
     ALOGD("%s()", __FUNCTION__);
+    deinitExpand();
 }
 
 
@@ -224,6 +231,10 @@ status_t AudioALSAPlaybackHandlerHDMI::open()
     initBitConverter();
 
 
+    // channel expansion
+    initExpand();
+
+
     // open pcm driver
     openPcmDriver(3);
 
@@ -270,6 +281,10 @@ status_t AudioALSAPlaybackHandlerHDMI::close()
     closePcmDriver();
 
 
+    // channel expansion
+    deinitExpand();
+
+
     // bit conversion
     deinitBitConverter();
 
@@ -332,6 +347,106 @@ int AudioALSAPlaybackHandlerHDMI::drain(audio_drain_type_t type)
 }    
 
 
+void AudioALSAPlaybackHandlerHDMI::initExpand()
+{
+    deinitExpand();
+
+    mExpandSampleSize = audio_bytes_per_sample(mStreamAttributeTarget.audio_format);
+    mExpandInChannels = mStreamAttributeTarget.num_channels;
+
+#ifdef __2CH_TO_8CH
+    mExpandMode = (mExpandInChannels == 2) ? HDMI_EXPAND_2CH_TO_8CH : HDMI_EXPAND_NONE;
+#else
+    mExpandMode = (mExpandInChannels == 6 && mConfig.channels == 8) ? HDMI_EXPAND_6CH_TO_8CH : HDMI_EXPAND_NONE;
+#endif
+
+    if (mExpandMode == HDMI_EXPAND_NONE)
+    {
+        ALOGD("%s(), passthrough, channels = %u", __FUNCTION__, mExpandInChannels);
+        return;
+    }
+
+    // one period of 8ch sink frames, a longer write is sent period by period
+    mExpandFrames = mConfig.period_size;
+    mExpandBuffer = new char[mExpandFrames * 8 * mExpandSampleSize];
+    ASSERT(mExpandBuffer != NULL);
+
+    ALOGD("%s(), mode = %d, channels = %u => 8, sample size = %u, frames = %u, kernel = %s", __FUNCTION__,
+          mExpandMode, mExpandInChannels, mExpandSampleSize, mExpandFrames, AudioKernel_getName());
+}
+
+
+void AudioALSAPlaybackHandlerHDMI::deinitExpand()
+{
+    if (mExpandBuffer != NULL)
+    {
+        delete[] mExpandBuffer;
+        mExpandBuffer = NULL;
+    }
+    mExpandFrames = 0;
+    mExpandMode = HDMI_EXPAND_NONE;
+}
+
+
+int AudioALSAPlaybackHandlerHDMI::writeExpand(const void *buffer, const uint32_t bytes)
+{
+    const uint32_t inFrameSize = mExpandInChannels * mExpandSampleSize;
+    const uint32_t outFrameSize = 8 * mExpandSampleSize;
+    const char *pIn = (const char *)buffer;
+    uint32_t frames = bytes / inFrameSize;
+    int retval = 0;
+
+    while (frames > 0)
+    {
+        const uint32_t chunkFrames = (frames < mExpandFrames) ? frames : mExpandFrames;
+
+        if (mExpandMode == HDMI_EXPAND_6CH_TO_8CH)
+        {
+            if (mExpandSampleSize == 2)
+            {
+                AudioKernel_6chTo8ch16((int16_t *)mExpandBuffer, (const int16_t *)pIn, chunkFrames);
+            }
+            else
+            {
+                AudioKernel_6chTo8ch32((int32_t *)mExpandBuffer, (const int32_t *)pIn, chunkFrames);
+            }
+        }
+        else
+        {
+            if (mExpandSampleSize == 2)
+            {
+                AudioKernel_stereoTo8ch16((int16_t *)mExpandBuffer, (const int16_t *)pIn, chunkFrames);
+            }
+            else
+            {
+                AudioKernel_stereoTo8ch32((int32_t *)mExpandBuffer, (const int32_t *)pIn, chunkFrames);
+            }
+        }
+
+        // write data to pcm driver
+        int ret = pcm_write(mPcm, mExpandBuffer, chunkFrames * outFrameSize);
+        if (ret != 0)
+        {
+            retval = ret;
+        }
+
+#ifdef _TDM_DEBUG
+        if (pOutFile != NULL)
+        {
+            fwrite(mExpandBuffer, sizeof(char), chunkFrames * outFrameSize, pOutFile);
+        }
+#else
+        WritePcmDumpData(mExpandBuffer, chunkFrames * outFrameSize);
+#endif
+
+        pIn += chunkFrames * inFrameSize;
+        frames -= chunkFrames;
+    }
+
+    return retval;
+}
+
+
 ssize_t AudioALSAPlaybackHandlerHDMI::write(const void *buffer, size_t bytes)
 {
     ALOGV("%s(), buffer = %p, bytes = %d", __FUNCTION__, buffer, bytes);
@@ -366,71 +481,22 @@ ssize_t AudioALSAPlaybackHandlerHDMI::write(const void *buffer, size_t bytes)
     uint32_t bytesAfterBitConvertion = 0;
     doBitConversion(pBufferAfterBliSrc, bytesAfterBliSrc, &pBufferAfterBitConvertion, &bytesAfterBitConvertion);
 
-    void *newbuffer[96 * 1024] = {0};
-    unsigned char *aaa;
-    unsigned char *bbb;
-    int i = 0;
-    int j = 0;
-	int retval = 0;
-
-    aaa = (unsigned char *)newbuffer;
-    bbb = (unsigned char *)pBufferAfterBitConvertion;
-	
-
-#ifdef __2CH_TO_8CH
+    ALOGV("%s(), channels = %d, format = %d ,bytes = %d", __FUNCTION__, mStreamAttributeTarget.num_channels, mStreamAttributeTarget.audio_format, bytes);
 
 
-    for (i = 0 ; j < bytesAfterBitConvertion; i += 16)
+    // channel expansion / passthrough, then write data to pcm driver
+    int retval = 0;
+    if (mExpandMode != HDMI_EXPAND_NONE)
     {
-        memcpy(aaa + i,      bbb + j, 4);
-        memcpy(aaa + i + 4,  bbb + j, 4);
-        memcpy(aaa + i + 8,  bbb + j, 4);
-        memcpy(aaa + i + 12, bbb + j, 4);
-        j += 4;
+        retval = writeExpand(pBufferAfterBitConvertion, bytesAfterBitConvertion);
     }
-
-    // write data to pcm driver
-    retval = pcm_write(mPcm, newbuffer, bytesAfterBitConvertion << 2);
-#else
-    ALOGD("%s(), channels = %d, format = %d ,bytes = %d", __FUNCTION__, mStreamAttributeTarget.num_channels, mStreamAttributeTarget.audio_format, bytes);
-
-	if (mStreamAttributeTarget.num_channels == 6) 
-	{
-		if (mStreamAttributeTarget.audio_format == AUDIO_FORMAT_PCM_16_BIT)
-		{
-			aaa = (unsigned char *)newbuffer;
-			bbb = (unsigned char *)pBuffer;
-			
-			for (i = 0 ; j < bytesAfterBitConvertion; i += 16)
-			{
-				memcpy(aaa + i, 	 bbb + j, 12);
-//				memcpy(aaa + i, 	 bbb + j + 4, 2); //test copy center to left
-//				memcpy(aaa + i + 4, 	 bbb + j + 2, 2); //test copy right to center                             
-				memset(aaa + i + 12, 0 , 4);
-				j += 12;
-			}
-		    retval = pcm_write(mPcm, newbuffer, ((bytesAfterBitConvertion*4)/3));
-		}
-		else
-		{
-			for (i = 0 ; j < bytesAfterBitConvertion; i += 32)
-			{
-				memcpy(aaa + i, 	 bbb + j, 24);
-				memset(aaa + i + 24, 0 , 8);
-				j += 24;
-			}
-		    retval = pcm_write(mPcm, newbuffer, ((bytesAfterBitConvertion*4)/3));
-
-		}		
-	}
-	else
-	{		
-	    // write data to pcm driver
-	    retval = pcm_write(mPcm, pBufferAfterBitConvertion, bytesAfterBitConvertion);
-	}
-    // write data to pcm driver
+    else
+    {
+        retval = pcm_write(mPcm, pBufferAfterBitConvertion, bytesAfterBitConvertion);
+#ifndef _TDM_DEBUG
+        WritePcmDumpData(pBufferAfterBitConvertion, bytesAfterBitConvertion);
 #endif
-
+    }
 
     if (retval != 0)
     {
@@ -439,31 +505,11 @@ ssize_t AudioALSAPlaybackHandlerHDMI::write(const void *buffer, size_t bytes)
 
 
 #ifdef _TDM_DEBUG
-
-#ifdef __2CH_TO_8CH
-
-    if (pOutFile != NULL)
-    {
-        ALOGD("%s(), newbuffer = %p", __FUNCTION__, newbuffer);
-        fwrite(newbuffer, sizeof(char), bytesAfterBitConvertion * 4, pOutFile);
-    }
-#endif
     if (pOutFileorg != NULL)
     {
         ALOGD("%s(), pBufferAfterBitConvertion = %p", __FUNCTION__, pBufferAfterBitConvertion);
         fwrite(pBufferAfterBitConvertion, sizeof(char), bytesAfterBitConvertion, pOutFileorg);
     }
-#else
-	if (mStreamAttributeTarget.num_channels == 6) 
-	{
-        ALOGD("%s(), dumpbytes = %d", __FUNCTION__, ((bytesAfterBitConvertion*16)/12));
-	
-	    WritePcmDumpData(newbuffer, ((bytesAfterBitConvertion*16)/12));
-	}
-	else
-	{		
-	    WritePcmDumpData(pBufferAfterBitConvertion, bytesAfterBitConvertion);
-	}
 #endif
 
 
@@ -10,6 +10,7 @@
 #include "AudioVUnlockDL.h"
 #include "AudioALSADeviceParser.h"
 #include "AudioALSADriverUtility.h"
+#include "AudioBenchTrace.h"
 #if defined(MTK_SPEAKER_MONITOR_SUPPORT)
 #include "AudioALSASpeakerMonitor.h"
 #endif
@@ -30,6 +31,9 @@
 #define THRESHOLD_KERNEL      0.010
 #endif
 
+// fade out + fade in length after the codec path is switched without reopening pcm
+#define ROUTING_RAMP_MS (5)
+
 #define calc_time_diff(x,y) ((x.tv_sec - y.tv_sec )+ (double)( x.tv_nsec - y.tv_nsec ) / (double)1000000000)
 static   const char PROPERTY_KEY_EXTDAC[PROPERTY_KEY_MAX]  = "af.resouce.extdac_support";
 
@@ -39,10 +43,16 @@ namespace android
 AudioALSAPlaybackHandlerNormal::AudioALSAPlaybackHandlerNormal(const stream_attribute_t *stream_attribute_source) :
     AudioALSAPlaybackHandlerBase(stream_attribute_source),
     mCurMuteBytes(0),
-    mForceMute(false)
+    mForceMute(false),
+    mRoutingRampFrames(0),
+    mRoutingRampFrameCount(0),
+    mRoutingPendingDevices(AUDIO_DEVICE_NONE),
+    mRoutingSilence(NULL),
+    mRoutingSilenceBytes(0)
 {
     ALOGD("%s()", __FUNCTION__);
     mPlaybackHandlerType = PLAYBACK_HANDLER_NORMAL;
+    mPlaybackStageEnable = true;
     mMixer = AudioALSADriverUtility::getInstance()->getMixer();
 }
 
@@ -318,6 +328,10 @@ status_t AudioALSAPlaybackHandlerNormal::open()
     memset(mAllZeroBlock, 0, mStreamAttributeSource->buffer_size);
 #endif
 
+    mRoutingRampFrames = 0;
+    mRoutingRampFrameCount = 0;
+    mRoutingPendingDevices = AUDIO_DEVICE_NONE;
+
     // post processing
     initPostProcessing();
 
@@ -340,6 +354,14 @@ status_t AudioALSAPlaybackHandlerNormal::open()
 
     initDataPending();
 
+    // plan stage buffers once, write() only walks the active stages
+    planPlaybackStages();
+
+    // one period of silence keeps the DMA busy while a hot routing switches the path
+    mRoutingSilenceBytes = mConfig.period_size * mConfig.channels * (pcm_format_to_bits(mConfig.format) / 8);
+    mRoutingSilence = new char[mRoutingSilenceBytes];
+    memset(mRoutingSilence, 0, mRoutingSilenceBytes);
+
     // disable lowjitter mode
     SetLowJitterMode(true, mStreamAttributeTarget.sample_rate);
 
@@ -350,12 +372,14 @@ status_t AudioALSAPlaybackHandlerNormal::open()
     mHardwareResourceManager->startOutputDevice(mStreamAttributeSource->output_devices, mStreamAttributeTarget.sample_rate);
 
 
+    // post-mix tap, publish what is written to pcm
+    attachPlaybackTap();
+
     //============Voice UI&Unlock REFERECE=============
     AudioVUnlockDL *VUnlockhdl = AudioVUnlockDL::getInstance();
     if (VUnlockhdl != NULL)
     {
         VUnlockhdl->SetInputStandBy(false);
-        VUnlockhdl-> GetSRCInputParameter(mStreamAttributeTarget.sample_rate, mStreamAttributeTarget.num_channels, mStreamAttributeTarget.audio_format);
         VUnlockhdl->GetFirstDLTime();
     }
     //===========================================
@@ -379,6 +403,8 @@ status_t AudioALSAPlaybackHandlerNormal::close()
     }
     //===========================================
 
+    detachPlaybackTap();
+
 
     // close codec driver
     mHardwareResourceManager->stopOutputDevice();
@@ -389,6 +415,8 @@ status_t AudioALSAPlaybackHandlerNormal::close()
     // disable lowjitter mode
     SetLowJitterMode(false, mStreamAttributeTarget.sample_rate);
 
+    clearPlaybackStages();
+
     DeinitDataPending();
 
     // bit conversion
@@ -406,6 +434,12 @@ status_t AudioALSAPlaybackHandlerNormal::close()
     //release pmic clk
     mHardwareResourceManager->EnableAudBufClk(false);
 
+    // a routing not picked up by write() is left to the next open(), which starts the new device
+    mRoutingPendingDevices = AUDIO_DEVICE_NONE;
+    delete [] mRoutingSilence;
+    mRoutingSilence = NULL;
+    mRoutingSilenceBytes = 0;
+
 #ifdef MTK_AUDIO_SW_DRE
     delete [] mAllZeroBlock;
 #endif
@@ -414,12 +448,183 @@ status_t AudioALSAPlaybackHandlerNormal::close()
 }
 
 
+bool AudioALSAPlaybackHandlerNormal::canHotRouting(const audio_devices_t output_devices)
+{
+    // only devices which createPlaybackHandler() also maps to the normal handler
+    if (output_devices != AUDIO_DEVICE_OUT_EARPIECE &&
+        output_devices != AUDIO_DEVICE_OUT_SPEAKER &&
+        output_devices != AUDIO_DEVICE_OUT_WIRED_HEADSET &&
+        output_devices != AUDIO_DEVICE_OUT_WIRED_HEADPHONE)
+    {
+        return false;
+    }
+
+    if (mPcm == NULL)
+    {
+        return false;
+    }
+
+    // pcm rate (hifi) depends on device
+    if (ChooseTargetSampleRate(AudioALSASampleRateController::getInstance()->getPrimaryStreamOutSampleRate(),
+                               output_devices) != mStreamAttributeTarget.sample_rate)
+    {
+        ALOGD("%s(), target sample rate changed, need reopen", __FUNCTION__);
+        return false;
+    }
+
+#ifdef MTK_MAXIM_SPEAKER_SUPPORT
+    // speaker uses another pcm
+    if (mStreamAttributeSource->output_devices == AUDIO_DEVICE_OUT_SPEAKER || output_devices == AUDIO_DEVICE_OUT_SPEAKER)
+    {
+        return false;
+    }
+#endif
+
+#ifdef NXP_SMARTPA_SUPPORT
+    // low jitter mode depends on speaker
+    if ((mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_SPEAKER) != (output_devices & AUDIO_DEVICE_OUT_SPEAKER))
+    {
+        return false;
+    }
+#endif
+
+#if defined(MTK_AUDIO_GAIN_TABLE) == defined(MTK_NEW_VOL_CONTROL)
+    // impedance detection needs its own pcm, done in open()
+    if ((output_devices == AUDIO_DEVICE_OUT_WIRED_HEADSET || output_devices == AUDIO_DEVICE_OUT_WIRED_HEADPHONE) &&
+        mHardwareResourceManager->getHeadPhoneChange() == true)
+    {
+        ALOGD("%s(), headphone changed, need reopen for impedance detection", __FUNCTION__);
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+
 status_t AudioALSAPlaybackHandlerNormal::routing(const audio_devices_t output_devices)
 {
-    mHardwareResourceManager->changeOutputDevice(output_devices);
-    if (mAudioFilterManagerHandler) { mAudioFilterManagerHandler->setDevice(output_devices); }
+    ALOGD("+%s(), output_devices = 0x%x", __FUNCTION__, output_devices);
+
+#if defined(MTK_AUDIO_SW_DRE) && defined(MTK_NEW_VOL_CONTROL)
+    // swdre mute only applies to headphone, release it before leaving
+    mCurMuteBytes = 0;
+    if (mForceMute)
+    {
+        mForceMute = false;
+        AudioMTKGainController::getInstance()->requestMute(getIdentity(), false);
+    }
+#endif
+
+    // switched by the next write(): its head fades out and plays out on the old path first
+    mRoutingPendingDevices = output_devices;
+
+    ALOGD("-%s()", __FUNCTION__);
     return NO_ERROR;
 }
+
+
+void AudioALSAPlaybackHandlerNormal::switchRoutingOnWrite(void **ppBuffer, uint32_t *pBytes)
+{
+    const uint32_t frame_bytes = (pcm_format_to_bits(mConfig.format) / 8) * mConfig.channels;
+    const uint32_t ramp_frames = (mStreamAttributeTarget.sample_rate * ROUTING_RAMP_MS) / 1000;
+    uint32_t fade_frames = *pBytes / frame_bytes;
+    if (fade_frames > ramp_frames)
+    {
+        fade_frames = ramp_frames;
+    }
+    const uint32_t fade_bytes = fade_frames * frame_bytes;
+
+    ALOGD("%s(), output_devices = 0x%x, fade %u frames", __FUNCTION__, mRoutingPendingDevices, fade_frames);
+
+    // fade out on the old path, then silence so the DMA does not run dry during the switch
+    applyRoutingRamp(*ppBuffer, fade_frames, fade_frames, false);
+    WritePcmDumpData(*ppBuffer, fade_bytes);
+    if (pcm_write(mPcm, *ppBuffer, fade_bytes) != 0 || pcm_write(mPcm, mRoutingSilence, mRoutingSilenceBytes) != 0)
+    {
+        ALOGE("%s(), pcm_write() error, %s", __FUNCTION__, pcm_get_error(mPcm));
+    }
+
+    // wait for the faded data to leave the old path, only silence stays queued
+    drainRoutingToFrames(mRoutingSilenceBytes / frame_bytes);
+
+    mHardwareResourceManager->changeOutputDevice(mRoutingPendingDevices);
+    if (mAudioFilterManagerHandler) { mAudioFilterManagerHandler->setDevice(mRoutingPendingDevices); }
+    mRoutingPendingDevices = AUDIO_DEVICE_NONE;
+
+    // the rest of this write fades in on the new path
+    *ppBuffer = (char *)*ppBuffer + fade_bytes;
+    *pBytes -= fade_bytes;
+    mRoutingRampFrames = ramp_frames;
+    mRoutingRampFrameCount = 0;
+}
+
+
+void AudioALSAPlaybackHandlerNormal::drainRoutingToFrames(const uint32_t keep_frames)
+{
+    const uint32_t kDrainRetry = 3;
+    const unsigned int buffer_frames = pcm_get_buffer_size(mPcm);
+
+    for (uint32_t retry = 0; retry < kDrainRetry; retry++)
+    {
+        unsigned int avail = 0;
+        struct timespec timestamp;
+        if (pcm_get_htimestamp(mPcm, &avail, &timestamp) != 0 || avail >= buffer_frames)
+        {
+            return;
+        }
+
+        const uint32_t queued = buffer_frames - avail;
+        if (queued <= keep_frames)
+        {
+            return;
+        }
+        usleep((uint64_t)(queued - keep_frames) * 1000000ULL / mConfig.rate);
+    }
+    ALOGW("%s(), old path not drained to %u frames", __FUNCTION__, keep_frames);
+}
+
+
+void AudioALSAPlaybackHandlerNormal::applyRoutingRamp(void *buffer, const uint32_t frames, const uint32_t ramp_frames, const bool fade_in)
+{
+    const uint32_t bytes_per_sample = (mConfig.format == PCM_FORMAT_S16_LE) ? 2 : 4;
+    const uint32_t channels = mConfig.channels;
+    const uint32_t start = fade_in ? mRoutingRampFrameCount : 0;
+
+    for (uint32_t frame = 0; frame < frames && start + frame < ramp_frames; frame++)
+    {
+        // Q15 linear gain, 0 -> 1 for fade in, 1 -> 0 for fade out
+        const uint32_t distance = fade_in ? (start + frame) : (ramp_frames - frame);
+        const int32_t gain = (int32_t)(((uint64_t)distance << 15) / ramp_frames);
+        if (bytes_per_sample == 2)
+        {
+            int16_t *sample = (int16_t *)buffer + frame * channels;
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                sample[ch] = (int16_t)(((int32_t)sample[ch] * gain) >> 15);
+            }
+        }
+        else
+        {
+            int32_t *sample = (int32_t *)buffer + frame * channels;
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                sample[ch] = (int32_t)(((int64_t)sample[ch] * gain) >> 15);
+            }
+        }
+    }
+
+    if (fade_in)
+    {
+        mRoutingRampFrameCount += frames;
+        if (mRoutingRampFrameCount >= mRoutingRampFrames)
+        {
+            mRoutingRampFrames = 0;
+            mRoutingRampFrameCount = 0;
+        }
+    }
+}
+
 status_t AudioALSAPlaybackHandlerNormal::pause()
 {
     return INVALID_OPERATION;
@@ -530,34 +735,25 @@ ssize_t AudioALSAPlaybackHandlerNormal::write(const void *buffer, size_t bytes)
     }
 #endif
 
-    // stereo to mono for speaker
-    if (mStreamAttributeSource->audio_format == AUDIO_FORMAT_PCM_16_BIT) // AudioMixer will perform stereo to mono when 32-bit
-    {
-        doStereoToMonoConversionIfNeed(pBuffer, bytes);
-    }
-
-
-    // post processing (can handle both Q1P16 and Q1P31 by audio_format_t)
-    void *pBufferAfterPostProcessing = NULL;
-    uint32_t bytesAfterPostProcessing = 0;
-    doPostProcessing(pBuffer, bytes, &pBufferAfterPostProcessing, &bytesAfterPostProcessing);
-
-
-    // SRC
-    void *pBufferAfterBliSrc = NULL;
-    uint32_t bytesAfterBliSrc = 0;
-    doBliSrc(pBufferAfterPostProcessing, bytesAfterPostProcessing, &pBufferAfterBliSrc, &bytesAfterBliSrc);
-
+    // stereo to mono -> post processing -> SRC -> bit conversion -> data pending, as planned in open()
+    void *pBufferAfterPending = NULL;
+    uint32_t bytesAfterpending = 0;
+    doPlaybackStages(pBuffer, bytes, &pBufferAfterPending, &bytesAfterpending);
 
-    // bit conversion
     void *pBufferAfterBitConvertion = NULL;
     uint32_t bytesAfterBitConvertion = 0;
-    doBitConversion(pBufferAfterBliSrc, bytesAfterBliSrc, &pBufferAfterBitConvertion, &bytesAfterBitConvertion);
+    getPlaybackStageOutput(PLAYBACK_STAGE_BIT_CONVERSION, &pBufferAfterBitConvertion, &bytesAfterBitConvertion);
 
-    // data pending
-    void *pBufferAfterPending = NULL;
-    uint32_t bytesAfterpending = 0;
-    dodataPending(pBufferAfterBitConvertion, bytesAfterBitConvertion, &pBufferAfterPending, &bytesAfterpending);
+    if (mRoutingPendingDevices != AUDIO_DEVICE_NONE)
+    {
+        switchRoutingOnWrite(&pBufferAfterPending, &bytesAfterpending);
+    }
+
+    if (mRoutingRampFrames != 0)
+    {
+        const uint32_t frame_bytes = (pcm_format_to_bits(mConfig.format) / 8) * mConfig.channels;
+        applyRoutingRamp(pBufferAfterPending, bytesAfterpending / frame_bytes, mRoutingRampFrames, true);
+    }
 
     // pcm dump
     WritePcmDumpData(pBufferAfterPending, bytesAfterpending);
@@ -570,7 +766,9 @@ ssize_t AudioALSAPlaybackHandlerNormal::write(const void *buffer, size_t bytes)
 
 
     // write data to pcm driver
+    AUDIO_BENCH_BEGIN(pcmWriteStartNs);
     int retval = pcm_write(mPcm, pBufferAfterPending, bytesAfterpending);
+    AUDIO_BENCH_END(AUDIO_BENCH_PLAYBACK_PCM_WRITE, pcmWriteStartNs);
 
 #ifdef DEBUG_LATENCY
     clock_gettime(CLOCK_REALTIME, &mNewtime);
@@ -579,6 +777,8 @@ ssize_t AudioALSAPlaybackHandlerNormal::write(const void *buffer, size_t bytes)
 #endif
 
 #if 1 // TODO(Harvey, Wendy), temporary disable Voice Unlock until 24bit ready
+    publishPlaybackTap(pBufferAfterBitConvertion, bytesAfterBitConvertion);
+
     //============Voice UI&Unlock REFERECE=============
     AudioVUnlockDL *VUnlockhdl = AudioVUnlockDL::getInstance();
     if (VUnlockhdl != NULL)
@@ -587,13 +787,13 @@ ssize_t AudioALSAPlaybackHandlerNormal::write(const void *buffer, size_t bytes)
         //VUnlockhdl->SetDownlinkStartTime(ret_ms);
         VUnlockhdl->GetFirstDLTime();
 
-        //VUnlockhdl->SetInputStandBy(false);
-        if (mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADSET ||
-            mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADPHONE)
+        // voice unlock reads the playback tap, headset output does not reach the mic;
+        // only the handler publishing to the tap knows where the reference goes
+        if (ownPlaybackTap())
         {
-            memset((void *)pBufferAfterBitConvertion, 0, bytesAfterBitConvertion);
+            VUnlockhdl->SetReferenceMute(mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADSET ||
+                                         mStreamAttributeSource->output_devices & AUDIO_DEVICE_OUT_WIRED_HEADPHONE);
         }
-        VUnlockhdl->WriteStreamOutToRing(pBufferAfterBitConvertion, bytesAfterBitConvertion);
     }
     //===========================================
 #endif
@@ -0,0 +1,363 @@
+#include "AudioALSAPlaybackTap.h"
+
+#include <unistd.h>
+
+#include "AudioAssert.h"
+
+
+#define LOG_TAG "AudioALSAPlaybackTap"
+
+namespace android
+{
+
+AudioALSAPlaybackTap *AudioALSAPlaybackTap::mAudioALSAPlaybackTap = NULL;
+AudioALSAPlaybackTap *AudioALSAPlaybackTap::getInstance()
+{
+    AudioLock mGetInstanceLock;
+    AudioAutoTimeoutLock _l(mGetInstanceLock);
+
+    if (mAudioALSAPlaybackTap == NULL)
+    {
+        mAudioALSAPlaybackTap = new AudioALSAPlaybackTap();
+    }
+    ASSERT(mAudioALSAPlaybackTap != NULL);
+    return mAudioALSAPlaybackTap;
+}
+
+
+AudioALSAPlaybackTap::AudioALSAPlaybackTap() :
+    mWriter(NULL),
+    mPublishing(0),
+    mGeneration(0),
+    mSampleRate(0),
+    mNumChannels(0),
+    mFormat(AUDIO_FORMAT_PCM_16_BIT),
+    mFrameSize(0),
+    mWriteReserve(0),
+    mWritePos(0),
+    mNumReaders(0)
+{
+    ALOGD("%s()", __FUNCTION__);
+    memset(mWriters, 0, sizeof(mWriters));
+    memset(mReaders, 0, sizeof(mReaders));
+    memset(mRing, 0, sizeof(mRing));
+}
+
+
+AudioALSAPlaybackTap::~AudioALSAPlaybackTap()
+{
+    ALOGD("%s()", __FUNCTION__);
+}
+
+
+bool AudioALSAPlaybackTap::attachWriter(const void *writer, const stream_attribute_t *attribute, const int priority)
+{
+    AudioAutoTimeoutLock _l(mLock);
+
+    if (attribute->audio_format != AUDIO_FORMAT_PCM_16_BIT &&
+        attribute->audio_format != AUDIO_FORMAT_PCM_8_24_BIT &&
+        attribute->audio_format != AUDIO_FORMAT_PCM_32_BIT)
+    {
+        ALOGW("%s(), format %d not supported", __FUNCTION__, attribute->audio_format);
+        return false;
+    }
+
+    tap_writer_t *pSlot = NULL;
+    for (int index = 0; index < kTapMaxWriters; index++)
+    {
+        if (mWriters[index].writer == writer)
+        {
+            pSlot = &mWriters[index];
+            break;
+        }
+        if (mWriters[index].writer == NULL && pSlot == NULL)
+        {
+            pSlot = &mWriters[index];
+        }
+    }
+    if (pSlot == NULL)
+    {
+        ALOGW("%s(), no free writer slot for %p", __FUNCTION__, writer);
+        return false;
+    }
+
+    pSlot->writer = writer;
+    pSlot->priority = priority;
+    pSlot->sample_rate = attribute->sample_rate;
+    pSlot->num_channels = attribute->num_channels;
+    pSlot->format = attribute->audio_format;
+
+    ALOGD("%s(), writer %p, priority %d, sample_rate %u, num_channels %u, format %d", __FUNCTION__,
+          writer, priority, pSlot->sample_rate, pSlot->num_channels, pSlot->format);
+
+    if (mWriter == writer)
+    {
+        // re-attach of the owner with a new attribute, it is not in publish() while it is in here
+        mWriter = NULL;
+    }
+    // an owner already attached keeps the tap unless this one has a higher priority
+    selectWriter_l();
+    return true;
+}
+
+
+void AudioALSAPlaybackTap::detachWriter(const void *writer)
+{
+    AudioAutoTimeoutLock _l(mLock);
+
+    for (int index = 0; index < kTapMaxWriters; index++)
+    {
+        if (mWriters[index].writer == writer)
+        {
+            ALOGD("%s(), writer %p", __FUNCTION__, writer);
+            mWriters[index].writer = NULL;
+            selectWriter_l();
+            break;
+        }
+    }
+}
+
+
+void AudioALSAPlaybackTap::selectWriter_l()
+{
+    const tap_writer_t *pOwner = NULL;
+    for (int index = 0; index < kTapMaxWriters; index++)
+    {
+        const tap_writer_t *pCandidate = &mWriters[index];
+        if (pCandidate->writer == NULL)
+        {
+            continue;
+        }
+        if (pOwner == NULL || pCandidate->priority > pOwner->priority ||
+            (pCandidate->priority == pOwner->priority && pCandidate->writer == mWriter))
+        {
+            pOwner = pCandidate;
+        }
+    }
+
+    const void *owner = (pOwner != NULL) ? pOwner->writer : NULL;
+    if (owner == mWriter)
+    {
+        return;
+    }
+
+    // stop the old owner, then wait out a publish() it may be in before the attribute changes
+    mWriter = NULL;
+    android_memory_barrier();
+    while (android_atomic_acquire_load(&mPublishing) != 0)
+    {
+        usleep(100);
+    }
+
+    if (pOwner != NULL)
+    {
+        mSampleRate = pOwner->sample_rate;
+        mNumChannels = pOwner->num_channels;
+        mFormat = pOwner->format;
+        mFrameSize = pOwner->num_channels * audio_bytes_per_sample(pOwner->format);
+
+        // readers drop their cursor on generation change, the barrier publishes the attribute first
+        android_atomic_inc(&mGeneration);
+        android_memory_barrier();
+        mWriter = owner;
+    }
+    ALOGD("%s(), owner %p", __FUNCTION__, owner);
+}
+
+
+void AudioALSAPlaybackTap::publish(const void *writer, const void *buffer, const uint32_t bytes)
+{
+    if (writer != mWriter || bytes == 0 || hasReader() == false)
+    {
+        return;
+    }
+
+    // a handover in selectWriter_l() clears mWriter and then waits for mPublishing, recheck after claiming it
+    android_atomic_inc(&mPublishing);
+    if (writer != mWriter)
+    {
+        android_atomic_dec(&mPublishing);
+        return;
+    }
+
+    const char *pSrc = (const char *)buffer;
+    uint32_t copyBytes = bytes;
+    if (copyBytes > kTapRingSize / 2) // keep the tail, readers could not catch up anyway
+    {
+        copyBytes = ((kTapRingSize / 2) / mFrameSize) * mFrameSize;
+        pSrc += bytes - copyBytes;
+    }
+
+    // only this thread moves the counters, so mWritePos == mWriteReserve here
+    const uint32_t position = (uint32_t)mWritePos;
+    android_atomic_add((int32_t)copyBytes, &mWriteReserve);
+    android_memory_barrier(); // readers must see the reservation before any byte of the copy
+
+    const uint32_t offset = position & (kTapRingSize - 1);
+    const uint32_t firstBytes = (copyBytes < kTapRingSize - offset) ? copyBytes : (kTapRingSize - offset);
+    memcpy(mRing + offset, pSrc, firstBytes);
+    if (copyBytes > firstBytes)
+    {
+        memcpy(mRing, pSrc + firstBytes, copyBytes - firstBytes);
+    }
+
+    android_atomic_release_store((int32_t)(position + copyBytes), &mWritePos);
+    android_atomic_dec(&mPublishing);
+}
+
+
+int AudioALSAPlaybackTap::addReader(const audio_format_t format)
+{
+    AudioAutoTimeoutLock _l(mLock);
+
+    if (format != AUDIO_FORMAT_PCM_16_BIT && format != AUDIO_FORMAT_DEFAULT)
+    {
+        ALOGW("%s(), format %d not supported", __FUNCTION__, format);
+        return -1;
+    }
+
+    for (int reader = 0; reader < kTapMaxReaders; reader++)
+    {
+        if (mReaders[reader].used == false)
+        {
+            mReaders[reader].format = format;
+            mReaders[reader].generation = android_atomic_acquire_load(&mGeneration);
+            mReaders[reader].cursor = (uint32_t)android_atomic_acquire_load(&mWritePos);
+            mReaders[reader].overrun_count = 0;
+            mReaders[reader].used = true;
+            android_atomic_inc(&mNumReaders);
+            ALOGD("%s(), reader %d, format %d", __FUNCTION__, reader, format);
+            return reader;
+        }
+    }
+
+    ALOGW("%s(), no free reader", __FUNCTION__);
+    return -1;
+}
+
+
+void AudioALSAPlaybackTap::removeReader(const int reader)
+{
+    AudioAutoTimeoutLock _l(mLock);
+
+    if (reader < 0 || reader >= kTapMaxReaders || mReaders[reader].used == false)
+    {
+        return;
+    }
+
+    ALOGD("%s(), reader %d, overrun_count %u", __FUNCTION__, reader, mReaders[reader].overrun_count);
+    mReaders[reader].used = false;
+    android_atomic_dec(&mNumReaders);
+}
+
+
+uint32_t AudioALSAPlaybackTap::read(const int reader, void *buffer, const uint32_t bytes)
+{
+    if (reader < 0 || reader >= kTapMaxReaders || mReaders[reader].used == false)
+    {
+        return 0;
+    }
+    tap_reader_t *pReader = &mReaders[reader];
+
+    const int32_t generation = android_atomic_acquire_load(&mGeneration);
+    const uint32_t writePos = (uint32_t)android_atomic_acquire_load(&mWritePos);
+    if (pReader->generation != generation)
+    {
+        // new source format, old data is not worth converting
+        pReader->generation = generation;
+        pReader->cursor = writePos;
+        return 0;
+    }
+
+    const audio_format_t sourceFormat = mFormat;
+    const uint32_t frameSize = mFrameSize;
+    if (frameSize == 0)
+    {
+        return 0;
+    }
+
+    uint32_t available = writePos - pReader->cursor;
+    if (available > kTapRingSize)
+    {
+        pReader->overrun_count++;
+        ALOGW("%s(), reader %d overrun, lost %u bytes", __FUNCTION__, reader, available);
+        pReader->cursor = writePos;
+        return 0;
+    }
+
+    uint32_t sourceBytes = bytes;
+    if (pReader->format == AUDIO_FORMAT_PCM_16_BIT && sourceFormat != AUDIO_FORMAT_PCM_16_BIT)
+    {
+        sourceBytes = bytes * 2;
+    }
+    if (sourceBytes > available)
+    {
+        sourceBytes = available;
+    }
+    sourceBytes = (sourceBytes / frameSize) * frameSize;
+    if (sourceBytes == 0)
+    {
+        return 0;
+    }
+
+    const uint32_t readBytes = copyOut(pReader->cursor, (char *)buffer, sourceBytes, sourceFormat, pReader->format);
+
+    // the writer may have started to overwrite what we just copied, the loads of the copy must not pass this check
+    android_memory_barrier();
+    const uint32_t writeReserve = (uint32_t)android_atomic_acquire_load(&mWriteReserve);
+    if (writeReserve - pReader->cursor > kTapRingSize ||
+        android_atomic_acquire_load(&mGeneration) != generation)
+    {
+        pReader->overrun_count++;
+        pReader->cursor = (uint32_t)android_atomic_acquire_load(&mWritePos);
+        return 0;
+    }
+
+    pReader->cursor += sourceBytes;
+    return readBytes;
+}
+
+
+uint32_t AudioALSAPlaybackTap::copyOut(const uint32_t position, char *buffer, const uint32_t source_bytes,
+                                       const audio_format_t source_format, const audio_format_t reader_format) const
+{
+    const uint32_t offset = position & (kTapRingSize - 1);
+    const uint32_t firstBytes = (source_bytes < kTapRingSize - offset) ? source_bytes : (kTapRingSize - offset);
+
+    if (reader_format == AUDIO_FORMAT_DEFAULT || source_format == AUDIO_FORMAT_PCM_16_BIT)
+    {
+        memcpy(buffer, mRing + offset, firstBytes);
+        if (source_bytes > firstBytes)
+        {
+            memcpy(buffer + firstBytes, mRing, source_bytes - firstBytes);
+        }
+        return source_bytes;
+    }
+
+    // 32 bit container to 16 bit, samples never straddle the wrap since the ring size is a multiple of 4
+    const uint32_t shift = (source_format == AUDIO_FORMAT_PCM_32_BIT) ? 16 : 8;
+    int16_t *pOut = (int16_t *)buffer;
+    const int32_t *pIn = (const int32_t *)(mRing + offset);
+    for (uint32_t count = firstBytes >> 2; count > 0; count--)
+    {
+        *pOut++ = (int16_t)(*pIn++ >> shift);
+    }
+    pIn = (const int32_t *)mRing;
+    for (uint32_t count = (source_bytes - firstBytes) >> 2; count > 0; count--)
+    {
+        *pOut++ = (int16_t)(*pIn++ >> shift);
+    }
+    return source_bytes >> 1;
+}
+
+
+void AudioALSAPlaybackTap::getSourceAttribute(uint32_t *sample_rate, uint32_t *num_channels, audio_format_t *format)
+{
+    AudioAutoTimeoutLock _l(mLock);
+
+    *sample_rate = mSampleRate;
+    *num_channels = mNumChannels;
+    *format = mFormat;
+}
+
+} // end namespace android
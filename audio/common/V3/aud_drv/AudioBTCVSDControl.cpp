@@ -1,5 +1,6 @@
 #include "AudioBTCVSDControl.h"
 
+#include <stdlib.h>
 #include <linux/ioctl.h>
 #include <utils/Log.h>
 
@@ -45,6 +46,24 @@ static const int32_t  btsco_FilterCoeff_64K[4] = {0x07F54A0C, 0xF017CB31, 0x07F2
 static const int32_t  btsco_FilterCoeff_8K[4] = {0x07AB676D, 0xF0BB80B9, 0x079933A1, 0x79F9C5B0};
 BTSCO_CVSD_Context *AudioBTCVSDControl::mBTSCOCVSDContext = NULL;
 
+// codec context and working memory live on their own cache lines, the SCO threads touch them every packet
+#define BTSCO_CACHE_LINE_SIZE 64
+
+static void *btsco_AllocAligned(uint32_t size)
+{
+    void *pBuf = NULL;
+    if (posix_memalign(&pBuf, BTSCO_CACHE_LINE_SIZE, (size + BTSCO_CACHE_LINE_SIZE - 1) & ~(BTSCO_CACHE_LINE_SIZE - 1)) != 0)
+    {
+        return NULL;
+    }
+    return pBuf;
+}
+
+static void btsco_FreeAligned(void *pBuf)
+{
+    free(pBuf);
+}
+
 
 AudioBTCVSDControl *AudioBTCVSDControl::UniqueAudioBTCVSDControl = NULL;
 
@@ -112,7 +131,7 @@ int AudioBTCVSDControl::getFd()
 void AudioBTCVSDControl::BT_SCO_CVSD_Init(void)
 {
     mBTSCOCVSDContext = NULL;
-    mBTSCOCVSDContext = (BTSCO_CVSD_Context *)new char[sizeof(BTSCO_CVSD_Context)];
+    mBTSCOCVSDContext = (BTSCO_CVSD_Context *)btsco_AllocAligned(sizeof(BTSCO_CVSD_Context));
     ASSERT(mBTSCOCVSDContext);
     memset((void *)mBTSCOCVSDContext, 0, sizeof(BTSCO_CVSD_Context));
 #if 0  //set to 1 for WB BTSCO test
@@ -130,7 +149,7 @@ void AudioBTCVSDControl::BT_SCO_CVSD_DeInit(void)
 {
     if (mBTSCOCVSDContext)
     {
-        delete []mBTSCOCVSDContext;
+        btsco_FreeAligned(mBTSCOCVSDContext);
         mBTSCOCVSDContext = NULL;
         ALOGD("BT_SCO_CVSD_DeInit() release mBTSCOCVSDContext");
     }
@@ -141,7 +160,13 @@ void AudioBTCVSDControl::BT_SCO_SetMode(uint32_t mode)
 
     if (mode == 1)
     {
+#if defined(__MSBC_CODEC_SUPPORT__)
         BTmode = BT_SCO_MODE_MSBC;
+#else
+        // no mSBC codec in this build, stay on narrowband so TX/RX still make progress
+        ALOGD("BT_SCO_SetMode, mSBC not supported, fall back to CVSD");
+        BTmode = BT_SCO_MODE_CVSD;
+#endif
     }
     else
     {
@@ -340,7 +365,7 @@ void AudioBTCVSDControl::BT_SCO_TX_Open(void)
 
     uTxMemSize += (sizeof(BT_SCO_TX) + 3)& ~0x3;
 
-    mBTSCOCVSDContext->pTX = (BT_SCO_TX *)new char[uTxMemSize];
+    mBTSCOCVSDContext->pTX = (BT_SCO_TX *)btsco_AllocAligned(uTxMemSize);
     ASSERT(mBTSCOCVSDContext->pTX);
     memset((void *)mBTSCOCVSDContext->pTX, 0, uTxMemSize);
 
@@ -375,7 +400,7 @@ void AudioBTCVSDControl::BT_SCO_TX_Close(void)
 
     if (mBTSCOCVSDContext->pTX)
     {
-        delete []mBTSCOCVSDContext->pTX;
+        btsco_FreeAligned(mBTSCOCVSDContext->pTX);
         mBTSCOCVSDContext->pTX = NULL;
         ALOGD("BT_SCO_TX_Close() release mBTSCOCVSDContext->pTX");
     }
@@ -404,7 +429,7 @@ void AudioBTCVSDControl::btsco_AllocMemory_TX_CVSD(void)
         }
     }
 
-    pBuf = new uint8_t[uTotalMemory];
+    pBuf = (uint8_t *)btsco_AllocAligned(uTotalMemory);
     mBTSCOCVSDContext->pTXWorkingMemory = pBuf;
     ASSERT(mBTSCOCVSDContext->pTXWorkingMemory);
 
@@ -440,7 +465,7 @@ void AudioBTCVSDControl::btsco_AllocMemory_TX_MSBC(void)
         }
     }
 
-    pBuf = new uint8_t[uTotalMemory];
+    pBuf = (uint8_t *)btsco_AllocAligned(uTotalMemory);
     mBTSCOCVSDContext->pTXWorkingMemory = pBuf;
     ASSERT(mBTSCOCVSDContext->pTXWorkingMemory);
 
@@ -492,7 +517,7 @@ void AudioBTCVSDControl::BT_SCO_TX_Stop(void)
 
     if (mBTSCOCVSDContext->pTXWorkingMemory)
     {
-        delete []mBTSCOCVSDContext->pTXWorkingMemory;
+        btsco_FreeAligned(mBTSCOCVSDContext->pTXWorkingMemory);
         mBTSCOCVSDContext->pTXWorkingMemory = NULL;
     }
     ALOGD("BT_SCO_TX_Stop(-)");
@@ -605,6 +630,23 @@ uint8_t packetvalid           : Is this SCO_RX_PLC_SIZE packet valid (without pa
 */
 
 void AudioBTCVSDControl::btsco_process_RX_CVSD(void *inbuf, uint32_t *insize, void *outbuf, uint32_t *outsize, void *workbuf, const uint32_t workbufsize, uint8_t packetvalid)
+{
+    btsco_decode_RX_CVSD(inbuf, insize, outbuf, outsize, workbuf, workbufsize, packetvalid);
+
+    if (mBTSCOCVSDContext->pRX->fEnableFilter)
+    {
+        //do filter
+        int32_t iInSample = *outsize >> 1;
+        int32_t iOutSample = *outsize >> 1;
+        Audio_IIRHPF_Process(mBTSCOCVSDContext->pRX->pHPFHandle, (uint16_t *)outbuf, (uint16_t *)&iInSample, (uint16_t *)outbuf, (uint16_t *)&iOutSample);
+        *outsize = iOutSample << 1;
+    }
+
+    ALOGVV("btsco_process_RX_CVSD() consumed=%d, *outsize=%d", *insize, *outsize);
+}
+
+// CVSD decode, SRC 64k->8k and PLC of one packet, without the HPF
+void AudioBTCVSDControl::btsco_decode_RX_CVSD(void *inbuf, uint32_t *insize, void *outbuf, uint32_t *outsize, void *workbuf, const uint32_t workbufsize, uint8_t packetvalid)
 {
     uint16_t *pDst, *pSrc, i;
     int32_t iOutSample = 0, iInByte = 0, consumed;
@@ -677,16 +719,67 @@ void AudioBTCVSDControl::btsco_process_RX_CVSD(void *inbuf, uint32_t *insize, vo
             g711plc_dofe_v2(mBTSCOCVSDContext->pRX->pPLCHandle, (short *)outbuf, 0);
         }
     }
-    if (mBTSCOCVSDContext->pRX->fEnableFilter)
+}
+
+/*
+BT_SCO_RX_ProcessPackets(const uint8_t *rawbuf, uint32_t rawsize, uint8_t *outbuf, uint32_t outsize)
+
+const uint8_t *rawbuf                       : all packets of one kernel read, each is SCO_RX_PLC_SIZE bytes bitstream
+                                              followed by BTSCO_CVSD_PACKET_VALID_SIZE bytes packet valid info
+uint32_t rawsize                            : length of rawbuf
+uint8_t *outbuf                             : outbuf of decoded pcm data of all packets
+uint32_t outsize                            : size of outbuf
+return                                      : practical output length of decoded pcm data
+
+Packets are decoded in place from rawbuf straight into outbuf, and the CVSD HPF runs once over the whole block.
+*/
+
+uint32_t AudioBTCVSDControl::BT_SCO_RX_ProcessPackets(const uint8_t *rawbuf, uint32_t rawsize, uint8_t *outbuf, uint32_t outsize)
+{
+    const uint32_t packet_size = SCO_RX_PLC_SIZE + BTSCO_CVSD_PACKET_VALID_SIZE;
+    const bool is_wide_band = BT_SCO_isWideBand();
+    const uint32_t frame_size = is_wide_band ? MSBC_PCM_FRAME_BYTE : SCO_RX_PCM8K_BUF_SIZE;
+    uint8_t *workbuf = BT_SCO_RX_GetCVSDWorkBuf();
+    uint32_t total_outsize = 0;
+
+    for (uint32_t offset = 0; offset + packet_size <= rawsize; offset += packet_size)
     {
-        //do filter
-        int32_t iInSample = *outsize >> 1;
-        int32_t iOutSample = *outsize >> 1;
+        if (total_outsize + frame_size > outsize)
+        {
+            ALOGE("%s(), total_outsize %u + frame_size %u > outsize %u, drop remaining packets", __FUNCTION__, total_outsize, frame_size, outsize);
+            break;
+        }
+
+        void *inbuf = (void *)(rawbuf + offset);
+        const uint8_t packetvalid = rawbuf[offset + SCO_RX_PLC_SIZE];
+        uint32_t insize = SCO_RX_PLC_SIZE;
+        uint32_t pcmsize = frame_size;
+
+        if (is_wide_band)
+        {
+#if defined(__MSBC_CODEC_SUPPORT__)
+            btsco_process_RX_MSBC(inbuf, &insize, outbuf + total_outsize, &pcmsize, workbuf, SCO_RX_PCM64K_BUF_SIZE, packetvalid);
+#else
+            pcmsize = 0; // no mSBC decoder in this build, nothing is decoded
+#endif
+        }
+        else
+        {
+            btsco_decode_RX_CVSD(inbuf, &insize, outbuf + total_outsize, &pcmsize, workbuf, SCO_RX_PCM64K_BUF_SIZE, packetvalid);
+        }
+        total_outsize += pcmsize;
+    }
+
+    if (is_wide_band == false && mBTSCOCVSDContext->pRX->fEnableFilter && total_outsize > 0)
+    {
+        int32_t iInSample = total_outsize >> 1;
+        int32_t iOutSample = total_outsize >> 1;
         Audio_IIRHPF_Process(mBTSCOCVSDContext->pRX->pHPFHandle, (uint16_t *)outbuf, (uint16_t *)&iInSample, (uint16_t *)outbuf, (uint16_t *)&iOutSample);
-        *outsize = iOutSample << 1;
+        total_outsize = iOutSample << 1;
     }
 
-    ALOGVV("btsco_process_RX_CVSD() consumed=%d, *outsize=%d", *insize, *outsize);
+    ALOGVV("BT_SCO_RX_ProcessPackets() rawsize=%d, total_outsize=%d", rawsize, total_outsize);
+    return total_outsize;
 }
 
 /*
@@ -1000,6 +1093,57 @@ void AudioBTCVSDControl::btsco_process_TX_MSBC(void *inbuf, uint32_t *insize, vo
 
 #endif
 
+/*
+BT_SCO_TX_ProcessPackets(void *inbuf, uint32_t *insize, uint8_t *outbuf, uint32_t outsize, uint32_t src_fs_s)
+
+void *inbuf                                 : inbuf of pcm data
+uint32_t *insize                            : in: inbuf length of pcm data
+                                              out: consumed inbuf length of pcm data
+uint8_t *outbuf                             : outbuf of encoded bitstream of all packets
+uint32_t outsize                            : size of outbuf, packets are encoded until it is full or the encoder outputs nothing
+unint32 src_fs_s                            : SRC source sample rate
+return                                      : practical output length of encoded bitstream
+*/
+
+uint32_t AudioBTCVSDControl::BT_SCO_TX_ProcessPackets(void *inbuf, uint32_t *insize, uint8_t *outbuf, uint32_t outsize, uint32_t src_fs_s)
+{
+    const bool is_wide_band = BT_SCO_isWideBand();
+    uint8_t *workbuf = BT_SCO_TX_GetCVSDWorkBuf();
+    uint8_t *pIn = (uint8_t *)inbuf;
+    uint32_t remain = *insize;
+    uint32_t total_outsize = 0;
+
+    while (total_outsize + SCO_TX_ENCODE_SIZE <= outsize)
+    {
+        uint32_t consumed = remain;
+        uint32_t encoded = SCO_TX_ENCODE_SIZE;
+        if (is_wide_band)
+        {
+#if defined(__MSBC_CODEC_SUPPORT__)
+            btsco_process_TX_MSBC(pIn, &consumed, outbuf + total_outsize, &encoded, workbuf, SCO_TX_PCM64K_BUF_SIZE, src_fs_s);
+#else
+            // no mSBC encoder in this build, consume and encode nothing
+            consumed = 0;
+            encoded = 0;
+#endif
+        }
+        else
+        {
+            btsco_process_TX_CVSD(pIn, &consumed, outbuf + total_outsize, &encoded, workbuf, SCO_TX_PCM64K_BUF_SIZE, src_fs_s);
+        }
+        pIn += consumed;
+        remain -= consumed;
+        total_outsize += encoded;
+        if (encoded == 0)
+        {
+            break;
+        }
+    }
+
+    *insize -= remain;
+    return total_outsize;
+}
+
 void AudioBTCVSDControl::BT_SCO_RX_Open(void)
 {
     uint32_t uRxMemSize = 0;
@@ -1011,7 +1155,7 @@ void AudioBTCVSDControl::BT_SCO_RX_Open(void)
 
     uRxMemSize += (sizeof(BT_SCO_RX) + 3)& ~0x3;
 
-    mBTSCOCVSDContext->pRX = (BT_SCO_RX *)new char[uRxMemSize];
+    mBTSCOCVSDContext->pRX = (BT_SCO_RX *)btsco_AllocAligned(uRxMemSize);
     ASSERT(mBTSCOCVSDContext->pRX);
     memset((void *)mBTSCOCVSDContext->pRX, 0, uRxMemSize);
 
@@ -1050,7 +1194,7 @@ void AudioBTCVSDControl::BT_SCO_RX_Close(void)
 
     if (mBTSCOCVSDContext->pRX)
     {
-        delete []mBTSCOCVSDContext->pRX;
+        btsco_FreeAligned(mBTSCOCVSDContext->pRX);
         mBTSCOCVSDContext->pRX = NULL;
         ALOGD("BT_SCO_RX_Close(-) release mBTSCOCVSDContext->pRX");
     }
@@ -1136,7 +1280,7 @@ void AudioBTCVSDControl::btsco_AllocMemory_RX_CVSD(void)
         }
     }
 
-    pBuf = new uint8_t[uTotalMemory];
+    pBuf = (uint8_t *)btsco_AllocAligned(uTotalMemory);
     mBTSCOCVSDContext->pRXWorkingMemory = pBuf;
     ASSERT(mBTSCOCVSDContext->pRXWorkingMemory);
 
@@ -1190,7 +1334,7 @@ void AudioBTCVSDControl::btsco_AllocMemory_RX_MSBC(void)
         }
     }
 
-    pBuf = new uint8_t[uTotalMemory];
+    pBuf = (uint8_t *)btsco_AllocAligned(uTotalMemory);
     mBTSCOCVSDContext->pRXWorkingMemory = pBuf;
     ASSERT(mBTSCOCVSDContext->pRXWorkingMemory);
 
@@ -1249,7 +1393,7 @@ void AudioBTCVSDControl::BT_SCO_RX_Stop(void)
 
     if (mBTSCOCVSDContext->pRXWorkingMemory)
     {
-        delete []mBTSCOCVSDContext->pRXWorkingMemory;
+        btsco_FreeAligned(mBTSCOCVSDContext->pRXWorkingMemory);
         mBTSCOCVSDContext->pRXWorkingMemory = NULL;
     }
     ALOGD("BT_SCO_RX_Stop(-)");
@@ -1,6 +1,7 @@
 #include "AudioGainTableParamParser.h"
 
 #include <utils/Log.h>
+#include <cutils/properties.h>
 #include "AudioUtility.h"//Mutex/assert
 #include <system/audio.h>
 
@@ -8,6 +9,9 @@
 
 #define LOG_TAG "GainTableParamParser"
 
+// bump when GainTableParam / GainTableSpec or the payload layout below changes
+#define GAIN_TABLE_SNAPSHOT_VERSION 1
+
 namespace android
 {
 
@@ -74,10 +78,30 @@ GainTableParamParser *GainTableParamParser::getInstance()
  *============================================================================*/
 
 GainTableParamParser::GainTableParamParser() :
-    mAppHandle(appHandleGetInstance())
+    mAppHandle(appHandleGetInstance()),
+    mSnapshot("gain_table_param", GAIN_TABLE_SNAPSHOT_VERSION),
+    mSnapshotSourceHash(0),
+    mSnapshotValid(false)
 {
     ALOGD("%s()", __FUNCTION__);
-    loadGainTableParam();
+    memset(&mSnapshotTable, 0, sizeof(mSnapshotTable));
+
+    char value[PROPERTY_VALUE_MAX];
+    property_get("persist.af.param_snapshot", value, "1");
+    if (atoi(value) != 0)
+    {
+        // tuning saved on the device goes to the custom folder and overrides the system xml
+        mSnapshotSourceHash = AudioParamSnapshot::hashXmlFolder(AUDIO_PARAM_XML_FOLDER);
+        if (mSnapshotSourceHash != 0)
+        {
+            mSnapshotSourceHash = AudioParamSnapshot::hashXmlFolder(XML_CUS_FOLDER_ON_DEVICE, mSnapshotSourceHash);
+        }
+    }
+
+    if (loadSnapshot() == false)
+    {
+        loadGainTableParam();
+    }
 }
 
 GainTableParamParser::~GainTableParamParser()
@@ -91,7 +115,14 @@ GainTableParamParser::~GainTableParamParser()
 
 status_t GainTableParamParser::getGainTableParam(GainTableParam *_gainTable)
 {
-    ALOGD("%s()", __FUNCTION__);
+    ALOGD("%s(), snapshot %d", __FUNCTION__, mSnapshotValid);
+
+    if (mSnapshotValid)
+    {
+        memcpy(_gainTable, &mSnapshotTable, sizeof(GainTableParam));
+        return NO_ERROR;
+    }
+
     status_t status = NO_ERROR;
     status |= updatePlaybackDigitalGain(_gainTable);
     status |= updatePlaybackAnalogGain(_gainTable);
@@ -105,6 +136,7 @@ status_t GainTableParamParser::getGainTableParam(GainTableParam *_gainTable)
         return status;
     }
 
+    saveSnapshot(_gainTable);
     return NO_ERROR;
 }
 
@@ -933,6 +965,164 @@ status_t GainTableParamParser::loadGainTableMapDl()
 
 }
 
+/*
+ * Snapshot functions
+ */
+static void encodeGainTableSpec(AudioParamBlobWriter *_writer, const GainTableSpec &_spec)
+{
+    _writer->put(_spec.keyStepPerDb);
+    _writer->put(_spec.keyDbPerStep);
+    _writer->put(_spec.keyVolumeStep);
+    _writer->put(_spec.digiDbMax);
+    _writer->put(_spec.digiDbMin);
+    _writer->put(_spec.sidetoneIdxMax);
+    _writer->put(_spec.sidetoneIdxMin);
+    _writer->put(_spec.micIdxMax);
+    _writer->put(_spec.micIdxMin);
+
+    _writer->put(_spec.numBufferGainLevel);
+    _writer->putVector(_spec.bufferGainDb);
+    _writer->putVector(_spec.bufferGainIdx);
+    _writer->putStringVector(_spec.bufferGainString);
+    _writer->put(_spec.bufferGainPreferMaxIdx);
+
+    _writer->put(_spec.numSpkGainLevel);
+    _writer->putVector(_spec.spkGainDb);
+    _writer->putVector(_spec.spkGainIdx);
+    _writer->putStringVector(_spec.spkGainString);
+
+    _writer->putString(_spec.spkLMixerName);
+    _writer->putString(_spec.spkRMixerName);
+    _writer->put(_spec.spkAnaType);
+
+    _writer->putVector(_spec.swagcGainMap);
+    _writer->putVector(_spec.ulPgaGainMap);
+    _writer->putStringVector(_spec.ulPgaGainString);
+    _writer->put(_spec.ulGainOffset);
+    _writer->put(_spec.ulPgaGainMapMax);
+    _writer->put(_spec.ulHwPgaIdxMax);
+
+    _writer->putVector(_spec.stfGainMap);
+}
+
+static bool decodeGainTableSpec(AudioParamBlobReader *_reader, GainTableSpec *_spec)
+{
+    _reader->get(&_spec->keyStepPerDb);
+    _reader->get(&_spec->keyDbPerStep);
+    _reader->get(&_spec->keyVolumeStep);
+    _reader->get(&_spec->digiDbMax);
+    _reader->get(&_spec->digiDbMin);
+    _reader->get(&_spec->sidetoneIdxMax);
+    _reader->get(&_spec->sidetoneIdxMin);
+    _reader->get(&_spec->micIdxMax);
+    _reader->get(&_spec->micIdxMin);
+
+    _reader->get(&_spec->numBufferGainLevel);
+    _reader->getVector(&_spec->bufferGainDb);
+    _reader->getVector(&_spec->bufferGainIdx);
+    _reader->getStringVector(&_spec->bufferGainString);
+    _reader->get(&_spec->bufferGainPreferMaxIdx);
+
+    _reader->get(&_spec->numSpkGainLevel);
+    _reader->getVector(&_spec->spkGainDb);
+    _reader->getVector(&_spec->spkGainIdx);
+    _reader->getStringVector(&_spec->spkGainString);
+
+    _reader->getString(&_spec->spkLMixerName);
+    _reader->getString(&_spec->spkRMixerName);
+    _reader->get(&_spec->spkAnaType);
+
+    _reader->getVector(&_spec->swagcGainMap);
+    _reader->getVector(&_spec->ulPgaGainMap);
+    _reader->getStringVector(&_spec->ulPgaGainString);
+    _reader->get(&_spec->ulGainOffset);
+    _reader->get(&_spec->ulPgaGainMapMax);
+    _reader->get(&_spec->ulHwPgaIdxMax);
+
+    return _reader->getVector(&_spec->stfGainMap);
+}
+
+bool GainTableParamParser::loadSnapshot()
+{
+    if (mSnapshotSourceHash == 0 || mSnapshot.map(mSnapshotSourceHash) != NO_ERROR)
+    {
+        return false;
+    }
+
+    AudioParamBlobReader reader(mSnapshot.payload(), mSnapshot.payloadSize());
+    GainTableSpec spec;
+    std::vector<short> mapDlDigital[NUM_GAIN_DEVICE];
+    std::vector<short> mapDlAnalog[NUM_GAIN_DEVICE];
+    GAIN_ANA_TYPE mapDlAnalogType[NUM_GAIN_DEVICE];
+
+    reader.get(&mSnapshotTable);
+    decodeGainTableSpec(&reader, &spec);
+    for (unsigned int i = 0; i < NUM_GAIN_DEVICE; i++)
+    {
+        reader.getVector(&mapDlDigital[i]);
+        reader.getVector(&mapDlAnalog[i]);
+        reader.get(&mapDlAnalogType[i]);
+    }
+    mSnapshot.unmap();
+
+    if (reader.ok() == false)
+    {
+        ALOGW("%s(), payload corrupted, parse xml", __FUNCTION__);
+        mSnapshot.remove();
+        return false;
+    }
+
+    mSpec = spec;
+    for (unsigned int i = 0; i < NUM_GAIN_DEVICE; i++)
+    {
+        mMapDlDigital[i].swap(mapDlDigital[i]);
+        mMapDlAnalog[i].swap(mapDlAnalog[i]);
+        mMapDlAnalogType[i] = mapDlAnalogType[i];
+    }
+    mSnapshotValid = true;
+
+    ALOGD("%s(), gain table restored from %s", __FUNCTION__, mSnapshot.getPath());
+    return true;
+}
+
+void GainTableParamParser::saveSnapshot(const GainTableParam *_gainTable)
+{
+    if (mSnapshotSourceHash == 0)
+    {
+        return;
+    }
+
+    AudioParamBlobWriter writer;
+    writer.put(*_gainTable);
+    encodeGainTableSpec(&writer, mSpec);
+    for (unsigned int i = 0; i < NUM_GAIN_DEVICE; i++)
+    {
+        writer.putVector(mMapDlDigital[i]);
+        writer.putVector(mMapDlAnalog[i]);
+        writer.put(mMapDlAnalogType[i]);
+    }
+
+    if (mSnapshot.write(mSnapshotSourceHash, writer.data(), writer.size()) == NO_ERROR)
+    {
+        memcpy(&mSnapshotTable, _gainTable, sizeof(GainTableParam));
+        mSnapshotValid = true;
+    }
+}
+
+void GainTableParamParser::invalidateSnapshot()
+{
+    if (mSnapshotSourceHash == 0)
+    {
+        return;
+    }
+
+    ALOGD("%s()", __FUNCTION__);
+    // runtime tuning is not part of the xml hash, stop snapshotting until reboot
+    mSnapshotSourceHash = 0;
+    mSnapshotValid = false;
+    mSnapshot.remove();
+}
+
 /*
  * Utility functions
  */
@@ -0,0 +1,331 @@
+#include "AudioParamSnapshot.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <utils/Log.h>
+
+
+#define LOG_TAG "AudioParamSnapshot"
+
+namespace android
+{
+
+static const uint32_t kSnapshotMagic = 0x4e535041; // "APSN"
+static const uint32_t kSnapshotMaxPayloadSize = 0x400000;
+
+static const uint64_t kFnv64Offset = 0xcbf29ce484222325ULL;
+static const uint64_t kFnv64Prime  = 0x100000001b3ULL;
+static const uint32_t kFnv32Offset = 0x811c9dc5;
+static const uint32_t kFnv32Prime  = 0x01000193;
+
+static inline uint64_t fnv64(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ p[i]) * kFnv64Prime;
+    }
+    return hash;
+}
+
+static inline uint32_t fnv32(const void *data, size_t size)
+{
+    uint32_t hash = kFnv32Offset;
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ p[i]) * kFnv32Prime;
+    }
+    return hash;
+}
+
+
+AudioParamSnapshot::AudioParamSnapshot(const char *name, const uint32_t version) :
+    mPath(std::string(AUDIO_PARAM_SNAPSHOT_FOLDER) + name + ".snapshot"),
+    mVersion(version),
+    mMapAddr(NULL),
+    mMapSize(0),
+    mPayload(NULL),
+    mPayloadSize(0)
+{
+}
+
+
+AudioParamSnapshot::~AudioParamSnapshot()
+{
+    unmap();
+}
+
+
+uint64_t AudioParamSnapshot::hashXmlFolder(const char *folder, const uint64_t seed)
+{
+    uint64_t hash = (seed == 0) ? kFnv64Offset : seed;
+
+    DIR *dir = opendir(folder);
+    if (dir == NULL)
+    {
+        if (errno == ENOENT && seed != 0)
+        {
+            // chained folder, e.g. no tuning saved to the custom folder yet
+            return hash;
+        }
+        ALOGW("%s(), opendir %s fail, errno %d", __FUNCTION__, folder, errno);
+        return 0;
+    }
+
+    std::vector<std::string> fileNames;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".xml") == 0)
+        {
+            fileNames.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(fileNames.begin(), fileNames.end());
+
+    char buffer[4096];
+    for (size_t i = 0; i < fileNames.size(); i++)
+    {
+        std::string path = std::string(folder) + "/" + fileNames[i];
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            ALOGW("%s(), open %s fail", __FUNCTION__, path.c_str());
+            return 0;
+        }
+
+        hash = fnv64(hash, fileNames[i].c_str(), fileNames[i].size() + 1);
+        ssize_t readSize;
+        while ((readSize = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            hash = fnv64(hash, buffer, readSize);
+        }
+        close(fd);
+        if (readSize < 0)
+        {
+            return 0;
+        }
+    }
+
+    return (hash == 0) ? 1 : hash;
+}
+
+
+status_t AudioParamSnapshot::verify(const void *data, const size_t size, const uint32_t version,
+                                    const uint64_t source_hash, audio_param_snapshot_header_t *header)
+{
+    if (size < sizeof(audio_param_snapshot_header_t))
+    {
+        return BAD_VALUE;
+    }
+    memcpy(header, data, sizeof(audio_param_snapshot_header_t));
+
+    if (header->magic != kSnapshotMagic ||
+        header->payload_size > kSnapshotMaxPayloadSize ||
+        size != sizeof(audio_param_snapshot_header_t) + header->payload_size)
+    {
+        return BAD_VALUE;
+    }
+    if (header->version != version || (source_hash != 0 && header->source_hash != source_hash))
+    {
+        return NAME_NOT_FOUND; // stale, not corrupt
+    }
+    if (fnv32((const char *)data + sizeof(audio_param_snapshot_header_t), header->payload_size) != header->payload_checksum)
+    {
+        return BAD_VALUE;
+    }
+    return NO_ERROR;
+}
+
+
+status_t AudioParamSnapshot::map(const uint64_t source_hash)
+{
+    unmap();
+
+    if (source_hash == 0)
+    {
+        return NO_INIT;
+    }
+
+    int fd = open(mPath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        ALOGD("%s(), no snapshot %s", __FUNCTION__, mPath.c_str());
+        return NAME_NOT_FOUND;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+    {
+        close(fd);
+        return BAD_VALUE;
+    }
+
+    void *addr = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        ALOGW("%s(), mmap %s fail", __FUNCTION__, mPath.c_str());
+        return NO_MEMORY;
+    }
+
+    audio_param_snapshot_header_t header;
+    status_t status = verify(addr, fileStat.st_size, mVersion, source_hash, &header);
+    if (status != NO_ERROR)
+    {
+        ALOGD("%s(), %s rejected, status %d, version %u/%u, hash %llx/%llx", __FUNCTION__, mPath.c_str(),
+              status, header.version, mVersion, (unsigned long long)header.source_hash, (unsigned long long)source_hash);
+        munmap(addr, fileStat.st_size);
+        return status;
+    }
+
+    mMapAddr = addr;
+    mMapSize = fileStat.st_size;
+    mPayload = (const char *)addr + sizeof(audio_param_snapshot_header_t);
+    mPayloadSize = header.payload_size;
+    ALOGD("%s(), %s mapped, payload %u bytes", __FUNCTION__, mPath.c_str(), mPayloadSize);
+    return NO_ERROR;
+}
+
+
+void AudioParamSnapshot::unmap()
+{
+    if (mMapAddr != NULL)
+    {
+        munmap(mMapAddr, mMapSize);
+        mMapAddr = NULL;
+        mMapSize = 0;
+    }
+    mPayload = NULL;
+    mPayloadSize = 0;
+}
+
+
+status_t AudioParamSnapshot::write(const uint64_t source_hash, const void *payload, const uint32_t size)
+{
+    if (source_hash == 0 || size > kSnapshotMaxPayloadSize)
+    {
+        return BAD_VALUE;
+    }
+
+    audio_param_snapshot_header_t header;
+    header.magic = kSnapshotMagic;
+    header.version = mVersion;
+    header.source_hash = source_hash;
+    header.payload_size = size;
+    header.payload_checksum = fnv32(payload, size);
+
+    std::string tempPath = mPath + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0640);
+    if (fd < 0)
+    {
+        ALOGW("%s(), open %s fail", __FUNCTION__, tempPath.c_str());
+        return NO_INIT;
+    }
+
+    bool done = (::write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)) &&
+                (::write(fd, payload, size) == (ssize_t)size) &&
+                (fsync(fd) == 0);
+    close(fd);
+
+    if (done == false || rename(tempPath.c_str(), mPath.c_str()) != 0)
+    {
+        ALOGW("%s(), write %s fail", __FUNCTION__, mPath.c_str());
+        unlink(tempPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    ALOGD("%s(), %s, payload %u bytes, hash %llx", __FUNCTION__, mPath.c_str(), size, (unsigned long long)source_hash);
+    return NO_ERROR;
+}
+
+
+void AudioParamSnapshot::remove()
+{
+    unmap();
+    unlink(mPath.c_str());
+}
+
+
+/*==============================================================================
+ *                     Blob encoder / decoder
+ *============================================================================*/
+
+void AudioParamBlobWriter::putBytes(const void *data, const size_t size)
+{
+    const char *p = (const char *)data;
+    mData.insert(mData.end(), p, p + size);
+}
+
+void AudioParamBlobWriter::putString(const std::string &string)
+{
+    put<uint32_t>(string.size());
+    putBytes(string.data(), string.size());
+}
+
+void AudioParamBlobWriter::putStringVector(const std::vector<std::string> &vector)
+{
+    put<uint32_t>(vector.size());
+    for (size_t i = 0; i < vector.size(); i++)
+    {
+        putString(vector[i]);
+    }
+}
+
+bool AudioParamBlobReader::getBytes(void *data, const size_t size)
+{
+    if (mError || size > mSize - mPos)
+    {
+        mError = true;
+        return false;
+    }
+    memcpy(data, mData + mPos, size);
+    mPos += size;
+    return true;
+}
+
+bool AudioParamBlobReader::getString(std::string *string)
+{
+    uint32_t length = 0;
+    if (get(&length) == false || length > mSize - mPos)
+    {
+        mError = true;
+        return false;
+    }
+    string->assign(mData + mPos, length);
+    mPos += length;
+    return true;
+}
+
+bool AudioParamBlobReader::getStringVector(std::vector<std::string> *vector)
+{
+    uint32_t count = 0;
+    if (get(&count) == false || count > mSize - mPos)
+    {
+        mError = true;
+        return false;
+    }
+    vector->resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (getString(&(*vector)[i]) == false)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // end namespace android
@@ -64,6 +64,7 @@
 #include <utils/String8.h>
 #include <cutils/properties.h>
 #include "AudioPreProcess.h"
+#include "AudioTimeline.h"
 
 
 #define LOG_TAG "AudioPreProcess"
@@ -399,7 +400,8 @@ uint32_t AudioPreProcess::WriteEchoRefData(void *buffer , uint32_t bytes, const
         mTime_Info_echoref.timestamp_get = Time_Info->timestamp_get;
         mTime_Info_echoref.frameInfo_get = Time_Info->frameInfo_get;
         mTime_Info_echoref.buffer_per_time = Time_Info->buffer_per_time;
-        mTime_Info_echoref.kernelbuffer_ns = Time_Info->kernelbuffer_ns;
+        // kernel delay is counted in nominal frames, convert with the measured echo ref clock rate
+        mTime_Info_echoref.kernelbuffer_ns = AudioTimeline::getInstance()->correctDurationNs(AUDIO_TIMELINE_CLOCK_ECHOREF, Time_Info->kernelbuffer_ns);
 
         get_echoref_delay(b.frame_count, &b);
         mEcho_Reference->write(mEcho_Reference, &b);
@@ -421,7 +423,7 @@ uint32_t AudioPreProcess::NativePreprocess(void *buffer , uint32_t bytes, const
         mTime_Info.timestamp_get = Time_Info->timestamp_get;
         mTime_Info.frameInfo_get = Time_Info->frameInfo_get;
         mTime_Info.buffer_per_time = Time_Info->buffer_per_time;
-        mTime_Info.kernelbuffer_ns = Time_Info->kernelbuffer_ns;
+        mTime_Info.kernelbuffer_ns = AudioTimeline::getInstance()->correctDurationNs(AUDIO_TIMELINE_CLOCK_CAPTURE, Time_Info->kernelbuffer_ns);
 
         ssize_t frames_wr = 0;
         audio_buffer_t in_buf;
@@ -19,6 +19,7 @@
 #include "AudioSpeechEnhLayer.h"
 
 #include "AudioUtility.h"
+#include "AudioTimeline.h"
 
 //#include <aee.h>
 
@@ -88,6 +89,12 @@ uWord32 DefaultVoIPEnhancePara[EnhanceParasNum] =
 #define MAX_DUMP_NUM (1024)
 int SPELayer::DumpFileNum = 0;
 
+#define SPE_BUFFER_POOL_TIME_MS (640)   // queued time the slab covers at the configured frame rate
+#define SPE_BUFFER_POOL_MIN_SLOT (8)
+#define SPE_BUFFER_POOL_MAX_SLOT (64)
+#define SPE_BUFFER_SLOT_FRAME_NUM (4)   // one slot holds up to 4 process frames
+#define SPE_BUFFER_QUEUE_MIN_SIZE (8)
+
 int SPELayer::GetVoIPJitterTime(void)
 {
     char value[PROPERTY_VALUE_MAX];
@@ -109,6 +116,232 @@ int SPELayer::GetVoIPLatencyTime(void)
     return LatencyTime;
 }
 
+SPEBufferPool::SPEBufferPool() :
+    mpSlotInfo(NULL),
+    mpSlotPcm(NULL),
+    mpFreeSlot(NULL),
+    mSlotNum(0),
+    mSlotBytes(0),
+    mFreeSlotNum(0),
+    mHeapAllocCount(0)
+{
+}
+
+SPEBufferPool::~SPEBufferPool()
+{
+    Deinit();
+}
+
+bool SPEBufferPool::Init(uint32_t slotNum, uint32_t slotBytes)
+{
+    Mutex::Autolock _l(mPoolLock);
+
+    slotBytes = (slotBytes + 15) & ~15; // keep every slot 16 bytes aligned
+    if (slotNum <= mSlotNum && slotBytes <= mSlotBytes)
+    {
+        return true;
+    }
+
+    if (mFreeSlotNum != mSlotNum)
+    {
+        ALOGW("%s, %u slots still in use, keep slot num %u size %u", __FUNCTION__, mSlotNum - mFreeSlotNum, mSlotNum, mSlotBytes);
+        return false;
+    }
+
+    BufferInfo *pSlotInfo = (BufferInfo *)malloc(slotNum * sizeof(BufferInfo));
+    char *pSlotPcm = (char *)malloc(slotNum * slotBytes);
+    uint16_t *pFreeSlot = (uint16_t *)malloc(slotNum * sizeof(uint16_t));
+    if (pSlotInfo == NULL || pSlotPcm == NULL || pFreeSlot == NULL)
+    {
+        ALOGE("%s, alloc fail, slotNum %u slotBytes %u", __FUNCTION__, slotNum, slotBytes);
+        free(pSlotInfo);
+        free(pSlotPcm);
+        free(pFreeSlot);
+        return false;
+    }
+
+    free(mpSlotInfo);
+    free(mpSlotPcm);
+    free(mpFreeSlot);
+    mpSlotInfo = pSlotInfo;
+    mpSlotPcm = pSlotPcm;
+    mpFreeSlot = pFreeSlot;
+    mSlotNum = slotNum;
+    mSlotBytes = slotBytes;
+    for (uint32_t i = 0; i < slotNum; i++)
+    {
+        mpFreeSlot[i] = slotNum - 1 - i;
+    }
+    mFreeSlotNum = slotNum;
+    ALOGD("%s, slotNum %u slotBytes %u", __FUNCTION__, mSlotNum, mSlotBytes);
+    return true;
+}
+
+void SPEBufferPool::Deinit()
+{
+    Mutex::Autolock _l(mPoolLock);
+    if (mFreeSlotNum != mSlotNum)
+    {
+        ALOGW("%s, %u slots not returned", __FUNCTION__, mSlotNum - mFreeSlotNum);
+    }
+    free(mpSlotInfo);
+    free(mpSlotPcm);
+    free(mpFreeSlot);
+    mpSlotInfo = NULL;
+    mpSlotPcm = NULL;
+    mpFreeSlot = NULL;
+    mSlotNum = 0;
+    mSlotBytes = 0;
+    mFreeSlotNum = 0;
+}
+
+bool SPEBufferPool::IsPoolSlot(const BufferInfo *pBufInfo) const
+{
+    return (mpSlotInfo != NULL) && (pBufInfo >= mpSlotInfo) && (pBufInfo < mpSlotInfo + mSlotNum);
+}
+
+BufferInfo *SPEBufferPool::Alloc(uint32_t bytes)
+{
+    BufferInfo *pBufInfo = NULL;
+    {
+        Mutex::Autolock _l(mPoolLock);
+        if (bytes <= mSlotBytes && mFreeSlotNum > 0)
+        {
+            uint16_t slot = mpFreeSlot[--mFreeSlotNum];
+            pBufInfo = &mpSlotInfo[slot];
+            memset(pBufInfo, 0, sizeof(BufferInfo));
+            pBufInfo->pBufBase = (short *)(mpSlotPcm + slot * mSlotBytes);
+            return pBufInfo;
+        }
+        mHeapAllocCount++;
+    }
+
+    // out of slots or oversized, e.g. EPL dump
+    pBufInfo = new BufferInfo;
+    memset(pBufInfo, 0, sizeof(BufferInfo));
+    pBufInfo->pBufBase = (short *)malloc(bytes);
+    return pBufInfo;
+}
+
+void SPEBufferPool::Free(BufferInfo *pBufInfo)
+{
+    {
+        Mutex::Autolock _l(mPoolLock);
+        if (IsPoolSlot(pBufInfo))
+        {
+            mpFreeSlot[mFreeSlotNum++] = pBufInfo - mpSlotInfo;
+            return;
+        }
+    }
+    free(pBufInfo->pBufBase);
+    delete pBufInfo;
+}
+
+void SPEBufferPool::dump()
+{
+    Mutex::Autolock _l(mPoolLock);
+    ALOGD("SPEBufferPool slotNum %u slotBytes %u free %u heapAlloc %u", mSlotNum, mSlotBytes, mFreeSlotNum, mHeapAllocCount);
+}
+
+SPEBufferQueue::SPEBufferQueue() :
+    mpRing(NULL),
+    mMask(0),
+    mHead(0),
+    mCount(0)
+{
+    Grow(SPE_BUFFER_QUEUE_MIN_SIZE);
+}
+
+SPEBufferQueue::~SPEBufferQueue()
+{
+    delete[] mpRing;
+}
+
+void SPEBufferQueue::Grow(size_t capacity)
+{
+    size_t ringSize = SPE_BUFFER_QUEUE_MIN_SIZE;
+    while (ringSize < capacity)
+    {
+        ringSize <<= 1;
+    }
+
+    BufferInfo **pRing = new BufferInfo *[ringSize];
+    memset(pRing, 0, ringSize * sizeof(BufferInfo *));
+    for (size_t i = 0; i < mCount; i++)
+    {
+        pRing[i] = mpRing[(mHead + i) & mMask];
+    }
+    delete[] mpRing;
+    mpRing = pRing;
+    mMask = ringSize - 1;
+    mHead = 0;
+}
+
+void SPEBufferQueue::setCapacity(size_t capacity)
+{
+    if (capacity > mMask + 1)
+    {
+        Grow(capacity);
+    }
+}
+
+void SPEBufferQueue::add(BufferInfo *pBufInfo)
+{
+    if (mCount > mMask)
+    {
+        Grow(mCount + 1);
+    }
+    mpRing[(mHead + mCount) & mMask] = pBufInfo;
+    mCount++;
+}
+
+void SPEBufferQueue::push_front(BufferInfo *pBufInfo)
+{
+    if (mCount > mMask)
+    {
+        Grow(mCount + 1);
+    }
+    mHead = (mHead - 1) & mMask;
+    mpRing[mHead] = pBufInfo;
+    mCount++;
+}
+
+void SPEBufferQueue::removeAt(size_t index)
+{
+    if (index >= mCount)
+    {
+        return;
+    }
+    if (index == 0)
+    {
+        mHead = (mHead + 1) & mMask;
+    }
+    else
+    {
+        for (size_t i = index; i + 1 < mCount; i++)
+        {
+            mpRing[(mHead + i) & mMask] = mpRing[(mHead + i + 1) & mMask];
+        }
+    }
+    mCount--;
+}
+
+void SPEBufferQueue::clear()
+{
+    mHead = 0;
+    mCount = 0;
+}
+
+BufferInfo *SPELayer::AllocBufferInfo(uint32_t bytes)
+{
+    return mBufferPool.Alloc(bytes);
+}
+
+void SPELayer::FreeBufferInfo(BufferInfo *pBufInfo)
+{
+    mBufferPool.Free(pBufInfo);
+}
+
 SPELayer::SPELayer()
 {
     Mutex::Autolock lock(mLock);
@@ -311,8 +544,7 @@ void SPELayer::FlushBufferQ(void)
     {
         while (mULOutBufferQ.size())
         {
-            free(mULOutBufferQ[0]->pBufBase);
-            delete mULOutBufferQ[0];
+            FreeBufferInfo(mULOutBufferQ[0]);
             mULOutBufferQ.removeAt(0);
         }
         mULOutBufferQ.clear();
@@ -321,8 +553,7 @@ void SPELayer::FlushBufferQ(void)
     {
         while (mULInBufferQ.size())
         {
-            free(mULInBufferQ[0]->pBufBase);
-            delete mULInBufferQ[0];
+            FreeBufferInfo(mULInBufferQ[0]);
             mULInBufferQ.removeAt(0);
         }
         mULInBufferQ.clear();
@@ -332,8 +563,7 @@ void SPELayer::FlushBufferQ(void)
     {
         while (mDLOutBufferQ.size())
         {
-            free(mDLOutBufferQ[0]->pBufBase);
-            delete mDLOutBufferQ[0];
+            FreeBufferInfo(mDLOutBufferQ[0]);
             mDLOutBufferQ.removeAt(0);
         }
         mDLOutBufferQ.clear();
@@ -363,10 +593,8 @@ void SPELayer::FlushBufferQ(void)
             if (mDLDelayBufferQ[0]->pBufBase)
             {
                 ALOGD("mDLDelayBufferQ::pBufBase=%p", mDLDelayBufferQ[0]->pBufBase);
-                free(mDLDelayBufferQ[0]->pBufBase);
+                FreeBufferInfo(mDLDelayBufferQ[0]);
                 ALOGD("mDLDelayBufferQ::free");
-                delete mDLDelayBufferQ[0];
-                ALOGD("mDLDelayBufferQ::delete");
                 mDLDelayBufferQ.removeAt(0);
                 ALOGD("mDLDelayBufferQ::done");
             }
@@ -1258,6 +1486,27 @@ bool    SPELayer::Start(SPE_MODE mode)  //for VOIP, both uplink/downlink
     mNsecPerSample = 1000000000 / mVoIPSampleRate;
     ALOGD("mNsecPerSample=%lld", mNsecPerSample);
 
+    //size the buffer slab and queues from the frame rate, so the queues run without heap allocation
+    if (mSph_Enh_ctrl.frame_rate > 0)
+    {
+        uint32_t slotNum = SPE_BUFFER_POOL_TIME_MS / mSph_Enh_ctrl.frame_rate;
+        if (slotNum < SPE_BUFFER_POOL_MIN_SLOT)
+        {
+            slotNum = SPE_BUFFER_POOL_MIN_SLOT;
+        }
+        else if (slotNum > SPE_BUFFER_POOL_MAX_SLOT)
+        {
+            slotNum = SPE_BUFFER_POOL_MAX_SLOT;
+        }
+        mBufferPool.Init(slotNum, mSPEProcessBufSize * SPE_BUFFER_SLOT_FRAME_NUM);
+
+        mULInBufferQ.setCapacity(slotNum);
+        mULOutBufferQ.setCapacity(slotNum);
+        mDLInBufferQ.setCapacity(slotNum);
+        mDLOutBufferQ.setCapacity(slotNum);
+        mDLDelayBufferQ.setCapacity(slotNum);
+    }
+
     mBufMutex.unlock();
     /*
         mfpInDL = NULL;
@@ -1411,8 +1660,7 @@ void SPELayer::DropDownlinkData(uint32_t dropsample)
                 {
                     droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                     mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                    free(mDLDelayBufferQ[0]->pBufBase);
-                    delete mDLDelayBufferQ[0];
+                    FreeBufferInfo(mDLDelayBufferQ[0]);
                     mDLDelayBufferQ.removeAt(0);
                 }
             }
@@ -1459,8 +1707,7 @@ void SPELayer::DropDownlinkData(uint32_t dropsample)
                 {
                     droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                     mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                    free(mDLDelayBufferQ[0]->pBufBase);
-                    delete mDLDelayBufferQ[0];
+                    FreeBufferInfo(mDLDelayBufferQ[0]);
                     mDLDelayBufferQ.removeAt(0);
                 }
             }
@@ -1483,11 +1730,8 @@ void SPELayer::AddtoInputBuffer(SPE_DATA_DIRECTION dir, struct InBufferInfo *BIn
 
     //    ALOGD("SPELayer::Process, dir=%x, inBuf=%p,inBufLength=%d,mMode=%x,copysize=%d",dir,inBuf,inBufLength,mMode,copysize);
 
-    BufferInfo *newInBuffer = new BufferInfo;
-    memset(newInBuffer, 0, sizeof(BufferInfo));
+    BufferInfo *newInBuffer = AllocBufferInfo(inBufLen);
     struct timespec tstamp_queue;
-    newInBuffer->pBufBase = (short *) malloc(inBufLen);
-
     memcpy(newInBuffer->pBufBase, inBufAddr, inBufLen);
 
     //tstamp_queue = GetSystemTime(true, dir);  //modify to use read time
@@ -1586,18 +1830,10 @@ void SPELayer::AddtoInputBuffer(SPE_DATA_DIRECTION dir, struct InBufferInfo *BIn
             {
                 struct timespec Esttstamp;
                 //unsigned long long ns = (((mPreULBufLen*1000000000)/2)/2)/mVoIPSampleRate;
-                unsigned long long ns = ((mPreULBufLen * (unsigned long long)1000000) / 64);
-                Esttstamp.tv_sec = mPreUplinkEstTime.tv_sec;
+                //uplink samples are produced by the capture clock, follow its drift
+                int64_t ns = AudioTimeline::getInstance()->correctDurationNs(AUDIO_TIMELINE_CLOCK_CAPTURE, (mPreULBufLen * 1000000LL) / 64);
                 //ALOGD("uplink estimate mPreUplinkEstTime, ns=%lld, tv_sec=%ld, nsec=%ld, mPreDLBufLen=%d", ns, mPreUplinkEstTime.tv_sec, mPreUplinkEstTime.tv_nsec, mPreULBufLen);
-                if (mPreUplinkEstTime.tv_nsec + ns >= 1000000000)
-                {
-                    Esttstamp.tv_sec++;
-                    Esttstamp.tv_nsec = mPreUplinkEstTime.tv_nsec + ns - 1000000000;
-                }
-                else
-                {
-                    Esttstamp.tv_nsec = mPreUplinkEstTime.tv_nsec + ns;
-                }
+                Esttstamp = AudioTimeline::nsToTimespec(AudioTimeline::timespecToNs(mPreUplinkEstTime) + ns);
 
                 newInBuffer->time_stamp_estimate.tv_sec = Esttstamp.tv_sec;
                 newInBuffer->time_stamp_estimate.tv_nsec = Esttstamp.tv_nsec;
@@ -1865,8 +2101,7 @@ void SPELayer::AddtoInputBuffer(SPE_DATA_DIRECTION dir, struct InBufferInfo *BIn
                 {
                     //ALOGD("free over queue, mDLDelayBufferQ size=%d,mDLDelayBufQLenTotal=%d, BufLen=%d, %p, %p",mDLDelayBufferQ.size(),mDLDelayBufQLenTotal,mDLDelayBufferQ[0]->BufLen4Delay,mDLDelayBufferQ[0]->pBufBase,mDLDelayBufferQ[0]);
                     mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                    free(mDLDelayBufferQ[0]->pBufBase);
-                    delete mDLDelayBufferQ[0];
+                    FreeBufferInfo(mDLDelayBufferQ[0]);
                     mDLDelayBufferQ.removeAt(0);
                     //ALOGD("free mDLDelayBufferQ over queue done");
                 }
@@ -1899,8 +2134,7 @@ void SPELayer::AddtoInputBuffer(SPE_DATA_DIRECTION dir, struct InBufferInfo *BIn
                     if (mUplinkIntrStartTime.tv_sec > tempFinalSec)
                     {
                         mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen;
-                        free(mDLDelayBufferQ[0]->pBufBase);
-                        delete mDLDelayBufferQ[0];
+                        FreeBufferInfo(mDLDelayBufferQ[0]);
                         mDLDelayBufferQ.removeAt(0);
                     }
                     else if (mUplinkIntrStartTime.tv_sec == tempFinalSec)
@@ -1908,8 +2142,7 @@ void SPELayer::AddtoInputBuffer(SPE_DATA_DIRECTION dir, struct InBufferInfo *BIn
                         if (mUplinkIntrStartTime.tv_nsec >= tempFinalNSec)
                         {
                             mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen;
-                            free(mDLDelayBufferQ[0]->pBufBase);
-                            delete mDLDelayBufferQ[0];
+                            FreeBufferInfo(mDLDelayBufferQ[0]);
                             mDLDelayBufferQ.removeAt(0);
                         }
                         else
@@ -1941,10 +2174,8 @@ void SPELayer::CompensateBuffer(size_t BufLength, struct timespec CompenStartTim
     //    ALOGD("SPELayer::Process, dir=%x, inBuf=%p,inBufLength=%d,mMode=%x,copysize=%d",dir,inBuf,inBufLength,mMode,copysize);
 
     ALOGD("CompensateBuffer, BufLength=%d, sec=%ld, nsec=%ld", BufLength, CompenStartTime.tv_sec, CompenStartTime.tv_nsec);
-    BufferInfo *newInBuffer = new BufferInfo;
+    BufferInfo *newInBuffer = AllocBufferInfo(BufLength);
     struct timespec tstamp;
-    newInBuffer->pBufBase = (short *) malloc(BufLength);
-
     //memset(newInBuffer->pBufBase, 0, BufLength);
     memset(newInBuffer->pBufBase, 0xCC, BufLength);
 
@@ -2073,118 +2304,25 @@ bool    SPELayer::InsertDownlinkData(void)
 //return NS
 unsigned long long SPELayer::TimeStampDiff(BufferInfo *BufInfo1, BufferInfo *BufInfo2)
 {
-    unsigned long long diffns = 0;
-    struct timespec tstemp1 = BufInfo1->time_stamp_estimate;
-    struct timespec tstemp2 = BufInfo2->time_stamp_estimate;
-
-    //    ALOGD("TimeStampDiff time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld" ,tstemp1.tv_sec, tstemp1.tv_nsec, tstemp2.tv_sec, tstemp2.tv_nsec);
+    const int64_t time1 = AudioTimeline::timespecToNs(BufInfo1->time_stamp_estimate);
+    const int64_t time2 = AudioTimeline::timespecToNs(BufInfo2->time_stamp_estimate);
+    unsigned long long diffns = (time1 >= time2) ? (time1 - time2) : (time2 - time1);
 
-    if (tstemp1.tv_sec > tstemp2.tv_sec)
-    {
-        if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-        {
-            diffns = ((tstemp1.tv_sec - tstemp2.tv_sec) * (unsigned long long)1000000000) + tstemp1.tv_nsec - tstemp2.tv_nsec;
-        }
-        else
-        {
-            diffns = ((tstemp1.tv_sec - tstemp2.tv_sec - 1) * (unsigned long long)1000000000) + tstemp1.tv_nsec + 1000000000 - tstemp2.tv_nsec;
-        }
-    }
-    else if (tstemp1.tv_sec == tstemp2.tv_sec)
-    {
-        if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-        {
-            diffns = tstemp1.tv_nsec - tstemp2.tv_nsec;
-        }
-        else
-        {
-            diffns = tstemp2.tv_nsec - tstemp1.tv_nsec;
-        }
-    }
-    else
-    {
-        if (tstemp2.tv_nsec >= tstemp1.tv_nsec)
-        {
-            diffns = ((tstemp2.tv_sec - tstemp1.tv_sec) * (unsigned long long)1000000000) + tstemp2.tv_nsec - tstemp1.tv_nsec;
-        }
-        else
-        {
-            diffns = ((tstemp2.tv_sec - tstemp1.tv_sec - 1) * (unsigned long long)1000000000) + tstemp2.tv_nsec + 1000000000 - tstemp1.tv_nsec;
-        }
-    }
-    ALOGD("%s, time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld, diffns=%lld" , __FUNCTION__, tstemp1.tv_sec, tstemp1.tv_nsec, tstemp2.tv_sec, tstemp2.tv_nsec, diffns);
+    ALOGD("%s, time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld, diffns=%lld" , __FUNCTION__, BufInfo1->time_stamp_estimate.tv_sec, BufInfo1->time_stamp_estimate.tv_nsec,
+          BufInfo2->time_stamp_estimate.tv_sec, BufInfo2->time_stamp_estimate.tv_nsec, diffns);
     return diffns;
 
 }
 unsigned long long SPELayer::TimeDifference(struct timespec time1, struct timespec time2)
 {
-    unsigned long long diffns = 0;
-    struct timespec tstemp1 = time1;
-    struct timespec tstemp2 = time2;
-
-    //    ALOGD("TimeStampDiff time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld" ,tstemp1.tv_sec, tstemp1.tv_nsec, tstemp2.tv_sec, tstemp2.tv_nsec);
-
-    if (tstemp1.tv_sec > tstemp2.tv_sec)
-    {
-        if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-        {
-            diffns = ((tstemp1.tv_sec - tstemp2.tv_sec) * (unsigned long long)1000000000) + tstemp1.tv_nsec - tstemp2.tv_nsec;
-        }
-        else
-        {
-            diffns = ((tstemp1.tv_sec - tstemp2.tv_sec - 1) * (unsigned long long)1000000000) + tstemp1.tv_nsec + 1000000000 - tstemp2.tv_nsec;
-        }
-    }
-    else if (tstemp1.tv_sec == tstemp2.tv_sec)
-    {
-        if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-        {
-            diffns = tstemp1.tv_nsec - tstemp2.tv_nsec;
-        }
-        else
-        {
-            diffns = tstemp2.tv_nsec - tstemp1.tv_nsec;
-        }
-    }
-    else
-    {
-        if (tstemp2.tv_nsec >= tstemp1.tv_nsec)
-        {
-            diffns = ((tstemp2.tv_sec - tstemp1.tv_sec) * (unsigned long long)1000000000) + tstemp2.tv_nsec - tstemp1.tv_nsec;
-        }
-        else
-        {
-            diffns = ((tstemp2.tv_sec - tstemp1.tv_sec - 1) * (unsigned long long)1000000000) + tstemp2.tv_nsec + 1000000000 - tstemp1.tv_nsec;
-        }
-    }
-    //    ALOGD("TimeDifference time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld, diffns=%lld" ,tstemp1.tv_sec, tstemp1.tv_nsec, tstemp2.tv_sec, tstemp2.tv_nsec,diffns);
-    return diffns;
+    const int64_t ns1 = AudioTimeline::timespecToNs(time1);
+    const int64_t ns2 = AudioTimeline::timespecToNs(time2);
+    return (ns1 >= ns2) ? (ns1 - ns2) : (ns2 - ns1);
 }
 
 bool SPELayer::TimeCompare(struct timespec time1, struct timespec time2)
 {
-    bool bRet = 0;
-
-    if (time1.tv_sec > time2.tv_sec)
-    {
-        bRet = true;
-    }
-    else if (time1.tv_sec == time2.tv_sec)
-    {
-        if (time1.tv_nsec >= time2.tv_nsec)
-        {
-            bRet = true;
-        }
-        else
-        {
-            bRet = false;
-        }
-    }
-    else
-    {
-        bRet = false;
-    }
-    return bRet;
+    return AudioTimeline::timespecToNs(time1) >= AudioTimeline::timespecToNs(time2);
 }
 
 //endtime = false => compare the start time
@@ -2192,104 +2330,32 @@ bool SPELayer::TimeCompare(struct timespec time1, struct timespec time2)
 bool SPELayer::TimeStampCompare(BufferInfo *BufInfo1, BufferInfo *BufInfo2, bool Endtime)
 {
     bool bRet = 0;
-    struct timespec tstemp1 = BufInfo1->time_stamp_estimate;
-    struct timespec tstemp2 = BufInfo2->time_stamp_estimate;
-    struct timespec tstemp2_end = tstemp2;
+    const int64_t time1 = AudioTimeline::timespecToNs(BufInfo1->time_stamp_estimate);
+    int64_t time2 = AudioTimeline::timespecToNs(BufInfo2->time_stamp_estimate);
     int inSample = BufInfo2->BufLen / 2; //mono data since BufInfo2 is downlink data
 
-    ALOGD("%s, time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld, Endtime=%d, inSample=%d" , __FUNCTION__, tstemp1.tv_sec, tstemp1.tv_nsec, tstemp2.tv_sec, tstemp2.tv_nsec, Endtime, inSample);
+    ALOGD("%s, time1 sec= %ld, nsec=%ld, time2 sec=%ld, nsec=%ld, Endtime=%d, inSample=%d" , __FUNCTION__, BufInfo1->time_stamp_estimate.tv_sec, BufInfo1->time_stamp_estimate.tv_nsec,
+          BufInfo2->time_stamp_estimate.tv_sec, BufInfo2->time_stamp_estimate.tv_nsec, Endtime, inSample);
 
-    if (Endtime == 0)
+    bRet = (time1 >= time2);
+    if ((Endtime == 0) || (bRet == false))
     {
-        if (tstemp1.tv_sec > tstemp2.tv_sec)
-        {
-            bRet = true;
-        }
-        else if (tstemp1.tv_sec == tstemp2.tv_sec)
-        {
-            if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-            {
-                bRet = true;
-            }
-            else
-            {
-                bRet = false;
-            }
-        }
-        else
-        {
-            bRet = false;
-        }
+        return bRet;
     }
-    else
-    {
-        if (tstemp1.tv_sec > tstemp2.tv_sec)
-        {
-            bRet = true;
-        }
-        else if (tstemp1.tv_sec == tstemp2.tv_sec)
-        {
-            if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-            {
-                bRet = true;
-            }
-            else
-            {
-                bRet = false;
-                return bRet;
-            }
-        }
-        else
-        {
-            bRet = false;
-            return bRet;
-        }
 
-        unsigned long long ns = ((inSample * (unsigned long long)1000000) / 16); //sample rate is 16000
+    //sample rate is 16000, downlink samples are played by the echo ref clock
+    time2 += AudioTimeline::getInstance()->correctDurationNs(AUDIO_TIMELINE_CLOCK_ECHOREF, (inSample * 1000000LL) / 16);
+    bRet = (time1 >= time2);
 
-        if (tstemp2.tv_nsec + ns >= 1000000000)
-        {
-            tstemp2.tv_sec++;
-            tstemp2.tv_nsec = tstemp2.tv_nsec + ns - 1000000000;
-        }
-        else
-        {
-            tstemp2.tv_nsec = tstemp2.tv_nsec + ns;
-        }
-
-        ALOGD("%s, tstemp2 sec=%ld, nsec=%ld, ns=%lld" , __FUNCTION__, tstemp2.tv_sec, tstemp2.tv_nsec, ns);
-
-        if (tstemp1.tv_sec > tstemp2.tv_sec)
-        {
-            bRet = true;
-        }
-        else if (tstemp1.tv_sec == tstemp2.tv_sec)
-        {
-            if (tstemp1.tv_nsec >= tstemp2.tv_nsec)
-            {
-                bRet = true;
-            }
-            else
-            {
-                bRet = false;
-            }
-        }
-        else
-        {
-            bRet = false;
-        }
-    }
-
-    ALOGD("%s, bRet=%d", __FUNCTION__, bRet);
+    ALOGD("%s, end time2=%lld, bRet=%d", __FUNCTION__, (long long)time2, bRet);
     return bRet;
 }
 
 void SPELayer::BypassDLBuffer(void)
 {
-    BufferInfo *newInBuffer = new BufferInfo;
     struct timespec tstamp;
     int BufLength = mSPEProcessBufSize / 2;
-    newInBuffer->pBufBase = (short *) malloc(BufLength);
+    BufferInfo *newInBuffer = AllocBufferInfo(BufLength);
     //ALOGD("PrepareProcessData %p", newInBuffer->pBufBase);
     //memset(newInBuffer->pBufBase, 0, BufLength);
     memset(newInBuffer->pBufBase, 0xEE, BufLength);
@@ -2409,8 +2475,7 @@ bool SPELayer::PrepareProcessData()
                     {
                         droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                         mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                        free(mDLDelayBufferQ[0]->pBufBase);
-                        delete mDLDelayBufferQ[0];
+                        FreeBufferInfo(mDLDelayBufferQ[0]);
                         mDLDelayBufferQ.removeAt(0);
                     }
                 }
@@ -2532,8 +2597,7 @@ bool SPELayer::PrepareProcessData()
                         {
                             droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                             mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                            free(mDLDelayBufferQ[0]->pBufBase);
-                            delete mDLDelayBufferQ[0];
+                            FreeBufferInfo(mDLDelayBufferQ[0]);
                             mDLDelayBufferQ.removeAt(0);
                         }
                     }
@@ -2580,8 +2644,7 @@ bool SPELayer::PrepareProcessData()
                         {
                             droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                             mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                            free(mDLDelayBufferQ[0]->pBufBase);
-                            delete mDLDelayBufferQ[0];
+                            FreeBufferInfo(mDLDelayBufferQ[0]);
                             mDLDelayBufferQ.removeAt(0);
                         }
                     }
@@ -2590,10 +2653,9 @@ bool SPELayer::PrepareProcessData()
             }
             else    //add DL zero data at the beginning
             {
-                BufferInfo *newInBuffer = new BufferInfo;
                 struct timespec tstamp;
                 int BufLength = diffBufLength;
-                newInBuffer->pBufBase = (short *) malloc(BufLength);
+                BufferInfo *newInBuffer = AllocBufferInfo(BufLength);
                 ALOGD("%s, data is ready but need adjust", __FUNCTION__);
                 //memset(newInBuffer->pBufBase, 0, BufLength);
                 memset(newInBuffer->pBufBase, 0xEE, BufLength);
@@ -2639,8 +2701,7 @@ bool SPELayer::PrepareProcessData()
         if (mNeedJitterBuffer && (mJitterSampleCount != 0)) //the first DL buffer, add the jitter buffer at the first downlink buffer queue and downlink delay buffer queue
         {
             mNeedJitterBuffer = false;
-            BufferInfo *newJitterBuffer = new BufferInfo;
-            newJitterBuffer->pBufBase = (short *) malloc(mJitterSampleCount * sizeof(short)); //one channel, 16bits
+            BufferInfo *newJitterBuffer = AllocBufferInfo(mJitterSampleCount * sizeof(short)); //one channel, 16bits
             newJitterBuffer->BufLen = mJitterSampleCount * sizeof(short);
             newJitterBuffer->pRead = newJitterBuffer->pBufBase;
             newJitterBuffer->pWrite = newJitterBuffer->pBufBase;
@@ -2664,8 +2725,7 @@ bool SPELayer::PrepareProcessData()
             ALOGD("%s, adjust downlink data mLatencyDir=%d,mLatencySampleCount=%d", __FUNCTION__, mLatencyDir, mLatencySampleCount);
             if (mLatencyDir == true)
             {
-                BufferInfo *newDelayBuffer = new BufferInfo;
-                newDelayBuffer->pBufBase = (short *) malloc(mLatencySampleCount * sizeof(short)); //one channel, 16bits
+                BufferInfo *newDelayBuffer = AllocBufferInfo(mLatencySampleCount * sizeof(short)); //one channel, 16bits
                 newDelayBuffer->BufLen = mLatencySampleCount * sizeof(short);
                 newDelayBuffer->pRead = newDelayBuffer->pBufBase;
                 newDelayBuffer->pWrite = newDelayBuffer->pBufBase;
@@ -2723,8 +2783,7 @@ bool SPELayer::PrepareProcessData()
                             {
                                 droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                                 mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                                free(mDLDelayBufferQ[0]->pBufBase);
-                                delete mDLDelayBufferQ[0];
+                                FreeBufferInfo(mDLDelayBufferQ[0]);
                                 mDLDelayBufferQ.removeAt(0);
                             }
                         }
@@ -2770,8 +2829,7 @@ bool SPELayer::PrepareProcessData()
                             {
                                 droplength -= mDLDelayBufferQ[0]->BufLen4Delay;
                                 mDLDelayBufQLenTotal -= mDLDelayBufferQ[0]->BufLen4Delay;
-                                free(mDLDelayBufferQ[0]->pBufBase);
-                                delete mDLDelayBufferQ[0];
+                                FreeBufferInfo(mDLDelayBufferQ[0]);
                                 mDLDelayBufferQ.removeAt(0);
                             }
                         }
@@ -2839,8 +2897,7 @@ int SPELayer::Process_Record(short *inBuf, int  inBufLength)
             }
             else    //consume all the data in first queue buffer
             {
-                free(mULInBufferQ[0]->pBufBase);
-                delete mULInBufferQ[0];
+                FreeBufferInfo(mULInBufferQ[0]);
                 mULInBufferQ.removeAt(0);
                 tempULIncopysize = mULInBufferQ[0]->BufLen >> 2;
                 //                ALOGD("UL in buffer consume finish, next BufferBase=%p",mULInBufferQ[0]->pBufBase);
@@ -2859,9 +2916,7 @@ int SPELayer::Process_Record(short *inBuf, int  inBufLength)
         Dump_EPL(&mSph_Enh_ctrl.EPL_buffer, EPLBufSize * sizeof(short));
         EPLTransVMDump();
 
-        BufferInfo *newOutBuffer = new BufferInfo;
-
-        newOutBuffer->pBufBase = (short *) malloc(mSPEProcessBufSize);
+        BufferInfo *newOutBuffer = AllocBufferInfo(mSPEProcessBufSize);
         newOutBuffer->BufLen = mSPEProcessBufSize;
 
         newOutBuffer->pRead = newOutBuffer->pBufBase;
@@ -2935,8 +2990,7 @@ int SPELayer::Process_Record(short *inBuf, int  inBufLength)
         }
         else    //consume all the data in first queue buffer
         {
-            free(mULOutBufferQ[0]->pBufBase);
-            delete mULOutBufferQ[0];
+            FreeBufferInfo(mULOutBufferQ[0]);
             mULOutBufferQ.removeAt(0);
             tempULCopy = mULOutBufferQ[0]->BufLen >> 2;
             //            ALOGD("SPELayer::uplink Output buffer consumed");
@@ -2992,8 +3046,7 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
             }
             else    //consume all the data in first queue buffer
             {
-                free(mULOutBufferQ[0]->pBufBase);
-                delete mULOutBufferQ[0];
+                FreeBufferInfo(mULOutBufferQ[0]);
                 mULOutBufferQ.removeAt(0);
                 //need check if still have ULOutbuffer
                 if (!mULOutBufferQ.isEmpty())
@@ -3167,8 +3220,7 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
                     if (mDLDelayBufferQ[0]->BufLen4Delay <= 0) //run out of DL  delay queue0 buffer
                     {
                         //ALOGD("DL delay consume");
-                        free(mDLDelayBufferQ[0]->pBufBase);
-                        delete mDLDelayBufferQ[0];
+                        FreeBufferInfo(mDLDelayBufferQ[0]);
                         mDLDelayBufferQ.removeAt(0);
                         if (mDLDelayBufferQ.isEmpty())
                         {
@@ -3195,8 +3247,7 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
 
                     if (mDLDelayBufferQ[0]->BufLen4Delay <= 0) //run out of DL  delay queue0 buffer
                     {
-                        free(mDLDelayBufferQ[0]->pBufBase);
-                        delete mDLDelayBufferQ[0];
+                        FreeBufferInfo(mDLDelayBufferQ[0]);
                         mDLDelayBufferQ.removeAt(0);
                     }
 
@@ -3207,8 +3258,7 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
                 }
                 else    //consume all the data in first queue buffer
                 {
-                    free(mULInBufferQ[0]->pBufBase);
-                    delete mULInBufferQ[0];
+                    FreeBufferInfo(mULInBufferQ[0]);
                     mULInBufferQ.removeAt(0);
                     ULIncopysize = mULInBufferQ[0]->BufLen >> 2;
                     //ALOGD("UL in buffer consume finish, next BufferBase=%p, size=%d,mULInBufQLenTotal=%d",mULInBufferQ[0]->pBufBase,mULInBufferQ.size(),mULInBufQLenTotal);
@@ -3230,7 +3280,7 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
             //record to the outputbuffer queue, no need processed downlink data
 
             //BufferInfo *newDLOutBuffer = new BufferInfo;
-            BufferInfo *newULOutBuffer = new BufferInfo;
+            BufferInfo *newULOutBuffer = AllocBufferInfo(mSPEProcessBufSize);
 
             //newDLOutBuffer->pBufBase = (short*) malloc(mSPEProcessBufSize/2);
             //newDLOutBuffer->BufLen= mSPEProcessBufSize/2;
@@ -3238,7 +3288,6 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
             //newDLOutBuffer->pRead = newDLOutBuffer->pBufBase;
             //newDLOutBuffer->pWrite= newDLOutBuffer->pBufBase;
 
-            newULOutBuffer->pBufBase = (short *) malloc(mSPEProcessBufSize);
             newULOutBuffer->BufLen = mSPEProcessBufSize;
 
             newULOutBuffer->pRead = newULOutBuffer->pBufBase;
@@ -3326,8 +3375,7 @@ bool SPELayer::Process_VoIP(short *inBuf, int  inBufLength)
             }
             else    //consume all the data in first queue buffer
             {
-                free(mULOutBufferQ[0]->pBufBase);
-                delete mULOutBufferQ[0];
+                FreeBufferInfo(mULOutBufferQ[0]);
                 mULOutBufferQ.removeAt(0);
                 if (!mULOutBufferQ.isEmpty())
                 {
@@ -3414,6 +3462,7 @@ bool    SPELayer::Stop()
     }
     mState = SPE_STATE_CLEANING;
     Clear();
+    mBufferPool.dump();
     mBufMutex.unlock();
     return true;
 }
@@ -3457,8 +3506,7 @@ void SPELayer::Clear()
     {
         while (mULOutBufferQ.size())
         {
-            free(mULOutBufferQ[0]->pBufBase);
-            delete mULOutBufferQ[0];
+            FreeBufferInfo(mULOutBufferQ[0]);
             mULOutBufferQ.removeAt(0);
         }
         mULOutBufferQ.clear();
@@ -3467,8 +3515,7 @@ void SPELayer::Clear()
     {
         while (mULInBufferQ.size())
         {
-            free(mULInBufferQ[0]->pBufBase);
-            delete mULInBufferQ[0];
+            FreeBufferInfo(mULInBufferQ[0]);
             mULInBufferQ.removeAt(0);
         }
         mULInBufferQ.clear();
@@ -3478,8 +3525,7 @@ void SPELayer::Clear()
     {
         while (mDLOutBufferQ.size())
         {
-            free(mDLOutBufferQ[0]->pBufBase);
-            delete mDLOutBufferQ[0];
+            FreeBufferInfo(mDLOutBufferQ[0]);
             mDLOutBufferQ.removeAt(0);
         }
         mDLOutBufferQ.clear();
@@ -3509,10 +3555,8 @@ void SPELayer::Clear()
             if (mDLDelayBufferQ[0]->pBufBase)
             {
                 ALOGD("mDLDelayBufferQ::pBufBase=%d", mDLDelayBufferQ[0]->pBufBase);
-                free(mDLDelayBufferQ[0]->pBufBase);
+                FreeBufferInfo(mDLDelayBufferQ[0]);
                 ALOGD("mDLDelayBufferQ::free");
-                delete mDLDelayBufferQ[0];
-                ALOGD("mDLDelayBufferQ::delete");
                 mDLDelayBufferQ.removeAt(0);
                 ALOGD("mDLDelayBufferQ::done");
             }
@@ -3695,8 +3739,7 @@ void SPELayer::DumpBufferClear(void)
     {
         while (mDumpDLInBufferQ.size())
         {
-            free(mDumpDLInBufferQ[0]->pBufBase);
-            delete mDumpDLInBufferQ[0];
+            FreeBufferInfo(mDumpDLInBufferQ[0]);
             mDumpDLInBufferQ.removeAt(0);
         }
         mDumpDLInBufferQ.clear();
@@ -3706,8 +3749,7 @@ void SPELayer::DumpBufferClear(void)
     {
         while (mDumpDLOutBufferQ.size())
         {
-            free(mDumpDLOutBufferQ[0]->pBufBase);
-            delete mDumpDLOutBufferQ[0];
+            FreeBufferInfo(mDumpDLOutBufferQ[0]);
             mDumpDLOutBufferQ.removeAt(0);
         }
         mDumpDLOutBufferQ.clear();
@@ -3717,8 +3759,7 @@ void SPELayer::DumpBufferClear(void)
     {
         while (mDumpULInBufferQ.size())
         {
-            free(mDumpULInBufferQ[0]->pBufBase);
-            delete mDumpULInBufferQ[0];
+            FreeBufferInfo(mDumpULInBufferQ[0]);
             mDumpULInBufferQ.removeAt(0);
         }
         mDumpULInBufferQ.clear();
@@ -3728,8 +3769,7 @@ void SPELayer::DumpBufferClear(void)
     {
         while (mDumpULOutBufferQ.size())
         {
-            free(mDumpULOutBufferQ[0]->pBufBase);
-            delete mDumpULOutBufferQ[0];
+            FreeBufferInfo(mDumpULOutBufferQ[0]);
             mDumpULOutBufferQ.removeAt(0);
         }
         mDumpULOutBufferQ.clear();
@@ -3739,8 +3779,7 @@ void SPELayer::DumpBufferClear(void)
     {
         while (mDumpEPLBufferQ.size())
         {
-            free(mDumpEPLBufferQ[0]->pBufBase);
-            delete mDumpEPLBufferQ[0];
+            FreeBufferInfo(mDumpEPLBufferQ[0]);
             mDumpEPLBufferQ.removeAt(0);
         }
         mDumpEPLBufferQ.clear();
@@ -3796,8 +3835,7 @@ void *DumpThread(void *arg)
             pSPEL->DumpMutexLock();
             if (pSPEL->hDumpThread != NULL)
             {
-                free(pSPEL->mDumpDLInBufferQ[0]->pBufBase);
-                delete pSPEL->mDumpDLInBufferQ[0];
+                pSPEL->FreeBufferInfo(pSPEL->mDumpDLInBufferQ[0]);
                 pSPEL->mDumpDLInBufferQ.removeAt(0);
             }
             pSPEL->DumpMutexUnlock();
@@ -3809,8 +3847,7 @@ void *DumpThread(void *arg)
             pSPEL->DumpMutexLock();
             if (pSPEL->hDumpThread != NULL)
             {
-                free(pSPEL->mDumpDLOutBufferQ[0]->pBufBase);
-                delete pSPEL->mDumpDLOutBufferQ[0];
+                pSPEL->FreeBufferInfo(pSPEL->mDumpDLOutBufferQ[0]);
                 pSPEL->mDumpDLOutBufferQ.removeAt(0);
             }
             pSPEL->DumpMutexUnlock();
@@ -3822,8 +3859,7 @@ void *DumpThread(void *arg)
             pSPEL->DumpMutexLock();
             if (pSPEL->hDumpThread != NULL)
             {
-                free(pSPEL->mDumpULInBufferQ[0]->pBufBase);
-                delete pSPEL->mDumpULInBufferQ[0];
+                pSPEL->FreeBufferInfo(pSPEL->mDumpULInBufferQ[0]);
                 pSPEL->mDumpULInBufferQ.removeAt(0);
             }
             pSPEL->DumpMutexUnlock();
@@ -3835,8 +3871,7 @@ void *DumpThread(void *arg)
             pSPEL->DumpMutexLock();
             if (pSPEL->hDumpThread != NULL)
             {
-                free(pSPEL->mDumpULOutBufferQ[0]->pBufBase);
-                delete pSPEL->mDumpULOutBufferQ[0];
+                pSPEL->FreeBufferInfo(pSPEL->mDumpULOutBufferQ[0]);
                 pSPEL->mDumpULOutBufferQ.removeAt(0);
             }
             pSPEL->DumpMutexUnlock();
@@ -3849,8 +3884,7 @@ void *DumpThread(void *arg)
             //            ALOGD("DumpThread %p, %p",pSPEL->mDumpEPLBufferQ[0],pSPEL->mDumpEPLBufferQ[0]->pBufBase);
             if (pSPEL->hDumpThread != NULL)
             {
-                free(pSPEL->mDumpEPLBufferQ[0]->pBufBase);
-                delete pSPEL->mDumpEPLBufferQ[0];
+                pSPEL->FreeBufferInfo(pSPEL->mDumpEPLBufferQ[0]);
                 pSPEL->mDumpEPLBufferQ.removeAt(0);
             }
             pSPEL->DumpMutexUnlock();
@@ -4129,8 +4163,7 @@ void SPELayer::Dump_PCM_In(SPE_DATA_DIRECTION dir, void *buffer, int bytes)
     {
         if (mfpInUL != NULL)
         {
-            BufferInfo *newInBuffer = new BufferInfo;
-            newInBuffer->pBufBase = (short *) malloc(bytes);
+            BufferInfo *newInBuffer = AllocBufferInfo(bytes);
             memcpy(newInBuffer->pBufBase, buffer, bytes);
 
             newInBuffer->BufLen = bytes;
@@ -4145,8 +4178,7 @@ void SPELayer::Dump_PCM_In(SPE_DATA_DIRECTION dir, void *buffer, int bytes)
     {
         if (mfpInDL != NULL)
         {
-            BufferInfo *newInBuffer = new BufferInfo;
-            newInBuffer->pBufBase = (short *) malloc(bytes);
+            BufferInfo *newInBuffer = AllocBufferInfo(bytes);
             memcpy(newInBuffer->pBufBase, buffer, bytes);
 
             newInBuffer->BufLen = bytes;
@@ -4188,8 +4220,7 @@ void SPELayer::Dump_PCM_Out(SPE_DATA_DIRECTION dir, void *buffer, int bytes)
     {
         if (mfpOutUL != NULL)
         {
-            BufferInfo *newInBuffer = new BufferInfo;
-            newInBuffer->pBufBase = (short *) malloc(bytes);
+            BufferInfo *newInBuffer = AllocBufferInfo(bytes);
             memcpy(newInBuffer->pBufBase, buffer, bytes);
 
             newInBuffer->BufLen = bytes;
@@ -4204,8 +4235,7 @@ void SPELayer::Dump_PCM_Out(SPE_DATA_DIRECTION dir, void *buffer, int bytes)
     {
         if (mfpOutDL != NULL)
         {
-            BufferInfo *newInBuffer = new BufferInfo;
-            newInBuffer->pBufBase = (short *) malloc(bytes);
+            BufferInfo *newInBuffer = AllocBufferInfo(bytes);
             memcpy(newInBuffer->pBufBase, buffer, bytes);
 
             newInBuffer->BufLen = bytes;
@@ -4226,8 +4256,7 @@ void SPELayer::Dump_EPL(void *buffer, int bytes)
     }
     if (mfpEPL != NULL)
     {
-        BufferInfo *newInBuffer = new BufferInfo;
-        newInBuffer->pBufBase = (short *) malloc(bytes);
+        BufferInfo *newInBuffer = AllocBufferInfo(bytes);
         memcpy(newInBuffer->pBufBase, buffer, bytes);
 
         newInBuffer->BufLen = bytes;
@@ -0,0 +1,140 @@
+#include "AudioTimeline.h"
+
+#include <cutils/atomic.h>
+
+#include "AudioAssert.h"
+
+
+#define LOG_TAG "AudioTimeline"
+
+namespace android
+{
+
+static const int64_t kClockGapNs = 500000000LL;         // no timestamp for 500ms, stream was restarted
+static const int64_t kDriftWindowMinNs = 10000000000LL;  // htimestamp jitter is ~1ms, so measure over >= 10s
+static const int64_t kDriftWindowMaxNs = 60000000000LL;  // re-anchor every minute to follow slow drift
+static const int32_t kDriftPpmLimit = 1000;
+static const int32_t kDriftSmoothShift = 3;             // new = old + (measured - old) / 8
+
+AudioTimeline *AudioTimeline::mAudioTimeline = NULL;
+AudioTimeline *AudioTimeline::getInstance()
+{
+    AudioLock mGetInstanceLock;
+    AudioAutoTimeoutLock _l(mGetInstanceLock);
+
+    if (mAudioTimeline == NULL)
+    {
+        mAudioTimeline = new AudioTimeline();
+    }
+    ASSERT(mAudioTimeline != NULL);
+    return mAudioTimeline;
+}
+
+
+AudioTimeline::AudioTimeline()
+{
+    ALOGD("%s()", __FUNCTION__);
+    memset(mClock, 0, sizeof(mClock));
+}
+
+
+AudioTimeline::~AudioTimeline()
+{
+    ALOGD("%s()", __FUNCTION__);
+}
+
+
+void AudioTimeline::updateClock(const audio_timeline_clock_t clock, const struct timespec &timestamp,
+                                const uint32_t read_frames, const uint32_t avail_frames, const uint32_t sample_rate)
+{
+    if (clock >= AUDIO_TIMELINE_CLOCK_NUM || sample_rate == 0)
+    {
+        return;
+    }
+
+    const int64_t time_ns = timespecToNs(timestamp);
+    if (time_ns == 0)
+    {
+        return;
+    }
+
+    AudioAutoTimeoutLock _l(mLock);
+    clock_state_t *pClock = &mClock[clock];
+
+    pClock->read_position += read_frames;
+    const uint64_t position = pClock->read_position + avail_frames;
+
+    if (pClock->anchored == false ||
+        pClock->sample_rate != sample_rate ||
+        time_ns <= pClock->last_ns ||
+        time_ns - pClock->last_ns > kClockGapNs)
+    {
+        pClock->anchored = true;
+        pClock->sample_rate = sample_rate;
+        pClock->anchor_ns = time_ns;
+        pClock->anchor_position = position;
+        pClock->last_ns = time_ns;
+        return;
+    }
+    pClock->last_ns = time_ns;
+
+    const int64_t elapsed_ns = time_ns - pClock->anchor_ns;
+    if (elapsed_ns < kDriftWindowMinNs)
+    {
+        return;
+    }
+
+    const int64_t frame_ns = (int64_t)((position - pClock->anchor_position) * 1000000000ULL / sample_rate);
+    int64_t measured_ppm = (frame_ns - elapsed_ns) * 1000000LL / elapsed_ns;
+    if (measured_ppm > kDriftPpmLimit || measured_ppm < -kDriftPpmLimit)
+    {
+        ALOGW("%s(), clock %d drift %lld ppm out of range, re-anchor", __FUNCTION__, clock, (long long)measured_ppm);
+        pClock->anchor_ns = time_ns;
+        pClock->anchor_position = position;
+        return;
+    }
+
+    int32_t drift_ppm = pClock->drift_ppm;
+    drift_ppm += ((int32_t)measured_ppm - drift_ppm) >> kDriftSmoothShift;
+    android_atomic_release_store(drift_ppm, &pClock->drift_ppm);
+
+    if (elapsed_ns > kDriftWindowMaxNs)
+    {
+        ALOGD("%s(), clock %d drift %d ppm", __FUNCTION__, clock, drift_ppm);
+        pClock->anchor_ns = time_ns;
+        pClock->anchor_position = position;
+    }
+}
+
+
+void AudioTimeline::resetClock(const audio_timeline_clock_t clock)
+{
+    if (clock >= AUDIO_TIMELINE_CLOCK_NUM)
+    {
+        return;
+    }
+
+    AudioAutoTimeoutLock _l(mLock);
+    // keep drift_ppm, the crystal does not change across stream restart
+    mClock[clock].anchored = false;
+    mClock[clock].read_position = 0;
+}
+
+
+int32_t AudioTimeline::getDriftPpm(const audio_timeline_clock_t clock) const
+{
+    if (clock >= AUDIO_TIMELINE_CLOCK_NUM)
+    {
+        return 0;
+    }
+    return android_atomic_acquire_load(&mClock[clock].drift_ppm);
+}
+
+
+int64_t AudioTimeline::correctDurationNs(const audio_timeline_clock_t clock, const int64_t nominal_ns) const
+{
+    // a fast clock plays its nominal frames in less real time
+    return nominal_ns - nominal_ns * getDriftPpm(clock) / 1000000LL;
+}
+
+} // end of namespace android
@@ -38,6 +38,7 @@
 #include "audio_custom_exp.h"
 #include <linux/rtpm_prio.h>
 #include "AudioVUnlockDL.h"
+#include "AudioALSAPlaybackTap.h"
 #include <cutils/log.h>
 #include <cutils/ashmem.h>
 #include <media/AudioSystem.h>
@@ -582,6 +583,36 @@ void *ReadRoutine(void *hdl)
             ALOGV("[ReadRoutine] switch to new DL time %d %d", VInstance->mDLtime.tv_sec, VInstance->mDLtime.tv_nsec);
         }
 
+        // pull what playback published since last loop, narrowed to 16 bit by the tap
+        if (VInstance->mTapReader >= 0)
+        {
+            // the SRC input follows whichever handler owns the tap now
+            AudioALSAPlaybackTap *pTap = AudioALSAPlaybackTap::getInstance();
+            const int32_t tapGeneration = pTap->getGeneration();
+            if (tapGeneration != VInstance->mTapGeneration)
+            {
+                uint32_t sampleRate = 0, numChannels = 0;
+                audio_format_t format = AUDIO_FORMAT_PCM_16_BIT;
+                pTap->getSourceAttribute(&sampleRate, &numChannels, &format);
+                if (sampleRate != 0)
+                {
+                    // our reader gets 16 bit whatever format is published
+                    VInstance->GetSRCInputParameter(sampleRate, numChannels, AUDIO_FORMAT_PCM_16_BIT);
+                }
+                VInstance->mTapGeneration = tapGeneration;
+            }
+
+            uint32_t tapread = pTap->read(VInstance->mTapReader, tempbuffer, ringBuf_in->GetBufSpace());
+            if (tapread > 0)
+            {
+                if (VInstance->mReferenceMute)
+                {
+                    memset(tempbuffer, 0, tapread);
+                }
+                ringBuf_in->Write(tempbuffer, tapread);
+            }
+        }
+
         uint32_t readsz = ringBuf_in->GetBufDataSz();
         dataread = ringBuf_in->ReadWithoutAdvance(tempbuffer, readsz);
         if (VInstance->mInRemaining != 0)
@@ -717,6 +748,9 @@ AudioVUnlockDL::AudioVUnlockDL()
     mInRemaining = 0;
     mTempBuf = NULL;
     mTempBufsz = 0;
+    mTapReader = -1;
+    mTapGeneration = -1;
+    mReferenceMute = false;
 }
 
 
@@ -1054,6 +1088,10 @@ void AudioVUnlockDL::SetInputStandBy(bool val)
         ALOGV("[SetInputStandBy] val %d", val);
     }
 }
+void AudioVUnlockDL::SetReferenceMute(bool mute)
+{
+    mReferenceMute = mute;
+}
 bool AudioVUnlockDL::StreamOutStandBy()
 {
     return mInputStandby ;
@@ -1180,6 +1218,12 @@ bool AudioVUnlockDL::startInput()
         return true;
     }
 
+    if (mTapReader < 0)
+    {
+        mTapReader = AudioALSAPlaybackTap::getInstance()->addReader(AUDIO_FORMAT_PCM_16_BIT);
+        mTapGeneration = -1;
+    }
+
     ALOGV("[startInput] +create AudioVUnlockDL ReadRoutine thread");
     ret = pthread_create(&mReadThread, NULL, ReadRoutine, this);
     ALOGV("[startInput] -create AudioVUnlockDL ReadRoutine thread");
@@ -1298,6 +1342,9 @@ bool AudioVUnlockDL::stopInput()
     mOutRemaining = 0;
     mInRemaining = 0;
 
+    AudioALSAPlaybackTap::getInstance()->removeReader(mTapReader);
+    mTapReader = -1;
+
     // stop read in from Stream out
     //delete ring buffer
     ClearState(VPWStreamIn_READ_START);
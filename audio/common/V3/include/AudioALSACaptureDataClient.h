@@ -1,9 +1,12 @@
 #ifndef ANDROID_AUDIO_ALSA_CAPTURE_DATA_CLIENT_H
 #define ANDROID_AUDIO_ALSA_CAPTURE_DATA_CLIENT_H
 
+#include <pthread.h>
+
 #include "AudioType.h"
 #include "AudioLock.h"
 #include "AudioUtility.h"
+#include "AudioSPSCRingBuf.h"
 #ifdef MTK_BASIC_PACKAGE
 #include "AudioTypeExt.h"
 #endif
@@ -26,6 +29,7 @@ namespace android
 class AudioALSACaptureDataProviderBase;
 class MtkAudioSrc;
 class AudioALSACaptureDataProviderEchoRef;
+struct capture_period_t;
 
 /// Observer pattern: Observer
 class AudioALSACaptureDataClient
@@ -47,6 +51,12 @@ class AudioALSACaptureDataClient
          */
         virtual uint32_t    copyCaptureDataToClient(RingBuf pcm_read_buf); // called by capture data provider
 
+        /**
+         * parallel fan-out: hand a published period to the client worker, false if not taken
+         */
+        bool                queueCapturePeriod(capture_period_t *period); // called by capture data provider
+        static const uint32_t kMaxPendingCapturePeriod = 4; // fan-out queue depth per client
+
 
         /**
          * read data from audio hardware
@@ -72,6 +82,11 @@ class AudioALSACaptureDataClient
          */
         bool	IsLowLatencyCapture(void);
 
+        /**
+         * heap allocations copyCaptureDataToClient() could not serve from the scratch arena, expected 0
+         */
+        inline uint32_t getScratchAllocCount() const { return mScratchAllocCount; }
+
     private:
         AudioALSACaptureDataClient() {}
         AudioALSACaptureDataProviderBase *mCaptureDataProvider;
@@ -91,7 +106,8 @@ class AudioALSACaptureDataClient
         uint32_t mIdentity; // key for mCaptureDataClientVector
         bool mIsIdentitySet;
 
-        AudioLock mLock;
+        AudioLock mLock; // processing state shared by provider thread and read()
+        AudioLock mWaitLock; // only guards mWaitWorkCV, ring data is lock-free
         AudioCondition mWaitWorkCV;
 
         /**
@@ -107,11 +123,11 @@ class AudioALSACaptureDataClient
 
 
         /**
-         * local ring buffer
+         * local ring buffer, mProcessedDataBuf is written by provider thread and read by read()
          */
-        RingBuf             mRawDataBuf;
-        RingBuf             mSrcDataBuf;
-        RingBuf             mProcessedDataBuf;
+        AudioSPSCRingBuf    mRawDataBuf;
+        AudioSPSCRingBuf    mSrcDataBuf;
+        AudioSPSCRingBuf    mProcessedDataBuf;
 
 
         /**
@@ -142,7 +158,7 @@ class AudioALSACaptureDataClient
         bool IsNeedChannelRemix() { return (mChannelRemixOp != CHANNEL_REMIX_NOP); }
         void CheckChannelRemixOp(void);
         ssize_t ApplyChannelRemix(short *buffer, size_t bytes);
-        ssize_t ApplyChannelRemixWithRingBuf(RingBuf *srcBuffer, RingBuf *dstBuffer);
+        ssize_t ApplyChannelRemixWithRingBuf(AudioSPSCRingBuf *srcBuffer, AudioSPSCRingBuf *dstBuffer);
         void CheckBesRecordStereoModeEnable(void);
 
         timespec GetCaptureTimeStamp(void);
@@ -172,6 +188,41 @@ class AudioALSACaptureDataClient
         SPE_MODE mSpeechProcessMode;
         voip_sph_enh_mask_struct_t mVoIPSpeechEnhancementMask;
         uint32_t mChannelRemixOp;
+
+        /**
+         * scratch arena for copyCaptureDataToClient(), sized once so the provider thread never allocates
+         */
+        void InitScratchBuffer(void);
+        void DeinitScratchBuffer(void);
+        char *GetScratchBuffer(char *pScratch, const uint32_t scratchSize, const uint32_t bytes);
+        void ReleaseScratchBuffer(char *pBuffer, const char *pScratch);
+
+        /**
+         * parallel fan-out worker, runs copyCaptureDataToClient() off the provider thread
+         */
+        void StartFanOutWorker(void);
+        void StopFanOutWorker(void);
+        static void *FanOutThread(void *arg);
+
+        pthread_t mFanOutThread;
+        bool      mFanOutThreadCreated;
+        bool      mFanOutExit;
+        AudioLock mFanOutLock;
+        AudioCondition mFanOutCV;
+        capture_period_t *mFanOutQueue[kMaxPendingCapturePeriod];
+        uint32_t  mFanOutQueueHead;
+        uint32_t  mFanOutQueueCount;
+
+        // Time_Info of the period being processed, the provider one in serial mode
+        const time_info_struct_t *mCaptureTimeInfo;
+
+        char    *mScratchLinearBuf;
+        uint32_t mScratchLinearBufSize;
+        char    *mScratchSrc1Buf;
+        uint32_t mScratchSrc1BufSize;
+        char    *mScratchSrc2Buf;
+        uint32_t mScratchSrc2BufSize;
+        uint32_t mScratchAllocCount;
         //Audio tuning tool
         bool mBesRecTuningEnable;
         char m_strTuningFileName[VM_FILE_NAME_LEN_MAX];
@@ -2,6 +2,7 @@
 #define ANDROID_AUDIO_ALSA_CAPTURE_DATA_PROVIDER_BASE_H
 
 #include <utils/KeyedVector.h>
+#include <utils/Vector.h>
 
 #include <tinyalsa/asoundlib.h>
 
@@ -20,6 +21,20 @@ class AudioLock;
 class AudioALSACaptureDataClient;
 
 
+/**
+ * one capture period published by the provider thread in parallel fan-out mode,
+ * shared read-only by all client workers and recycled when refCount drops to 0
+ */
+struct capture_period_t
+{
+    char    *pBufBase;
+    uint32_t bufLen;
+    uint32_t dataSize;
+    time_info_struct_t Time_Info; // snapshot of mStreamAttributeSource.Time_Info for this period
+    volatile int32_t refCount;
+};
+
+
 /// Observer pattern: Subject
 class AudioALSACaptureDataProviderBase
 {
@@ -34,6 +49,12 @@ class AudioALSACaptureDataProviderBase
 
         const stream_attribute_t *getStreamAttributeSource() { return &mStreamAttributeSource; }
 
+        /**
+         * parallel fan-out: each client processes published periods on its own worker
+         */
+        inline bool isParallelFanOut() const { return mParallelFanOut; }
+        static void releaseCapturePeriod(capture_period_t *period);
+
         static int mDumpFileNum;
 
 
@@ -51,6 +72,11 @@ class AudioALSACaptureDataProviderBase
          */
         void     provideCaptureDataToAllClients(const uint32_t open_index);
 
+        /**
+         * parallel fan-out mode, set by the derived provider before the first attach
+         */
+        bool     mParallelFanOut;
+
 
         //echoref+++
         /**
@@ -131,6 +157,17 @@ class AudioALSACaptureDataProviderBase
 
         capture_provider_t mCaptureDataProviderType;
 
+    private:
+        /**
+         * parallel fan-out: publish mPcmReadBuf once and queue it to every client worker
+         */
+        void     publishCaptureDataToAllClients(void);
+        capture_period_t *getFreeCapturePeriod(const uint32_t dataSize); // NULL when the whole pool is in use
+        void     clearCapturePeriodPool(void);
+
+        Vector<capture_period_t *> mCapturePeriodPool; // only touched with mClientLock held
+
+    protected:
         void  OpenPCMDump(const char *class_name);
         void  ClosePCMDump(void);
         void  WritePcmDumpData(void);
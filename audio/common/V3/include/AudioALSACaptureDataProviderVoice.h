@@ -2,6 +2,7 @@
 #define ANDROID_AUDIO_ALSA_CAPTURE_DATA_PROVIDER_VOICE_H
 
 #include "AudioALSACaptureDataProviderBase.h"
+#include "AudioSPSCRingBuf.h"
 
 namespace android
 {
@@ -20,7 +21,8 @@ class AudioALSACaptureDataProviderVoice : public AudioALSACaptureDataProviderBas
         status_t close();
 
         /**
-         * provide modem record data to capture data provider
+         * provide modem record data to capture data provider,
+         * called by the modem read thread, only copies to mStagingBuf and never blocks
          */
         status_t provideModemRecordDataToProvider(RingBuf modem_record_buf);
 
@@ -28,6 +30,17 @@ class AudioALSACaptureDataProviderVoice : public AudioALSACaptureDataProviderBas
     protected:
         AudioALSACaptureDataProviderVoice();
 
+        /**
+         * deliver staged modem data to clients (pcm dump, SRC, enh, ...)
+         */
+        static void *deliverThread(void *arg);
+
+        AudioSPSCRingBuf mStagingBuf;     // modem read thread -> deliverThread
+        AudioLock        mStagingLock;
+        AudioCondition   mStagingCond;
+        volatile int32_t mStagingDropBytes;
+
+        pthread_t hDeliverThread;
 
 
     private:
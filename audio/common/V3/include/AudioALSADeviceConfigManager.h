@@ -74,6 +74,16 @@
 namespace android
 {
 
+/**
+ * kctl name/value pair resolved to mixer control and enum index,
+ * mCtl is NULL when the pair can not be resolved and the string path is used
+ */
+struct DeviceCtlCompiledItem
+{
+    struct mixer_ctl *mCtl;
+    int mEnumIndex;
+};
+
 class DeviceCtlDescriptor
 {
     public:
@@ -82,6 +92,9 @@ class DeviceCtlDescriptor
         Vector<String8> mDeviceCltonVector;
         Vector<String8> mDeviceCltoffVector;
         Vector<String8> mDeviceCltsettingVector;
+        Vector<DeviceCtlCompiledItem> mDeviceCltonCompiled;
+        Vector<DeviceCtlCompiledItem> mDeviceCltoffCompiled;
+        Vector<DeviceCtlCompiledItem> mDeviceCltsettingCompiled;
         int DeviceStatusCounter;
 };
 
@@ -144,11 +157,24 @@ class AudioALSADeviceConfigManager
           */
         DeviceCtlDescriptor *GetDeviceDescriptorbyname(const char *devicename);
 
+        /**
+          * resolve kctl name/value pairs to mixer_ctl / enum index once mixer is ready
+          */
+        void CompileDeviceSequence(void);
+        void CompileCtlVector(const Vector<String8> &CtlVector, Vector<DeviceCtlCompiledItem> *CompiledVector);
+
+        /**
+          * apply a compiled sequence, skip controls already at the target value
+          */
+        status_t ApplyCompiledSequence(DeviceCtlDescriptor *descriptor, const Vector<String8> &CtlVector,
+                                       const Vector<DeviceCtlCompiledItem> &CompiledVector);
+
         Vector<DeviceCtlDescriptor *> mDeviceVector;
         DeviceCtlControlSeq mDeviceCtlSeq;
         String8 VersionControl;
         bool mConfigsupport;
         bool mInit;
+        bool mCtlDiffEnable;
 
         /**
          * mixer controller
@@ -243,6 +243,30 @@ private:
         int GetHeadphoneLGain(void);
         int GetSPKGain(void);
 
+        /**
+         * analog gain kctls, resolved again when the gain spec is reloaded.
+         * the last gain index written is kept so an unchanged gain skips the mixer write
+         */
+        enum gain_ctl_t
+        {
+            GAIN_CTL_HANDSET = 0,
+            GAIN_CTL_HEADSET_L,
+            GAIN_CTL_HEADSET_R,
+            GAIN_CTL_SPEAKER_L,
+            GAIN_CTL_SPEAKER_R,
+            NUM_GAIN_CTL
+        };
+        struct gain_ctl_cache_t
+        {
+            struct mixer_ctl *ctl;
+            int lastIndex; // -1: unknown, always write
+        };
+        void compileGainCtlCache();
+        void setGainCtl(gain_ctl_t gainCtl, const char *ctlName, const std::vector<std::string> &enumString, int index);
+        gain_ctl_cache_t mGainCtlCache[NUM_GAIN_CTL];
+        bool mGainCtlDiffEnable;
+        int  mMasterVolumeDegradeDb; // buffer gain steps to degrade for mMasterVolume
+
 private:
         GainTableParam mGainTable;
         GainTableSpec mSpec;
@@ -21,6 +21,7 @@
 #include <hardware_legacy/AudioMTKHardwareInterface.h>
 #include <hardware/AudioCustomVolume.h>
 #include "AudioVolumeInterface.h"
+#include "AudioParameterDispatcher.h"
 
 #ifdef MTK_BASIC_PACKAGE
 #include "AudioTypeExt.h"
@@ -218,8 +219,46 @@ class AudioALSAHardware : public android_audio_legacy::AudioMTKHardwareInterface
         AUDIO_CUSTOM_VOLUME_STRUCT VolCache;
         volatile int32_t mNextUniqueId;
         bool             mUseAudioPatchForFm;
+#ifdef AUDIO_POLICY_TEST
+        AudioParameter   mPolicyTestParam; // last test_cmd_policy* pairs, returned by getParameters()
+#endif
         SortedVector <AudioHalPatch *> mAudioHalPatchVector;
         float MappingFMVolofOutputDev(int Gain, audio_devices_t eOutput);
+
+        /**
+         * setParameters() handlers, see initParamDispatcher() for the keys
+         */
+        AudioParameterDispatcher<AudioALSAHardware> mParamDispatcher;
+        void     initParamDispatcher();
+        status_t setParamConsumed(AudioParameter &param, const String8 &key);
+        status_t setParamMasterVolume(AudioParameter &param, const String8 &key);
+        status_t setParamVTSpeechCall(AudioParameter &param, const String8 &key);
+        status_t setParamMute(AudioParameter &param, const String8 &key);
+        status_t setParamFlightMode(AudioParameter &param, const String8 &key);
+#ifdef  MTK_TTY_SUPPORT
+        status_t setParamTtyMode(AudioParameter &param, const String8 &key);
+#endif
+#if defined(MTK_HAC_SUPPORT)
+        status_t setParamHACEnable(AudioParameter &param, const String8 &key);
+#endif
+        status_t setParamFm(AudioParameter &param, const String8 &key);
+#ifdef BTNREC_DECIDED_BY_DEVICE
+        status_t setParamBtHeadsetNrec(AudioParameter &param, const String8 &key);
+#endif
+        status_t setParamBtMode(AudioParameter &param, const String8 &key);
+#ifdef MTK_AUDIO_GAIN_TABLE
+        status_t setParamBtSupportVolume(AudioParameter &param, const String8 &key);
+#endif
+#if defined(MTK_AUDIO_HIERARCHICAL_PARAM_SUPPORT)||defined(MTK_AUDIO_GAIN_TABLE)
+        status_t setParamVolumeIndex(AudioParameter &param, const String8 &key);
+#endif
+        status_t setParamScreenState(AudioParameter &param, const String8 &key);
+        status_t setParamMusicPlus(AudioParameter &param, const String8 &key);
+        status_t setParamLRChannelSwitch(AudioParameter &param, const String8 &key);
+        status_t setParamNumHeadsetPole(AudioParameter &param, const String8 &key);
+#ifdef AUDIO_POLICY_TEST
+        status_t setParamPolicyTestCommand(AudioParameter &param, const String8 &key);
+#endif
         //KeyedVector<audio_patch_handle_t, AudioHalPatch *> mAudioHalPatchVector;
 
 };
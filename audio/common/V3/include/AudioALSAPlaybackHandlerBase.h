@@ -24,6 +24,8 @@ class AudioMTKFilterManager;
 class MtkAudioSrc;
 class MtkAudioBitConverter;
 
+class AudioALSAPlaybackTap;
+
 class AudioALSAPlaybackHandlerBase
 {
     public:
@@ -49,6 +51,11 @@ class AudioALSAPlaybackHandlerBase
         virtual status_t routing(const audio_devices_t output_devices) = 0;
         virtual status_t setVolume(uint32_t vol) = 0;
 
+        /**
+         * whether routing() can switch to output_devices while pcm is kept open
+         */
+        virtual bool canHotRouting(const audio_devices_t output_devices) { return false; }
+
 
         /**
          * write data to audio hardware
@@ -141,11 +148,33 @@ class AudioALSAPlaybackHandlerBase
         status_t         dodataPending(void *pInBuffer, uint32_t inBytes, void **ppOutBuffer, uint32_t *pOutBytes);
 
 
+        /**
+         * Playback stage graph: the active stages and their output buffers are planned
+         * once at open(), so write() walks them without per-stage buffers or copies
+         */
+        status_t         planPlaybackStages();
+        status_t         clearPlaybackStages();
+        status_t         doPlaybackStages(void *pInBuffer, uint32_t inBytes, void **ppOutBuffer, uint32_t *pOutBytes);
+        status_t         getPlaybackStageOutput(const playback_stage_t stage, void **ppOutBuffer, uint32_t *pOutBytes) const;
+
+
+        /**
+         * Post-mix playback tap: publish the data written to pcm (in mStreamAttributeTarget format)
+         * for voice unlock and other readers, see AudioALSAPlaybackTap
+         */
+        status_t         attachPlaybackTap();
+        status_t         detachPlaybackTap();
+        void             publishPlaybackTap(const void *buffer, const uint32_t bytes);
+        bool             ownPlaybackTap() const;
+
+
 
         playback_handler_t mPlaybackHandlerType;
 
         AudioALSAHardwareResourceManager *mHardwareResourceManager;
 
+        AudioALSAPlaybackTap *mPlaybackTap;
+
         const stream_attribute_t *mStreamAttributeSource; // from stream out
         stream_attribute_t        mStreamAttributeTarget; // to audio hw
 
@@ -188,6 +217,24 @@ class AudioALSAPlaybackHandlerBase
         uint32_t             mdataPendingRemindBufferSize;
         static const uint32_t dataAlignedSize = 64;
 
+        /**
+         * Playback stage graph
+         */
+        struct playback_stage_info_t
+        {
+            playback_stage_t stage;
+            bool             in_place;      // stage rewrites its input buffer
+            void            *output_buffer; // result of the last write()
+            uint32_t         output_bytes;
+        };
+
+        bool                  mPlaybackStageEnable;  // set by handlers using doPlaybackStages()
+        playback_stage_info_t mPlaybackStages[PLAYBACK_STAGE_MAX];
+        uint32_t              mNumPlaybackStages;
+        char                 *mPlaybackStageBuffer[2]; // ping-pong buffers shared by out-of-place stages
+        uint32_t              mPlaybackStageBufferSize;
+        status_t              dodataPendingInPlace(void *pInBuffer, uint32_t inBytes, void **ppOutBuffer, uint32_t *pOutBytes);
+
         /**
          * for debug PCM dump
          */
@@ -34,6 +34,26 @@ class AudioALSAPlaybackHandlerHDMI : public AudioALSAPlaybackHandlerBase
          */
         virtual ssize_t  write(const void *buffer, size_t bytes);
 
+    private:
+        /**
+         * channel layout conversion toward the HDMI / MHL sink
+         */
+        enum hdmi_expand_t
+        {
+            HDMI_EXPAND_NONE = 0,       // sink takes the stream layout as is
+            HDMI_EXPAND_6CH_TO_8CH,     // 5.1 padded with 2 silent channels
+            HDMI_EXPAND_2CH_TO_8CH      // stereo repeated on the 4 pairs, __2CH_TO_8CH test only
+        };
+
+        void     initExpand();
+        void     deinitExpand();
+        int      writeExpand(const void *buffer, const uint32_t bytes);
+
+        hdmi_expand_t mExpandMode;
+        char         *mExpandBuffer;     // one pcm period of sink frames, allocated in open()
+        uint32_t      mExpandFrames;     // frames the buffer holds
+        uint32_t      mExpandSampleSize; // bytes per sample, 2 or 4
+        uint32_t      mExpandInChannels;
 };
 
 } // end namespace android
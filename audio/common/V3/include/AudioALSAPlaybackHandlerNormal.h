@@ -24,6 +24,7 @@ class AudioALSAPlaybackHandlerNormal : public AudioALSAPlaybackHandlerBase
         virtual int drain(audio_drain_type_t type);
 
         virtual status_t routing(const audio_devices_t output_devices);
+        virtual bool canHotRouting(const audio_devices_t output_devices);
 		virtual status_t setVolume(uint32_t vol);
 
 
@@ -54,6 +55,18 @@ class AudioALSAPlaybackHandlerNormal : public AudioALSAPlaybackHandlerBase
         struct pcm *mHpImpeDancePcm;
         double latencyTime[3];
 
+        /**
+         * hot routing: fade out on the old path, let it play out, switch, fade in on the new path
+         */
+        void switchRoutingOnWrite(void **ppBuffer, uint32_t *pBytes);
+        void drainRoutingToFrames(const uint32_t keep_frames);
+        void applyRoutingRamp(void *buffer, const uint32_t frames, const uint32_t ramp_frames, const bool fade_in);
+        uint32_t mRoutingRampFrames;      // fade in length, 0 when no fade in runs
+        uint32_t mRoutingRampFrameCount;
+        audio_devices_t mRoutingPendingDevices;
+        char *mRoutingSilence;
+        uint32_t mRoutingSilenceBytes;
+
 //#ifdef MTK_AUDIO_SW_DRE
         bool mForceMute;
         int mCurMuteBytes;
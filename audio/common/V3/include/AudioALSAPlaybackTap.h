@@ -0,0 +1,124 @@
+#ifndef ANDROID_AUDIO_ALSA_PLAYBACK_TAP_H
+#define ANDROID_AUDIO_ALSA_PLAYBACK_TAP_H
+
+#include <stdint.h>
+#include <cutils/atomic.h>
+
+#include "AudioType.h"
+#include "AudioLock.h"
+
+namespace android
+{
+
+/**
+ * Post-mix playback tap: one playback handler publishes what it wrote to the pcm,
+ * any number of readers (voice unlock, echo ref, meters) pull it at their own pace.
+ *
+ * The writer does one memcpy per period into a shared ring and never blocks;
+ * each reader keeps its own cursor and converts to its own format while reading.
+ * A reader that falls more than a ring behind is moved to the write position.
+ */
+class AudioALSAPlaybackTap
+{
+    public:
+        virtual ~AudioALSAPlaybackTap();
+
+        static AudioALSAPlaybackTap *getInstance();
+
+
+        /**
+         * writer side, called by playback handlers
+         * the attached handler with the highest priority publishes, the first one on a tie;
+         * when it detaches the next one takes over
+         */
+        bool     attachWriter(const void *writer, const stream_attribute_t *attribute, const int priority);
+        void     detachWriter(const void *writer);
+        void     publish(const void *writer, const void *buffer, const uint32_t bytes);
+
+        inline bool hasReader() const { return android_atomic_acquire_load(&mNumReaders) > 0; }
+        inline bool isWriter(const void *writer) const { return writer == mWriter; }
+
+
+        /**
+         * reader side
+         * addReader() returns a reader id >= 0, format is AUDIO_FORMAT_PCM_16_BIT or
+         * AUDIO_FORMAT_DEFAULT to get the data as published
+         */
+        int      addReader(const audio_format_t format);
+        void     removeReader(const int reader);
+
+        /**
+         * read at most bytes (in reader format), returns bytes read, 0 if no new data
+         */
+        uint32_t read(const int reader, void *buffer, const uint32_t bytes);
+
+        /**
+         * attribute of the data published, sample_rate == 0 if no writer attached yet;
+         * the generation changes with it, read the generation first
+         */
+        void     getSourceAttribute(uint32_t *sample_rate, uint32_t *num_channels, audio_format_t *format);
+        inline int32_t getGeneration() const { return android_atomic_acquire_load(&mGeneration); }
+
+
+    protected:
+        AudioALSAPlaybackTap();
+
+    private:
+        /**
+         * singleton pattern
+         */
+        static AudioALSAPlaybackTap *mAudioALSAPlaybackTap;
+
+        static const uint32_t kTapRingSize = 65536; // power of 2, ~170ms of 48k 2ch 32bit
+        static const int      kTapMaxReaders = 4;
+
+        static const int      kTapMaxWriters = 4;
+
+        struct tap_writer_t
+        {
+            const void    *writer;     // NULL for a free slot
+            int            priority;
+            uint32_t       sample_rate;
+            uint32_t       num_channels;
+            audio_format_t format;
+        };
+
+        struct tap_reader_t
+        {
+            bool           used;
+            audio_format_t format;
+            uint32_t       cursor;     // in source bytes, same counter as mWritePos
+            int32_t        generation; // source attribute the cursor refers to
+            uint32_t       overrun_count;
+        };
+
+        void     selectWriter_l();
+
+        uint32_t copyOut(const uint32_t position, char *buffer, const uint32_t source_bytes,
+                         const audio_format_t source_format, const audio_format_t reader_format) const;
+
+        AudioLock      mLock; // attach/detach and reader slots, never taken by publish()/read()
+
+        tap_writer_t   mWriters[kTapMaxWriters];
+        const void *volatile mWriter;   // the one publishing
+        volatile int32_t mPublishing;   // set while publish() copies, the owner only changes when clear
+        volatile int32_t mGeneration;
+        uint32_t       mSampleRate;
+        uint32_t       mNumChannels;
+        audio_format_t mFormat;
+        uint32_t       mFrameSize;
+
+        // byte counters, wrap at 2^32: mWriteReserve is advanced before the copy and
+        // mWritePos after it, so a reader knows which range may be under rewrite
+        volatile int32_t mWriteReserve;
+        volatile int32_t mWritePos;
+
+        volatile int32_t mNumReaders;
+        tap_reader_t   mReaders[kTapMaxReaders];
+
+        char           mRing[kTapRingSize];
+};
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_ALSA_PLAYBACK_TAP_H
@@ -200,6 +200,24 @@ class AudioALSAStreamOut : public android_audio_legacy::AudioMTKStreamOutInterfa
         audio_devices_t     mRoutingDevice;
 
         void setBufferSize();
+
+        /**
+         * presentation position published by write() after each period and read
+         * by getPresentationPosition() / getRenderPosition() without mLock (seqlock)
+         */
+        struct presentation_position_t
+        {
+            uint64_t        presented_frames; // frames accepted by write()
+            uint64_t        queued_frames;    // frames still in kernel buffer at timestamp
+            struct timespec timestamp;
+            bool            valid;            // timestamp comes from pcm htimestamp
+            bool            offload;          // position comes from compress driver, query it under mLock
+        };
+        volatile int32_t        mPositionSeq; // odd while mPosition is being updated
+        presentation_position_t mPosition;
+
+        void updatePresentationPosition(const bool query_hardware); // call only when mLock is locked
+        void readPresentationPosition(presentation_position_t *position) const;
 };
 
 } // end namespace android
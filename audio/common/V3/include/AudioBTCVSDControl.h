@@ -219,6 +219,12 @@ class AudioBTCVSDControl
         void btsco_cvsd_RX_main(void);
         void btsco_process_RX_CVSD(void *inbuf, uint32_t *insize, void *outbuf, uint32_t *outsize, void *workbuf, const uint32_t workbufsize, uint8_t packetvalid);
         void btsco_process_TX_CVSD(void *inbuf, uint32_t *insize, void *outbuf, uint32_t *outsize, void *workbuf, const uint32_t workbufsize, uint32_t src_fs_s);
+
+        /**
+         * batched codec path, all SCO packets of one kernel read / write per call
+         */
+        uint32_t BT_SCO_RX_ProcessPackets(const uint8_t *rawbuf, uint32_t rawsize, uint8_t *outbuf, uint32_t outsize);
+        uint32_t BT_SCO_TX_ProcessPackets(void *inbuf, uint32_t *insize, uint8_t *outbuf, uint32_t outsize, uint32_t src_fs_s);
         void BT_SCO_TX_Open(void);
         int BT_SCO_TX_SetHandle(void(*pCallback)(void *pData), void *pData, uint32_t uSampleRate, uint32_t uChannelNumber, uint32_t uEnableFilter);
         void BT_SCO_TX_Start(void);
@@ -292,6 +298,7 @@ class AudioBTCVSDControl
         FILE *mBTCVSDRXDumpFile;
 
         uint32_t Audio_IIRHPF_GetBufferSize(int a);
+        void btsco_decode_RX_CVSD(void *inbuf, uint32_t *insize, void *outbuf, uint32_t *outsize, void *workbuf, const uint32_t workbufsize, uint8_t packetvalid);
         void *Audio_IIRHPF_Init(int8_t *pBuf, const int32_t *btsco_FilterCoeff_8K, int a);
         void Audio_IIRHPF_Process(void *handle, uint16_t *inbuf, uint16_t *InSample, uint16_t *outbuf, uint16_t *OutSample);
         BT_SCO_MODE BTmode;
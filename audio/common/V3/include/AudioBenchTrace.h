@@ -0,0 +1,56 @@
+#ifndef ANDROID_AUDIO_BENCH_TRACE_H
+#define ANDROID_AUDIO_BENCH_TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Stage timing hooks of the data paths, for audio_hal_bench only.
+ *
+ * The bench builds the HAL sources with MTK_AUDIO_HAL_BENCH and provides
+ * AudioBenchTrace_record(); in audio.primary the macros are empty.
+ */
+namespace android
+{
+
+enum audio_bench_stage_t
+{
+    AUDIO_BENCH_PLAYBACK_STEREO_TO_MONO = 0, // playback_stage_t order up to DATA_PENDING
+    AUDIO_BENCH_PLAYBACK_POST_PROCESSING,
+    AUDIO_BENCH_PLAYBACK_BLI_SRC,
+    AUDIO_BENCH_PLAYBACK_BIT_CONVERSION,
+    AUDIO_BENCH_PLAYBACK_DATA_PENDING,
+    AUDIO_BENCH_PLAYBACK_PCM_WRITE,
+    AUDIO_BENCH_CAPTURE_PCM_READ,
+    AUDIO_BENCH_CAPTURE_24_TO_16,
+    AUDIO_BENCH_CAPTURE_PUBLISH,
+    AUDIO_BENCH_CLIENT_SRC,         // BesRecord or SRC into mSrcDataBuf
+    AUDIO_BENCH_CLIENT_EFFECT,      // channel remix / native effect into mProcessedDataBuf
+    AUDIO_BENCH_STAGE_NUM
+};
+
+#ifdef MTK_AUDIO_HAL_BENCH
+
+// provided by the bench, called from the data path threads
+void AudioBenchTrace_record(const audio_bench_stage_t stage, const uint64_t ns);
+
+static inline uint64_t AudioBenchTrace_getNowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define AUDIO_BENCH_BEGIN(start) const uint64_t start = AudioBenchTrace_getNowNs()
+#define AUDIO_BENCH_END(stage, start) AudioBenchTrace_record(stage, AudioBenchTrace_getNowNs() - (start))
+
+#else
+
+#define AUDIO_BENCH_BEGIN(start)
+#define AUDIO_BENCH_END(stage, start)
+
+#endif
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_BENCH_TRACE_H
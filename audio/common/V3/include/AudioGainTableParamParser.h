@@ -14,6 +14,7 @@
 //}
 
 #include "AudioGainTableParam.h"
+#include "AudioParamSnapshot.h"
 
 namespace android
 {
@@ -37,6 +38,12 @@ class GainTableParamParser
         status_t updateRecordVol(GainTableParam *_gainTable);
         status_t updateVoIPVol(GainTableParam *_gainTable);
 
+        /*
+         * drop the snapshot once the xml is tuned at runtime, the next
+         * getGainTableParam() walks the xml again
+         */
+        void invalidateSnapshot();
+
         /*
          * Utility functions
          */
@@ -54,6 +61,12 @@ class GainTableParamParser
         status_t getParamVector(ParamUnit *_paramUnit, std::vector<T> *_param, char *_paramName);
         status_t getParamVector(ParamUnit *_paramUnit, std::vector<std::string> *_param, char *_paramName);
 
+        /*
+         * resolved gain table / spec / DL map, keyed by the xml content hash
+         */
+        bool loadSnapshot();
+        void saveSnapshot(const GainTableParam *_gainTable);
+
         static GainTableParamParser *mGainTableParamParser;
         AppHandle *mAppHandle;
 
@@ -63,6 +76,11 @@ class GainTableParamParser
         std::vector<short> mMapDlDigital[NUM_GAIN_DEVICE];
         std::vector<short> mMapDlAnalog[NUM_GAIN_DEVICE];
         GAIN_ANA_TYPE      mMapDlAnalogType[NUM_GAIN_DEVICE];
+
+        AudioParamSnapshot mSnapshot;
+        uint64_t           mSnapshotSourceHash; // 0 if snapshot disabled
+        bool               mSnapshotValid;
+        GainTableParam     mSnapshotTable;
 };   //GainTableParamParser
 
 }
@@ -0,0 +1,141 @@
+#ifndef ANDROID_AUDIO_PARAM_SNAPSHOT_H
+#define ANDROID_AUDIO_PARAM_SNAPSHOT_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include <utils/Errors.h>
+
+namespace android
+{
+
+/**
+ * Binary snapshot of parameters resolved from the audio xml, so startup can map
+ * the result instead of walking the AudioType / ParamUnit tree again.
+ *
+ * A snapshot is valid only for the xml it was built from: the header keeps a
+ * content hash of the xml folder, the layout version of the owner and a payload
+ * checksum, and map() rejects any mismatch.
+ */
+#define AUDIO_PARAM_XML_FOLDER        "/system/etc/audio_param/"
+#define AUDIO_PARAM_SNAPSHOT_FOLDER   "/data/misc/audio/"
+
+struct audio_param_snapshot_header_t
+{
+    uint32_t magic;
+    uint32_t version;          // payload layout version of the owner
+    uint64_t source_hash;      // AudioParamSnapshot::hashXmlFolder() of the system and custom xml
+    uint32_t payload_size;
+    uint32_t payload_checksum;
+};
+
+
+class AudioParamSnapshot
+{
+    public:
+        AudioParamSnapshot(const char *name, const uint32_t version);
+        virtual ~AudioParamSnapshot();
+
+        /**
+         * FNV-1a over the names and contents of the *.xml in folder, in name order,
+         * continued from seed so the custom xml folder can be chained after the system one.
+         * A chained folder that does not exist adds nothing. 0 if the folder can not be read
+         */
+        static uint64_t hashXmlFolder(const char *folder, const uint64_t seed = 0);
+
+        /**
+         * map and validate the snapshot file, payload() is valid until unmap()
+         */
+        status_t    map(const uint64_t source_hash);
+        void        unmap();
+        const void *payload() const { return mPayload; }
+        uint32_t    payloadSize() const { return mPayloadSize; }
+
+        /**
+         * write through a temp file and rename, so a reader never maps a partial file
+         */
+        status_t    write(const uint64_t source_hash, const void *payload, const uint32_t size);
+        void        remove();
+
+        const char *getPath() const { return mPath.c_str(); }
+
+        /**
+         * check header and checksum of a mapped file, source_hash 0 skips the hash check
+         */
+        static status_t verify(const void *data, const size_t size, const uint32_t version,
+                               const uint64_t source_hash, audio_param_snapshot_header_t *header);
+
+    private:
+        std::string mPath;
+        uint32_t    mVersion;
+
+        void       *mMapAddr;
+        size_t      mMapSize;
+        const void *mPayload;
+        uint32_t    mPayloadSize;
+};
+
+
+/**
+ * append-only encoder / bounds checked decoder for snapshot payloads
+ */
+class AudioParamBlobWriter
+{
+    public:
+        void putBytes(const void *data, const size_t size);
+        template<class T> void put(const T &value) { putBytes(&value, sizeof(T)); }
+        template<class T> void putVector(const std::vector<T> &vector)
+        {
+            put<uint32_t>(vector.size());
+            if (vector.size() > 0)
+            {
+                putBytes(&vector[0], vector.size() * sizeof(T));
+            }
+        }
+        void putString(const std::string &string);
+        void putStringVector(const std::vector<std::string> &vector);
+
+        const void *data() const { return mData.size() > 0 ? &mData[0] : NULL; }
+        uint32_t    size() const { return mData.size(); }
+
+    private:
+        std::vector<char> mData;
+};
+
+class AudioParamBlobReader
+{
+    public:
+        AudioParamBlobReader(const void *data, const uint32_t size) :
+            mData((const char *)data), mSize(size), mPos(0), mError(false) {}
+
+        bool getBytes(void *data, const size_t size);
+        template<class T> bool get(T *value) { return getBytes(value, sizeof(T)); }
+        template<class T> bool getVector(std::vector<T> *vector)
+        {
+            uint32_t count = 0;
+            if (get(&count) == false || count > (mSize - mPos) / sizeof(T))
+            {
+                mError = true;
+                return false;
+            }
+            vector->resize(count);
+            return (count == 0) ? true : getBytes(&(*vector)[0], count * sizeof(T));
+        }
+        bool getString(std::string *string);
+        bool getStringVector(std::vector<std::string> *vector);
+
+        bool ok() const { return mError == false && mPos == mSize; }
+
+    private:
+        const char *mData;
+        uint32_t    mSize;
+        uint32_t    mPos;
+        bool        mError;
+};
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_PARAM_SNAPSHOT_H
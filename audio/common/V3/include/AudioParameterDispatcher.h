@@ -0,0 +1,202 @@
+#ifndef ANDROID_AUDIO_PARAMETER_DISPATCHER_H
+#define ANDROID_AUDIO_PARAMETER_DISPATCHER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/atomic.h>
+#include <utils/Errors.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+#include <media/AudioParameter.h>
+
+#include "AudioAssert.h"
+
+namespace android
+{
+
+/**
+ * setParameters() key table: the handler of each key is found by hash, so a
+ * call costs one parse of the key value pairs plus one lookup per key present,
+ * instead of one getInt()/get() per key the owner knows.
+ *
+ * Handlers are owner member functions, they get the parsed AudioParameter and
+ * the key, read the value the way the old if-ladder did, and must not remove
+ * the key themselves. Each key keeps a call count and a log2 (us) latency
+ * histogram for dump().
+ */
+template<class T>
+class AudioParameterDispatcher
+{
+    public:
+        typedef status_t (T::*handler_t)(AudioParameter &param, const String8 &key);
+
+        AudioParameterDispatcher(const char *name) : mName(name), mNumEntries(0)
+        {
+            memset(mTable, 0, sizeof(mTable));
+        }
+
+        void add(const char *key, handler_t handler)
+        {
+            ASSERT(mNumEntries < kTableSize / 2);
+
+            const uint32_t hash = hashKey(key, strlen(key));
+            uint32_t slot = hash & (kTableSize - 1);
+            while (mTable[slot].key != NULL)
+            {
+                ASSERT(strcmp(mTable[slot].key, key) != 0);
+                slot = (slot + 1) & (kTableSize - 1);
+            }
+            mTable[slot].key = key;
+            mTable[slot].hash = hash;
+            mTable[slot].handler = handler;
+            mNumEntries++;
+        }
+
+        /**
+         * run the handler of every registered key present in param and remove
+         * those keys, keys without a handler are left in param for the caller
+         */
+        status_t dispatch(T *owner, AudioParameter &param)
+        {
+            const size_t numKeys = param.size();
+            if (numKeys == 0)
+            {
+                return NO_ERROR;
+            }
+
+            // handlers may read other keys, so collect first and remove afterwards
+            entry_t *entries[kMaxKeysPerCall];
+            String8 keys[kMaxKeysPerCall];
+            size_t numHandled = 0;
+            for (size_t i = 0; i < numKeys && numHandled < kMaxKeysPerCall; i++)
+            {
+                if (param.getAt(i, keys[numHandled]) != NO_ERROR)
+                {
+                    continue;
+                }
+                entry_t *entry = find(keys[numHandled]);
+                if (entry != NULL)
+                {
+                    entries[numHandled++] = entry;
+                }
+            }
+
+            status_t status = NO_ERROR;
+            for (size_t i = 0; i < numHandled; i++)
+            {
+                const nsecs_t startTime = systemTime();
+                status_t handlerStatus = (owner->*(entries[i]->handler))(param, keys[i]);
+                recordLatency(entries[i], systemTime() - startTime);
+
+                if (handlerStatus != NO_ERROR)
+                {
+                    status = handlerStatus;
+                }
+            }
+            for (size_t i = 0; i < numHandled; i++)
+            {
+                param.remove(keys[i]);
+            }
+            return status;
+        }
+
+        void dump(int fd)
+        {
+            const size_t SIZE = 256;
+            char buffer[SIZE];
+            String8 result;
+
+            snprintf(buffer, SIZE, "\n%s setParameters (calls, max us, count per bucket, bucket i < 2^i us):\n", mName);
+            result.append(buffer);
+            for (uint32_t slot = 0; slot < kTableSize; slot++)
+            {
+                const entry_t *entry = &mTable[slot];
+                if (entry->key == NULL || android_atomic_acquire_load(&entry->count) == 0)
+                {
+                    continue;
+                }
+                snprintf(buffer, SIZE, " %-32s %d %d", entry->key,
+                         android_atomic_acquire_load(&entry->count), android_atomic_acquire_load(&entry->maxUs));
+                result.append(buffer);
+                for (int bucket = 0; bucket < kLatencyBucketNum; bucket++)
+                {
+                    snprintf(buffer, SIZE, " %d", android_atomic_acquire_load(&entry->latency[bucket]));
+                    result.append(buffer);
+                }
+                result.append("\n");
+            }
+            write(fd, result.string(), result.size());
+        }
+
+    private:
+        static const uint32_t kTableSize = 128; // power of 2, at most half used
+        static const size_t   kMaxKeysPerCall = 16;
+        static const int      kLatencyBucketNum = 12;
+
+        struct entry_t
+        {
+            const char      *key;
+            uint32_t         hash;
+            handler_t        handler;
+            volatile int32_t count;
+            volatile int32_t maxUs;
+            volatile int32_t latency[kLatencyBucketNum];
+        };
+
+        static inline uint32_t hashKey(const char *key, const size_t length)
+        {
+            uint32_t hash = 0x811c9dc5; // FNV-1a
+            for (size_t i = 0; i < length; i++)
+            {
+                hash = (hash ^ (unsigned char)key[i]) * 0x01000193;
+            }
+            return hash;
+        }
+
+        entry_t *find(const String8 &key)
+        {
+            const uint32_t hash = hashKey(key.string(), key.length());
+            uint32_t slot = hash & (kTableSize - 1);
+            while (mTable[slot].key != NULL)
+            {
+                if (mTable[slot].hash == hash && strcmp(mTable[slot].key, key.string()) == 0)
+                {
+                    return &mTable[slot];
+                }
+                slot = (slot + 1) & (kTableSize - 1);
+            }
+            return NULL;
+        }
+
+        void recordLatency(entry_t *entry, const nsecs_t latency)
+        {
+            // bucket i holds latency below (1 << i) us, the last one holds the rest
+            const int32_t latencyUs = (latency > 0) ? (int32_t)ns2us(latency) : 0;
+            uint32_t value = latencyUs;
+            int bucket = 0;
+            while (value != 0 && bucket < kLatencyBucketNum - 1)
+            {
+                value >>= 1;
+                bucket++;
+            }
+            android_atomic_inc(&entry->count);
+            android_atomic_inc(&entry->latency[bucket]);
+
+            int32_t maxUs = android_atomic_acquire_load(&entry->maxUs);
+            while (latencyUs > maxUs && android_atomic_release_cas(maxUs, latencyUs, &entry->maxUs) != 0)
+            {
+                maxUs = android_atomic_acquire_load(&entry->maxUs);
+            }
+        }
+
+        const char *mName;
+        uint32_t    mNumEntries;
+        entry_t     mTable[kTableSize];
+};
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_PARAMETER_DISPATCHER_H
@@ -167,6 +167,60 @@ struct BufferInfo
 };
 
 
+// fixed capacity slab of BufferInfo + pcm payload, sized at SPELayer::Start from the frame rate
+// requests larger than a slot or beyond the slot count fall back to heap
+class SPEBufferPool
+{
+    public:
+        SPEBufferPool();
+        ~SPEBufferPool();
+
+        bool Init(uint32_t slotNum, uint32_t slotBytes);
+        void Deinit();
+        BufferInfo *Alloc(uint32_t bytes);
+        void Free(BufferInfo *pBufInfo);
+        void dump();
+
+    private:
+        bool IsPoolSlot(const BufferInfo *pBufInfo) const;
+
+        Mutex mPoolLock;
+        BufferInfo *mpSlotInfo;
+        char *mpSlotPcm;
+        uint16_t *mpFreeSlot;   // stack of free slot index
+        uint32_t mSlotNum;
+        uint32_t mSlotBytes;
+        uint32_t mFreeSlotNum;
+        uint32_t mHeapAllocCount;
+};
+
+// ring of BufferInfo pointers with the Vector calls SPELayer uses, O(1) at both ends
+class SPEBufferQueue
+{
+    public:
+        SPEBufferQueue();
+        ~SPEBufferQueue();
+
+        void setCapacity(size_t capacity);
+        size_t size() const { return mCount; }
+        bool isEmpty() const { return mCount == 0; }
+        BufferInfo *operator[](size_t index) const { return mpRing[(mHead + index) & mMask]; }
+        void add(BufferInfo *pBufInfo);
+        void push_front(BufferInfo *pBufInfo);
+        void removeAt(size_t index);
+        void clear();
+
+    private:
+        SPEBufferQueue(const SPEBufferQueue &);
+        SPEBufferQueue &operator=(const SPEBufferQueue &);
+        void Grow(size_t capacity);
+
+        BufferInfo **mpRing;
+        size_t mMask;
+        size_t mHead;
+        size_t mCount;
+};
+
 struct InBufferInfo
 {
     short *pBufBase;
@@ -258,7 +312,10 @@ class SPELayer
         void EnableNormalModeVoIP(bool bSet);
         void SetEchoRefStartTime(struct timespec EchoRefStartTime);
 
-        Vector<BufferInfo *> mDumpDLInBufferQ, mDumpDLOutBufferQ, mDumpULOutBufferQ, mDumpULInBufferQ, mDumpEPLBufferQ;
+        BufferInfo *AllocBufferInfo(uint32_t bytes);
+        void FreeBufferInfo(BufferInfo *pBufInfo);
+
+        SPEBufferQueue mDumpDLInBufferQ, mDumpDLOutBufferQ, mDumpULOutBufferQ, mDumpULInBufferQ, mDumpEPLBufferQ;
 #if defined(PC_EMULATION)
         HANDLE hDumpThread;
 #else
@@ -381,8 +438,9 @@ class SPELayer
 
         int mULInBufQLenTotal, mDLInBufQLenTotal, mULOutBufQLenTotal, mDLOutBufQLenTotal, mDLDelayBufQLenTotal;
 
-        Vector<BufferInfo *> mDLInBufferQ, mDLOutBufferQ, mULOutBufferQ, mULInBufferQ, mDLDelayBufferQ;
+        SPEBufferQueue mDLInBufferQ, mDLOutBufferQ, mULOutBufferQ, mULInBufferQ, mDLDelayBufferQ;
         //Vector<BufferInfo>  mULInBufferQ;
+        SPEBufferPool mBufferPool;
 
         Mutex mLock, mDumpLock, mBufMutexWantLock;
         bool mError;
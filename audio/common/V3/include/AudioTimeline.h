@@ -0,0 +1,91 @@
+#ifndef ANDROID_AUDIO_TIMELINE_H
+#define ANDROID_AUDIO_TIMELINE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "AudioType.h"
+#include "AudioLock.h"
+
+namespace android
+{
+
+enum audio_timeline_clock_t
+{
+    AUDIO_TIMELINE_CLOCK_CAPTURE = 0,   // UL mic path
+    AUDIO_TIMELINE_CLOCK_ECHOREF,       // DL echo reference path
+    AUDIO_TIMELINE_CLOCK_NUM
+};
+
+
+class AudioTimeline
+{
+    public:
+        virtual ~AudioTimeline();
+
+        static AudioTimeline *getInstance();
+
+        static inline int64_t timespecToNs(const struct timespec &time)
+        {
+            return (int64_t)time.tv_sec * 1000000000LL + time.tv_nsec;
+        }
+
+        static inline struct timespec nsToTimespec(const int64_t ns)
+        {
+            struct timespec time;
+            time.tv_sec = ns / 1000000000LL;
+            time.tv_nsec = ns % 1000000000LL;
+            return time;
+        }
+
+        /**
+         * feed one hw timestamp of a clock, called after each pcm_read
+         * read_frames: frames of this read, avail_frames: frames still in kernel at timestamp
+         */
+        void updateClock(const audio_timeline_clock_t clock, const struct timespec &timestamp,
+                         const uint32_t read_frames, const uint32_t avail_frames, const uint32_t sample_rate);
+
+        /**
+         * forget the anchor and frame count of a clock when its stream closes, drift is kept
+         */
+        void resetClock(const audio_timeline_clock_t clock);
+
+        /**
+         * frame rate of the clock against the monotonic clock, > 0 when the device runs fast
+         */
+        int32_t getDriftPpm(const audio_timeline_clock_t clock) const;
+
+        /**
+         * convert a duration counted in nominal frames to monotonic ns
+         */
+        int64_t correctDurationNs(const audio_timeline_clock_t clock, const int64_t nominal_ns) const;
+
+
+    protected:
+        AudioTimeline();
+
+    private:
+        /**
+         * singleton pattern
+         */
+        static AudioTimeline *mAudioTimeline;
+
+        struct clock_state_t
+        {
+            bool     anchored;
+            uint32_t sample_rate;
+            int64_t  anchor_ns;
+            uint64_t anchor_position;
+            uint64_t read_position;
+            int64_t  last_ns;
+            volatile int32_t drift_ppm;
+        };
+
+        clock_state_t mClock[AUDIO_TIMELINE_CLOCK_NUM];
+
+        AudioLock mLock;
+};
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_TIMELINE_H
@@ -113,6 +113,19 @@ enum playback_handler_t
     PLAYBACK_HANDLER_FAST,
 };
 
+/**
+ * Playback handler processing stages, in write() order
+ */
+enum playback_stage_t
+{
+    PLAYBACK_STAGE_STEREO_TO_MONO,
+    PLAYBACK_STAGE_POST_PROCESSING,
+    PLAYBACK_STAGE_BLI_SRC,
+    PLAYBACK_STAGE_BIT_CONVERSION,
+    PLAYBACK_STAGE_DATA_PENDING,
+    PLAYBACK_STAGE_MAX
+};
+
 /**
  * Capture handler types
  */
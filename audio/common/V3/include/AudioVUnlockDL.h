@@ -224,6 +224,8 @@ class AudioVUnlockDL
         int32_t GetLatency(void);
         int32_t DumpData(void *buf, uint32_t datasz);
         void SetInputStandBy(bool val);
+        /* reference is read from AudioALSAPlaybackTap, mute it when playback does not reach the mic */
+        void SetReferenceMute(bool mute);
         void GetStreamOutLatency(int32_t latency);
         bool StreamOutStandBy();
         int GetShareMemory(int *fd, int *size, uint *flags);
@@ -247,6 +249,9 @@ class AudioVUnlockDL
 #endif
         AudioVUnlockRingBuf mRingBufIn;  // input ring buffer
         AudioVUnlockRingBuf mRingBufOut;    //output ring buffer
+        int mTapReader; // playback tap reader feeding mRingBufIn, -1 if not subscribed
+        int32_t mTapGeneration; // tap source attribute the SRC input is set for, -1 for none
+        bool mReferenceMute;
         bool mReadThreadExit;
         bool mReadThreadActive;
         bool mReadFunctionActive;
@@ -3,6 +3,8 @@
 
 #include <pthread.h>
 
+#include <utils/Timers.h>
+
 #include "AudioType.h"
 #include "SpeechType.h"
 #include "AudioUtility.h"
@@ -17,6 +19,51 @@ namespace android
 
 class SpeechDriverLAD;
 
+/**
+ * CCCI message lanes, each FIFO.
+ * NORMAL:  on / off / mode / data notify
+ * BULK:    speech enhancement parameter uploads through the A2M share buffer
+ * The normal lane is served first, but only data notify / read ack / request ack
+ * messages may overtake parameter uploads queued before them (see CanOvertakeBulk());
+ * on / mode / routing keep the enqueue order so the modem has its parameters first.
+ * Volume / mute control messages are sent at once when the normal lane is empty,
+ * and queued to the normal lane otherwise (see IsControlMessage()).
+ */
+enum ccci_lane_type_t
+{
+    CCCI_LANE_NORMAL = 0,
+    CCCI_LANE_BULK,
+    NUM_CCCI_LANE
+};
+
+// bulk messages are serialized by A2MBufLock(), so only a few wait at a time
+static const uint32_t kCcciBulkLaneSize = 12;
+static const uint32_t kCcciNormalLaneSize = CCCI_MAX_QUEUE_NUM - kCcciBulkLaneSize;
+
+/** enqueue to ack (or to sent, for no ack message) latency, in ms */
+static const uint32_t kCcciLatencyBinMs[] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+static const uint32_t NUM_CCCI_LATENCY_BIN = sizeof(kCcciLatencyBinMs) / sizeof(kCcciLatencyBinMs[0]) + 1;
+
+typedef struct ccci_lane_element_t
+{
+    ccci_queue_element_t element;
+    nsecs_t              enqueue_time;
+    uint32_t             sequence;     // enqueue order across lanes
+} ccci_lane_element_t;
+
+typedef struct ccci_message_lane_t
+{
+    ccci_lane_element_t *pQueue;
+    uint32_t size;
+    uint32_t read;
+    uint32_t count;
+
+    uint32_t latency_histogram[NUM_CCCI_LATENCY_BIN];
+    nsecs_t  max_latency;
+    uint32_t ack_timeout_count;
+    uint32_t drop_count;
+} ccci_message_lane_t;
+
 class SpeechMessengerECCCI : public SpeechMessengerInterface
 {
     public:
@@ -99,6 +146,16 @@ class SpeechMessengerECCCI : public SpeechMessengerInterface
 
         // for message queue
         virtual uint32_t    GetQueueCount() const;
+        virtual ccci_lane_type_t GetMessageLane(const uint16_t message_id);
+        virtual bool        IsControlMessage(const uint16_t message_id);
+        virtual bool        CanOvertakeBulk(const uint16_t message_id);
+        virtual status_t    EnqueueMessage(ccci_lane_type_t lane, const ccci_buff_t &ccci_buff, ccci_message_ack_t ack_type);
+        virtual status_t    DispatchMessageInQueue();
+        virtual status_t    SendMessageOutOfQueueLock(const ccci_lane_element_t &lane_element);
+        virtual void        DropMessage(ccci_lane_type_t lane, const ccci_buff_t &ccci_buff);
+        virtual void        UpdateMessageLatency(ccci_lane_type_t lane, const ccci_lane_element_t &lane_element);
+        virtual void        CheckAckTimeout();
+        virtual void        DumpMessageLatency();
         virtual status_t    ConsumeMessageInQueue();
         virtual bool        MDReset_CheckMessageInQueue();
         virtual void        MDReset_FlushMessageInQueue();
@@ -135,9 +192,18 @@ class SpeechMessengerECCCI : public SpeechMessengerInterface
         char    *mECCCIShareBuf;
         char    *mM2AShareBufRead;
 
-        ccci_queue_element_t pQueue[CCCI_MAX_QUEUE_NUM];
-        int32_t iQRead;
-        int32_t iQWrite;
+        ccci_lane_element_t mNormalLaneQueue[kCcciNormalLaneSize];
+        ccci_lane_element_t mBulkLaneQueue[kCcciBulkLaneSize];
+        ccci_message_lane_t mLane[NUM_CCCI_LANE];
+
+        // the only need ack message sent to modem and not acked yet
+        bool                mWaitAckPending;
+        ccci_lane_type_t    mWaitAckLane;
+        ccci_lane_element_t mWaitAckElement;
+        nsecs_t             mWaitAckSendTime;
+        bool                mWaitAckTimeoutReported;
+
+        uint32_t            mEnqueueSequence;
 
         uint32_t mSpeechParamAckCount[NUM_SPEECH_PARAM_ACK_TYPE];
 
@@ -148,6 +214,8 @@ class SpeechMessengerECCCI : public SpeechMessengerInterface
 
 
         AudioLock mCCCIMessageQueueMutex;
+        AudioCondition mCCCIMessageQueueSpaceCondition;
+        AudioLock mCCCISendMutex; // keeps the write order of queued messages, taken under mCCCIMessageQueueMutex
         AudioLock mA2MShareBufMutex;
         AudioLock mSetSpeechParamMutex;
 
@@ -873,7 +873,7 @@ void *SpeechMessengerCCCI::CCCIReadThread(void *arg)
 #ifdef SPEECH_PCM_VM_SUPPORT
             case MSG_M2A_PCM_REC_DATA_NOTIFY:   // meaning that we are recording, modem have some data
             {
-                ALOGD("%s() MSG_M2A_PCM_REC_DATA_NOTIFY", __FUNCTION__);
+                ALOGV("%s() MSG_M2A_PCM_REC_DATA_NOTIFY", __FUNCTION__);
                 ASSERT(pCCCI->GetModemSideModemStatus(RECORD_STATUS_MASK) == true);
 
                 if (pCCCI->mLad->GetApSideModemStatus(RECORD_STATUS_MASK) == false)
@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
@@ -57,6 +58,9 @@ static const unsigned int MODEM_STATUS_INIT    = 1; // Boot stage 1 -> Means MD
 static const unsigned int MODEM_STATUS_READY   = 2; // Boot stage 2 -> Means MD is ready
 static const unsigned int MODEM_STATUS_EXPT    = 3; // MD exception -> Means EE occur
 
+/** ReadMessage() wakes up this often to check the outstanding ack */
+static const int kCcciAckCheckIntervalMs = 200;
+
 /** Property keys*/
 static const char PROPERTY_KEY_MODEM_STATUS[NUM_MODEM][PROPERTY_KEY_MAX] = {"af.modem_1.status", "af.modem_2.status", "af.modem_ext.status"};
 static const char PROPERTY_KEY_RF_INFO[2][PROPERTY_KEY_MAX] = {"af.rf_info", "af.rf_mode"};
@@ -93,9 +97,17 @@ SpeechMessengerECCCI::SpeechMessengerECCCI(modem_index_t modem_index, SpeechDriv
     memset(&mM2AShareBuf, 0, sizeof(mM2AShareBuf));
 
     //initial the message queue
-    memset((void *)pQueue, 0, sizeof(pQueue));
-    iQRead = 0;
-    iQWrite = 0;
+    memset((void *)mLane, 0, sizeof(mLane));
+    mLane[CCCI_LANE_NORMAL].pQueue = mNormalLaneQueue;
+    mLane[CCCI_LANE_NORMAL].size   = kCcciNormalLaneSize;
+    mLane[CCCI_LANE_BULK].pQueue   = mBulkLaneQueue;
+    mLane[CCCI_LANE_BULK].size     = kCcciBulkLaneSize;
+
+    mWaitAckPending = false;
+    mWaitAckLane = CCCI_LANE_NORMAL;
+    mWaitAckSendTime = 0;
+    mWaitAckTimeoutReported = false;
+    mEnqueueSequence = 0;
 
     mWaitAckMessageID = 0;
 
@@ -179,6 +191,10 @@ status_t SpeechMessengerECCCI::Deinitial()
     ALOGD("%s()", __FUNCTION__);
     CCCIEnable = false;
 
+    mCCCIMessageQueueMutex.lock();
+    DumpMessageLatency();
+    mCCCIMessageQueueMutex.unlock();
+
     if (fHdl >= 0)
     {
         close(fHdl);
@@ -523,6 +539,23 @@ status_t SpeechMessengerECCCI::ReadMessage(ccci_buff_t &ccci_buff)
         }
     }
 
+    /* wait for a message, an outstanding ack is checked while the modem is quiet */
+    struct pollfd poll_fd;
+    poll_fd.fd = fHdl;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    while (poll(&poll_fd, 1, kCcciAckCheckIntervalMs) == 0)
+    {
+        mCCCIMessageQueueMutex.lock();
+        CheckAckTimeout();
+        mCCCIMessageQueueMutex.unlock();
+
+        if (CCCIEnable == false)
+        {
+            return UNKNOWN_ERROR;
+        }
+    }
+
     /* read message */
     int length_read = read(fHdl, (void *)&ccci_buff, sizeof(ccci_buff_t));
     if (ccci_buff.magic != CCCI_MAILBOX_MAGIC_NUMBER)
@@ -553,8 +586,12 @@ status_t SpeechMessengerECCCI::ReadMessage(ccci_buff_t &ccci_buff)
 
 uint32_t SpeechMessengerECCCI::GetQueueCount() const
 {
-    int32_t count = (iQWrite - iQRead);
-    if (count < 0) { count += CCCI_MAX_QUEUE_NUM; }
+    // the message waiting for ack is counted as well
+    uint32_t count = (mWaitAckPending == true) ? 1 : 0;
+    for (int lane = 0; lane < NUM_CCCI_LANE; lane++)
+    {
+        count += mLane[lane].count;
+    }
     return count;
 }
 
@@ -655,114 +692,321 @@ bool SpeechMessengerECCCI::IsModemFunctionOnOffMessage(const uint16_t message_id
     return bIsModemFunctionOnOffMessage;
 }
 
-status_t SpeechMessengerECCCI::SendMessageInQueue(ccci_buff_t ccci_buff)
+bool SpeechMessengerECCCI::IsControlMessage(const uint16_t message_id)
 {
-    mCCCIMessageQueueMutex.lock();
-
-    uint32_t count = GetQueueCount();
-    ASSERT(count < (CCCI_MAX_QUEUE_NUM - 1));  // check queue full
+    switch (message_id)
+    {
+        case MSG_A2M_SPH_DL_DIGIT_VOLUME:
+        case MSG_A2M_SPH_UL_DIGIT_VOLUME:
+        case MSG_A2M_MUTE_SPH_UL:
+        case MSG_A2M_MUTE_SPH_DL:
+        case MSG_A2M_SIDETONE_VOLUME:
+        case MSG_A2M_SPH_DL_ENH_REF_DIGIT_VOLUME:
+        case MSG_A2M_MUTE_SPH_UL_ENH_RESULT:
+        case MSG_A2M_MUTE_SPH_UL_SOURCE:
+            return true;
+        default:
+            return false;
+    }
+}
 
-    ccci_message_ack_t ack_type = JudgeAckOfMsg(GetMessageID(ccci_buff));
+bool SpeechMessengerECCCI::CanOvertakeBulk(const uint16_t message_id)
+{
+    // flow control of running data paths, none of them reads the uploaded parameters
+    switch (message_id)
+    {
+        case MSG_A2M_PNW_DL_DATA_NOTIFY:
+        case MSG_A2M_BGSND_DATA_NOTIFY:
+        case MSG_A2M_CTM_DATA_NOTIFY:
+        case MSG_A2M_PNW_UL_DATA_READ_ACK:
+        case MSG_A2M_REC_DATA_READ_ACK:
+        case MSG_A2M_CTM_DEBUG_DATA_READ_ACK:
+        case MSG_A2M_PCM_REC_DATA_READ_ACK:
+        case MSG_A2M_VM_REC_DATA_READ_ACK:
+        case MSG_A2M_DACA_DL_DATA_READ_ACK:
+        case MSG_A2M_RAW_PCM_REC_DATA_READ_ACK:
+        case MSG_A2M_EM_DATA_REQUEST_ACK:
+        case MSG_A2M_NETWORK_STATUS_ACK:
+        case MSG_A2M_EPOF_ACK:
+            return true;
+        default:
+            return false;
+    }
+}
 
-    if (ack_type == MESSAGE_NEED_ACK)
+ccci_lane_type_t SpeechMessengerECCCI::GetMessageLane(const uint16_t message_id)
+{
+    switch (message_id)
     {
-        ALOGD("%s(), mModemIndex = %d, need ack message: 0x%x, reserved param: 0x%x",
-              __FUNCTION__, mModemIndex, ccci_buff.message, ccci_buff.reserved);
+        case MSG_A2M_EM_NB:
+        case MSG_A2M_EM_WB:
+        case MSG_A2M_EM_DMNR:
+        case MSG_A2M_EM_MAGICON:
+        case MSG_A2M_EM_HAC:
+        case MSG_A2M_VIBSPK_PARAMETER:
+        case MSG_A2M_NXP_SMARTPA_PARAMETER:
+        case MSG_A2M_EM_DYNAMIC_SPH:
+            return CCCI_LANE_BULK;
+        default:
+            return CCCI_LANE_NORMAL;
     }
+}
 
+status_t SpeechMessengerECCCI::EnqueueMessage(ccci_lane_type_t lane, const ccci_buff_t &ccci_buff, ccci_message_ack_t ack_type)
+{
+    const uint32_t kLaneFullWaitMs = 500;
+    ccci_message_lane_t *pLane = &mLane[lane];
 
-    status_t ret = NO_ERROR;
-    if (count == 0) // queue is empty
+    // lane full: hold the caller until the modem acks something instead of asserting
+    if (pLane->count == pLane->size)
     {
-        if (ack_type == MESSAGE_BYPASS_ACK) // no need ack, send directly, don't care ret value
-        {
-            ret = SendMessage(ccci_buff);
-        }
-        else // need ack, en-queue and send message
+        ALOGW("%s(), lane %d full, count(%u), wait for space", __FUNCTION__, lane, pLane->count);
+        const nsecs_t deadline = systemTime() + milliseconds(kLaneFullWaitMs);
+        while (pLane->count == pLane->size)
         {
-            pQueue[iQWrite].ccci_buff = ccci_buff;
-            pQueue[iQWrite].ack_type  = ack_type;
-            iQWrite++;
-            if (iQWrite == CCCI_MAX_QUEUE_NUM) { iQWrite -= CCCI_MAX_QUEUE_NUM; }
-
-            ret = SendMessage(ccci_buff);
-            if (ret != NO_ERROR) // skip this fail CCCI message
+            const nsecs_t remain = deadline - systemTime();
+            if (remain <= 0)
             {
-                iQRead++;
-                if (iQRead == CCCI_MAX_QUEUE_NUM) { iQRead -= CCCI_MAX_QUEUE_NUM; }
+                ALOGE("%s(), lane %d still full after %u ms, message: 0x%x", __FUNCTION__, lane, kLaneFullWaitMs, ccci_buff.message);
+                return NO_MEMORY;
             }
+            mCCCIMessageQueueSpaceCondition.waitRelative(mCCCIMessageQueueMutex, remain);
         }
     }
-    else // queue is not empty, must queue the element
-    {
-        pQueue[iQWrite].ccci_buff = ccci_buff;
-        pQueue[iQWrite].ack_type  = ack_type;
-        iQWrite++;
-        if (iQWrite == CCCI_MAX_QUEUE_NUM) { iQWrite -= CCCI_MAX_QUEUE_NUM; }
 
-        ALOGD("%s(), Send message(0x%x) to queue, count(%u)", __FUNCTION__, ccci_buff.message, GetQueueCount());
-    }
+    ccci_lane_element_t *pElement = &pLane->pQueue[(pLane->read + pLane->count) % pLane->size];
+    pElement->element.ccci_buff = ccci_buff;
+    pElement->element.ack_type  = ack_type;
+    pElement->enqueue_time      = systemTime();
+    pElement->sequence          = mEnqueueSequence++;
+    pLane->count++;
+    return NO_ERROR;
+}
 
+status_t SpeechMessengerECCCI::SendMessageOutOfQueueLock(const ccci_lane_element_t &lane_element)
+{
+    // take the send lock before the queue lock is released, so writes keep the dequeue order
+    mCCCISendMutex.lock();
     mCCCIMessageQueueMutex.unlock();
+
+    status_t ret = SendMessage(lane_element.element.ccci_buff);
+
+    mCCCISendMutex.unlock();
+    mCCCIMessageQueueMutex.lock();
     return ret;
 }
 
-status_t SpeechMessengerECCCI::ConsumeMessageInQueue()
+void SpeechMessengerECCCI::DropMessage(ccci_lane_type_t lane, const ccci_buff_t &ccci_buff)
 {
-    mCCCIMessageQueueMutex.lock();
+    mLane[lane].drop_count++;
+    ALOGE("%s(), lane %d, message: 0x%x", __FUNCTION__, lane, ccci_buff.message);
 
-    uint32_t count = GetQueueCount();
-    if (count > 10)
+    // AP side must still reach the state the ack would bring (and release the A2M share buffer)
+    if (JudgeAckOfMsg(GetMessageID(ccci_buff)) == MESSAGE_NEED_ACK)
     {
-        ALOGW("%s(), queue count: %u", __FUNCTION__, count);
+        SendMsgFailErrorHandling(ccci_buff);
     }
+}
+
+void SpeechMessengerECCCI::UpdateMessageLatency(ccci_lane_type_t lane, const ccci_lane_element_t &lane_element)
+{
+    ccci_message_lane_t *pLane = &mLane[lane];
+    const nsecs_t latency = systemTime() - lane_element.enqueue_time;
+    const uint32_t latency_ms = (uint32_t)ns2ms(latency);
 
-    if (count == 0)
+    uint32_t bin = 0;
+    while (bin < NUM_CCCI_LATENCY_BIN - 1 && latency_ms >= kCcciLatencyBinMs[bin])
     {
-        ALOGW("%s(), no message in queue", __FUNCTION__);
-        mCCCIMessageQueueMutex.unlock();
-        return UNKNOWN_ERROR;
+        bin++;
     }
+    pLane->latency_histogram[bin]++;
+    if (latency > pLane->max_latency)
+    {
+        pLane->max_latency = latency;
+    }
+}
 
+void SpeechMessengerECCCI::CheckAckTimeout()
+{
+    const uint32_t kAckTimeoutMs = 1000;
+
+    if (mWaitAckPending == false || mWaitAckTimeoutReported == true)
+    {
+        return;
+    }
+
+    const nsecs_t wait_time = systemTime() - mWaitAckSendTime;
+    if (wait_time > milliseconds(kAckTimeoutMs))
+    {
+        // only tracked, a late ack still consumes the queue as usual
+        mWaitAckTimeoutReported = true;
+        mLane[mWaitAckLane].ack_timeout_count++;
+        ALOGW("%s(), message: 0x%x not acked for %lld ms, queue count: %u",
+              __FUNCTION__, mWaitAckElement.element.ccci_buff.message, (long long)ns2ms(wait_time), GetQueueCount());
+    }
+}
+
+void SpeechMessengerECCCI::DumpMessageLatency()
+{
+    for (int lane = 0; lane < NUM_CCCI_LANE; lane++)
+    {
+        const ccci_message_lane_t *pLane = &mLane[lane];
+        char histogram[128];
+        int length = 0;
+        for (uint32_t bin = 0; bin < NUM_CCCI_LATENCY_BIN && length < (int)sizeof(histogram); bin++)
+        {
+            length += snprintf(histogram + length, sizeof(histogram) - length, " %u", pLane->latency_histogram[bin]);
+        }
+        ALOGD("%s(), lane %d, latency histogram(<1,2,5,10,20,50,100,200,500,>=500 ms):%s, max %lld ms, ack timeout %u, drop %u",
+              __FUNCTION__, lane, histogram, (long long)ns2ms(pLane->max_latency), pLane->ack_timeout_count, pLane->drop_count);
+    }
+}
+
+status_t SpeechMessengerECCCI::DispatchMessageInQueue()
+{
+    // mCCCIMessageQueueMutex is held, and released around every write
     status_t ret = NO_ERROR;
-    while (1)
+    while (mWaitAckPending == false)
     {
-        // when entering this function, the first message in queue must be a message waiting for ack
-        // so we increment index, consuming the first message in queue
-        iQRead++;
-        if (iQRead == CCCI_MAX_QUEUE_NUM) { iQRead -= CCCI_MAX_QUEUE_NUM; }
+        const ccci_message_lane_t *pNormal = &mLane[CCCI_LANE_NORMAL];
+        const ccci_message_lane_t *pBulk = &mLane[CCCI_LANE_BULK];
+        if (pNormal->count == 0 && pBulk->count == 0)
+        {
+            break; // empty
+        }
 
-        // check if empty
-        if (iQRead == iQWrite)
+        int lane = (pNormal->count > 0) ? CCCI_LANE_NORMAL : CCCI_LANE_BULK;
+        if (pNormal->count > 0 && pBulk->count > 0)
         {
-            ret = NO_ERROR;
-            break;
+            // e.g. SPH_ON must not reach the modem before the EM_DYNAMIC_SPH queued ahead of it
+            const ccci_lane_element_t *pNormalHead = &pNormal->pQueue[pNormal->read];
+            const ccci_lane_element_t *pBulkHead = &pBulk->pQueue[pBulk->read];
+            if ((int32_t)(pBulkHead->sequence - pNormalHead->sequence) < 0 &&
+                CanOvertakeBulk(GetMessageID(pNormalHead->element.ccci_buff)) == false)
+            {
+                lane = CCCI_LANE_BULK;
+            }
         }
 
-        // update count
-        count = GetQueueCount();
+        ccci_message_lane_t *pLane = &mLane[lane];
+        const ccci_lane_element_t lane_element = pLane->pQueue[pLane->read];
+        pLane->read = (pLane->read + 1) % pLane->size;
+        pLane->count--;
+        mCCCIMessageQueueSpaceCondition.broadcast();
 
-        // send message
-        if (pQueue[iQRead].ack_type == MESSAGE_BYPASS_ACK) // no need ack, send directly, don't care ret value
+        if (lane_element.element.ack_type == MESSAGE_BYPASS_ACK) // no need ack, send directly, don't care ret value
         {
-            ALOGD("%s(), no need ack message: 0x%x, count: %u", __FUNCTION__, pQueue[iQRead].ccci_buff.message, count);
-            ret = SendMessage(pQueue[iQRead].ccci_buff);
+            ALOGD("%s(), no need ack message: 0x%x, count: %u", __FUNCTION__, lane_element.element.ccci_buff.message, GetQueueCount());
+            ret = SendMessageOutOfQueueLock(lane_element);
+            UpdateMessageLatency((ccci_lane_type_t)lane, lane_element);
         }
-        else if (pQueue[iQRead].ack_type == MESSAGE_NEED_ACK)
+        else if (lane_element.element.ack_type == MESSAGE_NEED_ACK)
         {
-            ALOGD("%s(), need ack message: 0x%x, count: %u", __FUNCTION__, pQueue[iQRead].ccci_buff.message, count);
-            ret = SendMessage(pQueue[iQRead].ccci_buff);
-            if (ret == NO_ERROR) // Send CCCI message success and wait for ack
+            ALOGD("%s(), need ack message: 0x%x, count: %u", __FUNCTION__, lane_element.element.ccci_buff.message, GetQueueCount());
+            mWaitAckPending = true;
+            mWaitAckLane = (ccci_lane_type_t)lane;
+            mWaitAckElement = lane_element;
+            mWaitAckSendTime = systemTime();
+            mWaitAckTimeoutReported = false;
+
+            ret = SendMessageOutOfQueueLock(lane_element);
+            if (ret != NO_ERROR) // skip this fail CCCI message, SendMessage() did the error handling
             {
-                break;
+                mWaitAckPending = false;
             }
         }
-        else if (pQueue[iQRead].ack_type == MESSAGE_CANCELED) // the cancelled message, ignore it
+        else if (lane_element.element.ack_type == MESSAGE_CANCELED) // the cancelled message, ignore it
         {
-            ALOGD("%s(), cancel on-off-on message: 0x%x, count: %u", __FUNCTION__, pQueue[iQRead].ccci_buff.message, count);
+            ALOGD("%s(), cancel on-off-on message: 0x%x, count: %u", __FUNCTION__, lane_element.element.ccci_buff.message, GetQueueCount());
             ret = NO_ERROR;
         }
     }
+    return ret;
+}
+
+status_t SpeechMessengerECCCI::SendMessageInQueue(ccci_buff_t ccci_buff)
+{
+    const uint16_t message_id = GetMessageID(ccci_buff);
+    const ccci_message_ack_t ack_type = JudgeAckOfMsg(message_id);
+    const ccci_lane_type_t lane = GetMessageLane(message_id);
+
+    if (ack_type == MESSAGE_NEED_ACK)
+    {
+        ALOGD("%s(), mModemIndex = %d, need ack message: 0x%x, reserved param: 0x%x",
+              __FUNCTION__, mModemIndex, ccci_buff.message, ccci_buff.reserved);
+    }
+
+    mCCCIMessageQueueMutex.lock();
+
+    CheckAckTimeout();
+
+    status_t ret = NO_ERROR;
+    if (IsControlMessage(message_id) == true)
+    {
+        // volume / mute only keep their order against normal messages not sent yet,
+        // they never wait for an outstanding ack or parameter uploads
+        if (mLane[CCCI_LANE_NORMAL].count == 0 && ack_type == MESSAGE_BYPASS_ACK)
+        {
+            ccci_lane_element_t lane_element;
+            lane_element.element.ccci_buff = ccci_buff;
+            lane_element.element.ack_type  = ack_type;
+            lane_element.enqueue_time      = systemTime();
+
+            ret = SendMessageOutOfQueueLock(lane_element);
+            UpdateMessageLatency(lane, lane_element);
+
+            mCCCIMessageQueueMutex.unlock();
+            return ret;
+        }
+    }
+
+    ret = EnqueueMessage(lane, ccci_buff, ack_type);
+    if (ret != NO_ERROR)
+    {
+        DropMessage(lane, ccci_buff);
+    }
+    else if (mWaitAckPending == false)
+    {
+        ret = DispatchMessageInQueue();
+    }
+    else
+    {
+        ALOGD("%s(), Send message(0x%x) to lane %d, count(%u)", __FUNCTION__, ccci_buff.message, lane, GetQueueCount());
+    }
+
+    mCCCIMessageQueueMutex.unlock();
+    return ret;
+}
+
+status_t SpeechMessengerECCCI::ConsumeMessageInQueue()
+{
+    mCCCIMessageQueueMutex.lock();
+
+    if (mWaitAckPending == false)
+    {
+        ALOGW("%s(), no message waiting for ack", __FUNCTION__);
+        mCCCIMessageQueueMutex.unlock();
+        return UNKNOWN_ERROR;
+    }
+
+    // the acked message leaves the queue
+    CheckAckTimeout();
+    mWaitAckPending = false;
+    UpdateMessageLatency(mWaitAckLane, mWaitAckElement);
+    const bool is_call_end = (GetMessageID(mWaitAckElement.element.ccci_buff) == MSG_A2M_SPH_OFF);
+
+    uint32_t count = GetQueueCount();
+    if (count > 10)
+    {
+        ALOGW("%s(), queue count: %u", __FUNCTION__, count);
+    }
+
+    status_t ret = DispatchMessageInQueue();
+
+    if (is_call_end == true)
+    {
+        DumpMessageLatency();
+    }
 
     mCCCIMessageQueueMutex.unlock();
     return ret;
@@ -774,34 +1018,33 @@ bool SpeechMessengerECCCI::MDReset_CheckMessageInQueue()
     uint32_t count = GetQueueCount();
     ALOGD("%s(), queue count: %u", __FUNCTION__, count);
 
-    bool ret = true;
-    while (1)
-    {
-        // Modem already reset.
-        // Check every CCCI message in queue.
-        // These messages that are sent before modem reset, don't send to modem.
-        // But AP side need to do related action to make AP side in the correct state.
+    // Modem already reset.
+    // Check every CCCI message in queue.
+    // These messages that are sent before modem reset, don't send to modem.
+    // But AP side need to do related action to make AP side in the correct state.
 
-        // check if empty
-        if (iQRead == iQWrite)
-        {
-            ALOGD("%s(), check message done", __FUNCTION__);
-            ret = true;
-            break;
-        }
+    // Need ack message. But modem reset, so simulate that the modem send back ack msg.
+    if (mWaitAckPending == true)
+    {
+        SendMsgFailErrorHandling(mWaitAckElement.element.ccci_buff);
+        mWaitAckPending = false;
+    }
 
-        // Need ack message. But modem reset, so simulate that the modem send back ack msg.
-        if (JudgeAckOfMsg(GetMessageID(pQueue[iQRead].ccci_buff)) == MESSAGE_NEED_ACK)
+    for (int lane = CCCI_LANE_NORMAL; lane < NUM_CCCI_LANE; lane++)
+    {
+        ccci_message_lane_t *pLane = &mLane[lane];
+        while (pLane->count > 0)
         {
-            SendMsgFailErrorHandling(pQueue[iQRead].ccci_buff);
+            DropMessage((ccci_lane_type_t)lane, pLane->pQueue[pLane->read].element.ccci_buff);
+            pLane->read = (pLane->read + 1) % pLane->size;
+            pLane->count--;
         }
-
-        iQRead++;
-        if (iQRead == CCCI_MAX_QUEUE_NUM) { iQRead -= CCCI_MAX_QUEUE_NUM; }
     }
+    mCCCIMessageQueueSpaceCondition.broadcast();
 
+    ALOGD("%s(), check message done", __FUNCTION__);
     mCCCIMessageQueueMutex.unlock();
-    return ret;
+    return true;
 }
 
 bool SpeechMessengerECCCI::GetMDResetFlag()
@@ -820,8 +1063,13 @@ void SpeechMessengerECCCI::MDReset_FlushMessageInQueue()
     if (count != 0)
     {
         ALOGE("%s(), queue is not empty!!", __FUNCTION__);
-        iQWrite = 0;
-        iQRead = 0;
+        for (int lane = 0; lane < NUM_CCCI_LANE; lane++)
+        {
+            mLane[lane].read = 0;
+            mLane[lane].count = 0;
+        }
+        mWaitAckPending = false;
+        mCCCIMessageQueueSpaceCondition.broadcast();
     }
 
     mCCCIMessageQueueMutex.unlock();
@@ -987,7 +1235,7 @@ void *SpeechMessengerECCCI::CCCIReadThread(void *arg)
             }
             case MSG_M2A_PCM_REC_DATA_NOTIFY:   // meaning that we are recording, modem have some data
             {
-                ALOGD("%s() MSG_M2A_PCM_REC_DATA_NOTIFY", __FUNCTION__);
+                ALOGV("%s() MSG_M2A_PCM_REC_DATA_NOTIFY", __FUNCTION__);
                 ASSERT(pCCCI->GetModemSideModemStatus(RECORD_STATUS_MASK) == true);
 
                 if (pCCCI->mLad->GetApSideModemStatus(RECORD_STATUS_MASK) == false)
@@ -999,7 +1247,7 @@ void *SpeechMessengerECCCI::CCCIReadThread(void *arg)
                     uint16_t Bytes_PCM = pCCCI->GetMessageLength(ccci_buff) - CCCI_PAYLOAD_BUFF_HEADER_LEN;
                     SLOGV("MSG_M2A_PCM_REC_DATA_NOTIFY(0x%x), data_length: %d", ccci_buff.message, Bytes_PCM);
 
-                    // Phone record
+                    // Phone record, only staged here, clients and pcm dump are served by the provider thread
                     AudioALSACaptureDataProviderVoice::getInstance()->provideModemRecordDataToProvider(pCCCI->GetM2AUplinkRingBuffer(ccci_buff));
 
                     if ((pCCCI->mLad->GetApSideModemStatus(RECORD_STATUS_MASK) == true) && (mA2M_ECCCI_DATA_READ_ACK == true))
@@ -1064,7 +1312,7 @@ void *SpeechMessengerECCCI::CCCIReadThread(void *arg)
                     SLOGV("MSG_M2A_VM_REC_DATA_NOTIFY(0x%x), data_length: %d", ccci_buff.message, pCCCI->GetMessageLength(ccci_buff) - CCCI_PAYLOAD_BUFF_HEADER_LEN);
 
                     SpeechVMRecorder *pSpeechVMRecorder = SpeechVMRecorder::GetInstance();
-                    // VM
+                    // VM, only staged here, fwrite() is done by the VM dump thread
                     pSpeechVMRecorder->CopyBufferToVM(pCCCI->GetM2AUplinkRingBuffer(ccci_buff));
 
                     if ((pCCCI->mLad->GetApSideModemStatus(VM_RECORD_STATUS_MASK) == true) && (mA2M_ECCCI_DATA_READ_ACK == true))
@@ -0,0 +1,572 @@
+/*
+ * Benchmark of the V3 HAL data paths.
+ *
+ * The bench links the audio.primary sources and drives the real
+ * AudioALSAPlaybackHandlerNormal::write() and the Normal capture provider
+ * readThread / AudioALSACaptureDataClient::read() against FakeTinyAlsa, whose
+ * pcm_* replace the driver and pace pcm_write / pcm_read like the DMA would.
+ * The mixer is still the real one, so stop the audio server before a run.
+ * It is a device executable: the HAL links the prebuilt MTK SRC / BesRecord /
+ * bit converter libraries, NVRAM and the mixer, none of which exist for host.
+ * Reported per scenario:
+ *   - CPU time per period (thread CPU clock for playback, process for capture)
+ *   - p50 / p99 / p999 latency of write() / read() and of every stage the HAL
+ *     reports through AudioBenchTrace (built with MTK_AUDIO_HAL_BENCH)
+ *   - heap allocations per period, expected 0 on the real-time path
+ *
+ * usage: audio_hal_bench [kernels|playback|capture|all] [-r rate] [-c channels]
+ *                        [-b 16|24] [-p period_ms] [-n periods] [-k clients] [-f]
+ *        -b is the playback source format, -c / -k the capture client channels / count
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include <cutils/atomic.h>
+
+#include "AudioALSACaptureDataClient.h"
+#include "AudioALSACaptureDataProviderNormal.h"
+#include "AudioALSAPlaybackHandlerNormal.h"
+#include "AudioALSASampleRateController.h"
+#include "AudioBenchTrace.h"
+#include "AudioSampleKernel.h"
+#include "FakeTinyAlsa.h"
+
+using namespace android;
+
+/*==============================================================================
+ *                     Allocation counter
+ *============================================================================*/
+
+static volatile int32_t gAllocCount = 0;
+
+void *operator new(size_t size)
+{
+    android_atomic_inc(&gAllocCount);
+    void *p = malloc(size ? size : 1);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) throw()
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) throw()
+{
+    free(p);
+}
+
+
+/*==============================================================================
+ *                     Option / statistic
+ *============================================================================*/
+
+struct bench_option_t
+{
+    uint32_t rate;
+    uint32_t channels;
+    uint32_t bits;      // 16, or 24 in 32 bit container
+    uint32_t periodMs;
+    uint32_t periods;
+    uint32_t clients;
+    bool     paced;
+};
+
+static uint64_t nowNs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class BenchStat
+{
+    public:
+        // reserve up front so that add() never allocates inside a measured period
+        BenchStat(const char *name, size_t count) : mName(name) { mSample.reserve(count); }
+
+        inline void add(uint64_t ns) { mSample.push_back(ns); }
+        void merge(const BenchStat &other) { mSample.insert(mSample.end(), other.mSample.begin(), other.mSample.end()); }
+
+        void print(const char *scenario)
+        {
+            if (mSample.empty())
+            {
+                return;
+            }
+            std::sort(mSample.begin(), mSample.end());
+            printf("%-9s %-24s n=%-7zu p50=%8llu p99=%8llu p999=%8llu max=%8llu ns\n",
+                   scenario, mName, mSample.size(),
+                   (unsigned long long)percentile(0.5), (unsigned long long)percentile(0.99),
+                   (unsigned long long)percentile(0.999), (unsigned long long)mSample.back());
+        }
+
+        uint64_t percentile(double p) const
+        {
+            size_t index = (size_t)(p * (mSample.size() - 1) + 0.5);
+            return mSample[index];
+        }
+
+    private:
+        const char *mName;
+        std::vector<uint64_t> mSample;
+};
+
+/*==============================================================================
+ *                     Stage trace, fed by the HAL data path threads
+ *============================================================================*/
+
+static const char *kBenchStageName[AUDIO_BENCH_STAGE_NUM] =
+{
+    "stage.stereo_to_mono",
+    "stage.post_processing",
+    "stage.bli_src",
+    "stage.bit_conversion",
+    "stage.data_pending",
+    "stage.pcm_write",
+    "stage.pcm_read",
+    "stage.24_to_16",
+    "stage.publish",
+    "client.src",
+    "client.effect",
+};
+
+struct bench_stage_trace_t
+{
+    uint64_t        *sample;   // allocated before a run, record never allocates
+    uint32_t         capacity;
+    volatile int32_t count;
+};
+
+static bench_stage_trace_t gStageTrace[AUDIO_BENCH_STAGE_NUM];
+
+namespace android
+{
+void AudioBenchTrace_record(const audio_bench_stage_t stage, const uint64_t ns)
+{
+    bench_stage_trace_t *trace = &gStageTrace[stage];
+    const uint32_t index = (uint32_t)android_atomic_inc(&trace->count);
+    if (index < trace->capacity)
+    {
+        trace->sample[index] = ns;
+    }
+}
+}
+
+static void resetStageTrace(const uint32_t capacity)
+{
+    for (int i = 0; i < AUDIO_BENCH_STAGE_NUM; i++)
+    {
+        delete[] gStageTrace[i].sample;
+        gStageTrace[i].sample = new uint64_t[capacity];
+        gStageTrace[i].capacity = capacity;
+        android_atomic_release_store(0, &gStageTrace[i].count);
+    }
+}
+
+static void printStageTrace(const char *scenario)
+{
+    for (int i = 0; i < AUDIO_BENCH_STAGE_NUM; i++)
+    {
+        bench_stage_trace_t *trace = &gStageTrace[i];
+        uint32_t count = (uint32_t)android_atomic_acquire_load(&trace->count);
+        if (count > trace->capacity)
+        {
+            count = trace->capacity;
+        }
+
+        BenchStat stat(kBenchStageName[i], count);
+        for (uint32_t j = 0; j < count; j++)
+        {
+            stat.add(trace->sample[j]);
+        }
+        stat.print(scenario);
+    }
+}
+
+static void printPeriodCost(const char *scenario, uint64_t cpuNs, int32_t allocs, uint32_t periods)
+{
+    printf("%-9s cpu/period=%llu ns allocs/period=%.3f\n", scenario,
+           (unsigned long long)(cpuNs / (periods ? periods : 1)), (double)allocs / (periods ? periods : 1));
+}
+
+
+/*==============================================================================
+ *                     Kernels: the loops the HAL used before AudioSampleKernel
+ *============================================================================*/
+
+static void legacyStereoToMono16(int16_t *Sample, uint32_t bytes)
+{
+    while (bytes > 0)
+    {
+        int16_t averageValue = ((*Sample) >> 1) + ((*(Sample + 1)) >> 1);
+        *Sample++ = averageValue;
+        *Sample++ = averageValue;
+        bytes -= 4;
+    }
+}
+
+static void legacyStereoToMono32(int32_t *Sample, uint32_t bytes)
+{
+    while (bytes > 0)
+    {
+        int32_t averageValue = ((*Sample) >> 1) + ((*(Sample + 1)) >> 1);
+        *Sample++ = averageValue;
+        *Sample++ = averageValue;
+        bytes -= 8;
+    }
+}
+
+static void legacyDownmix16(short *buffer, uint32_t bytes)
+{
+    short *monoBuffer = buffer;
+    int frameCount = bytes >> 2;
+    for (int i = 0; i < frameCount; i++)
+    {
+        *monoBuffer++ = (*buffer + *(buffer + 1)) >> 1;
+        buffer += 2;
+    }
+}
+
+// AudioALSAPlaybackHandlerHDMI::write() 6ch to 8ch before the expand kernels
+static void legacy6chTo8ch(unsigned char *out, const unsigned char *in, uint32_t bytes, uint32_t sampleSize)
+{
+    const uint32_t inFrameSize = 6 * sampleSize;
+    for (uint32_t i = 0, j = 0; j < bytes; i += 8 * sampleSize)
+    {
+        memcpy(out + i, in + j, inFrameSize);
+        memset(out + i + inFrameSize, 0, 2 * sampleSize);
+        j += inFrameSize;
+    }
+}
+
+static void legacyUpmix16(short *buffer, uint32_t bytes)
+{
+    int frameCount = bytes >> 1;
+    short *monoBuffer = buffer + frameCount - 1;
+    short *stereoBuffer = buffer + (frameCount * 2) - 1;
+    for (int i = 0; i < frameCount; i++)
+    {
+        short data = *monoBuffer--;
+        *stereoBuffer-- = data;
+        *stereoBuffer-- = data;
+    }
+}
+
+static void legacy24To16(char *linear_buffer, uint32_t bytes)
+{
+    uint32_t *ptr32bit_r = (uint32_t *)linear_buffer;
+    int16_t *ptr16bit_w = (int16_t *)linear_buffer;
+    for (uint32_t i = 0; i < bytes / 4; i++)
+    {
+        *(ptr16bit_w + i) = (int16_t)(*(ptr32bit_r + i) >> 8);
+    }
+}
+
+static void fillRandom(char *buffer, uint32_t bytes)
+{
+    for (uint32_t i = 0; i < bytes; i++)
+    {
+        buffer[i] = (char)rand();
+    }
+}
+
+static void runKernels(const bench_option_t *option)
+{
+    const uint32_t frames = option->rate * option->periodMs / 1000;
+    const uint32_t bytes = frames * 2 * sizeof(int32_t);
+    char *buffer = new char[bytes * 3]; // also holds 6ch 32 bit input
+    const uint32_t loops = option->periods;
+    char *expandBuffer = new char[frames * 8 * sizeof(int32_t)];
+
+    printf("kernels   impl=%s frames/period=%u\n", AudioKernel_getName(), frames);
+
+#define BENCH_KERNEL(name, call) \
+    { \
+        BenchStat stat(name, loops); \
+        for (uint32_t i = 0; i < loops; i++) \
+        { \
+            fillRandom(buffer, bytes); \
+            uint64_t start = nowNs(CLOCK_MONOTONIC); \
+            call; \
+            stat.add(nowNs(CLOCK_MONOTONIC) - start); \
+        } \
+        stat.print("kernels"); \
+    }
+
+    BENCH_KERNEL("s2m16.legacy",   legacyStereoToMono16((int16_t *)buffer, frames * 4));
+    BENCH_KERNEL("s2m16.kernel",   AudioKernel_stereoToMonoDup16((int16_t *)buffer, frames));
+    BENCH_KERNEL("s2m32.legacy",   legacyStereoToMono32((int32_t *)buffer, frames * 8));
+    BENCH_KERNEL("s2m32.kernel",   AudioKernel_stereoToMonoDup32((int32_t *)buffer, frames));
+    BENCH_KERNEL("downmix.legacy", legacyDownmix16((short *)buffer, frames * 4));
+    BENCH_KERNEL("downmix.kernel", AudioKernel_downmix16((int16_t *)buffer, (int16_t *)buffer, frames));
+    BENCH_KERNEL("upmix.legacy",   legacyUpmix16((short *)buffer, frames * 2));
+    BENCH_KERNEL("upmix.kernel",   AudioKernel_upmix16((int16_t *)buffer, (int16_t *)buffer, frames));
+    BENCH_KERNEL("q9p23.legacy",   legacy24To16(buffer, frames * 8));
+    BENCH_KERNEL("q9p23.kernel",   AudioKernel_q9p23ToQ15((int16_t *)buffer, (int32_t *)buffer, frames * 2));
+    BENCH_KERNEL("q15toq31.kernel", AudioKernel_q15ToQ31((int32_t *)(buffer + bytes), (int16_t *)buffer, frames * 2));
+    BENCH_KERNEL("q31toq15.kernel", AudioKernel_q31ToQ15((int16_t *)buffer, (int32_t *)buffer, frames * 2));
+    BENCH_KERNEL("6to8ch16.legacy", legacy6chTo8ch((unsigned char *)expandBuffer, (unsigned char *)buffer, frames * 12, 2));
+    BENCH_KERNEL("6to8ch16.kernel", AudioKernel_6chTo8ch16((int16_t *)expandBuffer, (int16_t *)buffer, frames));
+    BENCH_KERNEL("6to8ch32.legacy", legacy6chTo8ch((unsigned char *)expandBuffer, (unsigned char *)buffer, frames * 24, 4));
+    BENCH_KERNEL("6to8ch32.kernel", AudioKernel_6chTo8ch32((int32_t *)expandBuffer, (int32_t *)buffer, frames));
+    BENCH_KERNEL("2to8ch16.kernel", AudioKernel_stereoTo8ch16((int16_t *)expandBuffer, (int16_t *)buffer, frames));
+
+#undef BENCH_KERNEL
+    delete[] buffer;
+    delete[] expandBuffer;
+}
+
+
+/*==============================================================================
+ *                     Playback: AudioALSAPlaybackHandlerNormal::write()
+ *============================================================================*/
+
+static void runPlayback(const bench_option_t *option)
+{
+    const uint32_t frames = option->rate * option->periodMs / 1000;
+    const uint32_t sampleBytes = (option->bits == 24) ? sizeof(int32_t) : sizeof(int16_t);
+    const uint32_t periodBytes = frames * 2 * sampleBytes;
+
+    // what AudioALSAStreamOut hands to the handler of a primary stream
+    stream_attribute_t source;
+    memset(&source, 0, sizeof(source));
+    source.audio_format = (option->bits == 24) ? AUDIO_FORMAT_PCM_32_BIT : AUDIO_FORMAT_PCM_16_BIT;
+    source.audio_channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+    source.num_channels = 2;
+    source.sample_rate = option->rate;
+    source.buffer_size = periodBytes;
+    source.output_devices = AUDIO_DEVICE_OUT_SPEAKER;
+    source.audio_mode = AUDIO_MODE_NORMAL;
+    AudioALSASampleRateController::getInstance()->setPrimaryStreamOutSampleRate(option->rate);
+
+    AudioALSAPlaybackHandlerNormal *handler = new AudioALSAPlaybackHandlerNormal(&source);
+    if (handler->open() != NO_ERROR)
+    {
+        printf("playback  handler open fail\n");
+        delete handler;
+        return;
+    }
+
+    char *buffer = new char[periodBytes];
+
+    BenchStat process("write.process", option->periods); // write() minus the DMA wait in pcm_write
+    BenchStat total("write.total", option->periods);
+    resetStageTrace(option->periods);
+
+    const int32_t allocStart = android_atomic_acquire_load(&gAllocCount);
+    uint64_t cpuNs = 0;
+
+    for (uint32_t i = 0; i < option->periods; i++)
+    {
+        fillRandom(buffer, periodBytes);
+
+        const uint64_t waitStart = FakeTinyAlsa_getWriteWaitNs();
+        uint64_t cpuStart = nowNs(CLOCK_THREAD_CPUTIME_ID);
+        uint64_t t0 = nowNs(CLOCK_MONOTONIC);
+        handler->write(buffer, periodBytes);
+        uint64_t t1 = nowNs(CLOCK_MONOTONIC);
+        cpuNs += nowNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+
+        process.add(t1 - t0 - (FakeTinyAlsa_getWriteWaitNs() - waitStart));
+        total.add(t1 - t0);
+    }
+
+    const int32_t allocs = android_atomic_acquire_load(&gAllocCount) - allocStart;
+
+    printStageTrace("playback");
+    process.print("playback");
+    total.print("playback");
+    printPeriodCost("playback", cpuNs, allocs, option->periods);
+    printf("playback  frames written=%llu\n", (unsigned long long)FakeTinyAlsa_getWrittenFrames());
+
+    handler->close();
+    delete handler;
+    delete[] buffer;
+}
+
+
+/*==============================================================================
+ *                     Capture: Normal provider readThread -> AudioALSACaptureDataClient::read()
+ *============================================================================*/
+
+struct bench_client_t
+{
+    AudioALSACaptureDataClient *client;
+    uint32_t periodBytes;
+    uint32_t periods;
+    char *buffer;
+    BenchStat *read; // one per client, merged after join
+    pthread_t thread;
+};
+
+static void *clientThread(void *arg)
+{
+    bench_client_t *client = static_cast<bench_client_t *>(arg);
+
+    for (uint32_t i = 0; i < client->periods; i++)
+    {
+        // the provider readThread publishes at the DMA rate, so this is wait + client processing
+        uint64_t t0 = nowNs(CLOCK_MONOTONIC);
+        if (client->client->read(client->buffer, client->periodBytes) <= 0)
+        {
+            break;
+        }
+        client->read->add(nowNs(CLOCK_MONOTONIC) - t0);
+    }
+
+    return NULL;
+}
+
+static void runCapture(const bench_option_t *option)
+{
+    // provider format is fixed at build time (RECORD_INPUT_24BITS), -b does not apply here
+    stream_attribute_t target;
+    memset(&target, 0, sizeof(target));
+    target.audio_format = AUDIO_FORMAT_PCM_16_BIT;
+    target.audio_channel_mask = (option->channels == 1) ? AUDIO_CHANNEL_IN_MONO : AUDIO_CHANNEL_IN_STEREO;
+    target.num_channels = (option->channels == 1) ? 1 : 2;
+    target.sample_rate = option->rate;
+    target.input_device = AUDIO_DEVICE_IN_BUILTIN_MIC;
+    target.input_source = AUDIO_SOURCE_MIC;
+    target.audio_mode = AUDIO_MODE_NORMAL;
+
+    const uint32_t periodBytes = option->rate * option->periodMs / 1000 * target.num_channels * sizeof(int16_t);
+
+    BenchStat read("client.read", option->periods * option->clients);
+    // the provider may run a few periods ahead of the clients, the extra ones are not recorded
+    resetStageTrace(option->periods * option->clients);
+
+    // the first attach opens the provider and starts its readThread
+    const int32_t allocStart = android_atomic_acquire_load(&gAllocCount);
+    bench_client_t *client = new bench_client_t[option->clients];
+    for (uint32_t i = 0; i < option->clients; i++)
+    {
+        client[i].client = new AudioALSACaptureDataClient(AudioALSACaptureDataProviderNormal::getInstance(), &target);
+        client[i].periodBytes = periodBytes;
+        client[i].periods = option->periods;
+        client[i].buffer = new char[periodBytes];
+        client[i].read = new BenchStat("client.read", option->periods);
+    }
+    const int32_t allocSteady = android_atomic_acquire_load(&gAllocCount);
+
+    const uint64_t cpuStart = nowNs(CLOCK_PROCESS_CPUTIME_ID);
+    for (uint32_t i = 0; i < option->clients; i++)
+    {
+        pthread_create(&client[i].thread, NULL, clientThread, &client[i]);
+    }
+
+    for (uint32_t i = 0; i < option->clients; i++)
+    {
+        pthread_join(client[i].thread, NULL);
+    }
+    const uint64_t cpuNs = nowNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    const int32_t allocs = android_atomic_acquire_load(&gAllocCount) - allocSteady;
+
+    uint32_t scratchAllocs = 0;
+    for (uint32_t i = 0; i < option->clients; i++)
+    {
+        read.merge(*client[i].read);
+        scratchAllocs += client[i].client->getScratchAllocCount();
+
+        // the last detach stops the readThread and closes the provider
+        delete client[i].client;
+        delete client[i].read;
+        delete[] client[i].buffer;
+    }
+
+    printStageTrace("capture");
+    read.print("capture");
+    printPeriodCost("capture", cpuNs, allocs, option->periods);
+    printf("capture   clients=%u frames read=%llu setup allocs=%d scratch allocs=%u\n", option->clients,
+           (unsigned long long)FakeTinyAlsa_getReadFrames(), allocSteady - allocStart, scratchAllocs);
+
+    delete[] client;
+}
+
+
+/*==============================================================================
+ *                     main
+ *============================================================================*/
+
+int main(int argc, char **argv)
+{
+    bench_option_t option = { 48000, 2, 16, 20, 2000, 3, true };
+    const char *scenario = "all";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            scenario = argv[i];
+        }
+        else if (!strcmp(argv[i], "-f"))
+        {
+            option.paced = false;
+        }
+        else if (i + 1 < argc)
+        {
+            uint32_t value = (uint32_t)atoi(argv[++i]);
+            switch (argv[i - 1][1])
+            {
+                case 'r': option.rate = value; break;
+                case 'c': option.channels = value; break;
+                case 'b': option.bits = value; break;
+                case 'p': option.periodMs = value; break;
+                case 'n': option.periods = value; break;
+                case 'k': option.clients = value; break;
+                default:
+                    fprintf(stderr, "unknown option %s\n", argv[i - 1]);
+                    return 1;
+            }
+        }
+    }
+
+    fake_pcm_option_t fakeOption = { option.paced, NULL, NULL };
+    FakeTinyAlsa_setOption(&fakeOption);
+
+    printf("rate=%u channels=%u bits=%u period=%ums periods=%u clients=%u paced=%d\n",
+           option.rate, option.channels, option.bits, option.periodMs, option.periods, option.clients, option.paced);
+
+    if (!strcmp(scenario, "kernels") || !strcmp(scenario, "all"))
+    {
+        runKernels(&option);
+    }
+    if (!strcmp(scenario, "playback") || !strcmp(scenario, "all"))
+    {
+        runPlayback(&option);
+    }
+    if (!strcmp(scenario, "capture") || !strcmp(scenario, "all"))
+    {
+        runCapture(&option);
+    }
+    return 0;
+}
@@ -0,0 +1,285 @@
+#include "FakeTinyAlsa.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace android
+{
+
+static fake_pcm_option_t gFakePcmOption = { true, NULL, NULL };
+static uint64_t gWrittenFrames = 0;
+static uint64_t gReadFrames = 0;
+static volatile uint64_t gWriteWaitNs = 0;
+
+void FakeTinyAlsa_setOption(const fake_pcm_option_t *option)
+{
+    gFakePcmOption = *option;
+}
+
+uint64_t FakeTinyAlsa_getWrittenFrames(void)
+{
+    return gWrittenFrames;
+}
+
+uint64_t FakeTinyAlsa_getReadFrames(void)
+{
+    return gReadFrames;
+}
+
+uint64_t FakeTinyAlsa_getWriteWaitNs(void)
+{
+    return gWriteWaitNs;
+}
+
+} // end namespace android
+
+using namespace android;
+
+/*==============================================================================
+ *                     fake pcm device
+ *============================================================================*/
+
+struct pcm
+{
+    unsigned int flags;
+    struct pcm_config config;
+    unsigned int frameBytes;
+    bool running;
+    struct timespec startTime;  // DMA position 0
+    uint64_t frames;            // frames moved by the client
+    int16_t ramp;
+    char error[64];
+};
+
+struct pcm_params
+{
+    unsigned int dummy;
+};
+
+static struct pcm gBadPcm;
+
+static uint64_t timespecToNs(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static void nsToTimespec(uint64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+// frames the fake DMA consumed (playback) or produced (capture) since start
+static uint64_t dmaFrames(struct pcm *pcm, uint64_t nowNs)
+{
+    return (nowNs - timespecToNs(&pcm->startTime)) * pcm->config.rate / 1000000000ULL;
+}
+
+// block until the DMA reached frame, like the driver waits for a period interrupt
+static void waitDmaFrames(struct pcm *pcm, uint64_t frames)
+{
+    if (gFakePcmOption.paced == false)
+    {
+        return;
+    }
+    struct timespec deadline;
+    nsToTimespec(timespecToNs(&pcm->startTime) + frames * 1000000000ULL / pcm->config.rate, &deadline);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+}
+
+unsigned int pcm_format_to_bits(enum pcm_format format)
+{
+    switch (format)
+    {
+        case PCM_FORMAT_S32_LE:
+            return 32;
+        case PCM_FORMAT_S8:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+struct pcm *pcm_open(unsigned int card, unsigned int device, unsigned int flags, struct pcm_config *config)
+{
+    (void)card;
+    (void)device;
+    if (config == NULL || config->rate == 0 || config->channels == 0)
+    {
+        strcpy(gBadPcm.error, "invalid config");
+        return &gBadPcm;
+    }
+
+    struct pcm *pcm = (struct pcm *)calloc(1, sizeof(struct pcm));
+    pcm->flags = flags;
+    pcm->config = *config;
+    pcm->frameBytes = config->channels * pcm_format_to_bits(config->format) / 8;
+    return pcm;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    if (pcm != NULL && pcm != &gBadPcm)
+    {
+        free(pcm);
+    }
+    return 0;
+}
+
+int pcm_is_ready(struct pcm *pcm)
+{
+    return pcm != NULL && pcm != &gBadPcm;
+}
+
+const char *pcm_get_error(struct pcm *pcm)
+{
+    return (pcm != NULL) ? pcm->error : "";
+}
+
+int pcm_start(struct pcm *pcm)
+{
+    if (pcm->running == false)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &pcm->startTime);
+        pcm->frames = 0;
+        pcm->running = true;
+    }
+    return 0;
+}
+
+int pcm_stop(struct pcm *pcm)
+{
+    pcm->running = false;
+    return 0;
+}
+
+unsigned int pcm_get_buffer_size(struct pcm *pcm)
+{
+    return pcm->config.period_size * pcm->config.period_count;
+}
+
+unsigned int pcm_bytes_to_frames(struct pcm *pcm, unsigned int bytes)
+{
+    return bytes / pcm->frameBytes;
+}
+
+unsigned int pcm_frames_to_bytes(struct pcm *pcm, unsigned int frames)
+{
+    return frames * pcm->frameBytes;
+}
+
+int pcm_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    pcm_start(pcm);
+
+    const unsigned int frames = count / pcm->frameBytes;
+    const uint64_t bufferFrames = pcm_get_buffer_size(pcm);
+
+    // no room until the DMA consumed what is beyond one buffer
+    if (pcm->frames + frames > bufferFrames)
+    {
+        struct timespec waitStart, waitEnd;
+        clock_gettime(CLOCK_MONOTONIC, &waitStart);
+        waitDmaFrames(pcm, pcm->frames + frames - bufferFrames);
+        clock_gettime(CLOCK_MONOTONIC, &waitEnd);
+        gWriteWaitNs += timespecToNs(&waitEnd) - timespecToNs(&waitStart);
+    }
+
+    if (gFakePcmOption.playbackSink != NULL)
+    {
+        fwrite(data, 1, count, gFakePcmOption.playbackSink);
+    }
+    pcm->frames += frames;
+    gWrittenFrames += frames;
+    return 0;
+}
+
+int pcm_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    pcm_start(pcm);
+
+    const unsigned int frames = count / pcm->frameBytes;
+    waitDmaFrames(pcm, pcm->frames + frames);
+
+    if (gFakePcmOption.captureSource != NULL)
+    {
+        size_t got = fread(data, 1, count, gFakePcmOption.captureSource);
+        if (got < count)
+        {
+            rewind(gFakePcmOption.captureSource);
+            got += fread((char *)data + got, 1, count - got, gFakePcmOption.captureSource);
+        }
+        if (got < count)
+        {
+            // shorter than one read, or a read error: the rest is silence
+            memset((char *)data + got, 0, count - got);
+        }
+    }
+    else if (pcm_format_to_bits(pcm->config.format) == 32)
+    {
+        int32_t *sample = (int32_t *)data;
+        for (unsigned int i = 0; i < count / 4; i++)
+        {
+            sample[i] = (int32_t)(pcm->ramp++) << 8; // 24 bit in 32 bit, like the UL memif
+        }
+    }
+    else
+    {
+        int16_t *sample = (int16_t *)data;
+        for (unsigned int i = 0; i < count / 2; i++)
+        {
+            sample[i] = pcm->ramp++;
+        }
+    }
+    pcm->frames += frames;
+    gReadFrames += frames;
+    return 0;
+}
+
+int pcm_get_htimestamp(struct pcm *pcm, unsigned int *avail, struct timespec *tstamp)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t dma = dmaFrames(pcm, timespecToNs(&now));
+    const uint64_t bufferFrames = pcm_get_buffer_size(pcm);
+
+    if (pcm->flags & PCM_IN)
+    {
+        *avail = (dma > pcm->frames) ? (unsigned int)(dma - pcm->frames) : 0;
+    }
+    else
+    {
+        const uint64_t queued = (pcm->frames > dma) ? pcm->frames - dma : 0;
+        *avail = (queued < bufferFrames) ? (unsigned int)(bufferFrames - queued) : 0;
+    }
+    *tstamp = now;
+    return 0;
+}
+
+struct pcm_params *pcm_params_get(unsigned int card, unsigned int device, unsigned int flags)
+{
+    (void)card;
+    (void)device;
+    (void)flags;
+    return (struct pcm_params *)calloc(1, sizeof(struct pcm_params));
+}
+
+void pcm_params_free(struct pcm_params *pcm_params)
+{
+    free(pcm_params);
+}
+
+unsigned int pcm_params_get_min(struct pcm_params *pcm_params, enum pcm_param param)
+{
+    (void)pcm_params;
+    (void)param;
+    return 0;
+}
+
+unsigned int pcm_params_get_max(struct pcm_params *pcm_params, enum pcm_param param)
+{
+    (void)pcm_params;
+    return (param == PCM_PARAM_BUFFER_BYTES) ? 0x10000 : 0xFFFFFFFF;
+}
@@ -0,0 +1,36 @@
+#ifndef ANDROID_AUDIO_FAKE_TINYALSA_H
+#define ANDROID_AUDIO_FAKE_TINYALSA_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <tinyalsa/asoundlib.h>
+
+/**
+ * Replacement of the tinyalsa pcm calls used by the V3 HAL, linked ahead of
+ * libtinyalsa so that the HAL sources built into the bench call these.
+ * Every pcm is a memory (or file) backed DMA buffer consumed / produced at the
+ * configured rate, so pcm_write / pcm_read block like the real driver does.
+ */
+namespace android
+{
+
+struct fake_pcm_option_t
+{
+    bool  paced;         // false: never block, only account the data
+    FILE *captureSource; // capture reads come from this file (looped) when set, ramp otherwise
+    FILE *playbackSink;  // playback writes go to this file when set, discarded otherwise
+};
+
+void FakeTinyAlsa_setOption(const fake_pcm_option_t *option);
+
+// total frames moved through pcm_write / pcm_read since start
+uint64_t FakeTinyAlsa_getWrittenFrames(void);
+uint64_t FakeTinyAlsa_getReadFrames(void);
+
+// time pcm_write spent waiting for the DMA, single writer
+uint64_t FakeTinyAlsa_getWriteWaitNs(void);
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_FAKE_TINYALSA_H
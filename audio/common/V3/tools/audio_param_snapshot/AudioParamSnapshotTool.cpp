@@ -0,0 +1,156 @@
+/*
+ * Host check of the audio param snapshot.
+ *
+ * The snapshot payload is produced on the device by the param parsers (the xml
+ * is resolved by AppHandle, which is not available on host). This tool checks
+ * that a snapshot pulled from /data/misc/audio/ still matches an xml folder:
+ *   - hash:   content hash of the *.xml, same as the HAL computes at boot;
+ *             give the custom folder pulled from the device too if it has one
+ *   - info:   header of a snapshot file
+ *   - verify: magic, size and payload checksum, plus the source hash if an
+ *             xml folder is given. exit code 0 if the HAL would map it
+ *
+ * usage: audio_param_snapshot hash <xml_folder> [custom_xml_folder]
+ *        audio_param_snapshot info <snapshot_file>
+ *        audio_param_snapshot verify <snapshot_file> [xml_folder [custom_xml_folder]]
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AudioParamSnapshot.h"
+
+using namespace android;
+
+static void *mapFile(const char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "open %s fail\n", path);
+        return NULL;
+    }
+
+    struct stat fileStat;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        addr = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        *size = fileStat.st_size;
+    }
+    close(fd);
+
+    if (addr == MAP_FAILED)
+    {
+        fprintf(stderr, "mmap %s fail\n", path);
+        return NULL;
+    }
+    return addr;
+}
+
+static void printHeader(const audio_param_snapshot_header_t *header, const size_t size)
+{
+    printf("file_size=%zu version=%u source_hash=%016llx payload_size=%u payload_checksum=%08x\n",
+           size, header->version, (unsigned long long)header->source_hash,
+           header->payload_size, header->payload_checksum);
+}
+
+static uint64_t hashFolders(const char *folder, const char *customFolder)
+{
+    uint64_t hash = AudioParamSnapshot::hashXmlFolder(folder);
+    if (hash != 0 && customFolder != NULL)
+    {
+        hash = AudioParamSnapshot::hashXmlFolder(customFolder, hash);
+    }
+    if (hash == 0)
+    {
+        fprintf(stderr, "hash %s fail\n", folder);
+    }
+    return hash;
+}
+
+static int runHash(const char *folder, const char *customFolder)
+{
+    uint64_t hash = hashFolders(folder, customFolder);
+    if (hash == 0)
+    {
+        return 1;
+    }
+    printf("%016llx\n", (unsigned long long)hash);
+    return 0;
+}
+
+static int runVerify(const char *path, const char *folder, const char *customFolder, const bool printOnly)
+{
+    uint64_t hash = 0;
+    if (folder != NULL)
+    {
+        hash = hashFolders(folder, customFolder);
+        if (hash == 0)
+        {
+            return 1;
+        }
+    }
+
+    size_t size = 0;
+    void *addr = mapFile(path, &size);
+    if (addr == NULL)
+    {
+        return 1;
+    }
+
+    // the layout version belongs to the HAL side owner, take the one in the file
+    audio_param_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    if (size >= sizeof(header))
+    {
+        memcpy(&header, addr, sizeof(header));
+    }
+
+    status_t status = AudioParamSnapshot::verify(addr, size, header.version, hash, &header);
+    munmap(addr, size);
+
+    if (status == BAD_VALUE)
+    {
+        fprintf(stderr, "%s: corrupted\n", path);
+        return 1;
+    }
+    printHeader(&header, size);
+    if (printOnly)
+    {
+        return 0;
+    }
+
+    if (status == NAME_NOT_FOUND)
+    {
+        printf("%s: stale, xml hash %016llx\n", path, (unsigned long long)hash);
+        return 1;
+    }
+    printf("%s: ok\n", path);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && !strcmp(argv[1], "hash"))
+    {
+        return runHash(argv[2], (argc >= 4) ? argv[3] : NULL);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "info"))
+    {
+        return runVerify(argv[2], NULL, NULL, true);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "verify"))
+    {
+        return runVerify(argv[2], (argc >= 4) ? argv[3] : NULL, (argc >= 5) ? argv[4] : NULL, false);
+    }
+
+    fprintf(stderr, "usage: %s hash <xml_folder> [custom_xml_folder]\n"
+            "       %s info <snapshot_file>\n"
+            "       %s verify <snapshot_file> [xml_folder [custom_xml_folder]]\n", argv[0], argv[0], argv[0]);
+    return 1;
+}
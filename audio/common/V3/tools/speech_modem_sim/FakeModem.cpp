@@ -0,0 +1,451 @@
+#include "FakeModem.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/atomic.h>
+
+namespace android
+{
+
+/*==============================================================================
+ *                     Constant
+ *============================================================================*/
+
+static const uint32_t kCcciM2AChannel = 4;
+static const uint32_t kCcciMailboxMagic = 0xFFFFFFFF;
+
+// MSG_M2A_xxx_ACK = MSG_A2M_xxx + kAckIdOffset, and so are the notify / read ack pairs
+static const uint16_t kAckIdOffset = CCCI_MSG_M2A_BASE - CCCI_MSG_A2M_BASE;
+
+static const int kMaxPollWaitMs = 100;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/*==============================================================================
+ *                     Implementation
+ *============================================================================*/
+
+FakeModem::FakeModem(const fake_modem_option_t *option) :
+    mOption(*option),
+    mThread(0),
+    mExit(0),
+    mStatus(FAKE_MODEM_STATUS_INVALID),
+    mStartNs(0),
+    mSeed(1),
+    mLastAckDueNs(0)
+{
+    mFd[0] = -1;
+    mFd[1] = -1;
+    memset(mRecord, 0, sizeof(mRecord));
+    mRecord[RECORD_PCM].notifyId     = MSG_M2A_PCM_REC_DATA_NOTIFY;
+    mRecord[RECORD_PCM].dataType     = SHARE_BUFF_DATA_TYPE_CCCI_PCM_TYPE;
+    mRecord[RECORD_VM].notifyId      = MSG_M2A_VM_REC_DATA_NOTIFY;
+    mRecord[RECORD_VM].dataType      = SHARE_BUFF_DATA_TYPE_CCCI_VM_TYPE;
+    mRecord[RECORD_RAW_PCM].notifyId = MSG_M2A_RAW_PCM_REC_DATA_NOTIFY;
+    mRecord[RECORD_RAW_PCM].dataType = SHARE_BUFF_DATA_TYPE_CCCI_RAW_PCM_TYPE;
+
+    if (mOption.recordFrames == 0)
+    {
+        mOption.recordFrames = 1;
+    }
+
+    pthread_mutex_init(&mStatLock, NULL);
+    memset(&mStat, 0, sizeof(mStat));
+}
+
+FakeModem::~FakeModem()
+{
+    stop();
+    pthread_mutex_destroy(&mStatLock);
+}
+
+status_t FakeModem::start()
+{
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, mFd) != 0)
+    {
+        fprintf(stderr, "%s(), socketpair fail, errno: %d\n", __FUNCTION__, errno);
+        return UNKNOWN_ERROR;
+    }
+
+    mRecordPattern.resize(CCCI_MAX_PAYLOAD_SIZE * sizeof(uint32_t));
+    for (size_t i = 0; i < mRecordPattern.size(); i++)
+    {
+        mRecordPattern[i] = (char)i;
+    }
+    mRecordAckNs.reserve(65536);
+
+    mStartNs = nowNs();
+    android_atomic_release_store(0, &mExit);
+    android_atomic_release_store(FAKE_MODEM_STATUS_READY, &mStatus);
+
+    if (pthread_create(&mThread, NULL, FakeModem::modemThread, (void *)this) != 0)
+    {
+        fprintf(stderr, "%s(), create thread fail\n", __FUNCTION__);
+        return UNKNOWN_ERROR;
+    }
+    return NO_ERROR;
+}
+
+void FakeModem::stop()
+{
+    if (mFd[1] < 0)
+    {
+        return;
+    }
+
+    android_atomic_release_store(1, &mExit);
+    pthread_join(mThread, NULL);
+
+    close(mFd[0]);
+    close(mFd[1]);
+    mFd[0] = -1;
+    mFd[1] = -1;
+    android_atomic_release_store(FAKE_MODEM_STATUS_INVALID, &mStatus);
+}
+
+uint32_t FakeModem::getModemStatus() const
+{
+    return (uint32_t)android_atomic_acquire_load(&mStatus);
+}
+
+void FakeModem::getStat(fake_modem_stat_t *stat)
+{
+    pthread_mutex_lock(&mStatLock);
+    *stat = mStat;
+    pthread_mutex_unlock(&mStatLock);
+}
+
+// same list as SpeechMessengerECCCI::JudgeAckOfMsg()
+bool FakeModem::isNeedAckMessage(const uint16_t message_id)
+{
+    switch (message_id)
+    {
+        case MSG_A2M_SET_SPH_MODE:
+        case MSG_A2M_SPH_ON:
+        case MSG_A2M_SPH_OFF:
+        case MSG_A2M_SPH_ROUTER_ON:
+        case MSG_A2M_PCM_REC_ON:
+        case MSG_A2M_VM_REC_ON:
+        case MSG_A2M_PCM_REC_OFF:
+        case MSG_A2M_VM_REC_OFF:
+        case MSG_A2M_BGSND_ON:
+        case MSG_A2M_BGSND_OFF:
+        case MSG_A2M_PNW_ON:
+        case MSG_A2M_PNW_OFF:
+        case MSG_A2M_DMNR_RECPLAY_ON:
+        case MSG_A2M_DMNR_RECPLAY_OFF:
+        case MSG_A2M_DMNR_REC_ONLY_ON:
+        case MSG_A2M_DMNR_REC_ONLY_OFF:
+        case MSG_A2M_CTM_ON:
+        case MSG_A2M_CTM_OFF:
+        case MSG_A2M_SET_ACOUSTIC_LOOPBACK:
+        case MSG_A2M_EM_NB:
+        case MSG_A2M_EM_DMNR:
+        case MSG_A2M_EM_MAGICON:
+        case MSG_A2M_EM_HAC:
+        case MSG_A2M_EM_WB:
+        case MSG_A2M_VIBSPK_PARAMETER:
+        case MSG_A2M_NXP_SMARTPA_PARAMETER:
+        case MSG_A2M_QUERY_RF_INFO:
+        case MSG_A2M_RECORD_RAW_PCM_ON:
+        case MSG_A2M_RECORD_RAW_PCM_OFF:
+        case MSG_A2M_EM_DYNAMIC_SPH:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t FakeModem::randomUs(const uint32_t range)
+{
+    if (range == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)rand_r(&mSeed) % range;
+}
+
+void *FakeModem::modemThread(void *arg)
+{
+    FakeModem *pModem = static_cast<FakeModem *>(arg);
+    ccci_buff_t ccci_buff;
+
+    while (android_atomic_acquire_load(&pModem->mExit) == 0)
+    {
+        uint64_t now = nowNs();
+
+        // modem exception: stop answering, the AP sees it through getModemStatus()
+        if (pModem->mOption.resetAfterMs != 0 &&
+            pModem->getModemStatus() == FAKE_MODEM_STATUS_READY &&
+            now - pModem->mStartNs >= (uint64_t)pModem->mOption.resetAfterMs * 1000000ULL)
+        {
+            android_atomic_release_store(FAKE_MODEM_STATUS_EXPT, &pModem->mStatus);
+            pModem->mPendingAck.clear();
+            for (int i = 0; i < NUM_RECORD_STREAM; i++)
+            {
+                pModem->mRecord[i].on = false;
+            }
+        }
+
+        // wait for the next A2M frame or the next due ack / record burst
+        const uint64_t nextNs = pModem->getNextEventNs();
+        int waitMs = kMaxPollWaitMs;
+        if (nextNs != 0)
+        {
+            waitMs = (nextNs <= now) ? 0 : (int)((nextNs - now + 999999) / 1000000);
+            if (waitMs > kMaxPollWaitMs)
+            {
+                waitMs = kMaxPollWaitMs;
+            }
+        }
+
+        struct pollfd pfd;
+        pfd.fd = pModem->mFd[1];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, waitMs) > 0 && (pfd.revents & POLLIN))
+        {
+            ssize_t length = recv(pModem->mFd[1], &ccci_buff, sizeof(ccci_buff), 0);
+            if (length >= (ssize_t)CCCI_BUF_HEADER_SIZE)
+            {
+                pModem->handleMessage(ccci_buff, length, nowNs());
+            }
+        }
+
+        now = nowNs();
+        while (pModem->mPendingAck.empty() == false && pModem->mPendingAck.front().dueNs <= now)
+        {
+            pModem->handleAck(pModem->mPendingAck.front());
+            pModem->mPendingAck.pop_front();
+        }
+
+        for (int i = 0; i < NUM_RECORD_STREAM; i++)
+        {
+            record_stream_t *stream = &pModem->mRecord[i];
+            if (stream->on == true && stream->nextBurstNs <= now)
+            {
+                pModem->sendRecordBurst(stream, now);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+uint64_t FakeModem::getNextEventNs() const
+{
+    uint64_t nextNs = mPendingAck.empty() ? 0 : mPendingAck.front().dueNs;
+    for (int i = 0; i < NUM_RECORD_STREAM; i++)
+    {
+        if (mRecord[i].on == true && (nextNs == 0 || mRecord[i].nextBurstNs < nextNs))
+        {
+            nextNs = mRecord[i].nextBurstNs;
+        }
+    }
+    return nextNs;
+}
+
+void FakeModem::handleMessage(const ccci_buff_t &ccci_buff, const ssize_t length, const uint64_t now)
+{
+    // mailbox: id in message, payload message: id in reserved and payload inline
+    const bool is_mailbox = (ccci_buff.magic == kCcciMailboxMagic);
+    const uint16_t message_id = is_mailbox ? (ccci_buff.message >> 16) : (ccci_buff.reserved >> 16);
+    const uint16_t param = is_mailbox ? (ccci_buff.message & 0xFFFF) : (ccci_buff.reserved & 0xFFFF);
+    const uint32_t payload_length = length - CCCI_BUF_HEADER_SIZE;
+
+    pthread_mutex_lock(&mStatLock);
+    mStat.received++;
+    if (is_mailbox == false)
+    {
+        mStat.paramBytes += payload_length;
+    }
+    pthread_mutex_unlock(&mStatLock);
+
+    if (getModemStatus() != FAKE_MODEM_STATUS_READY)
+    {
+        return;
+    }
+
+    // read ack of a record burst
+    for (int i = 0; i < NUM_RECORD_STREAM; i++)
+    {
+        record_stream_t *stream = &mRecord[i];
+        if (message_id == stream->notifyId - kAckIdOffset)
+        {
+            pthread_mutex_lock(&mStatLock);
+            mStat.recordReadAck++;
+            if (stream->burstSentNs != 0)
+            {
+                mRecordAckNs.push_back(now - stream->burstSentNs);
+            }
+            pthread_mutex_unlock(&mStatLock);
+            stream->burstSentNs = 0;
+            return;
+        }
+    }
+
+    if (isNeedAckMessage(message_id) == false)
+    {
+        pthread_mutex_lock(&mStatLock);
+        if (message_id < CCCI_MSG_A2M_BASE || message_id >= CCCI_MSG_M2A_BASE)
+        {
+            mStat.unknown++;
+        }
+        else
+        {
+            mStat.bypassAck++;
+        }
+        pthread_mutex_unlock(&mStatLock);
+        return;
+    }
+
+    pthread_mutex_lock(&mStatLock);
+    mStat.needAck++;
+    const bool drop = (randomUs(100) < mOption.dropAckPercent);
+    if (drop == true)
+    {
+        mStat.droppedAck++;
+    }
+    pthread_mutex_unlock(&mStatLock);
+    if (drop == true)
+    {
+        return;
+    }
+
+    // the modem speech task handles messages one by one
+    pending_ack_t ack;
+    const uint64_t startNs = (mLastAckDueNs > now) ? mLastAckDueNs : now;
+    uint64_t handleUs = mOption.ackLatencyUs + randomUs(mOption.ackJitterUs);
+    if (is_mailbox == false)
+    {
+        handleUs += (uint64_t)payload_length * mOption.paramUsPerKB / 1024;
+    }
+    ack.dueNs = startNs + handleUs * 1000ULL;
+    ack.id = message_id;
+    ack.param = param;
+    mLastAckDueNs = ack.dueNs;
+    mPendingAck.push_back(ack);
+
+    pthread_mutex_lock(&mStatLock);
+    if (mPendingAck.size() > mStat.maxPendingAck)
+    {
+        mStat.maxPendingAck = mPendingAck.size();
+    }
+    pthread_mutex_unlock(&mStatLock);
+}
+
+void FakeModem::handleAck(const pending_ack_t &ack)
+{
+    const uint64_t now = nowNs();
+
+    // record on / off take effect when acked
+    record_stream_t *stream = NULL;
+    bool on = false;
+    switch (ack.id)
+    {
+        case MSG_A2M_PCM_REC_ON:        stream = &mRecord[RECORD_PCM];     on = true;  break;
+        case MSG_A2M_PCM_REC_OFF:       stream = &mRecord[RECORD_PCM];     on = false; break;
+        case MSG_A2M_VM_REC_ON:         stream = &mRecord[RECORD_VM];      on = true;  break;
+        case MSG_A2M_VM_REC_OFF:        stream = &mRecord[RECORD_VM];      on = false; break;
+        case MSG_A2M_RECORD_RAW_PCM_ON: stream = &mRecord[RECORD_RAW_PCM]; on = true;  break;
+        case MSG_A2M_RECORD_RAW_PCM_OFF: stream = &mRecord[RECORD_RAW_PCM]; on = false; break;
+        default: break;
+    }
+    if (stream != NULL && mOption.recordPeriodMs != 0)
+    {
+        stream->on = on;
+        stream->nextBurstNs = now + (uint64_t)mOption.recordPeriodMs * 1000000ULL;
+        stream->burstSentNs = 0;
+    }
+
+    ccci_buff_t ccci_buff;
+    ccci_buff.magic    = kCcciMailboxMagic;
+    ccci_buff.message  = ((uint32_t)(ack.id + kAckIdOffset) << 16) | ack.param;
+    ccci_buff.channel  = kCcciM2AChannel;
+    ccci_buff.reserved = 0;
+    if (send(mFd[1], &ccci_buff, CCCI_BUF_HEADER_SIZE, MSG_DONTWAIT) == (ssize_t)CCCI_BUF_HEADER_SIZE)
+    {
+        pthread_mutex_lock(&mStatLock);
+        mStat.acked++;
+        pthread_mutex_unlock(&mStatLock);
+    }
+}
+
+void FakeModem::sendRecordBurst(record_stream_t *stream, const uint64_t now)
+{
+    stream->nextBurstNs += (uint64_t)mOption.recordPeriodMs * 1000000ULL;
+    if (stream->nextBurstNs < now)
+    {
+        stream->nextBurstNs = now; // fell behind, do not burst to catch up
+    }
+
+    // the modem keeps one burst in the share buffer until the AP read ack
+    if (stream->burstSentNs != 0)
+    {
+        pthread_mutex_lock(&mStatLock);
+        mStat.recordOverrun++;
+        pthread_mutex_unlock(&mStatLock);
+        return;
+    }
+
+    const uint32_t maxData = CCCI_MAX_PAYLOAD_SIZE * sizeof(uint32_t) - CCCI_PAYLOAD_BUFF_HEADER_LEN;
+    uint32_t remain = mOption.recordBytes;
+    const uint16_t total = (uint16_t)mOption.recordFrames;
+
+    ccci_buff_t ccci_buff;
+    for (uint16_t index = 1; index <= total; index++)
+    {
+        uint32_t data_length = (index == total) ? remain : mOption.recordBytes / total;
+        if (data_length > maxData)
+        {
+            data_length = maxData;
+        }
+        remain -= (data_length < remain) ? data_length : remain;
+
+        // share buffer header: sync, type, length, current index, total index
+        uint16_t *header = (uint16_t *)ccci_buff.payload;
+        header[0] = EEMCS_M2A_SHARE_BUFF_HEADER_SYNC;
+        header[1] = stream->dataType;
+        header[2] = data_length;
+        header[3] = index;
+        header[4] = total;
+        memcpy((char *)ccci_buff.payload + CCCI_PAYLOAD_BUFF_HEADER_LEN, &mRecordPattern[0], data_length);
+
+        const uint32_t payload_length = CCCI_PAYLOAD_BUFF_HEADER_LEN + data_length;
+        ccci_buff.magic    = 0; // offset
+        ccci_buff.message  = payload_length + CCCI_BUF_HEADER_SIZE; // the AP reader removes the header size
+        ccci_buff.channel  = kCcciM2AChannel;
+        ccci_buff.reserved = ((uint32_t)stream->notifyId << 16) | stream->sequence;
+
+        if (send(mFd[1], &ccci_buff, CCCI_BUF_HEADER_SIZE + payload_length, MSG_DONTWAIT) < 0)
+        {
+            // AP does not read the node at all, same as a full kernel queue
+            pthread_mutex_lock(&mStatLock);
+            mStat.recordOverrun++;
+            pthread_mutex_unlock(&mStatLock);
+            return;
+        }
+    }
+
+    stream->burstSentNs = now;
+    stream->sequence++;
+
+    pthread_mutex_lock(&mStatLock);
+    mStat.recordBursts++;
+    pthread_mutex_unlock(&mStatLock);
+}
+
+} // end namespace android
@@ -0,0 +1,139 @@
+#ifndef ANDROID_SPEECH_FAKE_MODEM_H
+#define ANDROID_SPEECH_FAKE_MODEM_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <deque>
+#include <vector>
+
+#include <utils/Errors.h>
+
+#include "SpeechCCCIType.h"
+
+/**
+ * Host stand-in of the modem behind the ECCCI audio node.
+ *
+ * The AP side gets one end of a SOCK_SEQPACKET socketpair, so every write() /
+ * read() moves one whole ECCCI frame like the CCCI char device does, with the
+ * payload inline (ECCCI has no real share memory, the messenger rebuilds it).
+ * The modem thread answers MSG_A2M_* with the matching MSG_M2A_*_ACK after a
+ * configurable latency, handles one need-ack message at a time like the modem
+ * task does, and streams record data in MSG_M2A_*_REC_DATA_NOTIFY bursts that
+ * wait for the AP read ack.
+ */
+namespace android
+{
+
+// CCCI_IOC_GET_MD_STATE values
+enum fake_modem_status_t
+{
+    FAKE_MODEM_STATUS_INVALID = 0,
+    FAKE_MODEM_STATUS_INIT    = 1,
+    FAKE_MODEM_STATUS_READY   = 2,
+    FAKE_MODEM_STATUS_EXPT    = 3
+};
+
+struct fake_modem_option_t
+{
+    uint32_t ackLatencyUs;    // per need-ack message
+    uint32_t ackJitterUs;     // uniform random extra latency
+    uint32_t paramUsPerKB;    // extra handling time of EM parameter payloads
+    uint32_t recordPeriodMs;  // one record burst per period
+    uint32_t recordBytes;     // record data per burst
+    uint32_t recordFrames;    // frames per burst, read ack expected after the last one
+    uint32_t dropAckPercent;  // need-ack messages that are never acked
+    uint32_t resetAfterMs;    // modem exception after this time, 0: never
+};
+
+struct fake_modem_stat_t
+{
+    uint32_t received;        // A2M frames
+    uint32_t needAck;
+    uint32_t acked;
+    uint32_t droppedAck;
+    uint32_t bypassAck;
+    uint64_t paramBytes;      // EM parameter payload received
+    uint32_t maxPendingAck;   // modem side queue depth
+    uint32_t recordBursts;
+    uint32_t recordReadAck;
+    uint32_t recordOverrun;   // burst due while the previous one was not acked yet
+    uint32_t unknown;
+};
+
+class FakeModem
+{
+    public:
+        FakeModem(const fake_modem_option_t *option);
+        ~FakeModem();
+
+        status_t start();
+        void     stop();
+
+        // AP side view: the node fd, and CCCI_IOC_GET_MD_STATE
+        int      getApFd() const { return mFd[0]; }
+        uint32_t getModemStatus() const;
+
+        void     getStat(fake_modem_stat_t *stat);
+
+        // notify to read ack turnaround of every record burst, valid after stop()
+        const std::vector<uint64_t> &getRecordAckLatency() const { return mRecordAckNs; }
+
+        static bool isNeedAckMessage(const uint16_t message_id);
+
+    private:
+        struct pending_ack_t
+        {
+            uint64_t dueNs;
+            uint16_t id;
+            uint16_t param;
+        };
+
+        struct record_stream_t
+        {
+            bool     on;
+            uint16_t notifyId;        // MSG_M2A_*_REC_DATA_NOTIFY
+            uint16_t dataType;        // share_buff_data_type_t
+            uint64_t nextBurstNs;
+            uint64_t burstSentNs;     // 0: no burst waiting for read ack
+            uint16_t sequence;
+        };
+
+        enum
+        {
+            RECORD_PCM = 0,
+            RECORD_VM,
+            RECORD_RAW_PCM,
+            NUM_RECORD_STREAM
+        };
+
+        static void *modemThread(void *arg);
+
+        void     handleMessage(const ccci_buff_t &ccci_buff, const ssize_t length, const uint64_t now);
+        void     handleAck(const pending_ack_t &ack);
+        void     sendRecordBurst(record_stream_t *stream, const uint64_t now);
+        uint64_t getNextEventNs() const;
+        uint32_t randomUs(const uint32_t range);
+
+        fake_modem_option_t mOption;
+        int                 mFd[2];  // [0]: AP, [1]: modem
+        pthread_t           mThread;
+        volatile int32_t    mExit;
+        volatile int32_t    mStatus;
+        uint64_t            mStartNs;
+        uint32_t            mSeed;
+
+        std::deque<pending_ack_t> mPendingAck;
+        uint64_t                  mLastAckDueNs;
+        record_stream_t           mRecord[NUM_RECORD_STREAM];
+        std::vector<char>         mRecordPattern;
+
+        pthread_mutex_t       mStatLock;
+        fake_modem_stat_t     mStat;
+        std::vector<uint64_t> mRecordAckNs;
+};
+
+} // end namespace android
+
+#endif // end of ANDROID_SPEECH_FAKE_MODEM_H
@@ -0,0 +1,839 @@
+/*
+ * Host load generator of the AP <-> modem speech link.
+ *
+ * FakeModem stands in for the modem behind the ECCCI audio node. On the AP side
+ * runs a model of the SpeechMessengerECCCI protocol, not the messenger itself:
+ * the real one needs the CCCI ioctls, SpeechDriverLAD and the HAL singletons,
+ * none of which exist on host. The model keeps these rules of it:
+ *   - parameter uploads on the BULK lane, the rest on the NORMAL lane (GetMessageLane),
+ *     lane sizes of SpeechMessengerECCCI.h, a full lane holds the caller 500 ms then drops
+ *   - one need-ack message in flight for both lanes (DispatchMessageInQueue): NORMAL first,
+ *     unless its head was queued after the BULK head and is not allowed to overtake
+ *     parameters (enqueue sequence / CanOvertakeBulk)
+ *   - volume / mute sent at once while the NORMAL lane is empty (IsControlMessage)
+ *   - a send failure moves the AP state on without the ack (SendMsgFailErrorHandling)
+ *   - record data notify copied to a staging ring and read-acked from the read thread
+ * so the numbers measure the protocol and the modem timing, a change in
+ * SpeechMessengerECCCI only shows up here once the model is updated to match.
+ * Reported per scenario:
+ *   - call:   call setup latency (SET_SPH_MODE + speech params + SPH_ON acked)
+ *   - param:  speech parameter upload throughput, with background sound data notify
+ *             (may overtake) and mode switches (may not) queued in between
+ *   - record: record read ack turnaround seen by the modem, overruns, and the
+ *             ack latency of call control sent meanwhile
+ * plus the AP queue depth sampled at every enqueue, per lane latency (enqueue to
+ * ack, or to send for bypass messages) and how often the dispatch order kicked in.
+ *
+ * -s adds a storage stall per record batch to the record consumer, -i runs that
+ * consumer inline in the read thread before the read ack (the old VM path).
+ *
+ * usage: speech_modem_sim [call|param|record|all] [-l ack_latency_us] [-j jitter_us]
+ *                         [-k param_us_per_kb] [-r record_period_ms] [-b record_bytes]
+ *                         [-f record_frames] [-d drop_ack_percent] [-e reset_after_ms]
+ *                         [-n count] [-t record_ms] [-s stall_us] [-i]
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "AudioSPSCRingBuf.h"
+#include "FakeModem.h"
+
+using namespace android;
+
+/*==============================================================================
+ *                     Option / statistic
+ *============================================================================*/
+
+struct sim_option_t
+{
+    fake_modem_option_t modem;
+    uint32_t count;          // calls / parameter uploads
+    uint32_t recordMs;
+    uint32_t stallUs;        // storage stall per record batch
+    bool     inlineConsumer; // consume record data in the read thread before the ack
+};
+
+static const uint32_t kCcciA2MChannel = 5;
+static const uint32_t kCcciMailboxMagic = 0xFFFFFFFF;
+static const uint16_t kAckIdOffset = CCCI_MSG_M2A_BASE - CCCI_MSG_A2M_BASE;
+static const uint32_t kAckTimeoutMs = 1000;
+static const uint32_t kStagingSize = 0x20000;
+static const uint32_t kRecordBatchSize = 0x2000;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class SimStat
+{
+    public:
+        SimStat(const char *name, const char *unit, size_t count) : mName(name), mUnit(unit) { mSample.reserve(count); }
+
+        inline void add(uint64_t value) { mSample.push_back(value); }
+        void merge(const std::vector<uint64_t> &sample) { mSample.insert(mSample.end(), sample.begin(), sample.end()); }
+        size_t size() const { return mSample.size(); }
+
+        void print(const char *scenario, const uint64_t scale)
+        {
+            if (mSample.empty())
+            {
+                printf("%-7s %-24s n=0\n", scenario, mName);
+                return;
+            }
+            std::sort(mSample.begin(), mSample.end());
+            printf("%-7s %-24s n=%-7zu p50=%8llu p99=%8llu p999=%8llu max=%8llu %s\n",
+                   scenario, mName, mSample.size(),
+                   (unsigned long long)(percentile(0.5) / scale), (unsigned long long)(percentile(0.99) / scale),
+                   (unsigned long long)(percentile(0.999) / scale), (unsigned long long)(mSample.back() / scale), mUnit);
+        }
+
+    private:
+        uint64_t percentile(double p) const
+        {
+            size_t index = (size_t)(p * (mSample.size() - 1) + 0.5);
+            return mSample[index];
+        }
+
+        const char *mName;
+        const char *mUnit;
+        std::vector<uint64_t> mSample;
+};
+
+
+/*==============================================================================
+ *                     AP side messenger model
+ *============================================================================*/
+
+// protocol model of SpeechMessengerECCCI, see the rules at the top of the file
+
+enum sim_lane_t
+{
+    SIM_LANE_NORMAL = 0,
+    SIM_LANE_BULK,
+    NUM_SIM_LANE
+};
+
+// lane sizes of SpeechMessengerECCCI.h
+static const uint32_t kSimBulkLaneSize = 12;
+static const uint32_t kSimNormalLaneSize = 60 - kSimBulkLaneSize;
+static const uint32_t kLaneFullWaitMs = 500;
+
+struct sim_message_t
+{
+    ccci_buff_t ccci_buff;
+    uint32_t    length;      // bytes written to the node
+    uint16_t    id;
+    bool        needAck;
+    uint32_t    sequence;
+    uint64_t    enqueueNs;
+};
+
+class SimMessenger
+{
+    public:
+        SimMessenger(FakeModem *modem, const sim_option_t *option) :
+            mModem(modem),
+            mFd(modem->getApFd()),
+            mOption(option),
+            mExit(0),
+            mWaitAck(false),
+            mWaitAckLane(SIM_LANE_NORMAL),
+            mNextSequence(1),
+            mControlId(0),
+            mSendFail(0),
+            mAckTimeout(0),
+            mControlBypass(0),
+            mOvertake(0),
+            mHeldBehindBulk(0),
+            mStagingDrop(0),
+            mQueueDepth("ap.queue_depth", "msg", 65536),
+            mAckLatency("ap.ack_latency", "us", 65536),
+            mControlLatency("ap.control_latency", "us", 65536),
+            mNormalLaneLatency("ap.normal_lane_latency", "us", 65536),
+            mBulkLaneLatency("ap.bulk_lane_latency", "us", 65536)
+        {
+            pthread_mutex_init(&mLock, NULL);
+            pthread_cond_init(&mDoneCond, NULL);
+            pthread_cond_init(&mSpaceCond, NULL);
+            mLaneSize[SIM_LANE_NORMAL] = kSimNormalLaneSize;
+            mLaneSize[SIM_LANE_BULK] = kSimBulkLaneSize;
+            memset(mLaneFullWait, 0, sizeof(mLaneFullWait));
+            memset(mLaneDrop, 0, sizeof(mLaneDrop));
+            mStaging.init(kStagingSize);
+            mConsumed = 0;
+        }
+
+        ~SimMessenger()
+        {
+            pthread_cond_destroy(&mSpaceCond);
+            pthread_cond_destroy(&mDoneCond);
+            pthread_mutex_destroy(&mLock);
+        }
+
+        void start()
+        {
+            pthread_create(&mReadThread, NULL, SimMessenger::readThread, this);
+            pthread_create(&mConsumerThread, NULL, SimMessenger::consumerThread, this);
+        }
+
+        void stop()
+        {
+            android_atomic_release_store(1, &mExit);
+            shutdown(mFd, SHUT_RD); // wake up the reader
+            pthread_join(mReadThread, NULL);
+            pthread_join(mConsumerThread, NULL);
+        }
+
+        // like InitCcciMailbox() + SendMessageInQueue(), returns the sequence to wait for
+        uint32_t send(const uint16_t id, const uint16_t param, const uint32_t payload_length)
+        {
+            sim_message_t message;
+            memset(&message.ccci_buff, 0, CCCI_BUF_HEADER_SIZE);
+            if (payload_length == 0)
+            {
+                message.ccci_buff.magic    = kCcciMailboxMagic;
+                message.ccci_buff.message  = ((uint32_t)id << 16) | param;
+                message.ccci_buff.reserved = 0;
+            }
+            else
+            {
+                message.ccci_buff.magic    = 0; // offset
+                message.ccci_buff.message  = payload_length;
+                message.ccci_buff.reserved = ((uint32_t)id << 16) | payload_length;
+                memset(message.ccci_buff.payload, 0x5A, payload_length);
+            }
+            message.ccci_buff.channel = kCcciA2MChannel;
+            message.length    = CCCI_BUF_HEADER_SIZE + payload_length;
+            message.id        = id;
+            message.needAck   = FakeModem::isNeedAckMessage(id);
+            message.enqueueNs = nowNs();
+
+            const sim_lane_t lane = getMessageLane(id);
+
+            pthread_mutex_lock(&mLock);
+            message.sequence = mNextSequence++;
+            mPending.push_back(message.sequence);
+
+            // volume / mute go out at once unless a normal message is still queued
+            if (isControlMessage(id) == true && mLane[SIM_LANE_NORMAL].empty() == true && message.needAck == false)
+            {
+                mControlBypass++;
+                if (writeMessage(message) == false)
+                {
+                    mSendFail++;
+                }
+                completeLocked(message, lane);
+                pthread_mutex_unlock(&mLock);
+                return message.sequence;
+            }
+
+            // lane full: hold the caller until an ack frees a slot, drop after kLaneFullWaitMs
+            if (mLane[lane].size() >= mLaneSize[lane])
+            {
+                mLaneFullWait[lane]++;
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += kLaneFullWaitMs / 1000;
+                deadline.tv_nsec += (kLaneFullWaitMs % 1000) * 1000000L;
+                if (deadline.tv_nsec >= 1000000000L)
+                {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000L;
+                }
+                while (mLane[lane].size() >= mLaneSize[lane])
+                {
+                    if (pthread_cond_timedwait(&mSpaceCond, &mLock, &deadline) == ETIMEDOUT &&
+                        mLane[lane].size() >= mLaneSize[lane])
+                    {
+                        // DropMessage(): the AP state moves on as if it was acked
+                        mLaneDrop[lane]++;
+                        markDoneLocked(message.sequence);
+                        pthread_mutex_unlock(&mLock);
+                        return message.sequence;
+                    }
+                }
+            }
+
+            mLane[lane].push_back(message);
+            mQueueDepth.add(mLane[SIM_LANE_NORMAL].size() + mLane[SIM_LANE_BULK].size() + (mWaitAck ? 1 : 0));
+            dispatchLocked();
+            pthread_mutex_unlock(&mLock);
+            return message.sequence;
+        }
+
+        // wait until the message is acked or sent; with two lanes completion is not in enqueue order
+        bool waitDone(const uint32_t sequence)
+        {
+            bool done = true;
+            pthread_mutex_lock(&mLock);
+            while (isPendingLocked(sequence) == true)
+            {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += kAckTimeoutMs / 1000;
+                if (pthread_cond_timedwait(&mDoneCond, &mLock, &deadline) == ETIMEDOUT &&
+                    isPendingLocked(sequence) == true && mWaitAck == true)
+                {
+                    // dropped ack, consume it like a modem reset flush so the queue goes on
+                    mAckTimeout++;
+                    mWaitAck = false;
+                    markDoneLocked(mWaitAckMessage.sequence);
+                    dispatchLocked();
+                    done = false;
+                }
+            }
+            pthread_mutex_unlock(&mLock);
+            return done;
+        }
+
+        void setControlLatencyId(const uint16_t id) { mControlId = id; }
+
+        void printStat(const char *scenario)
+        {
+            mQueueDepth.print(scenario, 1);
+            mAckLatency.print(scenario, 1000);
+            mControlLatency.print(scenario, 1000);
+            mNormalLaneLatency.print(scenario, 1000);
+            mBulkLaneLatency.print(scenario, 1000);
+            printf("%-7s ap send_fail=%u ack_timeout=%u control_bypass=%u overtake_bulk=%u held_behind_bulk=%u\n",
+                   scenario, mSendFail, mAckTimeout, mControlBypass, mOvertake, mHeldBehindBulk);
+            printf("%-7s ap lane_full_wait=%u/%u lane_drop=%u/%u (normal/bulk) staging_drop=%u consumed=%llu\n", scenario,
+                   mLaneFullWait[SIM_LANE_NORMAL], mLaneFullWait[SIM_LANE_BULK],
+                   mLaneDrop[SIM_LANE_NORMAL], mLaneDrop[SIM_LANE_BULK],
+                   (uint32_t)android_atomic_acquire_load(&mStagingDrop), (unsigned long long)mConsumed);
+        }
+
+    private:
+        // GetMessageLane() of SpeechMessengerECCCI
+        static sim_lane_t getMessageLane(const uint16_t id)
+        {
+            switch (id)
+            {
+                case MSG_A2M_EM_NB:
+                case MSG_A2M_EM_WB:
+                case MSG_A2M_EM_DMNR:
+                case MSG_A2M_EM_MAGICON:
+                case MSG_A2M_EM_HAC:
+                case MSG_A2M_VIBSPK_PARAMETER:
+                case MSG_A2M_NXP_SMARTPA_PARAMETER:
+                case MSG_A2M_EM_DYNAMIC_SPH:
+                    return SIM_LANE_BULK;
+                default:
+                    return SIM_LANE_NORMAL;
+            }
+        }
+
+        // IsControlMessage() of SpeechMessengerECCCI
+        static bool isControlMessage(const uint16_t id)
+        {
+            switch (id)
+            {
+                case MSG_A2M_SPH_DL_DIGIT_VOLUME:
+                case MSG_A2M_SPH_UL_DIGIT_VOLUME:
+                case MSG_A2M_MUTE_SPH_UL:
+                case MSG_A2M_MUTE_SPH_DL:
+                case MSG_A2M_SIDETONE_VOLUME:
+                case MSG_A2M_SPH_DL_ENH_REF_DIGIT_VOLUME:
+                case MSG_A2M_MUTE_SPH_UL_ENH_RESULT:
+                case MSG_A2M_MUTE_SPH_UL_SOURCE:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // CanOvertakeBulk() of SpeechMessengerECCCI
+        static bool canOvertakeBulk(const uint16_t id)
+        {
+            switch (id)
+            {
+                case MSG_A2M_PNW_DL_DATA_NOTIFY:
+                case MSG_A2M_BGSND_DATA_NOTIFY:
+                case MSG_A2M_CTM_DATA_NOTIFY:
+                case MSG_A2M_PNW_UL_DATA_READ_ACK:
+                case MSG_A2M_REC_DATA_READ_ACK:
+                case MSG_A2M_CTM_DEBUG_DATA_READ_ACK:
+                case MSG_A2M_PCM_REC_DATA_READ_ACK:
+                case MSG_A2M_VM_REC_DATA_READ_ACK:
+                case MSG_A2M_DACA_DL_DATA_READ_ACK:
+                case MSG_A2M_RAW_PCM_REC_DATA_READ_ACK:
+                case MSG_A2M_EM_DATA_REQUEST_ACK:
+                case MSG_A2M_NETWORK_STATUS_ACK:
+                case MSG_A2M_EPOF_ACK:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool writeMessage(const sim_message_t &message)
+        {
+            return write(mFd, &message.ccci_buff, message.length) == (ssize_t)message.length &&
+                   mModem->getModemStatus() == FAKE_MODEM_STATUS_READY;
+        }
+
+        bool isPendingLocked(const uint32_t sequence) const
+        {
+            return std::find(mPending.begin(), mPending.end(), sequence) != mPending.end();
+        }
+
+        void markDoneLocked(const uint32_t sequence)
+        {
+            std::deque<uint32_t>::iterator it = std::find(mPending.begin(), mPending.end(), sequence);
+            if (it != mPending.end())
+            {
+                mPending.erase(it);
+            }
+            pthread_cond_broadcast(&mDoneCond);
+        }
+
+        // UpdateMessageLatency(): sent for bypass messages, acked for the others
+        void completeLocked(const sim_message_t &message, const int lane)
+        {
+            const uint64_t latency = nowNs() - message.enqueueNs;
+            ((lane == SIM_LANE_BULK) ? mBulkLaneLatency : mNormalLaneLatency).add(latency);
+            if (message.id == mControlId)
+            {
+                mControlLatency.add(latency);
+            }
+            markDoneLocked(message.sequence);
+        }
+
+        // DispatchMessageInQueue(): normal lane first, unless its head is younger than the
+        // bulk head and may not overtake it
+        void dispatchLocked()
+        {
+            while (mWaitAck == false)
+            {
+                std::deque<sim_message_t> *pNormal = &mLane[SIM_LANE_NORMAL];
+                std::deque<sim_message_t> *pBulk = &mLane[SIM_LANE_BULK];
+                if (pNormal->empty() == true && pBulk->empty() == true)
+                {
+                    break;
+                }
+
+                int lane = (pNormal->empty() == false) ? SIM_LANE_NORMAL : SIM_LANE_BULK;
+                if (pNormal->empty() == false && pBulk->empty() == false &&
+                    (int32_t)(pBulk->front().sequence - pNormal->front().sequence) < 0)
+                {
+                    if (canOvertakeBulk(pNormal->front().id) == false)
+                    {
+                        lane = SIM_LANE_BULK;
+                        mHeldBehindBulk++;
+                    }
+                    else
+                    {
+                        mOvertake++;
+                    }
+                }
+
+                const sim_message_t message = mLane[lane].front();
+                mLane[lane].pop_front();
+                pthread_cond_broadcast(&mSpaceCond);
+
+                if (writeMessage(message) == false)
+                {
+                    // SendMsgFailErrorHandling(): AP side state moves on without the ack
+                    mSendFail++;
+                    markDoneLocked(message.sequence);
+                    continue;
+                }
+
+                if (message.needAck == true)
+                {
+                    mWaitAck = true;
+                    mWaitAckLane = lane;
+                    mWaitAckMessage = message;
+                }
+                else
+                {
+                    completeLocked(message, lane);
+                }
+            }
+        }
+
+        void handleAck(const uint16_t ack_id)
+        {
+            pthread_mutex_lock(&mLock);
+            if (mWaitAck == true && ack_id == mWaitAckMessage.id + kAckIdOffset)
+            {
+                mAckLatency.add(nowNs() - mWaitAckMessage.enqueueNs);
+                mWaitAck = false;
+                completeLocked(mWaitAckMessage, mWaitAckLane);
+                dispatchLocked();
+            }
+            pthread_mutex_unlock(&mLock);
+        }
+
+        void consumeRecord()
+        {
+            // what the VM dump thread / capture provider does with a batch
+            char buffer[kRecordBatchSize];
+            uint32_t bytes = mStaging.read(buffer, sizeof(buffer));
+            if (bytes > 0)
+            {
+                mConsumed += bytes;
+                if (mOption->stallUs != 0)
+                {
+                    usleep(mOption->stallUs);
+                }
+            }
+        }
+
+        void handleRecordData(const ccci_buff_t &ccci_buff, const uint16_t notify_id, const ssize_t length)
+        {
+            const uint16_t *header = (const uint16_t *)ccci_buff.payload;
+            const uint32_t data_length = length - CCCI_BUF_HEADER_SIZE - CCCI_PAYLOAD_BUFF_HEADER_LEN;
+            const char *data = (const char *)ccci_buff.payload + CCCI_PAYLOAD_BUFF_HEADER_LEN;
+
+            if (mStaging.write(data, data_length) != data_length)
+            {
+                android_atomic_add(1, &mStagingDrop);
+            }
+
+            if (mOption->inlineConsumer == true)
+            {
+                while (mStaging.getDataCount() >= kRecordBatchSize)
+                {
+                    consumeRecord();
+                }
+            }
+
+            // read ack after the last frame of the burst, sent directly like the messenger does
+            if (header[3] == header[4])
+            {
+                ccci_buff_t ack;
+                ack.magic    = kCcciMailboxMagic;
+                ack.message  = (uint32_t)(notify_id - kAckIdOffset) << 16;
+                ack.channel  = kCcciA2MChannel;
+                ack.reserved = 0;
+                if (write(mFd, &ack, CCCI_BUF_HEADER_SIZE) != (ssize_t)CCCI_BUF_HEADER_SIZE)
+                {
+                    pthread_mutex_lock(&mLock);
+                    mSendFail++;
+                    pthread_mutex_unlock(&mLock);
+                }
+            }
+        }
+
+        static void *readThread(void *arg)
+        {
+            SimMessenger *pMessenger = static_cast<SimMessenger *>(arg);
+            ccci_buff_t ccci_buff;
+
+            while (android_atomic_acquire_load(&pMessenger->mExit) == 0)
+            {
+                ssize_t length = recv(pMessenger->mFd, &ccci_buff, sizeof(ccci_buff), 0);
+                if (length < (ssize_t)CCCI_BUF_HEADER_SIZE)
+                {
+                    if (length == 0 || (length < 0 && errno != EINTR))
+                    {
+                        break;
+                    }
+                    continue;
+                }
+
+                if (ccci_buff.magic == kCcciMailboxMagic)
+                {
+                    pMessenger->handleAck(ccci_buff.message >> 16);
+                }
+                else
+                {
+                    pMessenger->handleRecordData(ccci_buff, ccci_buff.reserved >> 16, length);
+                }
+            }
+            return NULL;
+        }
+
+        static void *consumerThread(void *arg)
+        {
+            SimMessenger *pMessenger = static_cast<SimMessenger *>(arg);
+
+            while (android_atomic_acquire_load(&pMessenger->mExit) == 0)
+            {
+                if (pMessenger->mOption->inlineConsumer == true ||
+                    pMessenger->mStaging.getDataCount() < kRecordBatchSize)
+                {
+                    usleep(5000);
+                    continue;
+                }
+                pMessenger->consumeRecord();
+            }
+            return NULL;
+        }
+
+        FakeModem          *mModem;
+        int                 mFd;
+        const sim_option_t *mOption;
+        volatile int32_t    mExit;
+
+        pthread_mutex_t     mLock;
+        pthread_cond_t      mDoneCond;
+        pthread_cond_t      mSpaceCond;
+        std::deque<sim_message_t> mLane[NUM_SIM_LANE];
+        uint32_t            mLaneSize[NUM_SIM_LANE];
+        std::deque<uint32_t> mPending;   // sequences not acked or sent yet
+        bool                mWaitAck;
+        int                 mWaitAckLane;
+        sim_message_t       mWaitAckMessage;
+        uint32_t            mNextSequence;
+        uint16_t            mControlId;
+
+        uint32_t            mSendFail;
+        uint32_t            mAckTimeout;
+        uint32_t            mControlBypass;
+        uint32_t            mOvertake;
+        uint32_t            mHeldBehindBulk;
+        uint32_t            mLaneFullWait[NUM_SIM_LANE];
+        uint32_t            mLaneDrop[NUM_SIM_LANE];
+        volatile int32_t    mStagingDrop;
+        AudioSPSCRingBuf    mStaging;
+        uint64_t            mConsumed;
+
+        SimStat             mQueueDepth;
+        SimStat             mAckLatency;
+        SimStat             mControlLatency;
+        SimStat             mNormalLaneLatency;
+        SimStat             mBulkLaneLatency;
+
+        pthread_t           mReadThread;
+        pthread_t           mConsumerThread;
+};
+
+
+/*==============================================================================
+ *                     Scenarios
+ *============================================================================*/
+
+static const uint32_t kSpeechParamBytes = CCCI_MAX_PAYLOAD_SIZE * sizeof(uint32_t);
+
+static void printModemStat(const char *scenario, FakeModem *modem)
+{
+    fake_modem_stat_t stat;
+    modem->getStat(&stat);
+    printf("%-7s modem received=%u need_ack=%u acked=%u dropped_ack=%u bypass=%u param_bytes=%llu max_pending=%u\n",
+           scenario, stat.received, stat.needAck, stat.acked, stat.droppedAck, stat.bypassAck,
+           (unsigned long long)stat.paramBytes, stat.maxPendingAck);
+    if (stat.recordBursts != 0 || stat.recordOverrun != 0)
+    {
+        printf("%-7s modem record_bursts=%u read_ack=%u overrun=%u\n", scenario,
+               stat.recordBursts, stat.recordReadAck, stat.recordOverrun);
+    }
+}
+
+static void runCall(const sim_option_t *option)
+{
+    FakeModem modem(&option->modem);
+    if (modem.start() != NO_ERROR)
+    {
+        return;
+    }
+    SimMessenger messenger(&modem, option);
+    messenger.setControlLatencyId(MSG_A2M_SPH_ON);
+    messenger.start();
+
+    SimStat setup("call.setup", "us", option->count);
+    SimStat teardown("call.teardown", "us", option->count);
+
+    for (uint32_t i = 0; i < option->count; i++)
+    {
+        // SpeechDriverLAD::SetSpeechMode() + SetAllSpeechEnhancementInfoToModem() + SpeechOn()
+        const uint64_t t0 = nowNs();
+        messenger.send(MSG_A2M_SET_SPH_MODE, 0, 0);
+        messenger.send(MSG_A2M_EM_NB, 0, kSpeechParamBytes);
+        messenger.send(MSG_A2M_EM_WB, 0, kSpeechParamBytes);
+        messenger.send(MSG_A2M_EM_DMNR, 0, kSpeechParamBytes);
+        messenger.send(MSG_A2M_SPH_DL_DIGIT_VOLUME, 0, 0);
+        messenger.send(MSG_A2M_SPH_UL_DIGIT_VOLUME, 0, 0);
+        const bool on = messenger.waitDone(messenger.send(MSG_A2M_SPH_ON, 0, 0));
+        const uint64_t t1 = nowNs();
+        if (on == true)
+        {
+            setup.add(t1 - t0);
+        }
+
+        messenger.send(MSG_A2M_MUTE_SPH_UL, 0, 0);
+        if (messenger.waitDone(messenger.send(MSG_A2M_SPH_OFF, 0, 0)) == true)
+        {
+            teardown.add(nowNs() - t1);
+        }
+    }
+
+    messenger.stop();
+    modem.stop();
+
+    setup.print("call", 1000);
+    teardown.print("call", 1000);
+    messenger.printStat("call");
+    printModemStat("call", &modem);
+}
+
+static void runParam(const sim_option_t *option)
+{
+    FakeModem modem(&option->modem);
+    if (modem.start() != NO_ERROR)
+    {
+        return;
+    }
+    SimMessenger messenger(&modem, option);
+    messenger.setControlLatencyId(MSG_A2M_BGSND_DATA_NOTIFY);
+    messenger.start();
+
+    const uint16_t kParamId[] = { MSG_A2M_EM_NB, MSG_A2M_EM_WB, MSG_A2M_EM_DMNR, MSG_A2M_EM_MAGICON, MSG_A2M_EM_HAC };
+    const uint32_t numParamId = sizeof(kParamId) / sizeof(kParamId[0]);
+
+    // queue everything up front, like a parameter reload does, while background sound keeps
+    // notifying (may overtake the uploads) and a mode switch now and then (may not)
+    const uint64_t t0 = nowNs();
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < option->count; i++)
+    {
+        last = messenger.send(kParamId[i % numParamId], 0, kSpeechParamBytes);
+        messenger.send(MSG_A2M_BGSND_DATA_NOTIFY, 0, 0);
+        if (i % 20 == 0)
+        {
+            messenger.send(MSG_A2M_SET_SPH_MODE, 0, 0);
+        }
+    }
+    messenger.waitDone(last);
+    const uint64_t elapsed = nowNs() - t0;
+
+    messenger.stop();
+    modem.stop();
+
+    const double seconds = (double)elapsed / 1000000000.0;
+    printf("param   uploads=%u bytes=%llu time=%.3f s throughput=%.1f KB/s %.1f msg/s\n",
+           option->count, (unsigned long long)option->count * kSpeechParamBytes, seconds,
+           (double)option->count * kSpeechParamBytes / 1024.0 / seconds, (double)option->count / seconds);
+    messenger.printStat("param");
+    printModemStat("param", &modem);
+}
+
+static void runRecord(const sim_option_t *option)
+{
+    FakeModem modem(&option->modem);
+    if (modem.start() != NO_ERROR)
+    {
+        return;
+    }
+    SimMessenger messenger(&modem, option);
+    messenger.setControlLatencyId(MSG_A2M_SET_SPH_MODE);
+    messenger.start();
+
+    messenger.send(MSG_A2M_SPH_ON, 0, 0);
+    messenger.send(MSG_A2M_PCM_REC_ON, 0, 0);
+    messenger.waitDone(messenger.send(MSG_A2M_VM_REC_ON, 0, 0));
+
+    // call control keeps going while recording: volume every 20 ms, a mode switch every 200 ms
+    const uint64_t endNs = nowNs() + (uint64_t)option->recordMs * 1000000ULL;
+    for (uint32_t tick = 0; nowNs() < endNs; tick++)
+    {
+        messenger.send(MSG_A2M_SPH_DL_DIGIT_VOLUME, tick & 0xFF, 0);
+        if (tick % 10 == 0)
+        {
+            messenger.send(MSG_A2M_SET_SPH_MODE, tick & 0x3, 0);
+        }
+        usleep(20000);
+    }
+
+    messenger.send(MSG_A2M_VM_REC_OFF, 0, 0);
+    messenger.send(MSG_A2M_PCM_REC_OFF, 0, 0);
+    messenger.waitDone(messenger.send(MSG_A2M_SPH_OFF, 0, 0));
+
+    messenger.stop();
+    modem.stop();
+
+    SimStat readAck("modem.read_ack", "us", 0);
+    readAck.merge(modem.getRecordAckLatency());
+    readAck.print("record", 1000);
+    messenger.printStat("record");
+    printModemStat("record", &modem);
+}
+
+
+/*==============================================================================
+ *                     main
+ *============================================================================*/
+
+int main(int argc, char **argv)
+{
+    sim_option_t option;
+    memset(&option, 0, sizeof(option));
+    option.modem.ackLatencyUs   = 2000;
+    option.modem.ackJitterUs    = 1000;
+    option.modem.paramUsPerKB   = 500;
+    option.modem.recordPeriodMs = 20;
+    option.modem.recordBytes    = 2304; // one EPL frame
+    option.modem.recordFrames   = 1;
+    option.count    = 200;
+    option.recordMs = 3000;
+    const char *scenario = "all";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            scenario = argv[i];
+        }
+        else if (!strcmp(argv[i], "-i"))
+        {
+            option.inlineConsumer = true;
+        }
+        else if (i + 1 < argc)
+        {
+            uint32_t value = (uint32_t)atoi(argv[++i]);
+            switch (argv[i - 1][1])
+            {
+                case 'l': option.modem.ackLatencyUs = value; break;
+                case 'j': option.modem.ackJitterUs = value; break;
+                case 'k': option.modem.paramUsPerKB = value; break;
+                case 'r': option.modem.recordPeriodMs = value; break;
+                case 'b': option.modem.recordBytes = value; break;
+                case 'f': option.modem.recordFrames = value; break;
+                case 'd': option.modem.dropAckPercent = value; break;
+                case 'e': option.modem.resetAfterMs = value; break;
+                case 'n': option.count = value; break;
+                case 't': option.recordMs = value; break;
+                case 's': option.stallUs = value; break;
+                default:
+                    fprintf(stderr, "unknown option %s\n", argv[i - 1]);
+                    return 1;
+            }
+        }
+    }
+
+    printf("ack_latency=%uus jitter=%uus param=%uus/KB record=%ubytes/%ums in %u frames drop_ack=%u%% reset_after=%ums "
+           "count=%u record_time=%ums stall=%uus inline=%d\n",
+           option.modem.ackLatencyUs, option.modem.ackJitterUs, option.modem.paramUsPerKB,
+           option.modem.recordBytes, option.modem.recordPeriodMs, option.modem.recordFrames,
+           option.modem.dropAckPercent, option.modem.resetAfterMs, option.count, option.recordMs,
+           option.stallUs, option.inlineConsumer);
+
+    if (!strcmp(scenario, "call") || !strcmp(scenario, "all"))
+    {
+        runCall(&option);
+    }
+    if (!strcmp(scenario, "param") || !strcmp(scenario, "all"))
+    {
+        runParam(&option);
+    }
+    if (!strcmp(scenario, "record") || !strcmp(scenario, "all"))
+    {
+        runRecord(&option);
+    }
+    return 0;
+}
@@ -6,6 +6,8 @@
 #define MTK_LOG_ENABLE 1
 #include <media/AudioSystem.h>
 #include <cutils/compiler.h>
+#include <cutils/atomic.h>
+#include <unistd.h>
 
 #include "audio_custom_exp.h"
 #include "AudioCustParam.h"
@@ -278,10 +280,15 @@ AudioMTKFilterManager::AudioMTKFilterManager(
       mEnhanceFilter(NULL),
 //#if defined(MTK_VIBSPK_SUPPORT)
       mVIBSPKFilter(NULL),
+      mVibspkAddToneFilter(NULL),
 //#endif
       mBuffer(NULL),
-      mDevices(0)
+      mDevices(0),
+      mChainIndex(0)
 {
+    memset(mChain, 0, sizeof(mChain));
+    mChainUser[0] = 0;
+    mChainUser[1] = 0;
     init();
 }
 
@@ -566,103 +573,146 @@ bool AudioMTKFilterManager::isParamFixed()
 void AudioMTKFilterManager::setDevice(uint32_t devices)
 {
     mDevices = devices;
+
+    // compile into the chain process() is not reading, then publish it. A process()
+    // which picked that slot before the last publish may still be walking it
+    const int32_t nextIndex = android_atomic_acquire_load(&mChainIndex) ^ 1;
+    android_memory_barrier(); // last publish before the hold check, pairs with the inc in process()
+    while (android_atomic_acquire_load(&mChainUser[nextIndex]) != 0)
+    {
+        usleep(100);
+    }
+    compileChain(devices, &mChain[nextIndex]);
+    android_atomic_release_store(nextIndex, &mChainIndex);
     return;
 }
 
-uint32_t  AudioMTKFilterManager::process(void *inBuffer, uint32_t bytes, void *outBuffer, uint32_t outSize)
+void AudioMTKFilterManager::addFilterStage(filter_chain_t *chain, AudioMTKFilter *filter)
 {
-#if defined(CONFIG_MT_ENG_BUILD) 
-    SLOGV("+process() insize %u", bytes);
-#endif
-    uint32_t outputSize = 0;
+    if (filter == NULL || chain->stageCount >= filter_chain_t::kMaxStage)
+    {
+        return;
+    }
+    chain->stage[chain->stageCount].type = FILTER_STAGE_FILTER;
+    chain->stage[chain->stageCount].filter = filter;
+    chain->stageCount++;
+}
+
+void AudioMTKFilterManager::addToneStage(filter_chain_t *chain)
+{
+    if (mVibspkAddToneFilter == NULL || chain->stageCount >= filter_chain_t::kMaxStage)
+    {
+        return;
+    }
+    chain->stage[chain->stageCount].type = FILTER_STAGE_VIBSPK_TONE;
+    chain->stage[chain->stageCount].filter = NULL;
+    chain->stageCount++;
+}
+
+void AudioMTKFilterManager::compileChain(uint32_t devices, filter_chain_t *chain)
+{
+    chain->stageCount = 0;
 #ifndef MTK_BASIC_PACKAGE
-    uint32_t device = mDevices;
-    if (device & AUDIO_DEVICE_OUT_SPEAKER)
+    if (devices & AUDIO_DEVICE_OUT_SPEAKER)
     {
-        if (mSpeakerFilter)
+        addFilterStage(chain, mSpeakerFilter);
+        if (IsAudioSupportFeature(AUDIO_SUPPORT_VIBRATION_SPEAKER) && mVIBSPKFilter)
         {
-            if (mSpeakerFilter->isStart())
-            {
-                outputSize = mSpeakerFilter->process(inBuffer, bytes, outBuffer, outSize);
-            }
+            addFilterStage(chain, mVIBSPKFilter); // notch filter
+            addToneStage(chain);
         }
-//#if defined(MTK_VIBSPK_SUPPORT)
-        if (IsAudioSupportFeature(AUDIO_SUPPORT_VIBRATION_SPEAKER))
+    }
+    else if ((devices & AUDIO_DEVICE_OUT_WIRED_HEADSET) || (devices & AUDIO_DEVICE_OUT_WIRED_HEADPHONE))
+    {
+        addFilterStage(chain, mEnhanceFilter);
+        addFilterStage(chain, mHeadphoneFilter);
+    }
+    else if (devices & AUDIO_DEVICE_OUT_EARPIECE)
+    {
+        if (IsAudioSupportFeature(AUDIO_SUPPORT_VIBRATION_SPEAKER) && IsAudioSupportFeature(AUDIO_SUPPORT_2IN1_SPEAKER))
         {
-            if (mVIBSPKFilter)//Notch filter
-            {
-                if (mVIBSPKFilter->isStart())
-                {
-                    void *out;
-                    void *in;
-                    if (CC_UNLIKELY(outputSize == 0))
-                    {
-                        in = inBuffer;
-                    }
-                    else
-                    {
-                        in = outBuffer;
-
-                    }
-
-                    out = mBuffer;
-                    outputSize = mVIBSPKFilter->process(in, bytes, out, outSize);
-
-                    //Temp Use mSwapBufferVoIP for memory reduce
-                    void *vibspkin = out;
-                    void *vibspkout = outBuffer;
-                    mVibspkAddToneFilter->DoVibSignal2DLProcess(vibspkout, vibspkin, outputSize);
-
-
-                }
+            addFilterStage(chain, mVIBSPKFilter);
+        }
+    }
+#endif
+    SLOGD("compileChain() devices 0x%x stageCount %u", devices, chain->stageCount);
+}
 
-            }
+uint32_t  AudioMTKFilterManager::process(void *inBuffer, uint32_t bytes, void *outBuffer, uint32_t outSize)
+{
+#if defined(CONFIG_MT_ENG_BUILD) 
+    SLOGV("+process() insize %u", bytes);
+#endif
+    // hold the slot, then check it is still the published one: setDevice() either
+    // sees the hold or has already moved on to the other slot
+    int32_t chainIndex;
+    while (true)
+    {
+        chainIndex = android_atomic_acquire_load(&mChainIndex);
+        android_atomic_inc(&mChainUser[chainIndex]);
+        if (android_atomic_acquire_load(&mChainIndex) == chainIndex)
+        {
+            break;
         }
-//#endif
+        android_atomic_dec(&mChainUser[chainIndex]);
     }
-    else if ((device & AUDIO_DEVICE_OUT_WIRED_HEADSET) || (device & AUDIO_DEVICE_OUT_WIRED_HEADPHONE))
+    const filter_chain_t *chain = &mChain[chainIndex];
+
+    // stages of filters which are not started drop out of this block; the tone
+    // stage only follows a running notch filter
+    const filter_stage_t *active[filter_chain_t::kMaxStage];
+    uint32_t activeCount = 0;
+    for (uint32_t i = 0; i < chain->stageCount; i++)
     {
-        if (mEnhanceFilter)
+        const filter_stage_t *stage = &chain->stage[i];
+        if (stage->type == FILTER_STAGE_FILTER)
         {
-            if (mEnhanceFilter->isStart())
+            if (stage->filter->isStart())
             {
-                outputSize = mEnhanceFilter->process(inBuffer, bytes, outBuffer, outSize);
+                active[activeCount++] = stage;
             }
         }
-        if (mHeadphoneFilter)
+        else if (activeCount > 0 && active[activeCount - 1]->filter == mVIBSPKFilter)
         {
-            if (mHeadphoneFilter->isStart())
-            {
-                if (CC_UNLIKELY(outputSize == 0))
-                {
-                    outputSize = mHeadphoneFilter->process(inBuffer, bytes, outBuffer, outSize);
-                }
-                else
-                {
-                    void *in = outBuffer;
-                    void *out = mBuffer;
-                    outputSize = mHeadphoneFilter->process(in, outputSize, out, outSize);
-                    if (outputSize > 0) { memcpy(outBuffer, out, outputSize); }
-                }
-            }
+            active[activeCount++] = stage;
         }
     }
-//#if defined(MTK_VIBSPK_SUPPORT)
-    else if(device & AUDIO_DEVICE_OUT_EARPIECE)
+
+    // ping-pong between outBuffer and mBuffer, chosen so the last stage lands in
+    // outBuffer and no stage has to be copied back
+    void *in = inBuffer;
+    uint32_t inSize = bytes;
+    uint32_t outputSize = 0;
+    for (uint32_t i = 0; i < activeCount; i++)
     {
-        if (IsAudioSupportFeature(AUDIO_SUPPORT_VIBRATION_SPEAKER) && IsAudioSupportFeature(AUDIO_SUPPORT_2IN1_SPEAKER))
+        void *out = (((activeCount - 1 - i) & 1) == 0) ? outBuffer : (void *)mBuffer;
+        if (active[i]->type == FILTER_STAGE_FILTER)
         {
-        if (mVIBSPKFilter)
-        {
-            if (mVIBSPKFilter->isStart())
+            outputSize = active[i]->filter->process(in, inSize, out, outSize);
+            if (CC_UNLIKELY(outputSize == 0))
             {
-                    outputSize = mVIBSPKFilter->process(inBuffer, bytes, outBuffer, outSize);
+                // filter stopped under us, pass its input through
+                if (i == 0)
+                {
+                    continue; // in stays inBuffer, caller uses it if nothing else runs
+                }
+                memcpy(out, in, inSize);
+                outputSize = inSize;
             }
         }
+        else
+        {
+            outputSize = mVibspkAddToneFilter->DoVibSignal2DLProcess(out, in, inSize);
+        }
+        in = out;
+        inSize = outputSize;
     }
+
+    if (CC_UNLIKELY(outputSize > 0 && in != outBuffer))
+    {
+        memcpy(outBuffer, in, outputSize); // only after a first stage skipped itself
     }
-//#endif
-#endif
+    android_atomic_dec(&mChainUser[chainIndex]);
 #if defined(CONFIG_MT_ENG_BUILD) 
     SLOGV("-process() outsize %u", outputSize);
 #endif
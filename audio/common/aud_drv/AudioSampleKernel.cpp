@@ -0,0 +1,501 @@
+#include "AudioSampleKernel.h"
+
+#include <pthread.h>
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cutils/log.h>
+
+#define LOG_TAG "AudioSampleKernel"
+
+namespace android
+{
+
+/*==============================================================================
+ *                     Scalar
+ *============================================================================*/
+
+static void stereoToMonoDup16_c(int16_t *stereo, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        int16_t averageValue = (stereo[0] >> 1) + (stereo[1] >> 1);
+        *stereo++ = averageValue;
+        *stereo++ = averageValue;
+    }
+}
+
+static void stereoToMonoDup32_c(int32_t *stereo, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        int32_t averageValue = (stereo[0] >> 1) + (stereo[1] >> 1);
+        *stereo++ = averageValue;
+        *stereo++ = averageValue;
+    }
+}
+
+static void downmix16_c(int16_t *mono, const int16_t *stereo, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        *mono++ = (stereo[0] + stereo[1]) >> 1;
+        stereo += 2;
+    }
+}
+
+static void selectChannel16_c(int16_t *mono, const int16_t *stereo, uint32_t frames, uint32_t channel)
+{
+    stereo += channel;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        *mono++ = *stereo;
+        stereo += 2;
+    }
+}
+
+static void crossmix16_c(int16_t *stereo, uint32_t frames, uint32_t fromChannel)
+{
+    const uint32_t toChannel = fromChannel ^ 1;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        stereo[toChannel] = stereo[fromChannel];
+        stereo += 2;
+    }
+}
+
+static void upmix16_c(int16_t *stereo, const int16_t *mono, uint32_t frames)
+{
+    // backwards so that stereo may overlap mono
+    for (uint32_t i = frames; i > 0; i--)
+    {
+        int16_t data = mono[i - 1];
+        stereo[2 * i - 1] = data;
+        stereo[2 * i - 2] = data;
+    }
+}
+
+static void q15ToQ31_c(int32_t *out, const int16_t *in, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        out[i] = (int32_t)in[i] << 16;
+    }
+}
+
+static void q31ToQ15_c(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        out[i] = (int16_t)(in[i] >> 16);
+    }
+}
+
+static void q9p23ToQ15_c(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        out[i] = (int16_t)(in[i] >> 8);
+    }
+}
+
+static void stereoTo8ch16_c(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        for (uint32_t pair = 0; pair < 4; pair++)
+        {
+            *out++ = in[0];
+            *out++ = in[1];
+        }
+        in += 2;
+    }
+}
+
+static void stereoTo8ch32_c(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        for (uint32_t pair = 0; pair < 4; pair++)
+        {
+            *out++ = in[0];
+            *out++ = in[1];
+        }
+        in += 2;
+    }
+}
+
+static void sixChTo8ch16_c(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        for (uint32_t channel = 0; channel < 6; channel++)
+        {
+            *out++ = *in++;
+        }
+        *out++ = 0;
+        *out++ = 0;
+    }
+}
+
+static void sixChTo8ch32_c(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        for (uint32_t channel = 0; channel < 6; channel++)
+        {
+            *out++ = *in++;
+        }
+        *out++ = 0;
+        *out++ = 0;
+    }
+}
+
+void AudioKernel_bindScalar(audio_sample_kernel_t *kernel)
+{
+    kernel->name = "scalar";
+    kernel->stereoToMonoDup16 = stereoToMonoDup16_c;
+    kernel->stereoToMonoDup32 = stereoToMonoDup32_c;
+    kernel->downmix16 = downmix16_c;
+    kernel->selectChannel16 = selectChannel16_c;
+    kernel->crossmix16 = crossmix16_c;
+    kernel->upmix16 = upmix16_c;
+    kernel->q15ToQ31 = q15ToQ31_c;
+    kernel->q31ToQ15 = q31ToQ15_c;
+    kernel->q9p23ToQ15 = q9p23ToQ15_c;
+    kernel->stereoTo8ch16 = stereoTo8ch16_c;
+    kernel->stereoTo8ch32 = stereoTo8ch32_c;
+    kernel->sixChTo8ch16 = sixChTo8ch16_c;
+    kernel->sixChTo8ch32 = sixChTo8ch32_c;
+}
+
+
+/*==============================================================================
+ *                     SSE2 (x86 host builds)
+ *============================================================================*/
+
+#if defined(__SSE2__)
+// 4 stereo frames per step, the remind goes to the scalar loop
+
+static void stereoToMonoDup16_sse2(int16_t *stereo, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128i x = _mm_srai_epi16(_mm_loadu_si128((const __m128i *)stereo), 1);
+        __m128i swap = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *)stereo, _mm_add_epi16(x, swap));
+        stereo += 8;
+    }
+    stereoToMonoDup16_c(stereo, frames - i);
+}
+
+static void stereoToMonoDup32_sse2(int32_t *stereo, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 2 <= frames; i += 2)
+    {
+        __m128i x = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)stereo), 1);
+        __m128i swap = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *)stereo, _mm_add_epi32(x, swap));
+        stereo += 4;
+    }
+    stereoToMonoDup32_c(stereo, frames - i);
+}
+
+static void downmix16_sse2(int16_t *mono, const int16_t *stereo, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)stereo);
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(stereo + 8));
+        // sign extended L and R of every frame in 32 bit lanes
+        __m128i sum0 = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(x0, 16), 16), _mm_srai_epi32(x0, 16));
+        __m128i sum1 = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(x1, 16), 16), _mm_srai_epi32(x1, 16));
+        _mm_storeu_si128((__m128i *)mono, _mm_packs_epi32(_mm_srai_epi32(sum0, 1), _mm_srai_epi32(sum1, 1)));
+        mono += 8;
+        stereo += 16;
+    }
+    downmix16_c(mono, stereo, frames - i);
+}
+
+static void selectChannel16_sse2(int16_t *mono, const int16_t *stereo, uint32_t frames, uint32_t channel)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)stereo);
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(stereo + 8));
+        if (channel == 0)
+        {
+            x0 = _mm_slli_epi32(x0, 16);
+            x1 = _mm_slli_epi32(x1, 16);
+        }
+        _mm_storeu_si128((__m128i *)mono, _mm_packs_epi32(_mm_srai_epi32(x0, 16), _mm_srai_epi32(x1, 16)));
+        mono += 8;
+        stereo += 16;
+    }
+    selectChannel16_c(mono, stereo, frames - i, channel);
+}
+
+static void crossmix16_sse2(int16_t *stereo, uint32_t frames, uint32_t fromChannel)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)stereo);
+        if (fromChannel == 0)
+        {
+            x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        }
+        else
+        {
+            x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+        }
+        _mm_storeu_si128((__m128i *)stereo, x);
+        stereo += 8;
+    }
+    crossmix16_c(stereo, frames - i, fromChannel);
+}
+
+static void upmix16_sse2(int16_t *stereo, const int16_t *mono, uint32_t frames)
+{
+    // backwards in blocks of 8, a block is loaded before its output is stored
+    uint32_t i = frames;
+    for (; i >= 8; i -= 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(mono + i - 8));
+        _mm_storeu_si128((__m128i *)(stereo + 2 * i - 16), _mm_unpacklo_epi16(x, x));
+        _mm_storeu_si128((__m128i *)(stereo + 2 * i - 8), _mm_unpackhi_epi16(x, x));
+    }
+    upmix16_c(stereo, mono, i);
+}
+
+static void q15ToQ31_sse2(int32_t *out, const int16_t *in, uint32_t samples)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(zero, x));
+        _mm_storeu_si128((__m128i *)(out + i + 4), _mm_unpackhi_epi16(zero, x));
+    }
+    q15ToQ31_c(out + i, in + i, samples - i);
+}
+
+static void q31ToQ15_sse2(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i x0 = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i)), 16);
+        __m128i x1 = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i + 4)), 16);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(x0, x1));
+    }
+    q31ToQ15_c(out + i, in + i, samples - i);
+}
+
+static void q9p23ToQ15_sse2(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        // keep bits 8..23 sign extended, so the saturating pack never saturates
+        __m128i x0 = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(in + i)), 8), 16);
+        __m128i x1 = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(in + i + 4)), 8), 16);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(x0, x1));
+    }
+    q9p23ToQ15_c(out + i, in + i, samples - i);
+}
+
+static void stereoTo8ch16_sse2(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    // a stereo 16 bit frame is one 32 bit lane
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)in);
+        _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 0, 0, 0)));
+        _mm_storeu_si128((__m128i *)(out + 8), _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 1, 1, 1)));
+        _mm_storeu_si128((__m128i *)(out + 16), _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 2, 2, 2)));
+        _mm_storeu_si128((__m128i *)(out + 24), _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3)));
+        out += 32;
+        in += 8;
+    }
+    stereoTo8ch16_c(out, in, frames - i);
+}
+
+static void stereoTo8ch32_sse2(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    // a stereo 32 bit frame is one 64 bit lane
+    uint32_t i = 0;
+    for (; i + 2 <= frames; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)in);
+        __m128i frame0 = _mm_unpacklo_epi64(x, x);
+        __m128i frame1 = _mm_unpackhi_epi64(x, x);
+        _mm_storeu_si128((__m128i *)out, frame0);
+        _mm_storeu_si128((__m128i *)(out + 4), frame0);
+        _mm_storeu_si128((__m128i *)(out + 8), frame1);
+        _mm_storeu_si128((__m128i *)(out + 12), frame1);
+        out += 16;
+        in += 4;
+    }
+    stereoTo8ch32_c(out, in, frames - i);
+}
+
+static void sixChTo8ch16_sse2(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    // loads stay inside the 12 byte frame, the upper 4 bytes of the store are zero
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        __m128i front = _mm_loadl_epi64((const __m128i *)in);
+        __m128i rear = _mm_cvtsi32_si128(*(const int32_t *)(in + 4));
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi64(front, rear));
+        out += 8;
+        in += 6;
+    }
+}
+
+static void sixChTo8ch32_sse2(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        _mm_storeu_si128((__m128i *)out, _mm_loadu_si128((const __m128i *)in));
+        _mm_storeu_si128((__m128i *)(out + 4), _mm_loadl_epi64((const __m128i *)(in + 4)));
+        out += 8;
+        in += 6;
+    }
+}
+
+static void bindSse2(audio_sample_kernel_t *kernel)
+{
+    kernel->name = "sse2";
+    kernel->stereoToMonoDup16 = stereoToMonoDup16_sse2;
+    kernel->stereoToMonoDup32 = stereoToMonoDup32_sse2;
+    kernel->downmix16 = downmix16_sse2;
+    kernel->selectChannel16 = selectChannel16_sse2;
+    kernel->crossmix16 = crossmix16_sse2;
+    kernel->upmix16 = upmix16_sse2;
+    kernel->q15ToQ31 = q15ToQ31_sse2;
+    kernel->q31ToQ15 = q31ToQ15_sse2;
+    kernel->q9p23ToQ15 = q9p23ToQ15_sse2;
+    kernel->stereoTo8ch16 = stereoTo8ch16_sse2;
+    kernel->stereoTo8ch32 = stereoTo8ch32_sse2;
+    kernel->sixChTo8ch16 = sixChTo8ch16_sse2;
+    kernel->sixChTo8ch32 = sixChTo8ch32_sse2;
+}
+#endif
+
+
+/*==============================================================================
+ *                     Dispatch
+ *============================================================================*/
+
+static audio_sample_kernel_t gAudioKernel;
+static pthread_once_t gAudioKernelOnce = PTHREAD_ONCE_INIT;
+
+static void AudioKernel_init(void)
+{
+    AudioKernel_bindScalar(&gAudioKernel);
+
+#if defined(__aarch64__)
+    AudioKernel_bindNeon(&gAudioKernel); // always there on ARMv8
+#elif defined(__arm__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON)
+    {
+        AudioKernel_bindNeon(&gAudioKernel);
+    }
+#elif defined(__SSE2__)
+    bindSse2(&gAudioKernel);
+#endif
+
+    ALOGD("%s(), use %s kernels", __FUNCTION__, gAudioKernel.name);
+}
+
+static inline const audio_sample_kernel_t *AudioKernel_get(void)
+{
+    pthread_once(&gAudioKernelOnce, AudioKernel_init);
+    return &gAudioKernel;
+}
+
+void AudioKernel_stereoToMonoDup16(int16_t *stereo, uint32_t frames)
+{
+    AudioKernel_get()->stereoToMonoDup16(stereo, frames);
+}
+
+void AudioKernel_stereoToMonoDup32(int32_t *stereo, uint32_t frames)
+{
+    AudioKernel_get()->stereoToMonoDup32(stereo, frames);
+}
+
+void AudioKernel_downmix16(int16_t *mono, const int16_t *stereo, uint32_t frames)
+{
+    AudioKernel_get()->downmix16(mono, stereo, frames);
+}
+
+void AudioKernel_selectChannel16(int16_t *mono, const int16_t *stereo, uint32_t frames, uint32_t channel)
+{
+    AudioKernel_get()->selectChannel16(mono, stereo, frames, channel);
+}
+
+void AudioKernel_crossmix16(int16_t *stereo, uint32_t frames, uint32_t fromChannel)
+{
+    AudioKernel_get()->crossmix16(stereo, frames, fromChannel);
+}
+
+void AudioKernel_upmix16(int16_t *stereo, const int16_t *mono, uint32_t frames)
+{
+    AudioKernel_get()->upmix16(stereo, mono, frames);
+}
+
+void AudioKernel_q15ToQ31(int32_t *out, const int16_t *in, uint32_t samples)
+{
+    AudioKernel_get()->q15ToQ31(out, in, samples);
+}
+
+void AudioKernel_q31ToQ15(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    AudioKernel_get()->q31ToQ15(out, in, samples);
+}
+
+void AudioKernel_q9p23ToQ15(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    AudioKernel_get()->q9p23ToQ15(out, in, samples);
+}
+
+void AudioKernel_stereoTo8ch16(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    AudioKernel_get()->stereoTo8ch16(out, in, frames);
+}
+
+void AudioKernel_stereoTo8ch32(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    AudioKernel_get()->stereoTo8ch32(out, in, frames);
+}
+
+void AudioKernel_6chTo8ch16(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    AudioKernel_get()->sixChTo8ch16(out, in, frames);
+}
+
+void AudioKernel_6chTo8ch32(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    AudioKernel_get()->sixChTo8ch32(out, in, frames);
+}
+
+const char *AudioKernel_getName(void)
+{
+    return AudioKernel_get()->name;
+}
+
+} // end namespace android
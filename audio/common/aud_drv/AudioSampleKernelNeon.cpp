@@ -0,0 +1,238 @@
+#include "AudioSampleKernel.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define AUDIO_KERNEL_NEON
+#endif
+
+/*
+ * Built with -mfpu=neon on ARMv7 (.neon suffix in Android.mk), so nothing here
+ * may run before AudioSampleKernel.cpp checked HWCAP_NEON.
+ */
+
+namespace android
+{
+
+#if defined(AUDIO_KERNEL_NEON)
+// the remind of every loop goes through the scalar kernels bound before
+
+static audio_sample_kernel_t gScalarKernel;
+
+static void stereoToMonoDup16_neon(int16_t *stereo, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        int16x8x2_t x = vld2q_s16(stereo);
+        int16x8_t averageValue = vaddq_s16(vshrq_n_s16(x.val[0], 1), vshrq_n_s16(x.val[1], 1));
+        x.val[0] = averageValue;
+        x.val[1] = averageValue;
+        vst2q_s16(stereo, x);
+        stereo += 16;
+    }
+    gScalarKernel.stereoToMonoDup16(stereo, frames - i);
+}
+
+static void stereoToMonoDup32_neon(int32_t *stereo, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        int32x4x2_t x = vld2q_s32(stereo);
+        int32x4_t averageValue = vaddq_s32(vshrq_n_s32(x.val[0], 1), vshrq_n_s32(x.val[1], 1));
+        x.val[0] = averageValue;
+        x.val[1] = averageValue;
+        vst2q_s32(stereo, x);
+        stereo += 8;
+    }
+    gScalarKernel.stereoToMonoDup32(stereo, frames - i);
+}
+
+static void downmix16_neon(int16_t *mono, const int16_t *stereo, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        int16x8x2_t x = vld2q_s16(stereo);
+        vst1q_s16(mono, vhaddq_s16(x.val[0], x.val[1])); // (L + R) >> 1 without overflow
+        mono += 8;
+        stereo += 16;
+    }
+    gScalarKernel.downmix16(mono, stereo, frames - i);
+}
+
+static void selectChannel16_neon(int16_t *mono, const int16_t *stereo, uint32_t frames, uint32_t channel)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        int16x8x2_t x = vld2q_s16(stereo);
+        vst1q_s16(mono, (channel == 0) ? x.val[0] : x.val[1]);
+        mono += 8;
+        stereo += 16;
+    }
+    gScalarKernel.selectChannel16(mono, stereo, frames - i, channel);
+}
+
+static void crossmix16_neon(int16_t *stereo, uint32_t frames, uint32_t fromChannel)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        int16x8x2_t x = vld2q_s16(stereo);
+        x.val[fromChannel ^ 1] = x.val[fromChannel];
+        vst2q_s16(stereo, x);
+        stereo += 16;
+    }
+    gScalarKernel.crossmix16(stereo, frames - i, fromChannel);
+}
+
+static void upmix16_neon(int16_t *stereo, const int16_t *mono, uint32_t frames)
+{
+    // backwards in blocks of 8, a block is loaded before its output is stored
+    uint32_t i = frames;
+    for (; i >= 8; i -= 8)
+    {
+        int16x8x2_t x;
+        x.val[0] = vld1q_s16(mono + i - 8);
+        x.val[1] = x.val[0];
+        vst2q_s16(stereo + 2 * i - 16, x);
+    }
+    gScalarKernel.upmix16(stereo, mono, i);
+}
+
+static void q15ToQ31_neon(int32_t *out, const int16_t *in, uint32_t samples)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        int16x8_t x = vld1q_s16(in + i);
+        vst1q_s32(out + i, vshll_n_s16(vget_low_s16(x), 16));
+        vst1q_s32(out + i + 4, vshll_n_s16(vget_high_s16(x), 16));
+    }
+    gScalarKernel.q15ToQ31(out + i, in + i, samples - i);
+}
+
+static void q31ToQ15_neon(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        int32x4_t x0 = vld1q_s32(in + i);
+        int32x4_t x1 = vld1q_s32(in + i + 4);
+        vst1q_s16(out + i, vcombine_s16(vshrn_n_s32(x0, 16), vshrn_n_s32(x1, 16)));
+    }
+    gScalarKernel.q31ToQ15(out + i, in + i, samples - i);
+}
+
+static void q9p23ToQ15_neon(int16_t *out, const int32_t *in, uint32_t samples)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        int32x4_t x0 = vld1q_s32(in + i);
+        int32x4_t x1 = vld1q_s32(in + i + 4);
+        vst1q_s16(out + i, vcombine_s16(vshrn_n_s32(x0, 8), vshrn_n_s32(x1, 8))); // truncating narrow
+    }
+    gScalarKernel.q9p23ToQ15(out + i, in + i, samples - i);
+}
+
+static void stereoTo8ch16_neon(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    // a stereo 16 bit frame is one 32 bit lane, vst4 writes every lane 4 times in a row
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        uint32x4x4_t x;
+        x.val[0] = vld1q_u32((const uint32_t *)in);
+        x.val[1] = x.val[0];
+        x.val[2] = x.val[0];
+        x.val[3] = x.val[0];
+        vst4q_u32((uint32_t *)out, x);
+        out += 32;
+        in += 8;
+    }
+    gScalarKernel.stereoTo8ch16(out, in, frames - i);
+}
+
+static void stereoTo8ch32_neon(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    uint32_t i = 0;
+    for (; i + 2 <= frames; i += 2)
+    {
+        int32x4_t x = vld1q_s32(in);
+        int32x4_t frame0 = vcombine_s32(vget_low_s32(x), vget_low_s32(x));
+        int32x4_t frame1 = vcombine_s32(vget_high_s32(x), vget_high_s32(x));
+        vst1q_s32(out, frame0);
+        vst1q_s32(out + 4, frame0);
+        vst1q_s32(out + 8, frame1);
+        vst1q_s32(out + 12, frame1);
+        out += 16;
+        in += 4;
+    }
+    gScalarKernel.stereoTo8ch32(out, in, frames - i);
+}
+
+static void sixChTo8ch16_neon(int16_t *out, const int16_t *in, uint32_t frames)
+{
+    // channel pairs as 32 bit lanes: vld3 splits 4 frames into 3 pairs, vst4 adds the silent one
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        uint32x4x3_t x = vld3q_u32((const uint32_t *)in);
+        uint32x4x4_t y;
+        y.val[0] = x.val[0];
+        y.val[1] = x.val[1];
+        y.val[2] = x.val[2];
+        y.val[3] = vdupq_n_u32(0);
+        vst4q_u32((uint32_t *)out, y);
+        out += 32;
+        in += 24;
+    }
+    gScalarKernel.sixChTo8ch16(out, in, frames - i);
+}
+
+static void sixChTo8ch32_neon(int32_t *out, const int32_t *in, uint32_t frames)
+{
+    const int32x2_t zero = vdup_n_s32(0);
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        vst1q_s32(out, vld1q_s32(in));
+        vst1q_s32(out + 4, vcombine_s32(vld1_s32(in + 4), zero));
+        out += 8;
+        in += 6;
+    }
+}
+
+bool AudioKernel_bindNeon(audio_sample_kernel_t *kernel)
+{
+    AudioKernel_bindScalar(&gScalarKernel);
+
+    kernel->name = "neon";
+    kernel->stereoToMonoDup16 = stereoToMonoDup16_neon;
+    kernel->stereoToMonoDup32 = stereoToMonoDup32_neon;
+    kernel->downmix16 = downmix16_neon;
+    kernel->selectChannel16 = selectChannel16_neon;
+    kernel->crossmix16 = crossmix16_neon;
+    kernel->upmix16 = upmix16_neon;
+    kernel->q15ToQ31 = q15ToQ31_neon;
+    kernel->q31ToQ15 = q31ToQ15_neon;
+    kernel->q9p23ToQ15 = q9p23ToQ15_neon;
+    kernel->stereoTo8ch16 = stereoTo8ch16_neon;
+    kernel->stereoTo8ch32 = stereoTo8ch32_neon;
+    kernel->sixChTo8ch16 = sixChTo8ch16_neon;
+    kernel->sixChTo8ch32 = sixChTo8ch32_neon;
+    return true;
+}
+
+#else
+
+bool AudioKernel_bindNeon(audio_sample_kernel_t *kernel)
+{
+    (void)kernel;
+    return false;
+}
+
+#endif
+
+} // end namespace android
@@ -1,6 +1,10 @@
 #include "AudioUtility.h"
 
+#include <sys/uio.h>
+#include <cutils/atomic.h>
+
 #include "AudioLock.h"
+#include "AudioSPSCRingBuf.h"
 #include "audio_custom_exp.h"
 
 extern "C" {
@@ -340,24 +344,45 @@ void RingBuf_writeDataValue(RingBuf *RingBuf1, const int value, const int count)
 
 //--------pc dump operation
 
-struct BufferDump
+/*
+ * Every dump file owns a pre-allocated slab. Audio threads copy into it without
+ * locking or allocating and drop the buffer when it does not fit; the dump
+ * thread drains all slabs with large writev() calls.
+ */
+static const uint32_t kPCMDumpSlabSize       = 512 * 1024; // ~2.7s of 48K stereo 16bit
+static const uint32_t kPCMDumpFileMax        = 32;
+static const uint32_t kPCMDumpWriteChunk     = 64 * 1024;  // write earlier than this only when idle
+static const uint32_t kPCMDumpWriterPeriodMs = 20;
+static const uint32_t kPCMDumpFlushPeriod    = 10;         // writer periods before a partial chunk is written
+static const uint32_t kPCMDumpIdleWaitMs     = 1000;
+
+enum pcm_dump_slot_state_t
 {
-    void *pBufBase;
-    int ssize_t;
+    PCM_DUMP_SLOT_FREE = 0,
+    PCM_DUMP_SLOT_OPEN,
+    PCM_DUMP_SLOT_CLOSING,
+};
+
+struct PCMDumpSlot
+{
+    volatile int32_t state;
+    volatile int32_t producerBusy; // one producer at a time, a second one drops instead of waiting
+    FILE *file;
+    int fd;
+    AudioSPSCRingBuf slab;
+    uint32_t idleCount;            // writer only
+    volatile int32_t dropCount;
+    volatile int32_t dropBytes;
+    int32_t reportedDropCount;     // writer only
 };
 
-#if defined(PC_EMULATION)
-HANDLE hPCMDumpThread = NULL;
-HANDLE PCMDataNotifyEvent = NULL;
-#else
 pthread_t hPCMDumpThread = NULL;
-pthread_cond_t  PCMDataNotifyEvent;
-pthread_mutex_t PCMDataNotifyMutex;
-#endif
+pthread_cond_t  PCMDataNotifyEvent = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t PCMDataNotifyMutex = PTHREAD_MUTEX_INITIALIZER;
+volatile int32_t mPCMDumpWriterIdle = 0;
 
-AudioLock mPCMDumpMutex; // use for PCM buffer dump
-KeyedVector<FILE *, Vector<BufferDump *> *> mDumpFileHandleVector; // vector to save current recording client
-uint32_t mSleepTime = 2;
+AudioLock mPCMDumpMutex; // open / close / writer, AudioDumpPCMData() only takes it without a dump thread
+static PCMDumpSlot mPCMDumpSlot[kPCMDumpFileMax];
 
 void *PCMDumpThread(void *arg);
 
@@ -390,6 +415,59 @@ int AudiocheckAndCreateDirectory(const char *pC)
 bool bDumpStreamOutFlg = false;
 bool bDumpStreamInFlg = false;
 
+static PCMDumpSlot *AudioFindDumpSlot(const FILE *file)
+{
+    for (uint32_t i = 0; i < kPCMDumpFileMax; i++)
+    {
+        if (android_atomic_acquire_load(&mPCMDumpSlot[i].state) != PCM_DUMP_SLOT_FREE &&
+            mPCMDumpSlot[i].file == file)
+        {
+            return &mPCMDumpSlot[i];
+        }
+    }
+    return NULL;
+}
+
+// with mPCMDumpMutex held
+static void AudioWriteDumpSlot(PCMDumpSlot *slot, const bool flush)
+{
+    AudioRingBufView view;
+    uint32_t dataCount = slot->slab.getReadView(&view);
+
+    if (dataCount == 0)
+    {
+        slot->idleCount = 0;
+        return;
+    }
+    if (!flush && dataCount < kPCMDumpWriteChunk && ++slot->idleCount < kPCMDumpFlushPeriod)
+    {
+        return;
+    }
+    slot->idleCount = 0;
+
+    struct iovec iov[2];
+    iov[0].iov_base = view.pSeg[0];
+    iov[0].iov_len  = view.segLen[0];
+    iov[1].iov_base = view.pSeg[1];
+    iov[1].iov_len  = view.segLen[1];
+
+    ssize_t written = writev(slot->fd, iov, (view.segLen[1] > 0) ? 2 : 1);
+    if (written < 0)
+    {
+        ALOGE("PCMDumpThread writev fd %d fail, %s", slot->fd, strerror(errno));
+        written = dataCount; // discard, the file will not recover
+    }
+    slot->slab.commitRead(written);
+
+    int32_t dropCount = android_atomic_acquire_load(&slot->dropCount);
+    if (dropCount != slot->reportedDropCount)
+    {
+        ALOGW("PCMDumpThread file %p writer behind, dropped %d buffers / %d bytes so far",
+              slot->file, dropCount, android_atomic_acquire_load(&slot->dropBytes));
+        slot->reportedDropCount = dropCount;
+    }
+}
+
 FILE *AudioOpendumpPCMFile(const char *filepath, const char *propty)
 {
     char value[PROPERTY_VALUE_MAX];
@@ -417,55 +495,50 @@ FILE *AudioOpendumpPCMFile(const char *filepath, const char *propty)
             FILE *fp = fopen(filepath, "wb");
             if (fp != NULL)
             {
+                // all data goes through writev() on the fd
+                setvbuf(fp, NULL, _IONBF, 0);
 
                 mPCMDumpMutex.lock();
 
-                Vector<BufferDump *> *pBD = new Vector<BufferDump *>;
-                //ALOGD("AudioOpendumpPCMFile file=%p, pBD=%p",fp, pBD);
-                mDumpFileHandleVector.add(fp, pBD);
-                /*for (size_t i = 0; i < mDumpFileHandleVector.size() ; i++)
+                PCMDumpSlot *slot = NULL;
+                for (uint32_t i = 0; i < kPCMDumpFileMax; i++)
+                {
+                    if (mPCMDumpSlot[i].state == PCM_DUMP_SLOT_FREE)
+                    {
+                        slot = &mPCMDumpSlot[i];
+                        break;
+                    }
+                }
+
+                if (slot == NULL || slot->slab.init(kPCMDumpSlabSize) != NO_ERROR)
                 {
-                    ALOGD("AudioOpendumpPCMFile i=%d, handle=%p, %p",i,mDumpFileHandleVector.keyAt(i),mDumpFileHandleVector.valueAt(i));
-                }*/
+                    ALOGE("AudioOpendumpPCMFile %s no dump slot left", filepath);
+                    mPCMDumpMutex.unlock();
+                    fclose(fp);
+                    return NULL;
+                }
+                slot->file = fp;
+                slot->fd = fileno(fp);
+                slot->idleCount = 0;
+                slot->dropCount = 0;
+                slot->dropBytes = 0;
+                slot->reportedDropCount = 0;
+                android_atomic_release_store(0, &slot->producerBusy);
+                android_atomic_release_store(PCM_DUMP_SLOT_OPEN, &slot->state);
 
-                //ALOGD("AudioOpendumpPCMFile hPCMDumpThread=%p",hPCMDumpThread);
                 if (hPCMDumpThread == NULL)
                 {
-#if defined(PC_EMULATION)
-                    PCMDataNotifyEvent = CreateEvent(NULL, TRUE, FALSE, "PCMDataNotifyEvent");
-                    hPCMDumpThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)PCMDumpThread, NULL, 0, 0);
-                    if (hPCMDumpThread == 0)
-                    {
-                        ALOGE("hPCMDumpThread create fail!!!");
-                    }
-                    else
-                    {
-                        ALOGD("hPCMDumpThread=%p created", hPCMDumpThread);
-                    }
-#else
                     //create PCM data dump thread here
-                    int ret;
                     ret = pthread_create(&hPCMDumpThread, NULL, PCMDumpThread, NULL);
                     if (ret != 0)
                     {
                         ALOGE("hPCMDumpThread create fail!!!");
+                        hPCMDumpThread = NULL;
                     }
                     else
                     {
                         ALOGD("hPCMDumpThread=%p created", hPCMDumpThread);
                     }
-                    ret = pthread_cond_init(&PCMDataNotifyEvent, NULL);
-                    if (ret != 0)
-                    {
-                        ALOGE("PCMDataNotifyEvent create fail!!!");
-                    }
-
-                    ret = pthread_mutex_init(&PCMDataNotifyMutex, NULL);
-                    if (ret != 0)
-                    {
-                        ALOGE("PCMDataNotifyMutex create fail!!!");
-                    }
-#endif
                 }
                 mPCMDumpMutex.unlock();
                 return fp;
@@ -484,28 +557,29 @@ void AudioCloseDumpPCMFile(FILE  *file)
     if (file != NULL)
     {
         mPCMDumpMutex.lock();
-        //ALOGD("AudioCloseDumpPCMFile file=%p, HandleCount=%d",file,mDumpFileHandleVector.size());
-        if (mDumpFileHandleVector.size())
+        PCMDumpSlot *slot = AudioFindDumpSlot(file);
+        if (slot != NULL)
         {
-            for (size_t i = 0; i < mDumpFileHandleVector.size() ; i++)
+            android_atomic_release_store(PCM_DUMP_SLOT_CLOSING, &slot->state);
+
+            // wait for a producer still copying into the slab, it only holds it for a memcpy
+            while (android_atomic_acquire_cas(0, 1, &slot->producerBusy) != 0)
             {
-                //ALOGD("AudioCloseDumpPCMFile i=%d, handle=%p",i,mDumpFileHandleVector.keyAt(i));
-                if (file == mDumpFileHandleVector.keyAt(i))
-                {
-                    FILE *key = mDumpFileHandleVector.keyAt(i);
-                    while ((* mDumpFileHandleVector.valueAt(i)).size() != 0)
-                    {
-                        free((* mDumpFileHandleVector.valueAt(i))[0]->pBufBase);
-                        delete(* mDumpFileHandleVector.valueAt(i))[0];
-                        (* mDumpFileHandleVector.valueAt(i)).removeAt(0);
-                    }
-                    delete mDumpFileHandleVector.valueAt(i);
-                    mDumpFileHandleVector.removeItem(key);
-                }
+                sched_yield();
             }
-        }
 
+            AudioWriteDumpSlot(slot, true);
+            if (slot->dropCount > 0)
+            {
+                ALOGW("AudioCloseDumpPCMFile file=%p dropped %d buffers / %d bytes", file, slot->dropCount, slot->dropBytes);
+            }
+            slot->slab.deinit();
+            slot->file = NULL;
+            slot->fd = -1;
+            android_atomic_release_store(PCM_DUMP_SLOT_FREE, &slot->state);
+        }
         mPCMDumpMutex.unlock();
+
         fclose(file);
         file = NULL;
     }
@@ -517,106 +591,88 @@ void AudioCloseDumpPCMFile(FILE  *file)
 
 void AudioDumpPCMData(void *buffer , uint32_t bytes, FILE  *file)
 {
-    if (hPCMDumpThread != NULL)
+    PCMDumpSlot *slot = AudioFindDumpSlot(file);
+    if (slot == NULL || hPCMDumpThread == NULL)
     {
+        // no dump thread: write directly, but only while close cannot run, and drop data of unknown files
         mPCMDumpMutex.lock();
-        if (mDumpFileHandleVector.size())
+        slot = AudioFindDumpSlot(file);
+        if (slot != NULL && android_atomic_acquire_load(&slot->state) == PCM_DUMP_SLOT_OPEN)
         {
-            for (size_t i = 0; i < mDumpFileHandleVector.size() ; i++)
-            {
-                if (file == mDumpFileHandleVector.keyAt(i))
-                {
-                    FILE *key = mDumpFileHandleVector.keyAt(i);
-                    //ALOGD("AudioDumpPCMData find!! i=%d, key=%p, value=%p",i,mDumpFileHandleVector.keyAt(i),mDumpFileHandleVector.valueAt(i));
-                    BufferDump *newInBuffer = new BufferDump;
-                    newInBuffer->pBufBase = (short *) malloc(bytes);
-                    memcpy(newInBuffer->pBufBase, buffer, bytes);
-                    newInBuffer->ssize_t = bytes;
-                    (* mDumpFileHandleVector.valueAt(i)).add(newInBuffer);
-
-                    if (mSleepTime == -1) //need to send event
-                    {
-#if defined(PC_EMULATION)
-                        SetEvent(PCMDataNotifyEvent);
-#else
-                        pthread_mutex_lock(&PCMDataNotifyMutex);
-                        pthread_cond_signal(&PCMDataNotifyEvent);
-                        pthread_mutex_unlock(&PCMDataNotifyMutex);
-#endif
-                    }
-                }
-            }
+            fwrite((void *)buffer, sizeof(char), bytes, file);
         }
         mPCMDumpMutex.unlock();
+        return;
+    }
+
+    if (android_atomic_acquire_cas(0, 1, &slot->producerBusy) != 0)
+    {
+        android_atomic_inc(&slot->dropCount);
+        android_atomic_add(bytes, &slot->dropBytes);
+        return;
     }
-    else    //if no dump thread, just write the data
+
+    if (slot->file == file && android_atomic_acquire_load(&slot->state) == PCM_DUMP_SLOT_OPEN)
     {
-        fwrite((void *)buffer, sizeof(char), bytes, file);
+        // whole buffers only, a partial one would shift the sample alignment of the dump
+        if (slot->slab.getFreeSpace() >= bytes)
+        {
+            slot->slab.write(buffer, bytes);
+        }
+        else
+        {
+            android_atomic_inc(&slot->dropCount);
+            android_atomic_add(bytes, &slot->dropBytes);
+        }
     }
+    android_atomic_release_store(0, &slot->producerBusy);
 
+    // lost wakeups are bounded by kPCMDumpIdleWaitMs, far below the slab length
+    if (android_atomic_acquire_load(&mPCMDumpWriterIdle) != 0)
+    {
+        pthread_cond_signal(&PCMDataNotifyEvent);
+    }
 }
 
 void *PCMDumpThread(void *arg)
 {
     ALOGD("PCMDumpThread");
     bool bHasdata = false;
-    int iNoDataCount = 0;
     while (1)
     {
         mPCMDumpMutex.lock();
         bHasdata = false;
-        //ALOGV( "PCMDumpThread mDumpFileHandleVector.size()=%d",mDumpFileHandleVector.size());
-        for (size_t i = 0; i < mDumpFileHandleVector.size() ; i++)
+        for (uint32_t i = 0; i < kPCMDumpFileMax; i++)
         {
-
-            if ((* mDumpFileHandleVector.valueAt(i)).size() > 0)
+            PCMDumpSlot *slot = &mPCMDumpSlot[i];
+            if (android_atomic_acquire_load(&slot->state) != PCM_DUMP_SLOT_OPEN)
+            {
+                continue;
+            }
+            if (slot->slab.getDataCount() > 0)
             {
                 bHasdata = true;
-                fwrite((* mDumpFileHandleVector.valueAt(i))[0]->pBufBase, (* mDumpFileHandleVector.valueAt(i))[0]->ssize_t, 1, mDumpFileHandleVector.keyAt(i));
-                free((* mDumpFileHandleVector.valueAt(i))[0]->pBufBase);
-                delete(* mDumpFileHandleVector.valueAt(i))[0];
-                (* mDumpFileHandleVector.valueAt(i)).removeAt(0);
             }
+            AudioWriteDumpSlot(slot, false);
         }
         mPCMDumpMutex.unlock();
+
         if (!bHasdata)
         {
-            iNoDataCount++;
-            if (iNoDataCount >= 1000)
-            {
-                mSleepTime = -1;
-                ALOGD("PCMDumpThread, wait for new data dump\n");
-#if defined(PC_EMULATION)
-                WaitForSingleObject(PCMDataNotifyEvent, INFINITE);
-                ResetEvent(PCMDataNotifyEvent);
-#else
-                pthread_mutex_lock(&PCMDataNotifyMutex);
-                pthread_cond_wait(&PCMDataNotifyEvent, &PCMDataNotifyMutex);
-                pthread_mutex_unlock(&PCMDataNotifyMutex);
-                ALOGD("PCMDumpThread, PCM data dump again\n");
-#endif
-            }
-            else
-            {
-                mSleepTime = 10;
-                usleep(mSleepTime * 1000);
-            }
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += kPCMDumpIdleWaitMs / 1000;
+
+            android_atomic_release_store(1, &mPCMDumpWriterIdle);
+            pthread_mutex_lock(&PCMDataNotifyMutex);
+            pthread_cond_timedwait(&PCMDataNotifyEvent, &PCMDataNotifyMutex, &ts);
+            pthread_mutex_unlock(&PCMDataNotifyMutex);
+            android_atomic_release_store(0, &mPCMDumpWriterIdle);
         }
         else
         {
-            iNoDataCount = 0;
-            mSleepTime = 2;
-            usleep(mSleepTime * 1000);
+            usleep(kPCMDumpWriterPeriodMs * 1000);
         }
-        /*
-                if(mDumpFileHandleVector.size()==0)
-                {
-                    ALOGD( "PCMDumpThread exit, no dump handle real");
-                    hPCMDumpThread = NULL;
-                    pthread_exit(NULL);
-                    return 0;
-                }*/
-
     }
 
     ALOGD("PCMDumpThread exit hPCMDumpThread=%p", hPCMDumpThread);
@@ -78,6 +78,30 @@ class AudioMTKFilter_VibSpkAddTone
 
 };
 
+/**
+ * One step of the post processing chain of AudioMTKFilterManager.
+ * A filter stage runs an AudioMTKFilter from in to out, the tone stage adds the
+ * vibration speaker tone to the output of the stage before it.
+ */
+enum filter_stage_type_t
+{
+    FILTER_STAGE_FILTER,
+    FILTER_STAGE_VIBSPK_TONE,
+};
+
+struct filter_stage_t
+{
+    filter_stage_type_t type;
+    AudioMTKFilter *filter;     // FILTER_STAGE_FILTER only
+};
+
+struct filter_chain_t
+{
+    enum { kMaxStage = 4 };
+    filter_stage_t stage[kMaxStage];
+    uint32_t stageCount;
+};
+
 class AudioMTKFilterManager
 {
     public:
@@ -100,6 +124,9 @@ class AudioMTKFilterManager
         AudioMTKFilterManager(const AudioMTKFilterManager &);
         AudioMTKFilterManager &operator=(const AudioMTKFilterManager &);
         bool init();
+        void compileChain(uint32_t devices, filter_chain_t *chain);
+        void addFilterStage(filter_chain_t *chain, AudioMTKFilter *filter);
+        void addToneStage(filter_chain_t *chain);
         uint32_t        mSamplerate;
         uint32_t        mChannel;
         uint32_t        mFormat;
@@ -114,6 +141,12 @@ class AudioMTKFilterManager
         //#endif
         uint8_t        *mBuffer;
         uint32_t        mDevices;
+
+        // compiled at setDevice(), process() reads mChain[mChainIndex] only and
+        // holds mChainUser[] of that slot so setDevice() does not recompile it under it
+        filter_chain_t  mChain[2];
+        volatile int32_t mChainIndex;
+        volatile int32_t mChainUser[2];
 };
 
 }
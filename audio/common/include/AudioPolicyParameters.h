@@ -13,6 +13,7 @@ enum PolicyParameters
     POLICY_SET_LOSSLESS_BT_STATUS,
     POLICY_SET_CROSSMOUNT_LOCAL_PLAYBACK, //For MTK_CROSSMOUNT_SUPPORT
     POLICY_SET_CROSSMOUNT_MIC_LOCAL_PLAYBACK, //For MTK_CROSSMOUNT_SUPPORT
+    POLICY_TEST_COMMAND, //For AUDIO_POLICY_TEST, test_cmd_policy is set in HAL
 };
 
 enum FMStatus
@@ -0,0 +1,250 @@
+#ifndef ANDROID_AUDIO_SPSC_RING_BUF_H
+#define ANDROID_AUDIO_SPSC_RING_BUF_H
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <cutils/atomic.h>
+#include <utils/Errors.h>
+
+#include "AudioUtility.h"
+#include "AudioAssert.h"
+
+namespace android
+{
+
+/**
+ * Two contiguous segments of a ring buffer, the second one is used only when
+ * the region wraps around the end of the buffer
+ */
+struct AudioRingBufView
+{
+    char    *pSeg[2];
+    uint32_t segLen[2];
+
+    inline uint32_t size() const { return segLen[0] + segLen[1]; }
+};
+
+
+/**
+ * Single-producer / single-consumer ring buffer.
+ * The producer only moves mWrite and the consumer only moves mRead, so the two
+ * threads never need a lock. Indices run freely and are masked on access,
+ * which needs a power-of-two size but lets the whole buffer be filled.
+ */
+class AudioSPSCRingBuf
+{
+    public:
+        AudioSPSCRingBuf();
+        ~AudioSPSCRingBuf();
+
+        // size is rounded up to power of two
+        status_t    init(const uint32_t size);
+        void        deinit();
+
+        // only when neither producer nor consumer is running
+        void        reset();
+
+        inline uint32_t getBufferSize() const { return mSize; }
+
+        // either side
+        uint32_t    getDataCount() const;
+        uint32_t    getFreeSpace() const;
+
+        // producer side
+        uint32_t    getWriteView(AudioRingBufView *view) const;
+        void        commitWrite(const uint32_t bytes);
+        uint32_t    write(const void *buffer, const uint32_t bytes);
+        uint32_t    writeFromRingBuf(RingBuf *src, const uint32_t bytes);
+
+        // consumer side
+        uint32_t    getReadView(AudioRingBufView *view) const;
+        void        commitRead(const uint32_t bytes);
+        uint32_t    read(void *buffer, const uint32_t bytes);
+
+        // consumer of this ring and producer of target
+        uint32_t    copyToRingBuf(AudioSPSCRingBuf *target, const uint32_t bytes);
+
+    private:
+        // A ring buffer cannot be copied
+        AudioSPSCRingBuf(const AudioSPSCRingBuf &);
+        AudioSPSCRingBuf &operator = (const AudioSPSCRingBuf &);
+
+        void        fillView(AudioRingBufView *view, const uint32_t index, const uint32_t bytes) const;
+
+        char    *mBufBase;
+        uint32_t mSize;
+        uint32_t mMask;
+
+        volatile int32_t mWrite; // written by producer only
+        volatile int32_t mRead;  // written by consumer only
+};
+
+
+// ---------------------------------------------------------------------------
+
+inline AudioSPSCRingBuf::AudioSPSCRingBuf() :
+    mBufBase(NULL),
+    mSize(0),
+    mMask(0),
+    mWrite(0),
+    mRead(0)
+{
+}
+
+inline AudioSPSCRingBuf::~AudioSPSCRingBuf()
+{
+    deinit();
+}
+
+inline status_t AudioSPSCRingBuf::init(const uint32_t size)
+{
+    ASSERT(mBufBase == NULL);
+
+    uint32_t pow2 = 1;
+    while (pow2 < size)
+    {
+        pow2 <<= 1;
+    }
+
+    mBufBase = new char[pow2];
+    if (mBufBase == NULL)
+    {
+        return NO_MEMORY;
+    }
+    mSize = pow2;
+    mMask = pow2 - 1;
+    reset();
+    return NO_ERROR;
+}
+
+inline void AudioSPSCRingBuf::deinit()
+{
+    if (mBufBase != NULL)
+    {
+        delete[] mBufBase;
+        mBufBase = NULL;
+    }
+    mSize = 0;
+    mMask = 0;
+    reset();
+}
+
+inline void AudioSPSCRingBuf::reset()
+{
+    android_atomic_release_store(0, &mWrite);
+    android_atomic_release_store(0, &mRead);
+}
+
+inline uint32_t AudioSPSCRingBuf::getDataCount() const
+{
+    return (uint32_t)android_atomic_acquire_load(&mWrite) - (uint32_t)android_atomic_acquire_load(&mRead);
+}
+
+inline uint32_t AudioSPSCRingBuf::getFreeSpace() const
+{
+    return mSize - getDataCount();
+}
+
+inline void AudioSPSCRingBuf::fillView(AudioRingBufView *view, const uint32_t index, const uint32_t bytes) const
+{
+    const uint32_t offset = index & mMask;
+    const uint32_t toEnd = mSize - offset;
+
+    view->pSeg[0] = mBufBase + offset;
+    view->segLen[0] = (bytes <= toEnd) ? bytes : toEnd;
+    view->pSeg[1] = mBufBase;
+    view->segLen[1] = bytes - view->segLen[0];
+}
+
+inline uint32_t AudioSPSCRingBuf::getWriteView(AudioRingBufView *view) const
+{
+    const uint32_t write = (uint32_t)mWrite; // own index
+    const uint32_t space = mSize - (write - (uint32_t)android_atomic_acquire_load(&mRead));
+    fillView(view, write, space);
+    return space;
+}
+
+inline void AudioSPSCRingBuf::commitWrite(const uint32_t bytes)
+{
+    ASSERT(bytes <= getFreeSpace());
+    android_atomic_release_store((int32_t)((uint32_t)mWrite + bytes), &mWrite);
+}
+
+inline uint32_t AudioSPSCRingBuf::write(const void *buffer, const uint32_t bytes)
+{
+    AudioRingBufView view;
+    const uint32_t space = getWriteView(&view);
+    const uint32_t count = (bytes <= space) ? bytes : space;
+    const uint32_t first = (count <= view.segLen[0]) ? count : view.segLen[0];
+
+    memcpy(view.pSeg[0], buffer, first);
+    memcpy(view.pSeg[1], (const char *)buffer + first, count - first);
+    commitWrite(count);
+    return count;
+}
+
+inline uint32_t AudioSPSCRingBuf::writeFromRingBuf(RingBuf *src, const uint32_t bytes)
+{
+    const uint32_t dataCount = RingBuf_getDataCount(src);
+    const uint32_t count = (bytes <= dataCount) ? bytes : dataCount;
+    const char *end = src->pBufBase + src->bufLen;
+    const uint32_t first = (src->pRead + count <= end) ? count : (uint32_t)(end - src->pRead);
+
+    uint32_t written = write(src->pRead, first);
+    if (written == first && count > first)
+    {
+        written += write(src->pBufBase, count - first);
+    }
+
+    src->pRead = src->pBufBase + ((src->pRead - src->pBufBase) + written) % src->bufLen;
+    return written;
+}
+
+inline uint32_t AudioSPSCRingBuf::getReadView(AudioRingBufView *view) const
+{
+    const uint32_t read = (uint32_t)mRead; // own index
+    const uint32_t count = (uint32_t)android_atomic_acquire_load(&mWrite) - read;
+    fillView(view, read, count);
+    return count;
+}
+
+inline void AudioSPSCRingBuf::commitRead(const uint32_t bytes)
+{
+    ASSERT(bytes <= getDataCount());
+    android_atomic_release_store((int32_t)((uint32_t)mRead + bytes), &mRead);
+}
+
+inline uint32_t AudioSPSCRingBuf::read(void *buffer, const uint32_t bytes)
+{
+    AudioRingBufView view;
+    const uint32_t dataCount = getReadView(&view);
+    const uint32_t count = (bytes <= dataCount) ? bytes : dataCount;
+    const uint32_t first = (count <= view.segLen[0]) ? count : view.segLen[0];
+
+    memcpy(buffer, view.pSeg[0], first);
+    memcpy((char *)buffer + first, view.pSeg[1], count - first);
+    commitRead(count);
+    return count;
+}
+
+inline uint32_t AudioSPSCRingBuf::copyToRingBuf(AudioSPSCRingBuf *target, const uint32_t bytes)
+{
+    AudioRingBufView view;
+    const uint32_t dataCount = getReadView(&view);
+    uint32_t count = (bytes <= dataCount) ? bytes : dataCount;
+    const uint32_t first = (count <= view.segLen[0]) ? count : view.segLen[0];
+
+    uint32_t copied = target->write(view.pSeg[0], first);
+    if (copied == first && count > first)
+    {
+        copied += target->write(view.pSeg[1], count - first);
+    }
+    commitRead(copied);
+    return copied;
+}
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_SPSC_RING_BUF_H
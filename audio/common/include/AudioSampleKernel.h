@@ -0,0 +1,80 @@
+#ifndef ANDROID_AUDIO_SAMPLE_KERNEL_H
+#define ANDROID_AUDIO_SAMPLE_KERNEL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android
+{
+
+/**
+ * Sample kernels shared by playback handlers and capture clients.
+ * The implementation is picked once at first use: NEON on ARM, SSE2 on x86 host
+ * builds, scalar otherwise. Every variant is bit exact with the scalar one.
+ */
+
+// stereo in place, both channels become (L >> 1) + (R >> 1)
+void AudioKernel_stereoToMonoDup16(int16_t *stereo, uint32_t frames);
+void AudioKernel_stereoToMonoDup32(int32_t *stereo, uint32_t frames);
+
+// stereo to mono (L + R) >> 1, mono may be the same buffer as stereo
+void AudioKernel_downmix16(int16_t *mono, const int16_t *stereo, uint32_t frames);
+
+// stereo to mono keeping channel 0 (L) or 1 (R), mono may be the same buffer as stereo
+void AudioKernel_selectChannel16(int16_t *mono, const int16_t *stereo, uint32_t frames, uint32_t channel);
+
+// stereo in place, copy channel 0 (L) or 1 (R) to the other one
+void AudioKernel_crossmix16(int16_t *stereo, uint32_t frames, uint32_t fromChannel);
+
+// mono to stereo, stereo may be the same buffer as mono (processed backwards)
+void AudioKernel_upmix16(int16_t *stereo, const int16_t *mono, uint32_t frames);
+
+// Q1.15 to Q1.31, out must not overlap in
+void AudioKernel_q15ToQ31(int32_t *out, const int16_t *in, uint32_t samples);
+
+// Q1.31 to Q1.15 (truncate), out may be the same buffer as in
+void AudioKernel_q31ToQ15(int16_t *out, const int32_t *in, uint32_t samples);
+
+// 24 bit in 32 bit container (Q9.23) to Q1.15 (truncate), out may be the same buffer as in
+void AudioKernel_q9p23ToQ15(int16_t *out, const int32_t *in, uint32_t samples);
+
+// stereo to 8 channels, the stereo pair repeated on every channel pair, out must not overlap in
+void AudioKernel_stereoTo8ch16(int16_t *out, const int16_t *in, uint32_t frames);
+void AudioKernel_stereoTo8ch32(int32_t *out, const int32_t *in, uint32_t frames);
+
+// 6 to 8 channels, channels 6 and 7 are silent, out must not overlap in
+void AudioKernel_6chTo8ch16(int16_t *out, const int16_t *in, uint32_t frames);
+void AudioKernel_6chTo8ch32(int32_t *out, const int32_t *in, uint32_t frames);
+
+// name of the implementation in use, for logs
+const char *AudioKernel_getName(void);
+
+
+/**
+ * dispatch table, only for the implementation files
+ */
+struct audio_sample_kernel_t
+{
+    const char *name;
+    void (*stereoToMonoDup16)(int16_t *stereo, uint32_t frames);
+    void (*stereoToMonoDup32)(int32_t *stereo, uint32_t frames);
+    void (*downmix16)(int16_t *mono, const int16_t *stereo, uint32_t frames);
+    void (*selectChannel16)(int16_t *mono, const int16_t *stereo, uint32_t frames, uint32_t channel);
+    void (*crossmix16)(int16_t *stereo, uint32_t frames, uint32_t fromChannel);
+    void (*upmix16)(int16_t *stereo, const int16_t *mono, uint32_t frames);
+    void (*q15ToQ31)(int32_t *out, const int16_t *in, uint32_t samples);
+    void (*q31ToQ15)(int16_t *out, const int32_t *in, uint32_t samples);
+    void (*q9p23ToQ15)(int16_t *out, const int32_t *in, uint32_t samples);
+    void (*stereoTo8ch16)(int16_t *out, const int16_t *in, uint32_t frames);
+    void (*stereoTo8ch32)(int32_t *out, const int32_t *in, uint32_t frames);
+    void (*sixChTo8ch16)(int16_t *out, const int16_t *in, uint32_t frames);
+    void (*sixChTo8ch32)(int32_t *out, const int32_t *in, uint32_t frames);
+};
+
+// fills the scalar table, then lets the SIMD variants override what they have
+void AudioKernel_bindScalar(audio_sample_kernel_t *kernel);
+bool AudioKernel_bindNeon(audio_sample_kernel_t *kernel); // false when built without NEON
+
+} // end namespace android
+
+#endif // end of ANDROID_AUDIO_SAMPLE_KERNEL_H
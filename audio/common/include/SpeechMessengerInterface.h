@@ -6,6 +6,7 @@
 #include "AudioType.h"
 #include "SpeechType.h"
 #include "AudioUtility.h"
+#include "SpeechCCCIType.h"
 
 #include "SpeechBGSPlayer.h"
 #include "SpeechPcm2way.h"
@@ -13,28 +14,8 @@
 namespace android
 {
 
-#define CCCI_BUF_HEADER_SIZE 16
-//EEMCS MTU 3584-128 = 3456 byte
-#define CCCI_MAX_PAYLOAD_SIZE 860 //(3456-16)/4 = 860
-/** CCCI buffer structure */
-typedef struct
-{
-    uint32_t magic;
-    uint32_t message; // message[31:16] = id, message[15:0] = parameters
-    uint32_t channel;
-    uint32_t reserved;
-    uint32_t payload[CCCI_MAX_PAYLOAD_SIZE];
-} ccci_buff_t;
 /** CCCI driver & ioctl */
 
-/** CCCI message need/no need ack type */
-enum ccci_message_ack_t
-{
-    MESSAGE_BYPASS_ACK = 0,
-    MESSAGE_NEED_ACK   = 1,
-    MESSAGE_CANCELED   = 8
-};
-
 /** CCCI message queue structure */
 typedef struct ccci_queue_element_t
 {
@@ -56,41 +37,6 @@ enum speech_param_ack_t
 };
 
 
-/** CCCI share buffer related infomation */
-const size_t CCCI_SHARE_BUFF_HEADER_LEN = 6;
-const size_t CCCI_PAYLOAD_BUFF_HEADER_LEN = 10;
-const size_t CCCI_RAW_PCM_BUFF_HEADER_LEN = 8;
-
-enum share_buff_sync_t
-{
-    CCCI_A2M_SHARE_BUFF_HEADER_SYNC = 0xA2A2,
-    CCCI_M2A_SHARE_BUFF_HEADER_SYNC = 0x2A2A,
-    EEMCS_M2A_SHARE_BUFF_HEADER_SYNC = 0x1234
-};
-enum share_buff_data_type_t
-{
-    SHARE_BUFF_DATA_TYPE_PCM_FillSE = 0,
-    SHARE_BUFF_DATA_TYPE_PCM_FillSpk,
-    SHARE_BUFF_DATA_TYPE_PCM_GetFromMic,
-    SHARE_BUFF_DATA_TYPE_PCM_GetfromSD,
-    SHARE_BUFF_DATA_TYPE_CCCI_VM_TYPE,
-    SHARE_BUFF_DATA_TYPE_CCCI_PCM_TYPE,
-    SHARE_BUFF_DATA_TYPE_CCCI_BGS_TYPE,
-    SHARE_BUFF_DATA_TYPE_CCCI_EM_PARAM,
-    SHARE_BUFF_DATA_TYPE_CCCI_CTM_UL_IN,
-    SHARE_BUFF_DATA_TYPE_CCCI_CTM_DL_IN,
-    SHARE_BUFF_DATA_TYPE_CCCI_CTM_UL_OUT,
-    SHARE_BUFF_DATA_TYPE_CCCI_CTM_DL_OUT,
-    SHARE_BUFF_DATA_TYPE_CCCI_VIBSPK_PARAM,
-    SHARE_BUFF_DATA_TYPE_CCCI_NXP_SMARTPA_PARAM = 15,
-    SHARE_BUFF_DATA_TYPE_CCCI_MAGICON_PARAM,
-    SHARE_BUFF_DATA_TYPE_CCCI_HAC_PARAM,
-    SHARE_BUFF_DATA_TYPE_CCCI_RAW_PCM_TYPE,
-
-    SHARE_BUFF_DATA_TYPE_CCCI_DYNAMIC_PARAM_TYPE,
-    SHARE_BUFF_DATA_TYPE_CCCI_MAX_TYPE
-};
-
 //For VT case, the CCCI message for every 20ms, UL/DL have 2 CCCI message (Put to Speaker / Get from Mic)
 //For BGS off ack message, the worst case maybe pending 150 ms. And for other change device control. (BGSoff,2WAY off,SPH off,...)
 //The total message maybe > 20 for this period. So enlarge the total CCCI message queue.
@@ -111,9 +57,6 @@ const size_t A2M_SHARED_BUFFER_P2W_DL_DATA_END  = A2M_SHARED_BUFFER_P2W_DL_DATA_
 // Speech enhacement parameters // MAX => WB Param use 2416+6 bytes
 const size_t A2M_SHARED_BUFFER_SPH_PARAM_BASE = A2M_SHARED_BUFFER_P2W_DL_DATA_END;
 
-/* CCCI Message ID */
-const uint32_t CCCI_MSG_A2M_BASE = 0x2F00;
-const uint32_t CCCI_MSG_M2A_BASE = 0xAF00;
 
 class SpeechMessengerInterface
 {
@@ -232,153 +175,6 @@ class SpeechMessengerInterface
 
 };
 
-enum ccci_message_id_t
-{
-    //------------------ A2M -----------------------
-    MSG_A2M_SPH_DL_DIGIT_VOLUME = CCCI_MSG_A2M_BASE,
-    MSG_A2M_SPH_UL_DIGIT_VOLUME,
-    MSG_A2M_MUTE_SPH_UL,
-    MSG_A2M_MUTE_SPH_DL,
-    MSG_A2M_SIDETONE_VOLUME,
-    MSG_A2M_SPH_DL_ENH_REF_DIGIT_VOLUME,
-    MSG_A2M_SIDETONE_CONFIG, // Using modem SW STF or not
-    MSG_A2M_MUTE_SPH_UL_ENH_RESULT, 
-    MSG_A2M_MUTE_SPH_UL_SOURCE, 
-
-    MSG_A2M_SET_SAMPLE_RATE = CCCI_MSG_A2M_BASE | 0x10,
-
-    MSG_A2M_SPH_ON = CCCI_MSG_A2M_BASE | 0x20,
-    MSG_A2M_SPH_OFF,
-    MSG_A2M_SET_SPH_MODE,
-    MSG_A2M_CTRL_SPH_ENH,
-    MSG_A2M_CONFIG_SPH_ENH,
-    MSG_A2M_SET_ACOUSTIC_LOOPBACK,
-    MSG_A2M_PRINT_SPH_PARAM,
-    MSG_A2M_SPH_ON_FOR_HOLD_CALL, // speech on with mute, for call hold use, no any other application can be turn on
-    MSG_A2M_SPH_ON_FOR_DACA,
-    MSG_A2M_SPH_ROUTER_ON, // PCM wrouter on for enhancement and other application path.
-
-    MSG_A2M_PNW_ON = CCCI_MSG_A2M_BASE | 0x30,
-    MSG_A2M_PNW_OFF,
-    MSG_A2M_RECORD_ON,
-    MSG_A2M_RECORD_OFF,
-    MSG_A2M_DMNR_RECPLAY_ON,
-    MSG_A2M_DMNR_RECPLAY_OFF,
-    MSG_A2M_DMNR_REC_ONLY_ON,
-    MSG_A2M_DMNR_REC_ONLY_OFF,
-    MSG_A2M_PCM_REC_ON,
-    MSG_A2M_PCM_REC_OFF,
-    MSG_A2M_VM_REC_ON,
-    MSG_A2M_VM_REC_OFF,
-    MSG_A2M_RECORD_RAW_PCM_ON,
-    MSG_A2M_RECORD_RAW_PCM_OFF,
-
-    MSG_A2M_CTM_ON = CCCI_MSG_A2M_BASE | 0x40,
-    MSG_A2M_CTM_OFF,
-    MSG_A2M_CTM_DUMP_DEBUG_FILE,
-    MSG_A2M_BGSND_ON,
-    MSG_A2M_BGSND_OFF,
-    MSG_A2M_BGSND_CONFIG,
-
-    MSG_A2M_PNW_DL_DATA_NOTIFY = CCCI_MSG_A2M_BASE | 0x50,
-    MSG_A2M_BGSND_DATA_NOTIFY,
-    MSG_A2M_CTM_DATA_NOTIFY,
-
-    MSG_A2M_PNW_UL_DATA_READ_ACK = CCCI_MSG_A2M_BASE | 0x60,
-    MSG_A2M_REC_DATA_READ_ACK,
-    MSG_A2M_CTM_DEBUG_DATA_READ_ACK,
-    MSG_A2M_PCM_REC_DATA_READ_ACK,
-    MSG_A2M_VM_REC_DATA_READ_ACK,
-    MSG_A2M_DACA_DL_DATA_READ_ACK,
-    MSG_A2M_RAW_PCM_REC_DATA_READ_ACK,
-
-    MSG_A2M_EM_DATA_REQUEST_ACK = CCCI_MSG_A2M_BASE | 0x70,
-    MSG_A2M_EM_NB,
-    MSG_A2M_EM_DMNR,
-    MSG_A2M_EM_WB,
-    MSG_A2M_EM_MAGICON,
-    MSG_A2M_NETWORK_STATUS_ACK,
-    MSG_A2M_QUERY_RF_INFO,
-    MSG_A2M_EM_HAC,
-    MSG_A2M_EPOF_ACK,
-    MSG_A2M_EM_DYNAMIC_SPH,
-
-    MSG_A2M_VIBSPK_PARAMETER = CCCI_MSG_A2M_BASE | 0x80,
-    MSG_A2M_NXP_SMARTPA_PARAMETER,
-
-    //------------------- M2A ----------------------
-    MSG_M2A_SPH_DL_DIGIT_VOLUME_ACK = CCCI_MSG_M2A_BASE,
-    MSG_M2A_SPH_UL_DIGIT_VOLUME_ACK,
-    MSG_M2A_MUTE_SPH_UL_ACK,
-    MSG_M2A_MUTE_SPH_DL_ACK,
-    MSG_M2A_SIDETONE_VOLUME_ACK,
-    MSG_M2A_SPH_DL_ENH_REF_DIGIT_VOLUME_ACK, // just define, not used.
-    MSG_M2A_SIDETONE_CONFIG_ACK, // just define, not used.
-
-    MSG_M2A_SET_SAMPLE_RATE_ACK = CCCI_MSG_M2A_BASE + 0x10,
-
-
-    MSG_M2A_SPH_ON_ACK = CCCI_MSG_M2A_BASE + 0x20,
-    MSG_M2A_SPH_OFF_ACK,
-    MSG_M2A_SET_SPH_MODE_ACK,
-    MSG_M2A_CTRL_SPH_ENH_ACK,
-    MSG_M2A_CONFIG_SPH_ENH_ACK,
-    MSG_M2A_SET_ACOUSTIC_LOOPBACK_ACK,
-    MSG_M2A_PRINT_SPH_COEFF_ACK,
-    MSG_M2A_SPH_ON_FOR_HOLD_CALL_ACK,
-    MSG_M2A_SPH_ON_FOR_DACA_ACK,
-    MSG_M2A_SPH_ROUTER_ON_ACK,
-
-
-    MSG_M2A_PNW_ON_ACK = CCCI_MSG_M2A_BASE + 0x30,
-    MSG_M2A_PNW_OFF_ACK,
-    MSG_M2A_RECORD_ON_ACK,
-    MSG_M2A_RECORD_OFF_ACK,
-    MSG_M2A_DMNR_RECPLAY_ON_ACK,
-    MSG_M2A_DMNR_RECPLAY_OFF_ACK,
-    MSG_M2A_DMNR_REC_ONLY_ON_ACK,
-    MSG_M2A_DMNR_REC_ONLY_OFF_ACK,
-    MSG_M2A_PCM_REC_ON_ACK,
-    MSG_M2A_PCM_REC_OFF_ACK,
-    MSG_M2A_VM_REC_ON_ACK,
-    MSG_M2A_VM_REC_OFF_ACK,
-    MSG_M2A_RECORD_RAW_PCM_ON_ACK,
-    MSG_M2A_RECORD_RAW_PCM_OFF_ACK,
-
-    MSG_M2A_CTM_ON_ACK = CCCI_MSG_M2A_BASE + 0x40,
-    MSG_M2A_CTM_OFF_ACK,
-    MSG_M2A_CTM_DUMP_DEBUG_FILE_ACK,
-    MSG_M2A_BGSND_ON_ACK,
-    MSG_M2A_BGSND_OFF_ACK,
-    MSG_M2A_BGSND_CONFIG_ACK,
-
-    MSG_M2A_PNW_DL_DATA_REQUEST = CCCI_MSG_M2A_BASE + 0x50,
-    MSG_M2A_BGSND_DATA_REQUEST,
-    MSG_M2A_CTM_DATA_REQUEST,
-
-    MSG_M2A_PNW_UL_DATA_NOTIFY = CCCI_MSG_M2A_BASE + 0x60,
-    MSG_M2A_REC_DATA_NOTIFY,
-    MSG_M2A_CTM_DEBUG_DATA_NOTIFY,
-    MSG_M2A_PCM_REC_DATA_NOTIFY,
-    MSG_M2A_VM_REC_DATA_NOTIFY,
-    MSG_M2A_DACA_DL_DATA_NOTIFY,
-    MSG_M2A_RAW_PCM_REC_DATA_NOTIFY,
-
-    MSG_M2A_EM_DATA_REQUEST = CCCI_MSG_M2A_BASE + 0x70,
-    MSG_M2A_EM_NB_ACK,
-    MSG_M2A_EM_DMNR_ACK,
-    MSG_M2A_EM_WB_ACK,
-    MSG_M2A_EM_MAGICON_ACK,
-    MSG_M2A_NETWORK_STATUS_NOTIFY,
-    MSG_M2A_QUERY_RF_INFO_ACK,
-    MSG_M2A_EM_HAC_ACK,
-    MSG_M2A_EPOF_NOTIFY,
-    MSG_M2A_EM_DYNAMIC_SPH_ACK,
-
-    MSG_M2A_VIBSPK_PARAMETER_ACK = CCCI_MSG_M2A_BASE + 0x80,
-    MSG_M2A_NXP_SMARTPA_PARAMETER_ACK,
-};
-
 } // end namespace android
 
 #endif // end of ANDROID_SPEECH_MESSAGE_INTERFACE_H
@@ -9,6 +9,7 @@
 #include "AudioUtility.h"
 
 #include "AudioLock.h"
+#include "AudioSPSCRingBuf.h"
 
 namespace android
 {
@@ -47,15 +48,18 @@ class SpeechVMRecorder
 
         status_t OpenFile();
         static void *DumpVMRecordDataThread(void *arg);
+        void JoinRecordThread(); // without mMutex, the thread takes it to exit
         void TriggerVMRecord();
 
         bool mStarting;
         bool mEnable;
 
-        RingBuf mRingBuf; // Internal Input Buffer for Get VM data
+        AudioSPSCRingBuf mRingBuf; // CCCI read thread -> DumpVMRecordDataThread, no lock on either side
+        volatile int32_t mDropBytes;
         FILE *mDumpFile;
 
         pthread_t mRecordThread;
+        bool mRecordThreadCreated; // joinable, Close() waits for it
         AudioLock mMutex;
         AudioCondition mExitCond;
 
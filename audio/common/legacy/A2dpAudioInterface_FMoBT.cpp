@@ -59,6 +59,7 @@
 #include <utils/String8.h>
 
 #include "A2dpAudioInterface.h"
+#include "A2dpStreamPacer.h"
 
 #ifdef __BTMTK__
 #include "audio/liba2dp.h"
@@ -114,6 +115,40 @@ namespace android_audio_legacy
 static const char *sA2dpWakeLock = "A2dpOutputStream";
 #define MAX_WRITE_RETRIES  5
 
+// mixer buffers queued between AudioFlinger and the BT transport
+static const uint32_t kJitterBufferChunks = 4;
+
+// openOutputStream() allows a single A2DP output, so one pacer serves it
+static A2dpStreamPacer sStreamPacer;
+
+static ssize_t a2dpSend(void *data, const void *buffer, size_t bytes)
+{
+    size_t remaining = bytes;
+    int retries = MAX_WRITE_RETRIES;
+
+    while (remaining > 0 && retries)
+    {
+#ifdef __BTMTK__
+        ssize_t status = a2dp_write(data, buffer, remaining);
+#else
+        ssize_t status = remaining;
+#endif
+        if (status < 0)
+        {
+            ALOGE("a2dp_write failed err: %d\n", (int)status);
+            return status;
+        }
+        if (status == 0)
+        {
+            retries--;
+            LOG_A2DPINTERFACE("a2dp_write retry %d", retries);
+        }
+        remaining -= status;
+        buffer = (const char *)buffer + status;
+    }
+    return bytes - remaining;
+}
+
 // ----------------------------------------------------------------------------
 
 AudioHardwareInterface *A2dpAudioInterface::createA2dpInterface()
@@ -406,16 +441,12 @@ A2dpAudioInterface::A2dpAudioStreamOut::~A2dpAudioStreamOut()
 ssize_t A2dpAudioInterface::A2dpAudioStreamOut::write(const void *buffer, size_t bytes)
 {
     status_t status = -1;
-    size_t remaining = bytes;
-    nsecs_t t1, t2;
-    t1 = systemTime();
-    ALOGD("A2dpAudioStreamOut::write START \n");
     {
         if (!mBluetoothEnabled || mClosing || mSuspended)
         {
-            ALOGE("A2dpAudioStreamOut::write(), but bluetooth disabled \
+            LOG_A2DPINTERFACE("A2dpAudioStreamOut::write(), but bluetooth disabled \
                 mBluetoothEnabled %d, mClosing %d, mSuspended %d,",
-                  mBluetoothEnabled, mClosing, mSuspended);
+                              mBluetoothEnabled, mClosing, mSuspended);
             usleep(((bytes * 1000) / frameSize() / sampleRate()) * 1000);
             return status;
         }
@@ -446,12 +477,10 @@ ssize_t A2dpAudioInterface::A2dpAudioStreamOut::write(const void *buffer, size_t
         {
             acquire_wake_lock(PARTIAL_WAKE_LOCK, sA2dpWakeLock);
             mStandby = false;
-            mLastWriteTime = systemTime();
         }
 #ifdef DUMP_A2DPSTREAMOUT
         if (pA2dpinputFile != NULL)
         {
-            ALOGD("A2dpAudioStreamOut::write bytes = %d", bytes);
             int written = fwrite(buffer, 1, bytes, pA2dpinputFile);
         }
 #endif
@@ -462,61 +491,38 @@ ssize_t A2dpAudioInterface::A2dpAudioStreamOut::write(const void *buffer, size_t
             goto Error;
         }
 
+        // a2dp_write() runs on the pacer thread, write() only queues and keeps the clock
+        if (!sStreamPacer.isStarted())
+        {
+            status = sStreamPacer.start(a2dpSend, mData, sampleRate() * frameSize(), bufferSize(),
+                                        kJitterBufferChunks);
+            if (status != NO_ERROR)
+            {
+                goto Error;
+            }
+        }
+
         if (WriteMuteCounter)
         {
             WriteMuteCounter--;
             memset((void *)buffer, 0, bytes);
         }
 #if defined(DEBUG_AUDIO_PCM)
-        dumpPCMData(buffer, remaining);
+        dumpPCMData(buffer, bytes);
 #endif
 
-        int retries = MAX_WRITE_RETRIES;
-        ALOGD("a2dp_write loop start \n");
-
-        while (remaining > 0 && retries)
+        ssize_t written = sStreamPacer.write(buffer, bytes);
+        if (written < 0)
         {
-#ifdef __BTMTK__
-            //t1 = systemTime();
-            ALOGD("a2dp_write start \n");
-            status = a2dp_write(mData, buffer, remaining);
-            ALOGD("a2dp_write end \n");
-            //t2 = systemTime();
-            //ALOGD("a2dp_write consume %lld ns !!! \n", t2-t1);
-#endif
-            if (status < 0)
-            {
-                ALOGE("a2dp_write failed err: %d\n", status);
-                goto Error;
-            }
-            if (status == 0)
-            {
-                retries--;
-                ALOGD("a2dp_write retry %d !!! \n", retries);
-            }
-            remaining -= status;
-            buffer = (char *)buffer + status;
-        }
-        ALOGD("a2dp_write loop end \n");
-
-        // if A2DP sink runs abnormally fast, sleep a little so that audioflinger mixer thread
-        // does no spin and starve other threads.
-        // NOTE: It is likely that the A2DP headset is being disconnected
-        nsecs_t now = systemTime();
-        if ((uint32_t)ns2us(now - mLastWriteTime) < (mBufferDurationUs >> 2))
-        {
-            ALOGD("A2DP sink runs too fast, sleep %d us \n", (mBufferDurationUs - (uint32_t)ns2us(now - mLastWriteTime)));
-            usleep(mBufferDurationUs - (uint32_t)ns2us(now - mLastWriteTime));
+            status = written;
+            goto Error;
         }
-        mLastWriteTime = now;
-        t2 = systemTime();
-        ALOGD("A2dpAudioStreamOut::write END, consume %lld ns \n", t2 - t1);
-        return bytes;
+        return written;
 
     }
 Error:
 
-    ALOGD("A2dpAudioStreamOut::write ERR \n");
+    ALOGD("A2dpAudioStreamOut::write ERR %d", status);
 
     standby();
 
@@ -560,6 +566,9 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::standby_l()
 {
     int result = NO_ERROR;
 
+    // the pacer thread must be out of a2dp_write() before a2dp_stop() / a2dp_cleanup()
+    sStreamPacer.stop(!mClosing && mBluetoothEnabled && !mSuspended);
+
 #ifdef __BTMTK__
 
     if (!mStandby || mSuspended)
@@ -724,6 +733,7 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::close_l()
 
 status_t A2dpAudioInterface::A2dpAudioStreamOut::dump(int fd, const Vector<String16> &args)
 {
+    sStreamPacer.dump(fd);
     return NO_ERROR;
 }
 
@@ -0,0 +1,325 @@
+#include "A2dpStreamPacer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <utils/threads.h>
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "A2dpStreamPacer"
+#include <utils/Log.h>
+
+namespace android_audio_legacy
+{
+
+using namespace android;
+
+// chunks queued before the sender starts, again after an underrun
+static const uint32_t kPrimeChunks = 2;
+
+A2dpStreamPacer::A2dpStreamPacer() :
+    mSend(NULL),
+    mCookie(NULL),
+    mBytesPerSecond(1),
+    mChunkBytes(0),
+    mPrimeBytes(0),
+    mChunkNs(0),
+    mJitterNs(0),
+    mLeadNs(0),
+    mStarted(false),
+    mExit(false),
+    mDrain(false),
+    mError(NO_ERROR),
+    mAnchorNs(0),
+    mQueuedBytes(0)
+{
+    memset(&mStat, 0, sizeof(mStat));
+}
+
+A2dpStreamPacer::~A2dpStreamPacer()
+{
+    stop(false);
+    mRing.deinit();
+}
+
+status_t A2dpStreamPacer::start(a2dp_pacer_send_t send, void *cookie, const uint32_t bytesPerSecond,
+                                const uint32_t chunkBytes, const uint32_t numChunks)
+{
+    ASSERT(mStarted == false);
+    ASSERT(bytesPerSecond != 0 && chunkBytes != 0 && numChunks > kPrimeChunks);
+
+    // allocated once, the stream format does not change
+    if (mRing.getBufferSize() < chunkBytes * numChunks)
+    {
+        mRing.deinit();
+        if (mRing.init(chunkBytes * numChunks) != NO_ERROR)
+        {
+            ALOGE("%s(), jitter buffer %u bytes alloc fail", __FUNCTION__, chunkBytes * numChunks);
+            return NO_MEMORY;
+        }
+    }
+    mRing.reset();
+
+    mSend = send;
+    mCookie = cookie;
+    mBytesPerSecond = bytesPerSecond;
+    mChunkBytes = chunkBytes;
+    mPrimeBytes = chunkBytes * kPrimeChunks;
+    mChunkNs = bytesToNs(chunkBytes);
+    mJitterNs = bytesToNs((uint64_t)chunkBytes * numChunks);
+    // the chunk in a2dp_write() still holds its space, keep one more free for the next write
+    mLeadNs = bytesToNs((uint64_t)chunkBytes * (numChunks - 2));
+    mExit = false;
+    mDrain = false;
+    mError = NO_ERROR;
+    mQueuedBytes = 0;
+
+    int ret = pthread_create(&mThread, NULL, A2dpStreamPacer::sendThread, (void *)this);
+    if (ret != 0)
+    {
+        ALOGE("%s(), pthread_create fail, ret = %d", __FUNCTION__, ret);
+        return UNKNOWN_ERROR;
+    }
+    mStarted = true;
+
+    ALOGD("%s(), chunk %u bytes, jitter buffer %u chunks (%lld us)", __FUNCTION__,
+          chunkBytes, numChunks, (long long)ns2us(mJitterNs));
+    return NO_ERROR;
+}
+
+void A2dpStreamPacer::stop(const bool drain)
+{
+    if (mStarted == false)
+    {
+        return;
+    }
+
+    {
+        Mutex::Autolock lock(mLock);
+        if (drain == true)
+        {
+            mDrain = true;
+            mDataCond.signal();
+
+            const nsecs_t deadline = systemTime() + mJitterNs;
+            while (mRing.getDataCount() > 0 && mError == NO_ERROR && mExit == false)
+            {
+                const nsecs_t timeout = deadline - systemTime();
+                if (timeout <= 0)
+                {
+                    break;
+                }
+                mSpaceCond.waitRelative(mLock, timeout);
+            }
+        }
+        mExit = true;
+        mDataCond.signal();
+        mSpaceCond.broadcast(); // a writer blocked on a full buffer
+    }
+
+    // the sender may still be in a2dp_write(), the caller stops the transport after this
+    pthread_join(mThread, NULL);
+    mStarted = false;
+
+    ALOGD("%s(), writes %u, underruns %u, full waits %u (max %u us), reanchors %u, send errors %u, max late %u us",
+          __FUNCTION__, mStat.writes, mStat.underruns, mStat.fullWaits, mStat.maxFullWaitUs,
+          mStat.reanchors, mStat.sendErrors, mStat.maxLateUs);
+}
+
+ssize_t A2dpStreamPacer::write(const void *buffer, const size_t bytes)
+{
+    const char *data = (const char *)buffer;
+    size_t remaining = bytes;
+
+    {
+        Mutex::Autolock lock(mLock);
+        if (mError != NO_ERROR)
+        {
+            return mError;
+        }
+
+        mStat.writes++;
+        nsecs_t waitStartNs = 0;
+        while (remaining > 0)
+        {
+            const uint32_t written = mRing.write(data, remaining);
+            if (written > 0)
+            {
+                data += written;
+                remaining -= written;
+                mDataCond.signal();
+                continue;
+            }
+
+            // back pressure: the transport is behind, wait for the sender however long it takes
+            if (waitStartNs == 0)
+            {
+                mStat.fullWaits++;
+                waitStartNs = systemTime();
+            }
+            mSpaceCond.wait(mLock);
+            if (mError != NO_ERROR)
+            {
+                return mError;
+            }
+            if (mExit == true)
+            {
+                break;
+            }
+        }
+
+        if (waitStartNs != 0)
+        {
+            const uint32_t waitUs = (uint32_t)ns2us(systemTime() - waitStartNs);
+            if (waitUs > mStat.maxFullWaitUs)
+            {
+                mStat.maxFullWaitUs = waitUs;
+            }
+        }
+    }
+
+    const size_t queued = bytes - remaining;
+    pace(queued);
+    return queued;
+}
+
+void A2dpStreamPacer::pace(const size_t bytes)
+{
+    const nsecs_t now = systemTime();
+    if (mQueuedBytes == 0 || now - (mAnchorNs + bytesToNs(mQueuedBytes)) > mJitterNs)
+    {
+        if (mQueuedBytes != 0)
+        {
+            mStat.reanchors++;
+        }
+        mAnchorNs = now;
+        mQueuedBytes = 0;
+    }
+    mQueuedBytes += bytes;
+
+    // up to two chunks less than the jitter buffer ahead of the clock (mLeadNs), anything beyond is slept off
+    const nsecs_t deadline = mAnchorNs + bytesToNs(mQueuedBytes) - mLeadNs;
+    if (deadline > now)
+    {
+        struct timespec ts;
+        ts.tv_sec = deadline / 1000000000LL;
+        ts.tv_nsec = deadline % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+        const uint32_t lateUs = (uint32_t)ns2us(systemTime() - deadline);
+        if (lateUs > mStat.maxLateUs)
+        {
+            mStat.maxLateUs = lateUs;
+        }
+    }
+}
+
+void *A2dpStreamPacer::sendThread(void *arg)
+{
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
+
+    A2dpStreamPacer *pPacer = static_cast<A2dpStreamPacer *>(arg);
+    pPacer->sendLoop();
+
+    pthread_exit(NULL);
+    return NULL;
+}
+
+void A2dpStreamPacer::sendLoop()
+{
+    bool streaming = false;
+
+    while (true)
+    {
+        uint32_t bytes = 0;
+        {
+            Mutex::Autolock lock(mLock);
+            while (mExit == false)
+            {
+                const uint32_t dataCount = mRing.getDataCount();
+                const uint32_t needBytes = (mDrain == true) ? 1 : ((streaming == true) ? mChunkBytes : mPrimeBytes);
+                if (dataCount >= needBytes)
+                {
+                    bytes = (dataCount < mChunkBytes) ? dataCount : mChunkBytes;
+                    break;
+                }
+                if (streaming == true && mDrain == false)
+                {
+                    // transport is idle with nothing queued, fill up again before resuming
+                    mStat.underruns++;
+                    streaming = false;
+                }
+                mDataCond.wait(mLock);
+            }
+            if (mExit == true)
+            {
+                break;
+            }
+        }
+
+        streaming = true;
+        const ssize_t sent = sendChunk(bytes);
+        mRing.commitRead(bytes);
+
+        Mutex::Autolock lock(mLock);
+        mSpaceCond.broadcast(); // writer and a draining stop() may both wait
+        if (sent < 0)
+        {
+            ALOGE("%s(), send fail err: %d", __FUNCTION__, (int)sent);
+            mStat.sendErrors++;
+            mError = (status_t)sent;
+            break;
+        }
+    }
+}
+
+ssize_t A2dpStreamPacer::sendChunk(const uint32_t bytes)
+{
+    android::AudioRingBufView view;
+    mRing.getReadView(&view);
+
+    ssize_t sent = 0;
+    uint32_t remaining = bytes;
+    for (int i = 0; i < 2 && remaining > 0; i++)
+    {
+        const uint32_t segBytes = (view.segLen[i] < remaining) ? view.segLen[i] : remaining;
+        if (segBytes == 0)
+        {
+            continue;
+        }
+        const ssize_t ret = mSend(mCookie, view.pSeg[i], segBytes);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        sent += ret;
+        remaining -= segBytes;
+    }
+    return sent;
+}
+
+void A2dpStreamPacer::getStat(a2dp_pacer_stat_t *stat)
+{
+    Mutex::Autolock lock(mLock);
+    *stat = mStat;
+}
+
+void A2dpStreamPacer::dump(int fd)
+{
+    a2dp_pacer_stat_t stat;
+    getStat(&stat);
+
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    snprintf(buffer, SIZE, " A2dpStreamPacer: writes %u, underruns %u, full waits %u (max %u us), "
+             "reanchors %u, send errors %u, max late %u us, queued %u bytes\n",
+             stat.writes, stat.underruns, stat.fullWaits, stat.maxFullWaitUs,
+             stat.reanchors, stat.sendErrors, stat.maxLateUs, mStarted ? mRing.getDataCount() : 0);
+    ::write(fd, buffer, strlen(buffer));
+}
+
+} // end namespace android_audio_legacy
@@ -0,0 +1,106 @@
+#ifndef ANDROID_A2DP_STREAM_PACER_H
+#define ANDROID_A2DP_STREAM_PACER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/Condition.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+
+#include "AudioSPSCRingBuf.h"
+
+namespace android_audio_legacy
+{
+
+struct a2dp_pacer_stat_t
+{
+    uint32_t writes;
+    uint32_t underruns;    // sender found the jitter buffer empty while streaming
+    uint32_t fullWaits;    // writer blocked on a full jitter buffer, the transport is slower than the clock
+    uint32_t maxFullWaitUs;
+    uint32_t reanchors;    // writer fell behind the target clock by more than the jitter depth
+    uint32_t sendErrors;
+    uint32_t maxLateUs;    // worst wake up after a pacing deadline
+};
+
+// returns bytes taken by the transport, or a negative error
+typedef ssize_t (*a2dp_pacer_send_t)(void *cookie, const void *buffer, size_t bytes);
+
+/**
+ * Clock driven pacing of the A2DP output stream.
+ *
+ * write() only queues into a jitter buffer of a few mixer buffers, a sender
+ * thread drains it to the BT transport one chunk at a time, so a slow
+ * a2dp_write() does not stretch a mixer cycle. Nothing is dropped: when the
+ * transport falls behind and the buffer is full, write() blocks until the
+ * sender frees space.
+ *
+ * The clock only throttles a sink that takes data too fast, so the mixer does
+ * not spin: the writer is held to a monotonic target clock (anchor + queued
+ * bytes / byte rate) and sleeps to an absolute deadline, so a late wake up is
+ * paid back by the next write instead of adding up. It may run ahead of the
+ * clock by two chunks less than the buffer (one in the transport, one for the
+ * next write), so a sink on time never fills it.
+ * A writer behind the clock by more than the jitter depth (first write,
+ * resume after a gap) re-anchors it.
+ */
+class A2dpStreamPacer
+{
+    public:
+        A2dpStreamPacer();
+        ~A2dpStreamPacer();
+
+        android::status_t start(a2dp_pacer_send_t send, void *cookie, const uint32_t bytesPerSecond,
+                                const uint32_t chunkBytes, const uint32_t numChunks);
+
+        // drain: let the sender empty the jitter buffer first, at most one jitter depth
+        void     stop(const bool drain);
+        bool     isStarted() const { return mStarted; }
+
+        // queue and pace, blocks while the jitter buffer is full; returns bytes queued or the send error
+        ssize_t  write(const void *buffer, const size_t bytes);
+
+        void     getStat(a2dp_pacer_stat_t *stat);
+        void     dump(int fd);
+
+    private:
+        static void *sendThread(void *arg);
+
+        void     sendLoop();
+        ssize_t  sendChunk(const uint32_t bytes);
+        void     pace(const size_t bytes);
+
+        inline nsecs_t bytesToNs(const uint64_t bytes) const { return (nsecs_t)(bytes * 1000000000ULL / mBytesPerSecond); }
+
+        a2dp_pacer_send_t  mSend;
+        void              *mCookie;
+        uint32_t           mBytesPerSecond;
+        uint32_t           mChunkBytes;
+        uint32_t           mPrimeBytes;
+        nsecs_t            mChunkNs;
+        nsecs_t            mJitterNs;
+        nsecs_t            mLeadNs;     // how far the writer may run ahead of the clock
+
+        android::AudioSPSCRingBuf mRing;
+        android::Mutex     mLock;
+        android::Condition mDataCond;   // sender waits for data
+        android::Condition mSpaceCond;  // writer waits for space
+        pthread_t          mThread;
+        bool               mStarted;
+        bool               mExit;
+        bool               mDrain;
+        android::status_t  mError;
+
+        // writer side target clock
+        nsecs_t            mAnchorNs;
+        uint64_t           mQueuedBytes;
+
+        a2dp_pacer_stat_t  mStat;
+};
+
+} // end namespace android_audio_legacy
+
+#endif // end of ANDROID_A2DP_STREAM_PACER_H
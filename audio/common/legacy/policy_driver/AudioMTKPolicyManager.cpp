@@ -38,6 +38,7 @@
 #include <math.h>
 #include <hardware_legacy/audio_policy_conf.h>
 #include <cutils/properties.h>
+#include <cutils/atomic.h>
 
 //#ifdef MTK_AUDIO
 #include <media/mediarecorder.h>
@@ -129,7 +130,7 @@ static int mapping_vol(float &vol, float unitstep)
 {
     int index = (vol + 0.5) / unitstep;
     vol -= (index * unitstep);
-    ALOGD("mapping_vol vol = %f unitstep = %f vol/unitstep  = %f index = %f", vol, unitstep, vol / unitstep, index);
+    ALOGV("mapping_vol vol = %f unitstep = %f vol/unitstep  = %f index = %f", vol, unitstep, vol / unitstep, index);
     return index;
 }
 
@@ -186,10 +187,25 @@ static const float KeydBConvert = -KeydBPerStep * 2.302585093f / 20.0f;
 static const float KeydBConvertInverse = 1.0f / KeydBPerStep;
 #endif
 
+#ifdef MTK_AUDIO_GAIN_TABLE
+void AudioMTKPolicyManager::initLinearToLogTable()
+{
+    mLinearToLogTable[0] = 0;
+    for (int i = 1; i < LINEAR_TO_LOG_TABLE_SIZE; i++)
+    {
+        mLinearToLogTable[i] = exp(float(KeyvolumeStep - i) * KeydBConvert);
+    }
+}
+#endif
+
 float AudioMTKPolicyManager::linearToLog(int volume)
 {
     //ALOGD("linearToLog(%d)=%f", volume, v);
 #ifdef MTK_AUDIO_GAIN_TABLE
+    if (volume >= 0 && volume < LINEAR_TO_LOG_TABLE_SIZE)
+    {
+        return mLinearToLogTable[volume];
+    }
     return volume ? exp(float(KeyvolumeStep - volume) * KeydBConvert) : 0;
 #else
     return volume ? exp(float(VOLUME_MAPPING_STEP - volume) * dBConvert) : 0;
@@ -215,6 +231,7 @@ status_t AudioMTKPolicyManager::setDeviceConnectionState(audio_devices_t device,
                                                          AudioSystem::device_connection_state state,
                                                          const char *device_address)
 {
+    PolicyLatencyTimer latencyTimer(this, POLICY_OP_DEVICE_CONNECTION);
     SortedVector <audio_io_handle_t> outputs;
 
     ALOGD("setDeviceConnectionState() device: %x, state %d, address %s", device, state, device_address);
@@ -531,6 +548,7 @@ AudioSystem::device_connection_state AudioMTKPolicyManager::getDeviceConnectionS
 
 void AudioMTKPolicyManager::setPhoneState(int state)
 {
+    PolicyLatencyTimer latencyTimer(this, POLICY_OP_PHONE_STATE);
     ALOGD("setPhoneState() state %d", state);
     audio_devices_t newDevice = AUDIO_DEVICE_NONE;
     if (state < 0 || state >= AudioSystem::NUM_MODES)
@@ -704,6 +722,7 @@ void AudioMTKPolicyManager::setPhoneState(int state)
 
 void AudioMTKPolicyManager::setForceUse(AudioSystem::force_use usage, AudioSystem::forced_config config)
 {
+    PolicyLatencyTimer latencyTimer(this, POLICY_OP_FORCE_USE);
     ALOGD("setForceUse() usage %d, config %d, mPhoneState %d", usage, config, mPhoneState);
 
     bool forceVolumeReeval = false;
@@ -1140,6 +1159,7 @@ status_t AudioMTKPolicyManager::startOutput(audio_io_handle_t output,
                                             AudioSystem::stream_type stream,
                                             int session)
 {
+    PolicyLatencyTimer latencyTimer(this, POLICY_OP_START_OUTPUT);
     ALOGD("startOutput() output %d, stream %d, session %d", output, stream, session);
     ssize_t index = mOutputs.indexOfKey(output);
     if (index < 0)
@@ -1255,6 +1275,7 @@ status_t AudioMTKPolicyManager::stopOutput(audio_io_handle_t output,
                                            AudioSystem::stream_type stream,
                                            int session)
 {
+    PolicyLatencyTimer latencyTimer(this, POLICY_OP_STOP_OUTPUT);
     ALOGD("stopOutput() output %d, stream %d, session %d", output, stream, session);
     ssize_t index = mOutputs.indexOfKey(output);
     if (index < 0)
@@ -1653,6 +1674,10 @@ void AudioMTKPolicyManager::initStreamVolume(AudioSystem::stream_type stream,
 #ifdef MTK_AUDIO
     mStreams[stream].mIndexRange = (float)volume_Mapping_Step / indexMax;
 #endif
+    for (int i = 0; i < DEVICE_CATEGORY_CNT; i++)
+    {
+        updateVolumeAmplCache(mStreams[stream], (device_category)i);
+    }
 }
 
 status_t AudioMTKPolicyManager::setStreamVolumeIndex(AudioSystem::stream_type stream,
@@ -2098,10 +2123,55 @@ status_t AudioMTKPolicyManager::dump(int fd)
         mEffects.valueAt(i)->dump(fd);
     }
 
+    dumpPolicyLatency(fd);
 
     return NO_ERROR;
 }
 
+void AudioMTKPolicyManager::recordPolicyLatency(policy_op_t op, nsecs_t latency)
+{
+    if (op >= POLICY_OP_NUM)
+    {
+        return;
+    }
+
+    // bucket i holds latency below (1 << i) us, the last one holds the rest
+    uint32_t latencyUs = (latency > 0) ? (uint32_t)(ns2us(latency)) : 0;
+    int bucket = 0;
+    while (latencyUs != 0 && bucket < kPolicyLatencyBucketNum - 1)
+    {
+        latencyUs >>= 1;
+        bucket++;
+    }
+    android_atomic_inc(&mPolicyLatency[op][bucket]);
+}
+
+void AudioMTKPolicyManager::dumpPolicyLatency(int fd)
+{
+    static const char *opName[POLICY_OP_NUM] =
+    {
+        "DeviceConnection", "PhoneState", "ForceUse", "StartOutput", "StopOutput", "Parameters", "TestCommand"
+    };
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+
+    snprintf(buffer, SIZE, "\nPolicy latency (count per bucket, bucket i < 2^i us):\n");
+    result.append(buffer);
+    for (int op = 0; op < POLICY_OP_NUM; op++)
+    {
+        snprintf(buffer, SIZE, " %-16s", opName[op]);
+        result.append(buffer);
+        for (int bucket = 0; bucket < kPolicyLatencyBucketNum; bucket++)
+        {
+            snprintf(buffer, SIZE, " %d", android_atomic_acquire_load(&mPolicyLatency[op][bucket]));
+            result.append(buffer);
+        }
+        result.append("\n");
+    }
+    write(fd, result.string(), result.size());
+}
+
 // This function checks for the parameters which can be offloaded.
 // This can be enhanced depending on the capability of the DSP and policy
 // of the system.
@@ -2208,8 +2278,12 @@ AudioMTKPolicyManager::AudioMTKPolicyManager(AudioPolicyClientInterface *clientI
     mSpeakerDrcEnabled(false)
 {
     mpClientInterface = clientInterface;
+    memset((void *)mPolicyLatency, 0, sizeof(mPolicyLatency));
 
 #ifdef MTK_AUDIO
+#ifdef MTK_AUDIO_GAIN_TABLE
+    initLinearToLogTable();
+#endif
     LoadCustomVolume();
 #ifdef MTK_AUDIO_GAIN_TABLE
     mVolumeStream = -1;
@@ -2385,14 +2459,47 @@ bool AudioMTKPolicyManager::threadLoop()
 {
     ALOGD("entering threadLoop()");
     while (!exitPending())
+    {
+        nsecs_t queuedTime = 0;
+        {
+            Mutex::Autolock _l(mLock);
+            // the HAL posts POLICY_TEST_COMMAND whenever test_cmd_policy is set
+            if (mTestCommandQueue.isEmpty() && !exitPending())
+            {
+                mWaitWorkCV.wait(mLock);
+            }
+            if (exitPending())
+            {
+                break;
+            }
+            if (mTestCommandQueue.isEmpty())
+            {
+                continue;
+            }
+            queuedTime = mTestCommandQueue[0];
+            mTestCommandQueue.removeAt(0);
+        }
+
+        processTestCommand();
+        recordPolicyLatency(POLICY_OP_TEST_COMMAND, systemTime() - queuedTime);
+    }
+    return false;
+}
+
+void AudioMTKPolicyManager::postTestCommand()
+{
+    AutoMutex _l(mLock);
+    mTestCommandQueue.add(systemTime());
+    mWaitWorkCV.signal();
+}
+
+void AudioMTKPolicyManager::processTestCommand()
+{
     {
         String8 command;
         int valueInt;
         String8 value;
 
-        Mutex::Autolock _l(mLock);
-        mWaitWorkCV.waitRelative(mLock, milliseconds(50));
-
         command = mpClientInterface->getParameters(0, String8("test_cmd_policy"));
         AudioParameter param = AudioParameter(command);
 
@@ -2543,7 +2650,6 @@ bool AudioMTKPolicyManager::threadLoop()
             mpClientInterface->setParameters(0, String8("test_cmd_policy="));
         }
     }
-    return false;
 }
 
 void AudioMTKPolicyManager::exit()
@@ -4112,12 +4218,54 @@ float AudioMTKPolicyManager::volIndexToAmpl(audio_devices_t device, const Stream
 {
     device_category deviceCategory = getDeviceCategory(device);
     const VolumeCurvePoint *curve = streamDesc.mVolumeCurve[deviceCategory];
+    int cacheIndex = indexInUi - streamDesc.mIndexMin;
+
+    // only [mIndexMin, mIndexMax] is cached, an index out of that range is computed directly
+    if (cacheIndex < 0 || cacheIndex > streamDesc.mIndexMax - streamDesc.mIndexMin ||
+        streamDesc.mIndexMax - streamDesc.mIndexMin >= StreamDescriptor::VOLUME_AMPL_CACHE_SIZE)
+    {
+        return curveIndexToAmpl(curve, streamDesc.mIndexMin, streamDesc.mIndexMax, indexInUi);
+    }
+
+    // the curve of a stream can be swapped at runtime (DTMF during a call), so the cache
+    // remembers which curve and index range it was built from and is rebuilt on mismatch
+    if (streamDesc.mVolumeAmplCurve[deviceCategory] != curve ||
+        streamDesc.mVolumeAmplIndexMin[deviceCategory] != streamDesc.mIndexMin ||
+        streamDesc.mVolumeAmplIndexMax[deviceCategory] != streamDesc.mIndexMax)
+    {
+        updateVolumeAmplCache(streamDesc, deviceCategory);
+    }
+    return streamDesc.mVolumeAmpl[deviceCategory][cacheIndex];
+}
+
+void AudioMTKPolicyManager::updateVolumeAmplCache(const StreamDescriptor &streamDesc,
+                                                  device_category deviceCategory)
+{
+    const VolumeCurvePoint *curve = streamDesc.mVolumeCurve[deviceCategory];
+    int nbIndex = streamDesc.mIndexMax - streamDesc.mIndexMin + 1;
 
+    if (curve == NULL || nbIndex > StreamDescriptor::VOLUME_AMPL_CACHE_SIZE)
+    {
+        return;
+    }
+    for (int i = 0; i < nbIndex; i++)
+    {
+        streamDesc.mVolumeAmpl[deviceCategory][i] =
+            curveIndexToAmpl(curve, streamDesc.mIndexMin, streamDesc.mIndexMax, streamDesc.mIndexMin + i);
+    }
+    streamDesc.mVolumeAmplCurve[deviceCategory] = curve;
+    streamDesc.mVolumeAmplIndexMin[deviceCategory] = streamDesc.mIndexMin;
+    streamDesc.mVolumeAmplIndexMax[deviceCategory] = streamDesc.mIndexMax;
+}
+
+float AudioMTKPolicyManager::curveIndexToAmpl(const VolumeCurvePoint *curve, int indexMin, int indexMax,
+                                              int indexInUi)
+{
     // the volume index in the UI is relative to the min and max volume indices for this stream type
     int nbSteps = 1 + curve[VOLMAX].mIndex -
                   curve[VOLMIN].mIndex;
-    int volIdx = (nbSteps * (indexInUi - streamDesc.mIndexMin)) /
-                 (streamDesc.mIndexMax - streamDesc.mIndexMin);
+    int volIdx = (nbSteps * (indexInUi - indexMin)) /
+                 (indexMax - indexMin);
 
     // find what part of the curve this index volume belongs to, or if it's out of bounds
     int segment = 0;
@@ -4152,7 +4300,7 @@ float AudioMTKPolicyManager::volIndexToAmpl(audio_devices_t device, const Stream
 
     float amplification = exp(decibels * 0.115129f);  // exp( dB * ln(10) / 20 )
 
-    ALOGD("VOLUME vol index=[%d %d %d], dB=[%.1f %.1f %.1f] ampl=%.5f",
+    ALOGV("VOLUME vol index=[%d %d %d], dB=[%.1f %.1f %.1f] ampl=%.5f",
           curve[segment].mIndex, volIdx,
           curve[segment + 1].mIndex,
           curve[segment].mDBAttenuation,
@@ -4473,7 +4621,7 @@ status_t AudioMTKPolicyManager::checkAndSetVolume(int stream,
                                                   bool force)
 {
 
-    ALOGD(" checkAndSetVolume stream = %d index = %d output = %d device = 0x%x delayMs = %d force = %d"
+    ALOGV(" checkAndSetVolume stream = %d index = %d output = %d device = 0x%x delayMs = %d force = %d"
           , stream, index, output, device, delayMs, force);
 
     // do not change actual stream volume if the stream is muted
@@ -4994,6 +5142,13 @@ status_t AudioMTKPolicyManager::AudioInputDescriptor::dump(int fd)
 AudioMTKPolicyManager::StreamDescriptor::StreamDescriptor()
     :   mIndexMin(0), mIndexMax(1), mCanBeMuted(true)
 {
+    for (int i = 0; i < DEVICE_CATEGORY_CNT; i++)
+    {
+        mVolumeCurve[i] = NULL;
+        mVolumeAmplCurve[i] = NULL;
+        mVolumeAmplIndexMin[i] = 0;
+        mVolumeAmplIndexMax[i] = -1;
+    }
 #ifdef MTK_AUDIO
     mIndexCur.add(AUDIO_DEVICE_OUT_DEFAULT, 1);
 #else
@@ -5789,7 +5944,7 @@ void AudioMTKPolicyManager::defaultAudioPolicyConfig(void)
 float AudioMTKPolicyManager::computeCustomVolume(int stream, int index, audio_io_handle_t output, audio_devices_t device)
 {
     float volume = 1.0;
-    ALOGD("+computeCustomVolume stream %d, index %d, device 0x%x", stream, index, device);
+    ALOGV("+computeCustomVolume stream %d, index %d, device 0x%x", stream, index, device);
     if (stream > AudioSystem::MATV)
     {
         return volume;
@@ -5813,7 +5968,7 @@ float AudioMTKPolicyManager::computeCustomVolume(int stream, int index, audio_io
     }
     uint8_t customGain = KeyvolumeStep - streamGain->stream[gainDevice].digital[index];
     volume = linearToLog(customGain);
-    ALOGD("-computeCustomVolume customGain 0x%x, volume %f", customGain, volume);
+    ALOGV("-computeCustomVolume customGain 0x%x, volume %f", customGain, volume);
     return volume;
 }
 
@@ -5937,6 +6092,7 @@ status_t AudioMTKPolicyManager::checkAndSetAnalogGain(int stream, int index, aud
 
 status_t AudioMTKPolicyManager::SetPolicyManagerParameters(int par1, int par2 , int par3, int par4)
 {
+    PolicyLatencyTimer latencyTimer(this, POLICY_OP_PARAMETERS);
     audio_devices_t device ;
     audio_devices_t curDevice = getDeviceForVolume((audio_devices_t)mOutputs.valueFor(mPrimaryOutput)->device());
     ALOGD("SetPolicyManagerParameters par1 = %d par2 = %d par3 = %d par4 = %d device = 0x%x curDevice = 0x%x", par1, par2, par3, par4, device, curDevice);
@@ -5949,6 +6105,13 @@ status_t AudioMTKPolicyManager::SetPolicyManagerParameters(int par1, int par2 ,
             bFMPreStopSignal = true;
             break;
         }
+        case POLICY_TEST_COMMAND:
+        {
+#ifdef AUDIO_POLICY_TEST
+            postTestCommand();
+#endif
+            break;
+        }
         case POLICY_LOAD_VOLUME:
         {
             LoadCustomVolume();
@@ -6266,7 +6429,7 @@ int AudioMTKPolicyManager::FindCustomVolumeIndex(unsigned char array[], int volI
 // this function will map vol 0~100 , base on customvolume amp to 0~255 , and do linear calculation to set mastervolume
 float AudioMTKPolicyManager::MapVoltoCustomVol(unsigned char array[], int volmin, int volmax, float &vol , int stream)
 {
-    ALOGD("+MapVoltoCustomVol vol = %f stream = %d volmin = %d volmax = %d", vol, stream, volmin, volmax);
+    ALOGV("+MapVoltoCustomVol vol = %f stream = %d volmin = %d volmax = %d", vol, stream, volmin, volmax);
 
     float volume = 0.0;
     StreamDescriptor &streamDesc = mStreams[stream];
@@ -6311,7 +6474,7 @@ float AudioMTKPolicyManager::MapVoltoCustomVol(unsigned char array[], int volmin
     }
 
     vol = volume;
-    ALOGD("-MapVoltoCustomVol volume = %f vol = %f", volume, vol);
+    ALOGV("-MapVoltoCustomVol volume = %f vol = %f", volume, vol);
     return volume;
 }
 
@@ -6445,28 +6608,28 @@ float AudioMTKPolicyManager::computeCustomVolume(int stream, float &volInt, audi
         case AudioSystem::MUSIC:
             if (OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER)
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER");
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER");
                 volmax = Audio_Ver1_Custom_Volume.audiovolume_media[VOL_HANDFREE][GetStreamMaxLevels(stream) - 1];
                 volmin = Audio_Ver1_Custom_Volume.audiovolume_media[VOL_HANDFREE][0];
                 volume = MapVoltoCustomVol(Audio_Ver1_Custom_Volume.audiovolume_media[VOL_HANDFREE], volmin, volmax, volInt, stream);
             }
             else if ((OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADSET) || (OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADPHONE))
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADSET");
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADSET");
                 volmax = Audio_Ver1_Custom_Volume.audiovolume_media[VOL_HEADSET][GetStreamMaxLevels(stream) - 1];
                 volmin = Audio_Ver1_Custom_Volume.audiovolume_media[VOL_HEADSET][0];
                 volume = MapVoltoCustomVol(Audio_Ver1_Custom_Volume.audiovolume_media[VOL_HEADSET], volmin, volmax, volInt, stream);
             }
             else if ((OutputDevice == AudioSystem::DEVICE_OUT_EARPIECE))
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_EARPIECE");
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_EARPIECE");
                 volmax = Audio_Ver1_Custom_Volume.audiovolume_media[VOL_NORMAL][GetStreamMaxLevels(stream) - 1];
                 volmin = Audio_Ver1_Custom_Volume.audiovolume_media[VOL_NORMAL][0];
                 volume = MapVoltoCustomVol(Audio_Ver1_Custom_Volume.audiovolume_media[VOL_NORMAL], volmin, volmax, volInt, stream);
             }
             else
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::VOLUME_HEADSET_SPEAKER_MODE");
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::VOLUME_HEADSET_SPEAKER_MODE");
                 volmax = Audio_Ver1_Custom_Volume.audiovolume_media[VOLUME_HEADSET_SPEAKER_MODE][GetStreamMaxLevels(stream) - 1];
                 volmin = Audio_Ver1_Custom_Volume.audiovolume_media[VOLUME_HEADSET_SPEAKER_MODE][0];
                 volume = MapVoltoCustomVol(Audio_Ver1_Custom_Volume.audiovolume_media[VOLUME_HEADSET_SPEAKER_MODE], volmin, volmax, volInt, stream);
@@ -6475,28 +6638,28 @@ float AudioMTKPolicyManager::computeCustomVolume(int stream, float &volInt, audi
         case AudioSystem::DTMF:
             if (OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER)
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_dtmf[VOL_HANDFREE][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_dtmf[VOL_HANDFREE][0];
                 volume = MapVoltoCustomVol(audiovolume_dtmf[VOL_HANDFREE], volmin, volmax, volInt, stream);
             }
             else if ((OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADSET) || (OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADPHONE))
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_dtmf[VOL_HEADSET][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_dtmf[VOL_HEADSET][0];
                 volume = MapVoltoCustomVol(audiovolume_dtmf[VOL_HEADSET], volmin, volmax, volInt, stream);
             }
             else if ((OutputDevice == AudioSystem::DEVICE_OUT_EARPIECE))
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_dtmf[VOL_NORMAL][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_dtmf[VOL_NORMAL][0];
                 volume = MapVoltoCustomVol(audiovolume_dtmf[VOL_NORMAL], volmin, volmax, volInt, stream);
             }
             else
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_dtmf[VOLUME_HEADSET_SPEAKER_MODE][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_dtmf[VOLUME_HEADSET_SPEAKER_MODE][0];
                 volume = MapVoltoCustomVol(audiovolume_dtmf[VOLUME_HEADSET_SPEAKER_MODE], volmin, volmax, volInt, stream);
@@ -6505,28 +6668,28 @@ float AudioMTKPolicyManager::computeCustomVolume(int stream, float &volInt, audi
         case AudioSystem::SYSTEM:
             if (OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER)
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_system[VOL_HANDFREE][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_system[VOL_HANDFREE][0];
                 volume = MapVoltoCustomVol(audiovolume_system[VOL_HANDFREE], volmin, volmax, volInt, stream);
             }
             else if ((OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADSET) || (OutputDevice == AudioSystem::DEVICE_OUT_WIRED_HEADPHONE))
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_system[VOL_HEADSET][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_system[VOL_HEADSET][0];
                 volume = MapVoltoCustomVol(audiovolume_system[VOL_HEADSET], volmin, volmax, volInt, stream);
             }
             else if ((OutputDevice == AudioSystem::DEVICE_OUT_EARPIECE))
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_system[VOL_NORMAL][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_system[VOL_NORMAL][0];
                 volume = MapVoltoCustomVol(audiovolume_system[VOL_NORMAL], volmin, volmax, volInt, stream);
             }
             else
             {
-                ALOGD("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
+                ALOGV("computeCustomVolume OutputDevice == AudioSystem::DEVICE_OUT_SPEAKER GetStreamMaxLevels(stream)-1 = %d", GetStreamMaxLevels(stream) - 1);
                 volmax = audiovolume_system[VOLUME_HEADSET_SPEAKER_MODE][GetStreamMaxLevels(stream) - 1];
                 volmin = audiovolume_system[VOLUME_HEADSET_SPEAKER_MODE][0];
                 volume = MapVoltoCustomVol(audiovolume_system[VOLUME_HEADSET_SPEAKER_MODE], volmin, volmax, volInt, stream);
@@ -6667,11 +6830,11 @@ float AudioMTKPolicyManager::computeCustomVoiceVolume(int stream, int index, aud
     }
 
     float volInt = (volume_Mapping_Step * (index - streamDesc.mIndexMin)) / (streamDesc.mIndexMax - streamDesc.mIndexMin);
-    ALOGD("computeCustomVoiceVolume stream = %d index = %d volInt = %f", stream, index, volInt);
+    ALOGV("computeCustomVoiceVolume stream = %d index = %d volInt = %f", stream, index, volInt);
 #ifndef MTK_AUDIO_GAIN_TABLE
     volume = computeCustomVolume(stream, volInt, output, device);
 #endif
-    ALOGD("computeCustomVoiceVolume volume = %f volInt = %f", volume, volInt);
+    ALOGV("computeCustomVoiceVolume volume = %f volInt = %f", volume, volInt);
     volInt = linearToLog(volInt);
     volume = volInt;
     return volume;
@@ -384,6 +384,13 @@ protected:
             const VolumeCurvePoint *mVolumeCurve[DEVICE_CATEGORY_CNT];
 //<MTK_AUDIO_ADD
             float mIndexRange;
+
+            // amplitude per UI index, filled from mVolumeCurve by updateVolumeAmplCache()
+            enum { VOLUME_AMPL_CACHE_SIZE = 32 };
+            mutable const VolumeCurvePoint *mVolumeAmplCurve[DEVICE_CATEGORY_CNT];
+            mutable int mVolumeAmplIndexMin[DEVICE_CATEGORY_CNT];
+            mutable int mVolumeAmplIndexMax[DEVICE_CATEGORY_CNT];
+            mutable float mVolumeAmpl[DEVICE_CATEGORY_CNT][VOLUME_AMPL_CACHE_SIZE];
 //MTK_AUDIO_ADD>
 
         };
@@ -521,6 +528,8 @@ protected:
         virtual     bool        threadLoop();
                     void        exit();
         int testOutputIndex(audio_io_handle_t output);
+                    void        postTestCommand();
+                    void        processTestCommand();
 #endif //AUDIO_POLICY_TEST
 
         status_t setEffectEnabled(EffectDescriptor *pDesc, bool enabled);
@@ -642,6 +651,7 @@ protected:
 #ifdef AUDIO_POLICY_TEST
         Mutex   mLock;
         Condition mWaitWorkCV;
+        Vector<nsecs_t> mTestCommandQueue; // queued time of each pending test command
 
         int             mCurOutput;
         bool            mDirectOutput;
@@ -678,6 +688,36 @@ public:
         float computeCustomVoiceVolume(int stream, int index, audio_io_handle_t output, uint32_t device);
         float computeCustomVolume(int stream, float &vol, audio_io_handle_t output,audio_devices_t device);
         void LoadCustomVolume(void);
+
+        // latency histogram of policy operations, log2 buckets of us, shown in dump()
+        enum policy_op_t
+        {
+            POLICY_OP_DEVICE_CONNECTION = 0,
+            POLICY_OP_PHONE_STATE,
+            POLICY_OP_FORCE_USE,
+            POLICY_OP_START_OUTPUT,
+            POLICY_OP_STOP_OUTPUT,
+            POLICY_OP_PARAMETERS,
+            POLICY_OP_TEST_COMMAND,
+            POLICY_OP_NUM
+        };
+        void recordPolicyLatency(policy_op_t op, nsecs_t latency);
+        void dumpPolicyLatency(int fd);
+
+        class PolicyLatencyTimer
+        {
+        public:
+            PolicyLatencyTimer(AudioMTKPolicyManager *manager, policy_op_t op) :
+                mManager(manager), mOp(op), mStartTime(systemTime()) {}
+            ~PolicyLatencyTimer() { mManager->recordPolicyLatency(mOp, systemTime() - mStartTime); }
+        private:
+            AudioMTKPolicyManager *mManager;
+            policy_op_t            mOp;
+            nsecs_t                mStartTime;
+        };
+private:
+        static const int kPolicyLatencyBucketNum = 16;
+        volatile int32_t mPolicyLatency[POLICY_OP_NUM][kPolicyLatencyBucketNum];
 #ifdef MTK_AUDIO_GAIN_TABLE
 public:
         AUDIO_GAIN_TABLE_STRUCT mCustomVolume;
@@ -690,6 +730,11 @@ private:
        int                 mVolumeStream;
        int                 mVolumeIndex;
        audio_devices_t     mVolumeDevice;
+
+       // linearToLog() result for every digital gain step of the gain table
+       enum { LINEAR_TO_LOG_TABLE_SIZE = 256 };
+       float               mLinearToLogTable[LINEAR_TO_LOG_TABLE_SIZE];
+       void initLinearToLogTable();
 #endif
 
 //MTK_AUDIO_ADD>
@@ -697,6 +742,12 @@ private:
 private:
         static float volIndexToAmpl(audio_devices_t device, const StreamDescriptor& streamDesc,
                 int indexInUi);
+//<MTK_AUDIO_ADD
+        static void updateVolumeAmplCache(const StreamDescriptor& streamDesc,
+                device_category deviceCategory);
+        static float curveIndexToAmpl(const VolumeCurvePoint *curve, int indexMin, int indexMax,
+                int indexInUi);
+//MTK_AUDIO_ADD>
         // updates device caching and output for streams that can influence the
         //    routing of notifications
         void handleNotificationRoutingForStream(AudioSystem::stream_type stream);
@@ -52,6 +52,7 @@ endif
 
 ifeq ($(AUDIO_POLICY_TEST),true)
   ENABLE_AUDIO_DUMP := true
+  LOCAL_CFLAGS += -DAUDIO_POLICY_TEST
 endif
 
 ifeq ($(strip $(TARGET_BUILD_VARIANT)),eng)
@@ -213,6 +214,7 @@ ifneq ($(MTK_AUDIO_TUNING_TOOL_VERSION),)
 
       LOCAL_SRC_FILES += $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAGainController.cpp
       LOCAL_SRC_FILES += $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioGainTableParamParser.cpp
+      LOCAL_SRC_FILES += $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioParamSnapshot.cpp
 
     endif
   endif
@@ -251,9 +253,11 @@ LOCAL_SRC_FILES+= \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioPreProcess.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSADriverUtility.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSASampleRateController.cpp \
+    $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioTimeline.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAHardware.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSADataProcessor.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAPlaybackHandlerBase.cpp \
+    $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAPlaybackTap.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAPlaybackHandlerNormal.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAPlaybackHandlerFast.cpp \
     $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioALSAPlaybackHandlerVoice.cpp \
@@ -313,6 +317,13 @@ LOCAL_SRC_FILES+= \
     aud_drv/AudioFtm.cpp \
     speech_driver/AudioALSASpeechPhoneCallController.cpp
 
+# Sample kernels, NEON is checked at runtime on ARMv7
+LOCAL_SRC_FILES += $(LOCAL_COMMON_PATH)/aud_drv/AudioSampleKernel.cpp
+LOCAL_SRC_FILES_arm += $(LOCAL_COMMON_PATH)/aud_drv/AudioSampleKernelNeon.cpp.neon
+LOCAL_SRC_FILES_arm64 += $(LOCAL_COMMON_PATH)/aud_drv/AudioSampleKernelNeon.cpp
+LOCAL_SRC_FILES_x86 += $(LOCAL_COMMON_PATH)/aud_drv/AudioSampleKernelNeon.cpp
+LOCAL_SRC_FILES_x86_64 += $(LOCAL_COMMON_PATH)/aud_drv/AudioSampleKernelNeon.cpp
+
 # MTK Audio Tuning Tool Version
 ifneq ($(MTK_AUDIO_TUNING_TOOL_VERSION),)
   ifneq ($(strip $(MTK_AUDIO_TUNING_TOOL_VERSION)),V1)
@@ -568,9 +579,77 @@ LOCAL_MODULE := audio.primary.$(TARGET_BOARD_PLATFORM)
 LOCAL_MODULE_RELATIVE_PATH := hw
 LOCAL_MODULE_TAGS := optional
 LOCAL_MULTILIB := both
+
+# audio_hal_bench below builds the same HAL sources
+AUDIO_HAL_SRC_FILES := $(LOCAL_SRC_FILES)
+AUDIO_HAL_SRC_FILES_arm := $(LOCAL_SRC_FILES_arm)
+AUDIO_HAL_SRC_FILES_arm64 := $(LOCAL_SRC_FILES_arm64)
+AUDIO_HAL_SRC_FILES_x86 := $(LOCAL_SRC_FILES_x86)
+AUDIO_HAL_SRC_FILES_x86_64 := $(LOCAL_SRC_FILES_x86_64)
+AUDIO_HAL_C_INCLUDES := $(LOCAL_C_INCLUDES)
+AUDIO_HAL_CFLAGS := $(LOCAL_CFLAGS)
+AUDIO_HAL_SHARED_LIBRARIES := $(LOCAL_SHARED_LIBRARIES)
+AUDIO_HAL_STATIC_LIBRARIES := $(LOCAL_STATIC_LIBRARIES)
+
 include $(BUILD_SHARED_LIBRARY)
 
 
+# Benchmark of the V3 Normal playback handler / capture provider on a fake tinyalsa,
+# FakeTinyAlsa.cpp comes before libtinyalsa so its pcm_* replace the driver ones.
+# Device only, no host variant: the HAL sources link the 32 bit prebuilt MTK SRC /
+# BesRecord / bit converter libraries, NVRAM and the mixer, which have no host build.
+# MTK_AUDIO_HAL_BENCH turns on the AudioBenchTrace stage timing in these HAL objects only
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_hal_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := \
+    $(LOCAL_COMMON_PATH)/V3/tools/audio_hal_bench/AudioHalBench.cpp \
+    $(LOCAL_COMMON_PATH)/V3/tools/audio_hal_bench/FakeTinyAlsa.cpp \
+    $(AUDIO_HAL_SRC_FILES)
+LOCAL_SRC_FILES_arm := $(AUDIO_HAL_SRC_FILES_arm)
+LOCAL_SRC_FILES_arm64 := $(AUDIO_HAL_SRC_FILES_arm64)
+LOCAL_SRC_FILES_x86 := $(AUDIO_HAL_SRC_FILES_x86)
+LOCAL_SRC_FILES_x86_64 := $(AUDIO_HAL_SRC_FILES_x86_64)
+LOCAL_C_INCLUDES := \
+    $(AUDIO_HAL_C_INCLUDES) \
+    $(LOCAL_PATH)/$(LOCAL_COMMON_PATH)/V3/tools/audio_hal_bench
+LOCAL_CFLAGS := $(AUDIO_HAL_CFLAGS) -DMTK_AUDIO_HAL_BENCH
+LOCAL_SHARED_LIBRARIES := $(AUDIO_HAL_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(AUDIO_HAL_STATIC_LIBRARIES)
+LOCAL_ARM_MODE := arm
+LOCAL_MULTILIB := 32
+include $(BUILD_EXECUTABLE)
+
+
+# Host check of the xml param snapshot, hash an xml folder and verify a pulled snapshot against it
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_param_snapshot
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := \
+    $(LOCAL_COMMON_PATH)/V3/tools/audio_param_snapshot/AudioParamSnapshotTool.cpp \
+    $(LOCAL_COMMON_PATH)/V3/aud_drv/AudioParamSnapshot.cpp
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/$(LOCAL_COMMON_PATH)/V3/include
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# Host load generator of the speech modem link, a protocol model of the AP messenger (not SpeechMessengerECCCI itself) against a fake ECCCI modem
+include $(CLEAR_VARS)
+LOCAL_MODULE := speech_modem_sim
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := \
+    $(LOCAL_COMMON_PATH)/V3/tools/speech_modem_sim/SpeechModemSim.cpp \
+    $(LOCAL_COMMON_PATH)/V3/tools/speech_modem_sim/FakeModem.cpp
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/$(LOCAL_COMMON_PATH)/include \
+    $(LOCAL_PATH)/$(LOCAL_COMMON_PATH)/V3/include \
+    $(LOCAL_PATH)/$(LOCAL_COMMON_PATH)/V3/tools/speech_modem_sim
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+LOCAL_LDLIBS := -lpthread -lrt
+include $(BUILD_HOST_EXECUTABLE)
+
+
 ifeq ($(findstring MTK_AOSP_ENHANCEMENT,  $(COMMON_GLOBAL_CPPFLAGS)),)
 ifneq ($(USE_LEGACY_AUDIO_POLICY), 1)
 include $(CLEAR_VARS)
@@ -2448,25 +2448,25 @@ status_t AudioALSAStreamManager::setParameters(const String8 &keyValuePairs, int
     status_t status = PERMISSION_DENIED;
     ssize_t index = -1;
 
-    ALOGD("+%s(), IOport = %d, keyValuePairs = %s", __FUNCTION__, IOport, keyValuePairs.string());
+    ALOGV("+%s(), IOport = %d, keyValuePairs = %s", __FUNCTION__, IOport, keyValuePairs.string());
 
     index = mStreamOutVector.indexOfKey(IOport);
     if (index >= 0)
     {
-        ALOGD("Send to mStreamOutVector[%zu]", index);
+        ALOGV("Send to mStreamOutVector[%zu]", index);
         AudioALSAStreamOut *pAudioALSAStreamOut = mStreamOutVector.valueAt(index);
         status = pAudioALSAStreamOut->setParameters(keyValuePairs);
-        ALOGD("-%s()", __FUNCTION__);
+        ALOGV("-%s()", __FUNCTION__);
         return status;
     }
 
     index = mStreamInVector.indexOfKey(IOport);
     if (index >= 0)
     {
-        ALOGD("Send to mStreamInVector [%zu]", index);
+        ALOGV("Send to mStreamInVector [%zu]", index);
         AudioALSAStreamIn *pAudioALSAStreamIn = mStreamInVector.valueAt(index);
         status = pAudioALSAStreamIn->setParameters(keyValuePairs);
-        ALOGD("-%s()", __FUNCTION__);
+        ALOGV("-%s()", __FUNCTION__);
         return status;
     }
 
@@ -9,6 +9,7 @@
 #include "AudioALSAHardwareResourceManager.h"
 
 #include <hardware/audio_mtk.h>
+#include <cutils/atomic.h>
 
 #ifdef MTK_DYNAMIC_CHANGE_HAL_BUFFER_SIZE
 #define LOW_POWER_HAL_BUFFER_SIZE   (45056)
@@ -37,6 +38,19 @@ uint32_t AudioALSAStreamOut::mSuspendStreamOutHDMIStereoCount = 0;
 
 AudioALSAStreamOut *AudioALSAStreamOut::mStreamOutHDMIStereo = NULL;
 
+// setParameters() keys, built once instead of per call
+static const String8 keyRouting = String8(AudioParameter::keyRouting);
+static const String8 keySampleRate = String8(AudioParameter::keySamplingRate);
+static const String8 keyDynamicSampleRate = String8("DynamicSampleRate");
+static const String8 keyLowLatencyMode = String8("LowLatencyMode");
+#ifdef MTK_BASIC_PACKAGE
+static const String8 keyRoutingToNone = String8(AUDIO_PARAMETER_KEY_ROUTING_TO_NONE);
+static const String8 keyFmDirectControl = String8(AUDIO_PARAMETER_KEY_FM_DIRECT_CONTROL);
+#else
+static const String8 keyRoutingToNone = String8(AudioParameter::keyRoutingToNone);
+static const String8 keyFmDirectControl = String8(AudioParameter::keyFmDirectControl);
+#endif
+
 
 AudioALSAStreamOut::AudioALSAStreamOut() :
     mStreamManager(AudioALSAStreamManager::getInstance()),
@@ -51,11 +65,13 @@ AudioALSAStreamOut::AudioALSAStreamOut() :
     mOffloadVol(0x10000),
     mPaused(false),
     mLowLatencyMode(true),
-    mLockCount(0)
+    mLockCount(0),
+    mPositionSeq(0)
 {
     ALOGD("%s()", __FUNCTION__);
 
     memset(&mStreamAttributeSource, 0, sizeof(mStreamAttributeSource));
+    memset(&mPosition, 0, sizeof(mPosition));
 }
 
 
@@ -276,7 +292,9 @@ ssize_t AudioALSAStreamOut::write(const void *buffer, size_t bytes)
         ALOGV("%s(), mStreamOutType = %d, mSuspendCount = %u, mSuspendStreamOutHDMIStereoCount = %d",
               __FUNCTION__, mStreamOutType, mSuspendCount, mSuspendStreamOutHDMIStereoCount);
         usleep(latency() * 1000);
+        AudioAutoTimeoutLock _l(mLock);
         mPresentedBytes += bytes;
+        updatePresentationPosition(false);
         return bytes;
     }
 
@@ -296,20 +314,34 @@ ssize_t AudioALSAStreamOut::write(const void *buffer, size_t bytes)
     if (AUDIO_DEVICE_NONE!=mRoutingDevice)
     {
         ALOGD("Routing : mStandby %d, mRoutingDevice %d", mStandby, mRoutingDevice);
+        bool hot_routing = false;
         if(mStandby==false)
         {
             //ASSERT(mRoutingDevice != mStreamAttributeSource.output_devices); // TODO(Harvey): Could remove it after stress test
             ASSERT(mPlaybackHandler != NULL);
-            //status = mPlaybackHandler->routing(output_devices);
-            //if (status != NO_ERROR)
             if(mPlaybackHandler->getPlaybackHandlerType() != PLAYBACK_HANDLER_OFFLOAD)
             {
-                status = close();
+                // keep pcm open and only switch codec path / filter / gain when handler allows
+                if (mStreamManager->isModeInPhoneCall() == false &&
+                    mPlaybackHandler->canHotRouting(mRoutingDevice) == true)
+                {
+                    hot_routing = true;
+                }
+                else
+                {
+                    status = close();
+                }
             }
         }
 
         mStreamAttributeSource.output_devices = mRoutingDevice;
         mRoutingDevice = AUDIO_DEVICE_NONE;
+
+        if (hot_routing == true)
+        {
+            status = mPlaybackHandler->routing(mStreamAttributeSource.output_devices);
+            mStreamManager->setMasterVolume(mStreamManager->getMasterVolume());
+        }
     }
 
     /// check open
@@ -338,10 +370,67 @@ ssize_t AudioALSAStreamOut::write(const void *buffer, size_t bytes)
     outputSize = mPlaybackHandler->write(buffer, bytes);
     mPresentedBytes += outputSize;
     //ALOGD("%s(), outputSize = %d, bytes = %d,mPresentedBytes=%d", __FUNCTION__, outputSize, bytes, mPresentedBytes);
+    updatePresentationPosition(true);
     return outputSize;
 }
 
 
+void AudioALSAStreamOut::updatePresentationPosition(const bool query_hardware)
+{
+    const uint8_t size_per_channel = (mStreamAttributeSource.audio_format == AUDIO_FORMAT_PCM_8_BIT ? 1 :
+                                      (mStreamAttributeSource.audio_format == AUDIO_FORMAT_PCM_16_BIT ? 2 :
+                                       (mStreamAttributeSource.audio_format == AUDIO_FORMAT_PCM_32_BIT ? 4 :
+                                        2)));
+    const uint32_t frame_size = mStreamAttributeSource.num_channels * size_per_channel;
+
+    presentation_position_t position;
+    memset(&position, 0, sizeof(position));
+    position.presented_frames = (frame_size != 0) ? (mPresentedBytes / (uint64_t)frame_size) : 0;
+
+    if (mPlaybackHandler != NULL)
+    {
+        if (mPlaybackHandler->getPlaybackHandlerType() == PLAYBACK_HANDLER_OFFLOAD)
+        {
+            position.offload = true;
+        }
+        else if (query_hardware == true)
+        {
+            time_info_struct_t HW_Buf_Time_Info;
+            memset(&HW_Buf_Time_Info, 0, sizeof(HW_Buf_Time_Info));
+            if (mPlaybackHandler->getHardwareBufferInfo(&HW_Buf_Time_Info) == NO_ERROR)
+            {
+                position.queued_frames = HW_Buf_Time_Info.buffer_per_time - HW_Buf_Time_Info.frameInfo_get;
+                position.timestamp = HW_Buf_Time_Info.timestamp_get;
+                position.valid = true;
+            }
+        }
+    }
+
+    // single writer: write() / open() / close() all hold mLock
+    // the odd sequence must be visible before any data store, the data before the even one
+    android_atomic_inc(&mPositionSeq);
+    android_memory_barrier();
+    mPosition = position;
+    android_memory_barrier();
+    android_atomic_inc(&mPositionSeq);
+}
+
+
+void AudioALSAStreamOut::readPresentationPosition(presentation_position_t *position) const
+{
+    int32_t seq_begin = 0;
+    int32_t seq_end = 0;
+    do
+    {
+        seq_begin = android_atomic_acquire_load(&mPositionSeq);
+        *position = mPosition;
+        android_memory_barrier(); // data loads complete before the sequence is read again
+        seq_end = android_atomic_acquire_load(&mPositionSeq);
+    }
+    while ((seq_begin & 1) != 0 || seq_begin != seq_end);
+}
+
+
 status_t AudioALSAStreamOut::standby()
 {
     ALOGD("%s()", __FUNCTION__);
@@ -413,22 +502,9 @@ status_t AudioALSAStreamOut::UpdateSampleRate(int sampleRate)
 
 status_t AudioALSAStreamOut::setParameters(const String8 &keyValuePairs)
 {
-    ALOGD("+%s(): %s", __FUNCTION__, keyValuePairs.string());
+    ALOGV("+%s(): %s", __FUNCTION__, keyValuePairs.string());
     AudioParameter param = AudioParameter(keyValuePairs);
 
-    /// keys
-    const String8 keyRouting = String8(AudioParameter::keyRouting);
-    const String8 keySampleRate = String8(AudioParameter::keySamplingRate);
-    const String8 keyDynamicSampleRate = String8("DynamicSampleRate");
-    const String8 keyLowLatencyMode = String8("LowLatencyMode");
-#ifdef MTK_BASIC_PACKAGE
-    const String8 keyRoutingToNone = String8(AUDIO_PARAMETER_KEY_ROUTING_TO_NONE);
-    const String8 keyFmDirectControl = String8(AUDIO_PARAMETER_KEY_FM_DIRECT_CONTROL);
-#else
-    const String8 keyRoutingToNone = String8(AudioParameter::keyRoutingToNone);
-    const String8 keyFmDirectControl = String8(AudioParameter::keyFmDirectControl);
-#endif
-
     audio_devices_t mydevice = 0;
 
 
@@ -539,7 +615,7 @@ status_t AudioALSAStreamOut::setParameters(const String8 &keyValuePairs)
         status = BAD_VALUE;
     }
 
-    ALOGD("-%s(): %s ", __FUNCTION__, keyValuePairs.string());
+    ALOGV("-%s(): %s ", __FUNCTION__, keyValuePairs.string());
     return status;
 }
 
@@ -577,6 +653,19 @@ String8 AudioALSAStreamOut::getParameters(const String8 &keys)
 
 status_t AudioALSAStreamOut::getRenderPosition(uint32_t *dspFrames)
 {
+    presentation_position_t position;
+    readPresentationPosition(&position);
+    if (position.offload == false)
+    {
+        if (position.valid == false)
+        {
+            *dspFrames = (uint32_t)position.presented_frames;
+            return INVALID_OPERATION;
+        }
+        *dspFrames = (uint32_t)(position.presented_frames - position.queued_frames);
+        return NO_ERROR;
+    }
+
 	if(mPlaybackHandler == NULL)
     {
         ALOGE("%s() handler NULL, frames: %ld", __FUNCTION__, mPresentFrames);
@@ -613,80 +702,62 @@ status_t AudioALSAStreamOut::getRenderPosition(uint32_t *dspFrames)
 status_t AudioALSAStreamOut::getPresentationPosition(uint64_t *frames, struct timespec *timestamp)
 {
     ALOGV("+%s()", __FUNCTION__);
-    AudioAutoTimeoutLock _l(mLock);
 
-    time_info_struct_t HW_Buf_Time_Info;
-    memset(&HW_Buf_Time_Info, 0, sizeof(HW_Buf_Time_Info));
+    // pcm position is published by write(), never wait for the blocking pcm_write
+    presentation_position_t position;
+    readPresentationPosition(&position);
+    if (position.offload == false)
+    {
+        if (position.valid == false)
+        {
+            *frames = position.presented_frames;
+            ALOGV("-%s(), no hardware position, *frames = %llu, return INVALID_OPERATION", __FUNCTION__, *frames);
+            return INVALID_OPERATION;
+        }
 
-    const uint8_t size_per_channel = (mStreamAttributeSource.audio_format == AUDIO_FORMAT_PCM_8_BIT ? 1 :
-                                      (mStreamAttributeSource.audio_format == AUDIO_FORMAT_PCM_16_BIT ? 2 :
-                                       (mStreamAttributeSource.audio_format == AUDIO_FORMAT_PCM_32_BIT ? 4 :
-                                        2)));
-    ALOGV("%s(), size_per_channel = %u, mStreamAttributeSource.num_channels = %d, mStreamAttributeSource.audio_channel_mask = %x,mPresentedBytes = %lu",
-          __FUNCTION__, size_per_channel, mStreamAttributeSource.num_channels, mStreamAttributeSource.audio_channel_mask, mPresentedBytes);
+        *frames = position.presented_frames - position.queued_frames;
+        *timestamp = position.timestamp;
+        ALOGV("-%s(), *frames = %llu", __FUNCTION__, *frames);
+        return NO_ERROR;
+    }
+
+    AudioAutoTimeoutLock _l(mLock);
 
     if (mPlaybackHandler == NULL)
     {
-        *frames = mPresentedBytes / (uint64_t)(mStreamAttributeSource.num_channels * size_per_channel);
+        *frames = mPresentFrames;
         ALOGE("-%s(), no playback handler, *frames = %ld, return", __FUNCTION__, *frames);
         return INVALID_OPERATION;
     }
 
-
-    //query remaining hardware buffer size
-    status_t status = NO_ERROR;
-
-    if(mPlaybackHandler->getPlaybackHandlerType() == PLAYBACK_HANDLER_OFFLOAD)
+    unsigned long codec_io_frame;
+    unsigned int codec_samplerate;
+    unsigned long time;
+    if(NO_ERROR == mPlaybackHandler->get_timeStamp(&codec_io_frame, &codec_samplerate) )
     {
-        unsigned long codec_io_frame;
-        unsigned int codec_samplerate;
-        unsigned long time;
-        if(NO_ERROR == mPlaybackHandler->get_timeStamp(&codec_io_frame, &codec_samplerate) )
+        if(codec_samplerate == 0)
         {
-            if(codec_samplerate == 0)
-            {
-                *frames = 0;
-                timestamp->tv_sec = 0;
-                timestamp->tv_nsec = 0;
-                ALOGE("%s(), Compress Not Ready", __FUNCTION__);
-                return INVALID_OPERATION;
-            }
-            *frames = codec_io_frame;
-            mPresentFrames = codec_io_frame;
-            time = codec_io_frame / codec_samplerate;
-            timestamp->tv_sec = time;
-            time = codec_io_frame % codec_samplerate;
-            timestamp->tv_nsec = time * 1000000000 / codec_samplerate;
-            ALOGV("%s(), get_tstamp done:%ld ", __FUNCTION__, *frames);
-        }
-        else
-        {
-            *frames = mPresentFrames;
-            ALOGD("%s(), get_tstamp fail, frames:%ld", __FUNCTION__, mPresentFrames);
+            *frames = 0;
+            timestamp->tv_sec = 0;
+            timestamp->tv_nsec = 0;
+            ALOGE("%s(), Compress Not Ready", __FUNCTION__);
             return INVALID_OPERATION;
         }
+        *frames = codec_io_frame;
+        mPresentFrames = codec_io_frame;
+        time = codec_io_frame / codec_samplerate;
+        timestamp->tv_sec = time;
+        time = codec_io_frame % codec_samplerate;
+        timestamp->tv_nsec = time * 1000000000 / codec_samplerate;
+        ALOGV("%s(), get_tstamp done:%ld ", __FUNCTION__, *frames);
     }
     else
     {
-
-        if (mPlaybackHandler->getHardwareBufferInfo(&HW_Buf_Time_Info) != NO_ERROR)
-        {
-            *frames = mPresentedBytes / (uint64_t)(mStreamAttributeSource.num_channels * size_per_channel);
-            status = INVALID_OPERATION;
-
-            ALOGV("-%s(), getHardwareBufferInfo fail, *frames = %ld, return INVALID_OPERATION", __FUNCTION__, *frames);
-        }
-        else
-        {
-            uint64_t PresentedFrames = mPresentedBytes / (uint64_t)(mStreamAttributeSource.num_channels * size_per_channel);
-            *frames = (uint64_t)PresentedFrames - (uint64_t)(HW_Buf_Time_Info.buffer_per_time - HW_Buf_Time_Info.frameInfo_get);
-            *timestamp = HW_Buf_Time_Info.timestamp_get;
-            status = NO_ERROR;
-
-            ALOGV("-%s(), *frames = %ld", __FUNCTION__, *frames);
-        }
+        *frames = mPresentFrames;
+        ALOGD("%s(), get_tstamp fail, frames:%ld", __FUNCTION__, mPresentFrames);
+        return INVALID_OPERATION;
     }
-    return status;
+    return NO_ERROR;
 }
 
 status_t AudioALSAStreamOut::getNextWriteTimestamp(int64_t *timestamp)
@@ -746,6 +817,8 @@ status_t AudioALSAStreamOut::open()
 
 
         OpenPCMDump(LOG_TAG);
+
+        updatePresentationPosition(false);
     }
 
     return status;
@@ -787,6 +860,8 @@ status_t AudioALSAStreamOut::close()
         mStreamManager->destroyPlaybackHandler(mPlaybackHandler);
         mPlaybackHandler = NULL;
         AudioALSASampleRateController::getInstance()->resetScenarioStatus(PLAYBACK_SCENARIO_STREAM_OUT);
+
+        updatePresentationPosition(false);
     }
 
     ASSERT(mPlaybackHandler == NULL);